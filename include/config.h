@@ -12,6 +12,7 @@
 
 #define MAX_WALLPAPER_DIRS 10
 #define MAX_MONITORS 8
+#define MAX_EXCLUDES 16
 #define MAX_COMMAND 512
 
 /**
@@ -21,6 +22,12 @@ typedef struct {
     char wallpaper_dir[MAX_PATH];              /**< Primary directory containing wallpapers */
     char wallpaper_dirs[MAX_WALLPAPER_DIRS][MAX_PATH]; /**< Multiple wallpaper directories */
     int wallpaper_dirs_count;                  /**< Number of configured directories */
+    bool recursive;                            /**< Also list images in subdirectories */
+    int max_depth;                             /**< Subdirectory levels to enter (0 = unlimited) */
+    char excludes[MAX_EXCLUDES][MAX_PATH];     /**< Glob patterns of files and directories to skip */
+    int excludes_count;                        /**< Number of exclude patterns */
+    bool search_index;                         /**< Search paths below the wallpaper directories via a trigram index */
+    char search_mode[12];                      /**< Query matching: "substring" or "fuzzy" */
     char feh_command[MAX_PATH];                /**< Command to set wallpaper */
     char palette_script[MAX_PATH];             /**< Script to generate color palette */
     
@@ -40,7 +47,13 @@ typedef struct {
     int window_width;                          /**< Window width */
     int window_height;                         /**< Window height */
     bool use_shaders;                          /**< Enable shader rendering */
+    bool frosted_background;                   /**< Blur the selected wallpaper behind the carousel (shaders only) */
     int thumbnails_per_row;                    /**< Number of thumbnails per row */
+    int texture_cache_mb;                      /**< VRAM budget for cached thumbnail textures */
+    int thumbnail_threads;                     /**< Worker threads per thumbnail stage (0 = one per CPU) */
+    char thumbnail_cache_format[8];            /**< Cache codec: "raw", "qoi", "lz4" or "png" */
+    char thumbnail_filter[8];                  /**< Downscaling filter: "box" or "lanczos" */
+    int thumbnail_memory_mb;                   /**< RAM budget for loaded thumbnails (0 = unlimited) */
     
     char audio_dir[MAX_PATH];                  /**< Directory containing audio files for roulette */
     
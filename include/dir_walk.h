@@ -0,0 +1,58 @@
+/**
+ * @file dir_walk.h
+ * @brief Parallel directory tree listing
+ *
+ * Lists the files under several root directories at once using a pool of
+ * worker threads fed from per-device queues, so a slow network mount does
+ * not hold up a local disk. Directories are read with getdents64() on Linux
+ * and classified by d_type; only symlinks, filesystems that do not report a
+ * type, and the files that are kept are stat()ed.
+ */
+
+#ifndef DIR_WALK_H
+#define DIR_WALK_H
+
+#include <stdbool.h>
+#include "scan_index.h"
+
+/**
+ * @brief What to list
+ */
+typedef struct {
+    bool recursive;                  /**< Descend into subdirectories */
+    int max_depth;                   /**< Levels below a root to enter, 0 for unlimited */
+    const char *const *excludes;     /**< Globs matched against names and root-relative paths */
+    int exclude_count;               /**< Number of exclude globs */
+    const char *exclude_prefix;      /**< Path of the roots within a larger tree, for excludes; may be NULL */
+    bool (*accept)(const char *name);/**< Files to keep, by name; NULL keeps all */
+    int threads;                     /**< Worker threads, 0 for the default */
+    bool (*cancelled)(void *data);   /**< Polled between directories to stop early; may be NULL */
+    void *cancel_data;               /**< Passed to cancelled */
+} DirWalkOptions;
+
+/**
+ * @brief List several directory trees
+ *
+ * Symlinks to files and directories are followed; a directory reached
+ * twice under one root (through a symlink loop or a bind mount) is only
+ * listed once. Subdirectories are recorded with their mtime so the listing
+ * can later be checked for changes without reading it again.
+ *
+ * @param roots Root directories
+ * @param root_count Number of roots
+ * @param options What to list
+ * @param scans Receives one sorted listing per root, names relative to the root
+ * @param opened Receives, per root, whether it could be opened (may be NULL)
+ */
+void dir_walk(const char *const *roots, int root_count, const DirWalkOptions *options,
+              ScanDirectory *scans, bool *opened);
+
+/**
+ * @brief Whether an entry matches one of the exclude globs
+ * @param options Options holding the globs
+ * @param name Entry name
+ * @param rel Entry path relative to its root
+ */
+bool dir_walk_excluded(const DirWalkOptions *options, const char *name, const char *rel);
+
+#endif /* DIR_WALK_H */
@@ -0,0 +1,67 @@
+/**
+ * @file favorites.h
+ * @brief Journaled store of favorite wallpaper paths
+ *
+ * Favorites are held in memory in a hash set of paths. On disk they are a
+ * base file, one path per line, plus a journal of changes since it was
+ * written ("+path" or "-path" per line). A toggle only appends one journal
+ * line, and that is done by a writer thread, so callers never wait on the
+ * disk. The writer folds the journal back into the base file once it grows
+ * past a limit, and again when the store is closed.
+ *
+ * Favorites whose files are missing (an unmounted directory, say) are kept,
+ * so they come back with their files.
+ */
+
+#ifndef FAVORITES_H
+#define FAVORITES_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#define FAVORITES_COMPACT_AFTER 1024  /**< Journal lines that trigger a rewrite of the base file */
+
+/**
+ * @brief Opaque favorites store
+ */
+typedef struct FavoritesStore FavoritesStore;
+
+/**
+ * @brief Load favorites and start the writer
+ * @param path Base file; the journal is the same path with ".journal" added
+ * @param compact_after Journal lines that trigger compaction, 0 for the default
+ * @return Store, or NULL if out of memory (missing files just mean no favorites)
+ */
+FavoritesStore* favorites_open(const char *path, int compact_after);
+
+/**
+ * @brief Write out pending changes, compact, stop the writer and free the store
+ */
+void favorites_close(FavoritesStore *store);
+
+/**
+ * @brief Whether a wallpaper is a favorite
+ * @param dir Directory of the wallpaper, without a trailing slash
+ * @param dir_len Length of dir
+ * @param name File name within dir
+ */
+bool favorites_contains(const FavoritesStore *store, const char *dir, size_t dir_len, const char *name);
+
+/**
+ * @brief Mark or unmark a favorite
+ *
+ * Updates the set at once and queues the journal line for the writer.
+ */
+void favorites_set(FavoritesStore *store, const char *dir, size_t dir_len, const char *name, bool favorite);
+
+/**
+ * @brief Number of favorites
+ */
+int favorites_count(const FavoritesStore *store);
+
+/**
+ * @brief Wait until every change made so far is on disk
+ */
+void favorites_flush(FavoritesStore *store);
+
+#endif /* FAVORITES_H */
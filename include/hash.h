@@ -0,0 +1,70 @@
+/**
+ * @file hash.h
+ * @brief Fast non-cryptographic hashing
+ *
+ * Implements XXH64 (xxHash, 64-bit variant). Output matches the reference
+ * implementation, so hashes stored on disk stay valid across builds and
+ * platforms. MD5 is only kept to locate cache files written by older
+ * versions.
+ */
+
+#ifndef HASH_H
+#define HASH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Incremental XXH64 state
+ */
+typedef struct {
+    uint64_t total_len;   /**< Bytes consumed so far */
+    uint64_t v[4];        /**< Accumulator lanes */
+    uint8_t buffer[32];   /**< Bytes not yet forming a full stripe */
+    uint32_t buffered;    /**< Valid bytes in buffer */
+    uint64_t seed;        /**< Seed the state was reset with */
+} HashState;
+
+/**
+ * @brief Hash a buffer in one call
+ * @param data Input bytes
+ * @param len Input length
+ * @param seed Hash seed
+ * @return XXH64 digest
+ */
+uint64_t hash_xxh64(const void *data, size_t len, uint64_t seed);
+
+/**
+ * @brief Start an incremental hash
+ * @param state State to initialize
+ * @param seed Hash seed
+ */
+void hash_reset(HashState *state, uint64_t seed);
+
+/**
+ * @brief Feed more input into an incremental hash
+ * @param state Hash state
+ * @param data Input bytes
+ * @param len Input length
+ */
+void hash_update(HashState *state, const void *data, size_t len);
+
+/**
+ * @brief Finish an incremental hash
+ *
+ * The state is left untouched, so more input may still be added.
+ *
+ * @param state Hash state
+ * @return XXH64 digest of everything fed so far
+ */
+uint64_t hash_digest(const HashState *state);
+
+/**
+ * @brief MD5 digest of a buffer
+ * @param data Input bytes
+ * @param len Input length
+ * @param digest Receives the 16-byte digest
+ */
+void hash_md5(const void *data, size_t len, uint8_t digest[16]);
+
+#endif /* HASH_H */
@@ -0,0 +1,79 @@
+/**
+ * @file library_watch.h
+ * @brief Live updates of the wallpaper directories
+ *
+ * Watches the configured directories (and, when scanning recursively, their
+ * subdirectories) with inotify on a background thread. Files that appear,
+ * change or disappear are queued as LibraryChange records and announced with
+ * a library_watch_event(), so the main loop can apply them to its list
+ * without scanning the directories again. Without inotify no watcher is
+ * started and the list only changes on restart.
+ */
+
+#ifndef LIBRARY_WATCH_H
+#define LIBRARY_WATCH_H
+
+#include <SDL3/SDL.h>
+#include <stdbool.h>
+#include "config.h"
+#include "thumbnail_atlas.h"
+
+/**
+ * @brief Opaque watcher handle
+ */
+typedef struct LibraryWatch LibraryWatch;
+
+/**
+ * @brief What happened to a path
+ */
+typedef enum {
+    LIBRARY_CHANGE_ADDED,       /**< File created, moved in or rewritten */
+    LIBRARY_CHANGE_REMOVED,     /**< File deleted or moved out */
+    LIBRARY_CHANGE_REMOVED_DIR, /**< Directory deleted or moved out, with everything in it */
+    LIBRARY_CHANGE_RESCAN       /**< Events were lost; only a full rescan is reliable */
+} LibraryChangeKind;
+
+/**
+ * @brief One change to a wallpaper directory
+ */
+typedef struct {
+    LibraryChangeKind kind;     /**< What happened */
+    int dir;                    /**< Directory: 0 for wallpaper_dir, then wallpaper_dirs in order */
+    char *rel;                  /**< Path relative to the directory, "" for the directory itself */
+    ThumbnailStamp stamp;       /**< Identity of an added file */
+} LibraryChange;
+
+/**
+ * @brief Start watching the configured directories
+ * @param config Configuration (directories, recursion and excludes; copied)
+ * @return Watcher, or NULL if inotify is unavailable or the thread could not start
+ */
+LibraryWatch* library_watch_start(const Config *config);
+
+/**
+ * @brief SDL event type pushed when changes are waiting
+ *
+ * Pushed once per batch; collect the batch with library_watch_take().
+ */
+Uint32 library_watch_event(void);
+
+/**
+ * @brief Take every change queued so far, oldest first
+ * @param watch Watcher
+ * @param count Receives the number of changes
+ * @return Changes (free with library_watch_free_changes()), NULL if none
+ */
+LibraryChange* library_watch_take(LibraryWatch *watch, int *count);
+
+/**
+ * @brief Free changes returned by library_watch_take()
+ */
+void library_watch_free_changes(LibraryChange *changes, int count);
+
+/**
+ * @brief Stop the watcher thread and free it
+ * @param watch Watcher, may be NULL
+ */
+void library_watch_stop(LibraryWatch *watch);
+
+#endif /* LIBRARY_WATCH_H */
@@ -18,6 +18,17 @@ typedef enum {
     VIEW_MODE_GRID           /**< Grid layout view */
 } ViewMode;
 
+/**
+ * @brief Cached GPU texture for one wallpaper thumbnail
+ */
+typedef struct {
+    SDL_Texture *texture;     /**< Uploaded texture, NULL if not resident */
+    uint64_t generation;      /**< Thumbnail generation the texture was uploaded from */
+    size_t bytes;             /**< Estimated VRAM footprint of the texture */
+    int lru_prev;             /**< More recently used neighbour (-1 if head) */
+    int lru_next;             /**< Less recently used neighbour (-1 if tail) */
+} TextureCacheEntry;
+
 /**
  * @brief Renderer state
  */
@@ -34,6 +45,14 @@ typedef struct {
     float current_scroll_y;   /**< Current vertical scroll */
     bool search_mode;         /**< Whether in search mode */
     bool show_help;           /**< Whether to show help overlay */
+
+    // Thumbnail texture cache, keyed by wallpaper index
+    TextureCacheEntry *tex_cache; /**< Per-wallpaper texture slots */
+    int tex_cache_capacity;   /**< Number of allocated slots */
+    size_t tex_cache_bytes;   /**< Bytes currently resident in VRAM */
+    size_t tex_cache_budget;  /**< Maximum resident bytes before eviction */
+    int tex_lru_head;         /**< Most recently used slot (-1 if empty) */
+    int tex_lru_tail;         /**< Least recently used slot (-1 if empty) */
 } Renderer;
 
 /**
@@ -51,6 +70,17 @@ Renderer* renderer_init(const Config *config);
  */
 void renderer_draw_frame(Renderer *r, const WallpaperList *list, const Config *config);
 
+/**
+ * @brief Display indices that are on screen, or will be during the current scroll
+ *
+ * @param r Renderer state
+ * @param config Configuration
+ * @param count Number of displayed wallpapers
+ * @param first Receives the first visible display index
+ * @param last Receives one past the last visible display index
+ */
+void renderer_visible_range(const Renderer *r, const Config *config, int count, int *first, int *last);
+
 /**
  * @brief Move selection left
  * @param r Renderer state
@@ -0,0 +1,105 @@
+/**
+ * @file scan_index.h
+ * @brief Persisted directory listings for fast startup
+ *
+ * A scan index stores the image files found under one wallpaper directory,
+ * with their stat() identity, together with the mtime of the directory and
+ * of every subdirectory that was entered. Adding, removing or renaming a
+ * file changes its directory's mtime, so while none has changed the listing
+ * can be taken from the index instead of reading the directories, which is
+ * slow on network mounts. A trigram index of the file paths can be stored
+ * alongside, so searching needs no index build at startup either.
+ */
+
+#ifndef SCAN_INDEX_H
+#define SCAN_INDEX_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "thumbnail_atlas.h"
+#include "trigram.h"
+
+/**
+ * @brief One image file in a directory
+ */
+typedef struct {
+    char *name;               /**< Path relative to the scanned directory */
+    ThumbnailStamp stamp;     /**< Identity of the file when it was listed */
+} ScanEntry;
+
+/**
+ * @brief A subdirectory that was listed
+ */
+typedef struct {
+    char *name;               /**< Path relative to the scanned directory */
+    int64_t mtime_ns;         /**< Its mtime in nanoseconds when listed */
+    uint64_t inode;           /**< Its inode */
+} ScanSubdir;
+
+/**
+ * @brief Listing of one directory tree
+ */
+typedef struct {
+    ScanEntry *entries;       /**< Files, sorted by name */
+    int count;                /**< Number of entries */
+    int capacity;             /**< Allocated entries */
+    ScanSubdir *subdirs;      /**< Subdirectories entered, sorted by name */
+    int subdir_count;         /**< Number of subdirectories */
+    int subdir_capacity;      /**< Allocated subdirectories */
+    int64_t dir_mtime_ns;     /**< Directory mtime in nanoseconds, 0 if not to be trusted */
+    uint64_t dir_inode;       /**< Directory inode */
+    uint64_t options_hash;    /**< Identifies the scan options (recursion, excludes) used */
+    TrigramIndex trigrams;    /**< Trigrams of the entry names, numbered by entry; empty if not built */
+} ScanDirectory;
+
+/**
+ * @brief Start an empty listing
+ */
+void scan_directory_init(ScanDirectory *scan);
+
+/**
+ * @brief Append a file (name is copied)
+ * @return false if out of memory
+ */
+bool scan_directory_add(ScanDirectory *scan, const char *name, const ThumbnailStamp *stamp);
+
+/**
+ * @brief Record a subdirectory that was entered (name is copied)
+ * @return false if out of memory
+ */
+bool scan_directory_add_subdir(ScanDirectory *scan, const char *name, int64_t mtime_ns, uint64_t inode);
+
+/**
+ * @brief Sort entries and subdirectories by name so listings compare and display consistently
+ */
+void scan_directory_sort(ScanDirectory *scan);
+
+/**
+ * @brief Whether two sorted listings hold the same files with the same stamps
+ *
+ * Only files are compared; directory mtimes are not.
+ */
+bool scan_directory_equal(const ScanDirectory *a, const ScanDirectory *b);
+
+/**
+ * @brief Free a listing's entries and trigrams and reset it to empty
+ */
+void scan_directory_free(ScanDirectory *scan);
+
+/**
+ * @brief Read a listing saved by scan_index_save()
+ * @param path Index file path
+ * @param scan Receives the listing (initialised by this call)
+ * @return false if the file is missing, from another version or damaged
+ */
+bool scan_index_load(const char *path, ScanDirectory *scan);
+
+/**
+ * @brief Save a listing, replacing the index file atomically
+ * @param path Index file path
+ * @param scan Listing to save
+ * @return true on success
+ */
+bool scan_index_save(const char *path, const ScanDirectory *scan);
+
+#endif /* SCAN_INDEX_H */
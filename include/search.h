@@ -0,0 +1,172 @@
+/**
+ * @file search.h
+ * @brief Incremental substring search over wallpaper names
+ *
+ * Names are case folded once into a contiguous arena, so a query from
+ * scratch is a single pass over it. Results are kept for every query on
+ * the way to the current one: typing a character refines the previous
+ * results, and backspace returns the cached results of the shorter query
+ * without searching again. Matching is ASCII case-insensitive, like
+ * strcasestr() in the C locale.
+ *
+ * With trigrams enabled, queries of three or more characters take their
+ * candidates from a trigram index instead of passing over every name,
+ * which keeps long texts such as paths fast to search.
+ *
+ * In fuzzy mode a name matches if it holds the query's characters in
+ * order, scored like fzf: consecutive characters and ones starting a word
+ * score higher, gaps cost. Results come back best first.
+ */
+
+#ifndef SEARCH_H
+#define SEARCH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "trigram.h"
+
+#define SEARCH_MAX_QUERY 256
+
+/**
+ * @brief How queries match
+ */
+typedef enum {
+    SEARCH_SUBSTRING,     /**< Names containing the query, in list order */
+    SEARCH_FUZZY,         /**< Names holding the query's characters in order, best first */
+    SEARCH_MODE_COUNT
+} SearchMode;
+
+/**
+ * @brief Results of one query
+ */
+typedef struct {
+    size_t length;        /**< Length of the query these results are for */
+    int *matches;         /**< Matching name indices, ascending or by rank */
+    int count;            /**< Number of matches */
+} SearchLevel;
+
+/**
+ * @brief Search state for one list of names
+ */
+typedef struct {
+    char *folded;         /**< Lowercased names, NUL-separated, in index order */
+    size_t folded_size;   /**< Bytes used in folded */
+    size_t folded_capacity; /**< Bytes allocated for folded */
+    uint32_t *offsets;    /**< Start of each name in folded */
+    uint64_t *masks;      /**< Characters present in each name, see search_char_mask() */
+    int count;            /**< Names indexed */
+    int capacity;         /**< Names allocated */
+    bool valid;           /**< Index matches the names; cleared by search_invalidate() */
+    SearchMode mode;      /**< How queries match */
+    uint16_t *scores;     /**< Fuzzy score of each name, for those in the latest ranking */
+    
+    TrigramIndex trigrams; /**< Trigrams of the names, if enabled */
+    int trigram_count;    /**< Names the trigrams cover; -1 if not built */
+    bool use_trigrams;    /**< Serve long queries from the trigrams */
+
+    char query[SEARCH_MAX_QUERY]; /**< Longest query with cached results (folded) */
+    SearchLevel levels[SEARCH_MAX_QUERY]; /**< Results per prefix of query, shortest first */
+    int level_count;      /**< Cached levels */
+} SearchEngine;
+
+/**
+ * @brief Text of one item to search
+ * @param data Caller's data
+ * @param index Item
+ * @param buffer Scratch space for texts that have to be composed
+ * @param size Size of buffer
+ * @return The text, in buffer or elsewhere
+ */
+typedef const char* (*SearchText)(const void *data, int index, char *buffer, size_t size);
+
+/**
+ * @brief Initialize an empty engine
+ */
+void search_init(SearchEngine *engine);
+
+/**
+ * @brief Free an engine's memory
+ */
+void search_free(SearchEngine *engine);
+
+/**
+ * @brief Forget the index and cached results after the names changed
+ *
+ * The index is rebuilt by the next search_query().
+ */
+void search_invalidate(SearchEngine *engine);
+
+/**
+ * @brief Look up a search mode by name ("substring" or "fuzzy")
+ * @return false if the name is unknown
+ */
+bool search_mode_parse(const char *name, SearchMode *mode);
+
+/**
+ * @brief Name of a search mode
+ */
+const char* search_mode_name(SearchMode mode);
+
+/**
+ * @brief Switch how queries match, forgetting cached results
+ */
+void search_set_mode(SearchEngine *engine, SearchMode mode);
+
+/**
+ * @brief Enable or disable the trigram index
+ *
+ * Trigrams are built by the next search_query() unless adopted first.
+ */
+void search_use_trigrams(SearchEngine *engine, bool enable);
+
+/**
+ * @brief Take a trigram index of the current texts built elsewhere
+ * @param engine Engine, with trigrams enabled
+ * @param trigrams Index covering count texts; emptied, the engine owns its memory
+ * @param count Number of texts it covers
+ */
+void search_adopt_trigrams(SearchEngine *engine, TrigramIndex *trigrams, int count);
+
+/**
+ * @brief Set of characters in a string, one bit per class
+ *
+ * A string can only contain another if its mask covers the other's mask.
+ *
+ * @param s String
+ * @param len Length of s
+ * @return Mask of case-folded characters
+ */
+uint64_t search_char_mask(const char *s, size_t len);
+
+/**
+ * @brief Fuzzy score of a text for a query, both already case folded
+ *
+ * The tightest span holding the query's characters in order is scored:
+ * each matched character earns points, more at the start of a word
+ * (most at the start of the text or after a space, then after '/', then
+ * after '_', '-' or '.'; doubled for the query's first character) and when
+ * it follows the previous match; skipped characters inside the span cost
+ * a little.
+ *
+ * @return Score, at least 0; -1 if the text does not match
+ */
+int search_fuzzy_score(const char *text, size_t len, const char *query, size_t query_len);
+
+/**
+ * @brief Texts matching a query, ignoring ASCII case
+ *
+ * @param engine Engine
+ * @param text Gives each text; only called while (re)building the index
+ * @param data Passed to text
+ * @param count Number of texts
+ * @param query Query, non-empty
+ * @param result_count Receives the number of matches
+ * @return Matching indices, ascending for substring search and best first
+ *         (equal scores in list order) for fuzzy search; valid until the
+ *         next call
+ */
+const int* search_query(SearchEngine *engine, SearchText text, const void *data, int count,
+                        const char *query, int *result_count);
+
+#endif /* SEARCH_H */
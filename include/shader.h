@@ -15,6 +15,56 @@
 #include "thumbnails.h"
 #include "wallpaper.h"
 
+/**
+ * @brief One layer of the thumbnail texture array
+ */
+typedef struct {
+    uint64_t generation;     /**< Thumbnail generation uploaded into the layer, 0 if free */
+    int wallpaper;           /**< Wallpaper it was uploaded for, -1 if free */
+    unsigned drawn_frame;    /**< Last frame that drew it, which must not overwrite it */
+    int lru_prev;            /**< More recently used layer (-1 if head) */
+    int lru_next;            /**< Less recently used layer (-1 if tail) */
+} GLThumbLayer;
+
+/**
+ * @brief Per-instance attributes of one quad in the carousel draw
+ */
+typedef struct {
+    float quad[4];           /**< Drawn rectangle: x, y, width, height (glow margin included) */
+    float thumbnail[4];      /**< Thumbnail rectangle within it, for corners and glow */
+    float color[4];          /**< Average colour for the glow, then the selection weight */
+    float params[4];         /**< Rotation, texture layer, background flag, frosted flag */
+    float uv_scale[2];       /**< Part of the layer the thumbnail fills */
+} GLInstance;
+
+/**
+ * @brief Constants shared by every draw in a frame
+ *
+ * Mirrors the std140 FrameConstants block the shaders declare, so the
+ * whole struct is uploaded into the uniform buffer as it is.
+ */
+typedef struct {
+    float projection[16];    /**< Orthographic projection, column-major */
+    float window_size[2];    /**< Window size in pixels */
+    float time;              /**< Seconds since the renderer started */
+    float corner_radius;     /**< Corner radius of thumbnails and window */
+    float tilt_x;            /**< Carousel tilt in 3D mode */
+    float depth_3d;          /**< Depth offset in 3D mode */
+    float is_3d;             /**< 1 for the 3D transform, 0 for flat */
+    float padding;           /**< std140 rounds the block up to 16 bytes */
+} GLFrameConstants;
+
+/**
+ * @brief Uniforms of the shader programs, looked up once after linking
+ */
+typedef struct {
+    GLint thumbnails;        /**< sampler2DArray of thumbnail layers */
+    GLint background;        /**< sampler2D of the blurred background */
+    GLuint frame_block;      /**< Index of the FrameConstants block */
+    GLint blur_source;       /**< Blur program: texture being blurred */
+    GLint blur_direction;    /**< Blur program: one texel along the pass axis */
+} GLUniformLocations;
+
 /**
  * @brief OpenGL renderer state
  */
@@ -22,10 +72,42 @@ typedef struct {
     SDL_Window *window;
     SDL_GLContext gl_context;
     GLuint shader_program;
+    GLUniformLocations uniforms;
+    GLuint frame_ubo;             // GLFrameConstants, written once per frame
     GLuint vao;
     GLuint vbo;
     GLuint ebo;
     
+    // Thumbnails stay resident in layers of one texture array and are only
+    // uploaded when they first arrive; layer 0 is the loading placeholder
+    GLuint thumb_array;
+    GLuint copy_fbo;              // Reads the old layers when the array grows
+    int layer_width;
+    int layer_height;
+    int layer_count;              // Layers allocated
+    int layer_limit;              // Layers the texture_cache_mb budget allows
+    GLThumbLayer *layers;
+    int *wallpaper_layers;        // Layer of each wallpaper, 0 if not resident; a hint, checked by generation
+    int wallpaper_capacity;
+    int lru_head;                 // Most recently drawn layer (-1 if none)
+    int lru_tail;                 // Least recently drawn layer (-1 if none)
+    unsigned frame;               // Frames drawn so far
+    
+    // Frosted background: the selected thumbnail downsampled and blurred
+    // into blur_textures[0], redone only when the selection changes
+    GLuint blur_program;          // 0 if the frosted background is off
+    GLuint blur_vao;
+    GLuint blur_fbo;
+    GLuint blur_textures[2];      // Result, and the horizontal pass in between
+    int blur_width;
+    int blur_height;
+    uint64_t blur_generation;     // Thumbnail generation in blur_textures[0] (0 if none)
+    
+    // The whole carousel is one instanced draw of these
+    GLuint instance_vbo;
+    GLInstance *instances;
+    int instance_capacity;
+    
     // Selection and scroll state (matching regular Renderer)
     int selected_index;
     int scroll_offset;
@@ -46,6 +128,17 @@ typedef struct {
  */
 GLRenderer* gl_renderer_init(const Config *config);
 
+/**
+ * @brief Display indices the carousel shows now or while easing to the selection
+ *
+ * @param r GL renderer
+ * @param config Configuration
+ * @param count Number of displayed wallpapers
+ * @param first Receives the first visible display index
+ * @param last Receives one past the last visible display index
+ */
+void gl_renderer_visible_range(const GLRenderer *r, const Config *config, int count, int *first, int *last);
+
 /**
  * @brief Render frame with OpenGL
  * @param r GL renderer
@@ -0,0 +1,119 @@
+/**
+ * @file thumbnail_atlas.h
+ * @brief Packed, memory-mapped thumbnail cache file
+ *
+ * All thumbnails of one size live in a single file made of fixed-size chunks.
+ * Each chunk starts with an index of entries followed by the same number of
+ * fixed-stride slots, each big enough for width*height*4 bytes. The file is
+ * mapped into memory chunk by chunk, so a cache hit is a hash lookup
+ * returning a pointer straight into the mapping: no open() or stat() per
+ * thumbnail. Slot contents are opaque to the atlas; each entry carries a
+ * codec tag and length for the caller (see thumbnail_codec.h), plus a few
+ * bytes of caller info (the thumbnail's colours, see thumbnail_palette.h).
+ *
+ * Every entry also records the size, modification time and inode of the
+ * source file it was made from, so a wallpaper edited or replaced in place
+ * misses the cache and is regenerated on its own. Several keys can share one
+ * thumbnail through aliases without storing the pixels twice.
+ *
+ * The atlas is safe to use from several threads at once.
+ */
+
+#ifndef THUMBNAIL_ATLAS_H
+#define THUMBNAIL_ATLAS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define THUMBNAIL_ATLAS_KEY_SIZE 16
+#define THUMBNAIL_ATLAS_INFO_SIZE 16
+
+/**
+ * @brief Identity of a thumbnail's source file, as reported by stat()
+ */
+typedef struct {
+    int64_t mtime;        /**< Modification time in seconds */
+    int64_t size;         /**< File size in bytes */
+    uint64_t inode;       /**< Inode number */
+} ThumbnailStamp;
+
+/**
+ * @brief Opaque atlas handle
+ */
+typedef struct ThumbnailAtlas ThumbnailAtlas;
+
+/**
+ * @brief Open (or create) an atlas file
+ *
+ * A file written for a different thumbnail size or format version is
+ * discarded and recreated. If another process holds the file the atlas is
+ * opened read-only and thumbnail_atlas_store() always fails. Otherwise, if
+ * replaced entries have come to outnumber live ones, the live entries are
+ * first copied into a new file that takes the old one's place.
+ *
+ * @param path Atlas file path
+ * @param width Thumbnail width in pixels
+ * @param height Thumbnail height in pixels
+ * @return Atlas, or NULL on error
+ */
+ThumbnailAtlas* thumbnail_atlas_open(const char *path, int width, int height);
+
+/**
+ * @brief Unmap and close an atlas
+ *
+ * Pixel pointers returned by thumbnail_atlas_lookup() become invalid.
+ *
+ * @param atlas Atlas
+ */
+void thumbnail_atlas_close(ThumbnailAtlas *atlas);
+
+/**
+ * @brief Find a thumbnail
+ * @param atlas Atlas
+ * @param key Cache key
+ * @param stamp Current identity of the source file, or NULL to accept any
+ * @param codec Receives the entry's codec tag (may be NULL)
+ * @param length Receives the entry's data length (may be NULL)
+ * @param info Receives the entry's THUMBNAIL_ATLAS_INFO_SIZE info bytes (may be NULL)
+ * @return Pointer to the entry's data, valid until the atlas is closed, or
+ *         NULL on miss or if the entry is stale
+ */
+const void* thumbnail_atlas_lookup(ThumbnailAtlas *atlas, const uint8_t key[THUMBNAIL_ATLAS_KEY_SIZE],
+                                   const ThumbnailStamp *stamp, uint32_t *codec, size_t *length,
+                                   void *info);
+
+/**
+ * @brief Add a thumbnail, replacing any previous one with the same key
+ * @param atlas Atlas
+ * @param key Cache key
+ * @param stamp Identity of the source file the thumbnail was made from
+ * @param codec Codec tag stored with the data
+ * @param data Encoded thumbnail
+ * @param length Data length, at most width*height*4
+ * @param info THUMBNAIL_ATLAS_INFO_SIZE bytes kept with the entry, or NULL for zeros
+ * @return true on success
+ */
+bool thumbnail_atlas_store(ThumbnailAtlas *atlas, const uint8_t key[THUMBNAIL_ATLAS_KEY_SIZE],
+                           const ThumbnailStamp *stamp, uint32_t codec, const void *data, size_t length,
+                           const void *info);
+
+/**
+ * @brief Add a key that shares the pixels (and info) of an existing entry
+ * @param atlas Atlas
+ * @param key New cache key, replacing any previous entry with that key
+ * @param stamp Identity of the source file the new key refers to
+ * @param target Key of the entry whose pixels to share
+ * @return true on success, false if target is not in the atlas
+ */
+bool thumbnail_atlas_alias(ThumbnailAtlas *atlas, const uint8_t key[THUMBNAIL_ATLAS_KEY_SIZE],
+                           const ThumbnailStamp *stamp, const uint8_t target[THUMBNAIL_ATLAS_KEY_SIZE]);
+
+/**
+ * @brief Number of keys in the atlas, aliases included
+ * @param atlas Atlas
+ * @return Entry count
+ */
+int thumbnail_atlas_count(ThumbnailAtlas *atlas);
+
+#endif /* THUMBNAIL_ATLAS_H */
@@ -0,0 +1,88 @@
+/**
+ * @file thumbnail_codec.h
+ * @brief Encoders and decoders for cached thumbnail pixels
+ *
+ * Thumbnails only ever live in vista's own cache, so the codecs here trade
+ * compression ratio for speed: raw slots are used in place with no decode at
+ * all, QOI and LZ4 shrink the cache file at a small per-hit cost. PNG is kept
+ * for compatibility and is encoded through SDL by thumbnails.c rather than
+ * here.
+ *
+ * Pixels are always 4 bytes each in R, G, B, A byte order
+ * (SDL_PIXELFORMAT_RGBA32).
+ */
+
+#ifndef THUMBNAIL_CODEC_H
+#define THUMBNAIL_CODEC_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Cache codecs (values are stored on disk, never renumber)
+ */
+typedef enum {
+    THUMBNAIL_CODEC_RAW = 0,   /**< Uncompressed pixels, used in place */
+    THUMBNAIL_CODEC_QOI = 1,   /**< "Quite OK Image" format */
+    THUMBNAIL_CODEC_LZ4 = 2,   /**< LZ4 block compression of the raw pixels */
+    THUMBNAIL_CODEC_PNG = 3,   /**< PNG, encoded via SDL */
+    THUMBNAIL_CODEC_COUNT
+} ThumbnailCodec;
+
+/**
+ * @brief Look up a codec by its config name ("raw", "qoi", "lz4", "png")
+ * @param name Codec name
+ * @param codec Receives the codec
+ * @return false if the name is unknown
+ */
+bool thumbnail_codec_parse(const char *name, ThumbnailCodec *codec);
+
+/**
+ * @brief Config name of a codec
+ * @param codec Codec
+ * @return Static name string
+ */
+const char* thumbnail_codec_name(ThumbnailCodec codec);
+
+/**
+ * @brief Worst-case encoded size of an image
+ * @param codec Codec (not PNG)
+ * @param width Image width
+ * @param height Image height
+ * @return Output buffer size that always suffices
+ */
+size_t thumbnail_codec_bound(ThumbnailCodec codec, int width, int height);
+
+/**
+ * @brief Encode an image
+ * @param codec Codec (not PNG)
+ * @param pixels Source pixels
+ * @param width Image width
+ * @param height Image height
+ * @param pitch Source row length in bytes
+ * @param out Output buffer
+ * @param capacity Output buffer size
+ * @return Encoded length, or 0 if the output did not fit
+ */
+size_t thumbnail_codec_encode(ThumbnailCodec codec, const uint8_t *pixels, int width, int height,
+                              int pitch, uint8_t *out, size_t capacity);
+
+/**
+ * @brief Decode an image
+ *
+ * Corrupt input is detected and rejected; it never writes out of bounds.
+ *
+ * @param codec Codec (not PNG)
+ * @param data Encoded data
+ * @param length Encoded length
+ * @param pixels Output pixels
+ * @param width Image width
+ * @param height Image height
+ * @param pitch Output row length in bytes
+ * @return true on success
+ */
+bool thumbnail_codec_decode(ThumbnailCodec codec, const uint8_t *data, size_t length,
+                            uint8_t *pixels, int width, int height, int pitch);
+
+#endif /* THUMBNAIL_CODEC_H */
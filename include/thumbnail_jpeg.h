@@ -0,0 +1,56 @@
+/**
+ * @file thumbnail_jpeg.h
+ * @brief Reduced-size JPEG decoding for thumbnails
+ *
+ * Uses libjpeg's DCT scaling to decode straight to 1/2, 1/4 or 1/8 of the
+ * full resolution, picking the smallest scale that still covers the
+ * thumbnail. Decoding is split into open and read so the caller can
+ * allocate the destination once the output size is known.
+ */
+
+#ifndef THUMBNAIL_JPEG_H
+#define THUMBNAIL_JPEG_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct ThumbnailJpeg ThumbnailJpeg;
+
+/**
+ * @brief Pick the DCT scale denominator for a decode
+ * @param width Full image width
+ * @param height Full image height
+ * @param min_width Smallest acceptable output width
+ * @param min_height Smallest acceptable output height
+ * @return 8, 4, 2 or 1
+ */
+int thumbnail_jpeg_scale_denom(int width, int height, int min_width, int min_height);
+
+/**
+ * @brief Read a JPEG header and choose the output scale
+ * @param path JPEG file path
+ * @param min_width Smallest acceptable output width
+ * @param min_height Smallest acceptable output height
+ * @param width Receives the output width
+ * @param height Receives the output height
+ * @return Decoder, or NULL if the file is not a JPEG libjpeg can decode
+ */
+ThumbnailJpeg* thumbnail_jpeg_open(const char *path, int min_width, int min_height,
+                                   int *width, int *height);
+
+/**
+ * @brief Decode the image as RGBA32 (byte order R,G,B,A, alpha 255)
+ * @param jpeg Decoder from thumbnail_jpeg_open()
+ * @param pixels Destination of at least height * pitch bytes
+ * @param pitch Destination row stride in bytes
+ * @return true on success; on failure the destination is partially written
+ */
+bool thumbnail_jpeg_read(ThumbnailJpeg *jpeg, uint8_t *pixels, int pitch);
+
+/**
+ * @brief Release a decoder and close its file
+ * @param jpeg Decoder (may be NULL)
+ */
+void thumbnail_jpeg_close(ThumbnailJpeg *jpeg);
+
+#endif /* THUMBNAIL_JPEG_H */
@@ -0,0 +1,44 @@
+/**
+ * @file thumbnail_palette.h
+ * @brief Average and dominant colours of a thumbnail
+ *
+ * Computed once when a thumbnail is made and stored with it in the cache,
+ * so renderers can tint glows and backgrounds without reading pixels back.
+ * Dominant colours come from a coarse histogram (three bits per channel):
+ * the fullest bins, skipping any too close to a colour already picked, each
+ * reported as the mean of the pixels that fell in it.
+ */
+
+#ifndef THUMBNAIL_PALETTE_H
+#define THUMBNAIL_PALETTE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define THUMBNAIL_PALETTE_COLORS 3
+
+/**
+ * @brief Colour summary of one thumbnail, 16 bytes
+ */
+typedef struct {
+    uint8_t average[4];   /**< Mean RGB; alpha is 255 once computed, 0 if unknown */
+    uint8_t colors[THUMBNAIL_PALETTE_COLORS][4]; /**< Dominant RGB, commonest first; alpha is the share of pixels, 0 for unused */
+} ThumbnailPalette;
+
+/**
+ * @brief Summarise a 4-byte RGBA image
+ * @param pixels First row
+ * @param width Width in pixels
+ * @param height Height in pixels
+ * @param pitch Bytes per row
+ * @param palette Receives the summary; unknown if the image is empty
+ */
+void thumbnail_palette_compute(const uint8_t *pixels, int width, int height, int pitch,
+                               ThumbnailPalette *palette);
+
+/**
+ * @brief Whether a palette has been computed
+ */
+bool thumbnail_palette_known(const ThumbnailPalette *palette);
+
+#endif /* THUMBNAIL_PALETTE_H */
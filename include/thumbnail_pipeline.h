@@ -0,0 +1,125 @@
+/**
+ * @file thumbnail_pipeline.h
+ * @brief Multi-threaded thumbnail generation pipeline
+ *
+ * Thumbnails are produced by a chain of stages (cache lookup, decode, scale,
+ * cache write), each served by its own pool of worker threads and connected
+ * by bounded queues so that only a few full-size decoded images are alive at
+ * once. Finished thumbnails are published through a lock-free stack and
+ * handed back to the main thread via thumbnail_pipeline_poll(), so the render
+ * loop can collect them every frame without ever blocking on a worker.
+ *
+ * Queued jobs are served nearest the selection first (see thumbnail_schedule.h)
+ * once thumbnail_pipeline_set_focus() has been called, and jobs that leave the
+ * wanted range before they are decoded come back cancelled.
+ */
+
+#ifndef THUMBNAIL_PIPELINE_H
+#define THUMBNAIL_PIPELINE_H
+
+#include <SDL3/SDL.h>
+#include <stdbool.h>
+#include "config.h"
+#include "thumbnail_atlas.h"
+#include "thumbnail_palette.h"
+#include "thumbnail_schedule.h"
+
+/**
+ * @brief Opaque pipeline handle
+ */
+typedef struct ThumbnailPipeline ThumbnailPipeline;
+
+/**
+ * @brief A finished thumbnail handed back to the main thread
+ */
+typedef struct {
+    int index;            /**< Wallpaper index the job was submitted with, or renumbered to */
+    SDL_Surface *thumb;   /**< Thumbnail surface (caller owns), NULL if the image failed */
+    ThumbnailPalette palette; /**< Colours of thumb */
+    bool cancelled;       /**< Dropped unfinished because it left the wanted range */
+} ThumbnailResult;
+
+/**
+ * @brief Create a pipeline and start its worker threads
+ * @param config Configuration (thumbnail size and thread count)
+ * @return Pipeline, or NULL if threads could not be started
+ */
+ThumbnailPipeline* thumbnail_pipeline_create(const Config *config);
+
+/**
+ * @brief Queue a thumbnail job (never blocks)
+ * @param p Pipeline
+ * @param index Wallpaper index, returned unchanged in the result
+ * @param position Display index, used to order and cancel jobs
+ * @param path Original image path (copied)
+ * @param stamp Identity of the image file, used to validate the cache
+ */
+void thumbnail_pipeline_submit(ThumbnailPipeline *p, int index, int position, const char *path,
+                               const ThumbnailStamp *stamp);
+
+/**
+ * @brief Tell the scheduler where the selection is and what is still wanted
+ *
+ * Call once per frame from the main thread. Until the first call jobs run
+ * in submission order and none are cancelled.
+ *
+ * @param p Pipeline
+ * @param focus Selected display index, always served next
+ * @param keep_first First display index still wanted
+ * @param keep_last One past the last display index still wanted
+ */
+void thumbnail_pipeline_set_focus(ThumbnailPipeline *p, int focus, int keep_first, int keep_last);
+
+/**
+ * @brief Collect finished thumbnails (main thread only)
+ *
+ * With wait == false this never takes a lock and returns immediately.
+ *
+ * @param p Pipeline
+ * @param results Output array
+ * @param max Capacity of the output array
+ * @param wait Block until at least one result is ready or no jobs remain
+ * @return Number of results written
+ */
+int thumbnail_pipeline_poll(ThumbnailPipeline *p, ThumbnailResult *results, int max, bool wait);
+
+/**
+ * @brief Move unfinished jobs to new wallpaper indices (main thread only)
+ *
+ * Call after the wallpaper list was renumbered. Jobs keep running and come
+ * back under their new index; jobs whose wallpaper is gone are discarded by
+ * thumbnail_pipeline_poll() instead of being returned.
+ *
+ * @param p Pipeline
+ * @param map New index of each old one, -1 for wallpapers that are gone; NULL discards every job
+ * @param count Number of entries in map
+ */
+void thumbnail_pipeline_renumber(ThumbnailPipeline *p, const int *map, int count);
+
+/**
+ * @brief Move unfinished jobs to new display positions (main thread only)
+ *
+ * Call after the view was filtered, reordered or renumbered, so queued jobs
+ * are ordered and cancelled by where their wallpaper is drawn now rather
+ * than where it was when they were submitted.
+ *
+ * @param p Pipeline
+ * @param positions Display index of each wallpaper, -1 if it is not shown
+ * @param count Number of entries in positions
+ */
+void thumbnail_pipeline_reposition(ThumbnailPipeline *p, const int *positions, int count);
+
+/**
+ * @brief Number of submitted jobs whose results have not been collected yet
+ * @param p Pipeline
+ * @return Outstanding job count
+ */
+int thumbnail_pipeline_outstanding(ThumbnailPipeline *p);
+
+/**
+ * @brief Stop all workers, discard unfinished jobs and free the pipeline
+ * @param p Pipeline
+ */
+void thumbnail_pipeline_destroy(ThumbnailPipeline *p);
+
+#endif /* THUMBNAIL_PIPELINE_H */
@@ -0,0 +1,96 @@
+/**
+ * @file thumbnail_resample.h
+ * @brief Area-averaging and Lanczos downscaler for thumbnails
+ *
+ * Works on 4-byte pixels and treats the channels independently, so any
+ * 32-bit RGBA-style layout passes through unchanged. The box filter
+ * averages every source pixel under each output pixel (weighting partial
+ * coverage at the edges), which does not alias at large reductions. The
+ * Lanczos filter box-reduces to twice the target first and finishes with a
+ * Lanczos-3 pass for a sharper result.
+ *
+ * Inner loops have SSE2 and AVX2 versions picked at runtime. All versions
+ * use the same fixed-point arithmetic and produce identical output.
+ */
+
+#ifndef THUMBNAIL_RESAMPLE_H
+#define THUMBNAIL_RESAMPLE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief Downscaling filter
+ */
+typedef enum {
+    THUMBNAIL_FILTER_BOX = 0,      /**< Area average */
+    THUMBNAIL_FILTER_LANCZOS = 1,  /**< Area average to 2x, then Lanczos-3 */
+    THUMBNAIL_FILTER_COUNT
+} ThumbnailFilter;
+
+/**
+ * @brief Instruction set used by the inner loops
+ */
+typedef enum {
+    RESAMPLE_ISA_SCALAR = 0,
+    RESAMPLE_ISA_SSE2 = 1,
+    RESAMPLE_ISA_AVX2 = 2,
+    RESAMPLE_ISA_COUNT
+} ResampleIsa;
+
+/**
+ * @brief Look up a filter by its config name ("box" or "lanczos")
+ * @param name Filter name
+ * @param filter Receives the filter
+ * @return true if the name is known
+ */
+bool thumbnail_filter_parse(const char *name, ThumbnailFilter *filter);
+
+/**
+ * @brief Config name of a filter
+ */
+const char* thumbnail_filter_name(ThumbnailFilter filter);
+
+/**
+ * @brief Resize a 4-byte-per-pixel image
+ *
+ * Upscaling is supported (linear interpolation for box, Lanczos otherwise)
+ * but is not what this is tuned for.
+ *
+ * @param src Source pixels
+ * @param src_w Source width
+ * @param src_h Source height
+ * @param src_pitch Source row stride in bytes
+ * @param dst Destination pixels
+ * @param dst_w Destination width
+ * @param dst_h Destination height
+ * @param dst_pitch Destination row stride in bytes
+ * @param filter Filter to use
+ * @return false on invalid sizes or out of memory
+ */
+bool thumbnail_resample(const uint8_t *src, int src_w, int src_h, int src_pitch,
+                        uint8_t *dst, int dst_w, int dst_h, int dst_pitch,
+                        ThumbnailFilter filter);
+
+/**
+ * @brief Instruction set the next resample will use
+ */
+ResampleIsa thumbnail_resample_isa(void);
+
+/**
+ * @brief Restrict the inner loops to an instruction set
+ *
+ * For tests and benchmarks; call before any resampling starts on other
+ * threads. Passing RESAMPLE_ISA_COUNT restores automatic selection.
+ *
+ * @param isa Instruction set to use
+ * @return false if the CPU or build does not support it
+ */
+bool thumbnail_resample_force_isa(ResampleIsa isa);
+
+/**
+ * @brief Short name of an instruction set ("scalar", "sse2", "avx2")
+ */
+const char* thumbnail_resample_isa_name(ResampleIsa isa);
+
+#endif /* THUMBNAIL_RESAMPLE_H */
@@ -0,0 +1,65 @@
+/**
+ * @file thumbnail_schedule.h
+ * @brief Ordering and cancellation of queued thumbnail jobs
+ *
+ * The pipeline serves queued jobs by score rather than in submission order.
+ * A job's score grows with its distance from the selected wallpaper, and
+ * faster for wallpapers behind the direction of travel, so the selection is
+ * always served first and the strip ahead of it fills in before the strip
+ * it is leaving. Jobs that fall outside the range the view still needs are
+ * cancelled instead of being decoded.
+ *
+ * Positions are display indices as drawn by the renderer.
+ */
+
+#ifndef THUMBNAIL_SCHEDULE_H
+#define THUMBNAIL_SCHEDULE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief Where the user is and where they are heading
+ */
+typedef struct {
+    bool active;            /**< False until the first update; jobs then run in submission order */
+    int focus;              /**< Selected display index */
+    int keep_first;         /**< First display index still wanted */
+    int keep_last;          /**< One past the last display index still wanted */
+    float velocity;         /**< Selection speed in items per second, positive towards higher indices */
+    uint64_t last_move_ns;  /**< When the focus last changed */
+} ThumbnailSchedule;
+
+/**
+ * @brief Start with no focus (first in, first out, nothing cancelled)
+ */
+void thumbnail_schedule_init(ThumbnailSchedule *s);
+
+/**
+ * @brief Record the current selection and wanted range
+ *
+ * Call once per frame; the selection velocity is estimated from successive
+ * calls and decays to zero once the selection stops moving.
+ *
+ * @param s Schedule
+ * @param focus Selected display index
+ * @param keep_first First display index still wanted
+ * @param keep_last One past the last display index still wanted
+ * @param now_ns Monotonic time in nanoseconds
+ */
+void thumbnail_schedule_update(ThumbnailSchedule *s, int focus, int keep_first, int keep_last,
+                               uint64_t now_ns);
+
+/**
+ * @brief Whether a job at this position is still wanted
+ */
+bool thumbnail_schedule_keep(const ThumbnailSchedule *s, int position);
+
+/**
+ * @brief Priority of a job at this position, lower runs first
+ *
+ * The focus itself always scores 0. Equal scores run in submission order.
+ */
+uint32_t thumbnail_schedule_score(const ThumbnailSchedule *s, int position);
+
+#endif /* THUMBNAIL_SCHEDULE_H */
@@ -7,31 +7,114 @@
 #define THUMBNAILS_H
 
 #include <SDL3/SDL.h>
+#include <stdint.h>
 #include "config.h"
+#include "thumbnail_pipeline.h"
+#include "thumbnail_codec.h"
+#include "thumbnail_palette.h"
+#include "search.h"
+#include "thumbnail_resample.h"
+#include "dir_walk.h"
+#include "library_watch.h"
 
 /**
- * @brief Wallpaper structure
+ * @brief Residency of a wallpaper's thumbnail surface
+ */
+typedef enum {
+    THUMB_STATE_NONE,     /**< Not in memory */
+    THUMB_STATE_PENDING,  /**< Requested from the pipeline */
+    THUMB_STATE_LOADED,   /**< Surface resident and on the LRU list */
+    THUMB_STATE_FAILED    /**< Image could not be read; not retried */
+} ThumbnailState;
+
+/**
+ * @brief Thumbnail of one wallpaper
  */
 typedef struct {
-    char *path;           /**< Full path to wallpaper file */
-    char *name;           /**< Filename without path */
-    SDL_Surface *thumb;   /**< Loaded thumbnail surface */
-    bool is_favorite;     /**< Whether wallpaper is marked as favorite */
-} Wallpaper;
+    SDL_Surface *thumb;   /**< Loaded thumbnail surface, NULL unless THUMB_STATE_LOADED */
+    int lru_prev;         /**< More recently viewed resident thumbnail (-1 if head) */
+    int lru_next;         /**< Less recently viewed resident thumbnail (-1 if tail) */
+    unsigned view_generation; /**< Last visible-range request that covered this wallpaper */
+    ThumbnailState state; /**< Whether thumb is resident, on its way or unavailable */
+    uint64_t generation;  /**< Identifies thumb; new for every surface attached, 0 if none */
+    ThumbnailPalette palette; /**< Colours of the last thumbnail loaded; kept when it is evicted */
+} ThumbnailSlot;
 
 /**
  * @brief List of wallpapers
+ *
+ * Stored as parallel arrays indexed by wallpaper index, so a pass over one
+ * field (names while filtering, favorites while counting) reads only that
+ * field. Names and directory paths live in one string arena; each directory
+ * is stored once and shared by the wallpapers in it. Read fields through
+ * the wallpaper_list_name() family rather than the arrays.
  */
 typedef struct {
-    Wallpaper *items;     /**< Array of wallpapers */
     int count;            /**< Number of wallpapers */
-    int capacity;         /**< Allocated capacity */
+    int capacity;         /**< Allocated wallpapers */
+    uint32_t *name_offsets; /**< Filename of each wallpaper, offset into strings */
+    uint32_t *prefixes;   /**< Directory of each wallpaper, index into prefix_offsets */
+    ThumbnailStamp *stamps; /**< File identity at scan time, validates the cached thumbnail */
+    ThumbnailSlot *thumbs; /**< Thumbnail of each wallpaper */
+    uint64_t *favorites;  /**< Favorite flags, one bit per wallpaper */
+    
+    // String arena: NUL-terminated filenames and directory paths
+    char *strings;         /**< Arena */
+    size_t strings_size;   /**< Bytes used */
+    size_t strings_capacity; /**< Bytes allocated */
+    size_t strings_dead;   /**< Bytes held by names of removed wallpapers, reclaimed once they pass half */
+    uint32_t *prefix_offsets; /**< Each distinct directory path, offset into strings */
+    int prefix_count;      /**< Number of distinct directories */
+    int prefix_capacity;   /**< Allocated directories */
+    int *prefix_table;     /**< Open-addressed lookup of directory paths, -1 for empty */
+    int prefix_table_size; /**< Slots in prefix_table, a power of two */
+    
+    // View: while a query or the favorites filter is set, the visible
+    // wallpapers in list order (best match first for fuzzy queries), kept
+    // up to date as favorites and files change
     char search_query[256]; /**< Current search query */
     int *filtered_indices; /**< Indices of filtered wallpapers */
     int filtered_count;    /**< Number of filtered wallpapers */
+    bool filter_active;    /**< filtered_indices is the view, even when empty */
+    bool view_stale;       /**< A ranked view needs rebuilding after changes */
+    bool positions_stale;  /**< The view changed since queued jobs were given display positions */
     bool show_favorites_only; /**< Filter to show only favorites */
+    SearchEngine search;   /**< Folded names and cached results of the query so far */
+    bool search_paths;     /**< Match queries against paths below the configured directories, via trigrams */
+    
+    // Resident thumbnail surfaces, least recently viewed evicted first
+    size_t thumb_bytes;    /**< Memory held by resident thumbnails */
+    size_t thumb_budget;   /**< Resident thumbnail limit in bytes, 0 for unlimited */
+    int thumb_lru_head;    /**< Most recently viewed resident thumbnail (-1 if none) */
+    int thumb_lru_tail;    /**< Least recently viewed resident thumbnail (-1 if none) */
+    unsigned view_generation; /**< Incremented by every visible-range request */
+    ThumbnailCodec thumb_codec; /**< Cache format for thumbnails made without a pipeline */
+    ThumbnailFilter thumb_filter; /**< Downscaling filter for thumbnails made without a pipeline */
+    
+    bool from_index;       /**< Some directories were listed from their scan index */
+    int dir_ends[MAX_WALLPAPER_DIRS + 1]; /**< One past the last item listed from each directory */
+    size_t dir_lengths[MAX_WALLPAPER_DIRS + 1]; /**< Length of each directory's path */
+    int dir_count;         /**< Number of directories listed */
 } WallpaperList;
 
+/**
+ * @brief Background check of directories listed from their scan index
+ */
+typedef struct WallpaperRescan WallpaperRescan;
+
+/**
+ * @brief Whether a file name has an image extension vista can show
+ */
+bool wallpaper_is_image_file(const char *filename);
+
+/**
+ * @brief Directory listing options for the configured recursion and excludes
+ * @param config Configuration
+ * @param excludes Receives pointers to the config's exclude patterns
+ * @return Options, valid while config and excludes are
+ */
+DirWalkOptions wallpaper_walk_options(const Config *config, const char *excludes[MAX_EXCLUDES]);
+
 /**
  * @brief Scan directory for wallpapers
  * @param dir Directory path
@@ -41,26 +124,256 @@ WallpaperList wallpaper_list_scan(const char *dir);
 
 /**
  * @brief Scan multiple directories for wallpapers
+ *
+ * Subdirectories are included when config->recursive is set, down to
+ * config->max_depth, skipping anything matching config->excludes.
+ *
  * @param config Configuration containing directory list
  * @return List of found wallpapers
  */
 WallpaperList wallpaper_list_scan_multiple(const Config *config);
 
 /**
- * @brief Generate thumbnails for all wallpapers
+ * @brief Scan the configured directories again, keeping loaded thumbnails
+ *
+ * Thumbnails of files that are unchanged carry over; the search filter and
+ * favorites filter are reapplied. Wallpaper indices change, so unfinished
+ * jobs on the pipeline are renumbered to match, or dropped if their file
+ * is gone or changed.
+ *
+ * @param list List to replace
+ * @param pipeline Pipeline thumbnails were requested from, may be NULL
+ * @param config Configuration containing directory list
+ */
+void wallpaper_list_reload(WallpaperList *list, ThumbnailPipeline *pipeline, const Config *config);
+
+/**
+ * @brief Apply changes reported by a library watcher
+ *
+ * Added files are inserted in listing order with no thumbnail, so only they
+ * get scheduled; rewritten files lose their stale thumbnail. Removed files
+ * are dropped. Loaded thumbnails of everything else stay, favorites are
+ * looked up for new files and the search filter is reapplied.
+ *
+ * Changes take effect in the order given, but the list is rebuilt only once
+ * per call, so pass a whole batch from library_watch_take() at a time.
+ *
+ * Wallpaper indices shift, so unfinished jobs on the pipeline are renumbered
+ * to match, and those of removed or rewritten files are dropped.
+ * LIBRARY_CHANGE_RESCAN is not handled here; use wallpaper_list_reload()
+ * for it.
+ *
+ * @param list Wallpaper list
+ * @param pipeline Pipeline thumbnails were requested from, may be NULL
+ * @param config Configuration containing directory list
+ * @param changes Changes from library_watch_take()
+ * @param count Number of changes
+ * @return true if the list changed
+ */
+bool wallpaper_list_apply_changes(WallpaperList *list, ThumbnailPipeline *pipeline, const Config *config,
+                                  const LibraryChange *changes, int count);
+
+/**
+ * @brief Start re-reading the configured directories on a background thread
+ *
+ * Directory trees whose mtimes have not changed are listed from their scan
+ * index without being read, but files edited in place do not change the
+ * directory mtime. This reads every tree again, updates the indexes, and pushes
+ * a wallpaper_rescan_event() if anything differed from what was loaded.
+ *
+ * @param config Configuration containing directory list
+ * @return Rescan handle, or NULL if the thread could not be started
+ */
+WallpaperRescan* wallpaper_rescan_start(const Config *config);
+
+/**
+ * @brief SDL event type pushed when a rescan found changes
+ *
+ * Handle it with wallpaper_list_reload().
+ */
+Uint32 wallpaper_rescan_event(void);
+
+/**
+ * @brief Stop a rescan (waiting for the directories being read) and free it
+ * @param rescan Rescan handle, may be NULL
+ */
+void wallpaper_rescan_finish(WallpaperRescan *rescan);
+
+/**
+ * @brief Generate thumbnails for all wallpapers, blocking until done
  * @param list Wallpaper list
  * @param config Configuration
  */
 void wallpaper_list_generate_thumbnails(WallpaperList *list, const Config *config);
 
+/**
+ * @brief Queue every wallpaper without a thumbnail on a pipeline (non-blocking)
+ * @param list Wallpaper list
+ * @param pipeline Thumbnail pipeline
+ */
+void wallpaper_list_request_thumbnails(WallpaperList *list, ThumbnailPipeline *pipeline);
+
+/**
+ * @brief Limit the memory held by resident thumbnail surfaces
+ *
+ * Once over budget, thumbnails outside the last requested range are freed
+ * least recently viewed first and reloaded on demand. Thumbnails inside the
+ * range are never evicted, so the budget can be exceeded by one screen's worth.
+ *
+ * @param list Wallpaper list
+ * @param bytes Budget in bytes, 0 for unlimited
+ */
+void wallpaper_list_set_thumbnail_budget(WallpaperList *list, size_t bytes);
+
+/**
+ * @brief Make sure the thumbnails of a range of display indices are loaded
+ *
+ * Call once per frame with the visible range plus a prefetch margin. Missing
+ * thumbnails are queued on the pipeline; without a pipeline they are loaded
+ * synchronously. Resident ones are marked as recently viewed. Queued jobs
+ * are served nearest @p focus first, and ones outside the range are cancelled.
+ *
+ * @param list Wallpaper list
+ * @param pipeline Thumbnail pipeline, or NULL to load on the calling thread
+ * @param config Configuration (thumbnail size)
+ * @param first First display index (clamped)
+ * @param last One past the last display index (clamped)
+ * @param focus Selected display index
+ */
+void wallpaper_list_request_range(WallpaperList *list, ThumbnailPipeline *pipeline,
+                                  const Config *config, int first, int last, int focus);
+
+/**
+ * @brief Attach thumbnails the pipeline has finished since the last call
+ *
+ * Never blocks, so it can be called once per frame from the render loop.
+ * Evicts off-screen thumbnails if the arrivals push memory over budget.
+ *
+ * @param list Wallpaper list
+ * @param pipeline Thumbnail pipeline
+ * @return Number of thumbnails that arrived
+ */
+int wallpaper_list_collect_thumbnails(WallpaperList *list, ThumbnailPipeline *pipeline);
+
+/**
+ * @brief Cache format and downscaling filter named by the configuration
+ *
+ * Unknown names are reported and fall back to raw and box.
+ *
+ * @param config Configuration (thumbnail_cache_format and thumbnail_filter)
+ * @param codec Receives the cache format
+ * @param filter Receives the downscaling filter
+ */
+void thumbnail_options_parse(const Config *config, ThumbnailCodec *codec, ThumbnailFilter *filter);
+
 /**
  * @brief Load or create cached thumbnail
  * @param path Original image path
  * @param width Thumbnail width
  * @param height Thumbnail height
+ * @param codec Cache format, used if this opens the cache
+ * @param filter Downscaling filter for a new thumbnail
+ * @param palette Receives the thumbnail's colours (may be NULL)
  * @return Loaded thumbnail surface
  */
-SDL_Surface* thumbnail_load_or_cache(const char *path, int width, int height);
+SDL_Surface* thumbnail_load_or_cache(const char *path, int width, int height, ThumbnailCodec codec,
+                                     ThumbnailFilter filter, ThumbnailPalette *palette);
+
+/**
+ * @brief Open the thumbnail cache for one thumbnail size
+ *
+ * The cache is process-wide and stays open until thumbnail_cache_close().
+ * Calling it again while open does nothing. Main thread only.
+ *
+ * Entries written with any codec can be read back; the codec only selects
+ * how new thumbnails are stored.
+ *
+ * @param width Thumbnail width
+ * @param height Thumbnail height
+ * @param codec Encoding for newly stored thumbnails
+ * @return true if the cache is usable
+ */
+bool thumbnail_cache_open(int width, int height, ThumbnailCodec codec);
+
+/**
+ * @brief Close the thumbnail cache
+ *
+ * Surfaces returned by thumbnail_cache_load() point into the cache mapping,
+ * so they must all be destroyed first.
+ */
+void thumbnail_cache_close(void);
+
+/**
+ * @brief Load a thumbnail from the cache
+ *
+ * Raw entries are wrapped in place and the surface must not be modified;
+ * other codecs decode into a new surface.
+ *
+ * @param path Original image path
+ * @param stamp Current identity of the image file; a changed file misses
+ * @param width Thumbnail width
+ * @param height Thumbnail height
+ * @param palette Receives the colours stored with the thumbnail (may be NULL)
+ * @return Cached thumbnail surface, or NULL on cache miss
+ */
+SDL_Surface* thumbnail_cache_load(const char *path, const ThumbnailStamp *stamp, int width, int height,
+                                  ThumbnailPalette *palette);
+
+/**
+ * @brief Read a thumbnail left by the PNG-per-image cache of older versions
+ *
+ * The legacy file is deleted once read; the caller should store the result
+ * with thumbnail_cache_store().
+ *
+ * @param path Original image path
+ * @param stamp Current identity of the image file; older legacy files are ignored
+ * @param width Thumbnail width
+ * @param height Thumbnail height
+ * @return Thumbnail surface, or NULL if there is no usable legacy file
+ */
+SDL_Surface* thumbnail_cache_migrate(const char *path, const ThumbnailStamp *stamp, int width, int height);
+
+/**
+ * @brief Decode an original image for thumbnailing
+ *
+ * JPEGs are decoded at a reduced scale when libjpeg is available; the result
+ * is never smaller than the requested minimum. Other formats are decoded at
+ * full resolution.
+ *
+ * @param path Original image path
+ * @param min_width Smallest useful width (the thumbnail width)
+ * @param min_height Smallest useful height (the thumbnail height)
+ * @return Decoded surface, or NULL on error
+ */
+SDL_Surface* thumbnail_decode(const char *path, int min_width, int min_height);
+
+/**
+ * @brief Scale a decoded image down to thumbnail size
+ * @param original Decoded source image, in any pixel format
+ * @param width Thumbnail width
+ * @param height Thumbnail height
+ * @param filter Downscaling filter
+ * @return New RGBA32 thumbnail surface, or NULL on error
+ */
+SDL_Surface* thumbnail_scale(SDL_Surface *original, int width, int height, ThumbnailFilter filter);
+
+/**
+ * @brief Work out a thumbnail's average and dominant colours
+ * @param thumb Thumbnail surface
+ * @param palette Receives the colours (unknown if the surface cannot be read)
+ */
+void thumbnail_compute_palette(SDL_Surface *thumb, ThumbnailPalette *palette);
+
+/**
+ * @brief Write a thumbnail to the cache
+ * @param path Original image path
+ * @param stamp Identity of the image file the thumbnail was made from
+ * @param thumb Thumbnail surface, sized as passed to thumbnail_cache_open()
+ * @param palette Colours stored with it, from thumbnail_compute_palette()
+ * @return true on success
+ */
+bool thumbnail_cache_store(const char *path, const ThumbnailStamp *stamp, SDL_Surface *thumb,
+                           const ThumbnailPalette *palette);
 
 /**
  * @brief Free wallpaper list
@@ -85,9 +398,67 @@ void wallpaper_list_clear_filter(WallpaperList *list);
  * @brief Get wallpaper at display index (accounts for filtering)
  * @param list Wallpaper list
  * @param index Display index
- * @return Wallpaper pointer or NULL
+ * @return Wallpaper index, or -1 if out of range
+ */
+int wallpaper_list_get(const WallpaperList *list, int index);
+
+/**
+ * @brief Filename of a wallpaper
+ * @param list Wallpaper list
+ * @param wallpaper Wallpaper index
+ * @return Name, valid until the list changes
+ */
+const char* wallpaper_list_name(const WallpaperList *list, int wallpaper);
+
+/**
+ * @brief Full path of a wallpaper
+ * @param list Wallpaper list
+ * @param wallpaper Wallpaper index
+ * @param buffer Receives the path
+ * @param size Size of buffer
+ * @return buffer
+ */
+const char* wallpaper_list_path(const WallpaperList *list, int wallpaper, char *buffer, size_t size);
+
+/**
+ * @brief Loaded thumbnail of a wallpaper
+ * @param list Wallpaper list
+ * @param wallpaper Wallpaper index
+ * @return Surface, or NULL if not loaded
+ */
+SDL_Surface* wallpaper_list_thumb(const WallpaperList *list, int wallpaper);
+
+/**
+ * @brief Identity of a wallpaper's loaded thumbnail
+ *
+ * Never reused, even across reloads, so renderers can key uploaded
+ * textures by it: a thumbnail that was replaced, or a wallpaper whose
+ * index shifted, no longer matches. Surface addresses can be reused.
+ *
+ * @param list Wallpaper list
+ * @param wallpaper Wallpaper index
+ * @return Generation, or 0 if no thumbnail is loaded
+ */
+uint64_t wallpaper_list_thumb_generation(const WallpaperList *list, int wallpaper);
+
+/**
+ * @brief Average and dominant colours of a wallpaper's thumbnail
+ *
+ * Read from the thumbnail cache with the thumbnail, so this costs nothing
+ * per frame. Stays available after the thumbnail is evicted.
+ *
+ * @param list Wallpaper list
+ * @param wallpaper Wallpaper index
+ * @return Palette, or NULL if no thumbnail has been loaded yet
  */
-Wallpaper* wallpaper_list_get(WallpaperList *list, int index);
+const ThumbnailPalette* wallpaper_list_palette(const WallpaperList *list, int wallpaper);
+
+/**
+ * @brief Whether a wallpaper is marked as favorite
+ * @param list Wallpaper list
+ * @param wallpaper Wallpaper index
+ */
+bool wallpaper_list_is_favorite(const WallpaperList *list, int wallpaper);
 
 /**
  * @brief Get visible count (accounts for filtering)
@@ -110,15 +481,18 @@ void wallpaper_toggle_favorite(WallpaperList *list, int index);
 void wallpaper_list_toggle_favorites_filter(WallpaperList *list);
 
 /**
- * @brief Load favorites from disk
+ * @brief Mark the wallpapers that are favorites
+ *
+ * The favorites store is read from disk on first use; after that this is
+ * one lookup per wallpaper.
+ *
  * @param list Wallpaper list
  */
 void wallpaper_list_load_favorites(WallpaperList *list);
 
 /**
- * @brief Save favorites to disk
- * @param list Wallpaper list
+ * @brief Write out pending favorite changes and close the favorites store
  */
-void wallpaper_list_save_favorites(const WallpaperList *list);
+void wallpaper_favorites_close(void);
 
 #endif /* THUMBNAILS_H */
@@ -0,0 +1,75 @@
+/**
+ * @file trigram.h
+ * @brief Trigram inverted index for substring search
+ *
+ * Maps every three-byte sequence (ASCII case folded) to the ascending list
+ * of texts containing it. A text containing a query contains all of the
+ * query's trigrams, so intersecting their posting lists gives a small
+ * candidate set that only needs confirming with a direct comparison.
+ * Queries shorter than three bytes have no trigram and are not served.
+ */
+
+#ifndef TRIGRAM_H
+#define TRIGRAM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Trigram index over a numbered set of texts
+ */
+typedef struct {
+    uint32_t *keys;           /**< Distinct trigrams, ascending; three folded bytes, first one highest */
+    uint32_t *starts;         /**< Postings of keys[i] are postings[starts[i]] up to postings[starts[i + 1]] */
+    uint32_t *postings;       /**< Text numbers, ascending within each trigram */
+    uint32_t key_count;       /**< Number of distinct trigrams */
+    uint32_t posting_count;   /**< Number of postings */
+} TrigramIndex;
+
+/**
+ * @brief Start an empty index
+ */
+void trigram_index_init(TrigramIndex *index);
+
+/**
+ * @brief Free an index and reset it to empty
+ */
+void trigram_index_free(TrigramIndex *index);
+
+/**
+ * @brief Index a set of texts, numbered by their position
+ * @param index Receives the index (previous contents are freed)
+ * @param texts Texts to index
+ * @param count Number of texts
+ * @return false if out of memory, leaving the index empty
+ */
+bool trigram_index_build(TrigramIndex *index, const char *const *texts, int count);
+
+/**
+ * @brief Add another index's texts after this one's
+ * @param index Index to extend
+ * @param other Index of the texts that follow
+ * @param offset Number of the first text of other within index
+ * @return false if out of memory, leaving index unchanged
+ */
+bool trigram_index_append(TrigramIndex *index, const TrigramIndex *other, uint32_t offset);
+
+/**
+ * @brief Most candidates a query can produce: its rarest trigram's posting count
+ * @param query Query, already case folded
+ * @param len Length of query, at least 3
+ */
+uint32_t trigram_index_estimate(const TrigramIndex *index, const char *query, size_t len);
+
+/**
+ * @brief Texts containing every trigram of a query
+ * @param index Index
+ * @param query Query, already case folded
+ * @param len Length of query, at least 3
+ * @param out Receives ascending text numbers; room for trigram_index_estimate() of them
+ * @return Number of candidates
+ */
+int trigram_index_candidates(const TrigramIndex *index, const char *query, size_t len, uint32_t *out);
+
+#endif /* TRIGRAM_H */
@@ -0,0 +1,22 @@
+#version 330 core
+
+in vec2 TexCoord;
+
+out vec4 FragColor;
+
+uniform sampler2D source;
+uniform vec2 direction;   // One texel along the axis of this pass
+
+// One axis of a 9-tap Gaussian, with neighbouring taps merged into single
+// bilinear fetches: five texture reads instead of nine
+const float offsets[3] = float[](0.0, 1.3846153846, 3.2307692308);
+const float weights[3] = float[](0.2270270270, 0.3162162162, 0.0702702703);
+
+void main() {
+    vec4 result = texture(source, TexCoord) * weights[0];
+    for (int i = 1; i < 3; i++) {
+        result += texture(source, TexCoord + direction * offsets[i]) * weights[i];
+        result += texture(source, TexCoord - direction * offsets[i]) * weights[i];
+    }
+    FragColor = result;
+}
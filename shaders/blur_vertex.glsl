@@ -0,0 +1,12 @@
+#version 330 core
+
+layout (location = 0) in vec2 aPos;
+layout (location = 1) in vec2 aTexCoord;
+
+out vec2 TexCoord;
+
+// The unit quad covers the whole blur target
+void main() {
+    TexCoord = aTexCoord;
+    gl_Position = vec4(aPos * 2.0 - 1.0, 0.0, 1.0);
+}
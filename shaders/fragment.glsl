@@ -8,17 +8,29 @@ in float Depth;
 
 out vec4 FragColor;
 
-uniform sampler2D texture1;
-uniform sampler2D backgroundTexture;
-uniform float selected;
-uniform float time;
-uniform vec2 windowSize;
-uniform vec2 thumbnailPos;
-uniform vec2 thumbnailSize;
-uniform float cornerRadius;
-uniform float isBackground;
-uniform vec3 avgColor;
-uniform float rotationY;
+flat in vec2 thumbnailPos;
+flat in vec2 thumbnailSize;
+flat in vec3 avgColor;
+flat in float selected;
+flat in float rotationY;
+flat in float layer;
+flat in float isBackground;
+flat in vec2 uvScale;
+flat in float frosted;
+
+uniform sampler2DArray thumbnails;
+uniform sampler2D backgroundTexture;   // Selected wallpaper, blurred by the blur pass
+
+// Per-frame constants, shared with the vertex shader (GLFrameConstants)
+layout (std140) uniform FrameConstants {
+    mat4 projection;
+    vec2 windowSize;
+    float time;
+    float cornerRadius;
+    float tiltX;
+    float depth3D;
+    float is3D;
+};
 
 // ====================
 // WINDOWS AERO FROSTED GLASS SHADER (FIXED)
@@ -30,32 +42,6 @@ float hash(vec2 p) {
     return fract(sin(p.x + p.y) * 43758.5453);
 }
 
-// Optimized blur - uses fewer samples but still looks good
-vec4 frostBlur(sampler2D tex, vec2 uv, float radius) {
-    vec2 texel = 1.0 / windowSize;
-    vec4 result = vec4(0.0);
-    float totalWeight = 0.0;
-    
-    // Reduced kernel for better performance
-    const int samples = 8;
-    const float sigma = 3.5;
-    
-    for (int x = -samples; x <= samples; x++) {
-        for (int y = -samples; y <= samples; y++) {
-            vec2 offset = vec2(float(x), float(y)) * texel * radius;
-            vec2 sampleUV = clamp(uv + offset, 0.001, 0.999);
-            
-            float dist = length(vec2(x, y));
-            float weight = exp(-(dist * dist) / (2.0 * sigma * sigma));
-            
-            result += texture(tex, sampleUV) * weight;
-            totalWeight += weight;
-        }
-    }
-    
-    return result / totalWeight;
-}
-
 // Rounded rectangle distance field - FIXED for proper corner handling
 float roundedBoxSDF(vec2 pos, vec2 center, vec2 halfSize, float radius) {
     vec2 d = abs(pos - center) - halfSize + radius;
@@ -114,6 +100,13 @@ void main() {
         float grain = (hash(WindowPos + time * 100.0) - 0.5) * 0.02;
         tintColor += grain;
         
+        // Frosted glass: the blurred wallpaper under the same tint, one tap
+        if (frosted > 0.5) {
+            vec3 frost = texture(backgroundTexture, TexCoord).rgb;
+            tintColor = mix(frost, tintColor, tintAlpha);
+            tintAlpha = 0.95;
+        }
+        
         FragColor = vec4(clamp(tintColor, 0.0, 1.0), tintAlpha * windowAlpha);
         return;
     }
@@ -122,7 +115,7 @@ void main() {
     // THUMBNAIL RENDERING
     // ======================
     
-    vec4 texColor = texture(texture1, TexCoord);
+    vec4 texColor = texture(thumbnails, vec3(TexCoord * uvScale, layer));
     
     // Calculate rounded corners for thumbnail
     vec2 thumbnailCenter = thumbnailPos + thumbnailSize * 0.5;
@@ -3,21 +3,58 @@
 layout (location = 0) in vec2 aPos;
 layout (location = 1) in vec2 aTexCoord;
 
+// Per instance: one carousel item, or the background
+layout (location = 2) in vec4 aQuad;       // Drawn rectangle (x, y, width, height)
+layout (location = 3) in vec4 aThumbnail;  // Thumbnail rectangle within it
+layout (location = 4) in vec4 aColor;      // Average colour, selection weight
+layout (location = 5) in vec4 aParams;     // Rotation, layer, background flag, frosted flag
+layout (location = 6) in vec2 aUvScale;    // Part of the layer the thumbnail fills
+
 out vec2 TexCoord;
 out vec2 FragPos;
 out vec2 WindowPos;
 out vec3 WorldPos3D;
 out float Depth;
 
-uniform mat4 projection;
-uniform mat4 model;
-uniform vec2 windowSize;
-uniform float rotationY;
-uniform float tiltX;
-uniform float depth3D;
-uniform float is3D;
+flat out vec2 thumbnailPos;
+flat out vec2 thumbnailSize;
+flat out vec3 avgColor;
+flat out float selected;
+flat out float rotationY;
+flat out float layer;
+flat out float isBackground;
+flat out vec2 uvScale;
+flat out float frosted;
+
+// Per-frame constants, shared with the fragment shader (GLFrameConstants)
+layout (std140) uniform FrameConstants {
+    mat4 projection;
+    vec2 windowSize;
+    float time;
+    float cornerRadius;
+    float tiltX;
+    float depth3D;
+    float is3D;
+};
 
 void main() {
+    thumbnailPos = aThumbnail.xy;
+    thumbnailSize = aThumbnail.zw;
+    avgColor = aColor.rgb;
+    selected = aColor.a;
+    rotationY = aParams.x;
+    layer = aParams.y;
+    isBackground = aParams.z;
+    uvScale = aUvScale;
+    frosted = aParams.w;
+    
+    mat4 model = mat4(
+        aQuad.z, 0.0,     0.0, 0.0,
+        0.0,     aQuad.w, 0.0, 0.0,
+        0.0,     0.0,     1.0, 0.0,
+        aQuad.x, aQuad.y, 0.0, 1.0
+    );
+    
     vec4 pos = vec4(aPos, 0.0, 1.0);
     
     if (is3D > 0.5) {
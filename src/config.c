@@ -58,6 +58,11 @@ Config config_default(void)
 
     snprintf(config.wallpaper_dir, MAX_PATH, "%s/wallpaper/desktopGenerations", home);
     config.wallpaper_dirs_count = 0;
+    config.recursive = false;
+    config.max_depth = 0;  // 0 means no limit
+    config.excludes_count = 0;
+    config.search_index = false;
+    snprintf(config.search_mode, sizeof(config.search_mode), "substring");
 
     snprintf(config.feh_command, MAX_PATH, "feh --bg-scale");
     config.palette_script[0] = '\0';
@@ -75,7 +80,13 @@ Config config_default(void)
     config.window_width = 1200;
     config.window_height = 300;
     config.use_shaders = false;
+    config.frosted_background = false;
     config.thumbnails_per_row = 5;
+    config.texture_cache_mb = 256;
+    config.thumbnail_threads = 0;  // 0 means one per logical CPU
+    snprintf(config.thumbnail_cache_format, sizeof(config.thumbnail_cache_format), "raw");
+    snprintf(config.thumbnail_filter, sizeof(config.thumbnail_filter), "box");
+    config.thumbnail_memory_mb = 256;
     config.audio_dir[0] = '\0';
     
     // Roulette defaults
@@ -189,6 +200,31 @@ Config config_parse(const char *path)
                     config.wallpaper_dirs_count++;
                 }
             }
+            else if (strcmp(k, "recursive") == 0)
+            {
+                config.recursive = (strcmp(v, "true") == 0 || strcmp(v, "1") == 0);
+            }
+            else if (strcmp(k, "max_depth") == 0)
+            {
+                config.max_depth = atoi(v);
+            }
+            else if (strncmp(k, "exclude_", 8) == 0)
+            {
+                if (config.excludes_count < MAX_EXCLUDES)
+                {
+                    strncpy(config.excludes[config.excludes_count], v, MAX_PATH - 1);
+                    config.excludes[config.excludes_count][MAX_PATH - 1] = '\0';
+                    config.excludes_count++;
+                }
+            }
+            else if (strcmp(k, "search_index") == 0)
+            {
+                config.search_index = (strcmp(v, "true") == 0 || strcmp(v, "1") == 0);
+            }
+            else if (strcmp(k, "search_mode") == 0)
+            {
+                strncpy(config.search_mode, v, sizeof(config.search_mode) - 1);
+            }
             else if (strcmp(k, "feh_command") == 0)
             {
                 strncpy(config.feh_command, v, MAX_PATH - 1);
@@ -247,10 +283,34 @@ Config config_parse(const char *path)
             {
                 config.use_shaders = (strcmp(v, "true") == 0 || strcmp(v, "1") == 0);
             }
+            else if (strcmp(k, "frosted_background") == 0)
+            {
+                config.frosted_background = (strcmp(v, "true") == 0 || strcmp(v, "1") == 0);
+            }
             else if (strcmp(k, "thumbnails_per_row") == 0)
             {
                 config.thumbnails_per_row = atoi(v);
             }
+            else if (strcmp(k, "texture_cache_mb") == 0)
+            {
+                config.texture_cache_mb = atoi(v);
+            }
+            else if (strcmp(k, "thumbnail_threads") == 0)
+            {
+                config.thumbnail_threads = atoi(v);
+            }
+            else if (strcmp(k, "thumbnail_cache_format") == 0)
+            {
+                strncpy(config.thumbnail_cache_format, v, sizeof(config.thumbnail_cache_format) - 1);
+            }
+            else if (strcmp(k, "thumbnail_filter") == 0)
+            {
+                strncpy(config.thumbnail_filter, v, sizeof(config.thumbnail_filter) - 1);
+            }
+            else if (strcmp(k, "thumbnail_memory_mb") == 0)
+            {
+                config.thumbnail_memory_mb = atoi(v);
+            }
             else if (strcmp(k, "audio_dir") == 0)
             {
                 expand_tilde(v, config.audio_dir, MAX_PATH);
@@ -314,6 +374,14 @@ void config_print(const Config *config)
 {
     printf("Configuration:\n");
     printf("  wallpaper_dir: %s\n", config->wallpaper_dir);
+    printf("  recursive: %s\n", config->recursive ? "true" : "false");
+    printf("  max_depth: %d\n", config->max_depth);
+    for (int i = 0; i < config->excludes_count; i++)
+    {
+        printf("  exclude: %s\n", config->excludes[i]);
+    }
+    printf("  search_index: %s\n", config->search_index ? "true" : "false");
+    printf("  search_mode: %s\n", config->search_mode);
     printf("  feh_command: %s\n", config->feh_command);
     printf("  palette_script: %s\n", config->palette_script);
     printf("  use_wal: %s\n", config->use_wal ? "true" : "false");
@@ -336,5 +404,11 @@ void config_print(const Config *config)
     printf("  thumbnail_size: %dx%d\n", config->thumbnail_width, config->thumbnail_height);
     printf("  window_size: %dx%d\n", config->window_width, config->window_height);
     printf("  use_shaders: %s\n", config->use_shaders ? "true" : "false");
+    printf("  frosted_background: %s\n", config->frosted_background ? "true" : "false");
     printf("  thumbnails_per_row: %d\n", config->thumbnails_per_row);
+    printf("  texture_cache_mb: %d\n", config->texture_cache_mb);
+    printf("  thumbnail_threads: %d\n", config->thumbnail_threads);
+    printf("  thumbnail_cache_format: %s\n", config->thumbnail_cache_format);
+    printf("  thumbnail_filter: %s\n", config->thumbnail_filter);
+    printf("  thumbnail_memory_mb: %d\n", config->thumbnail_memory_mb);
 }
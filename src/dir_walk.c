@@ -0,0 +1,441 @@
+/**
+ * @file dir_walk.c
+ * @brief Work-queue directory traversal
+ *
+ * Each directory is one task. Tasks wait in a queue per device (st_dev of
+ * the directory they were found in) and workers take them round-robin
+ * across devices, with a cap on how many run against one device at a time.
+ * Subdirectories are opened with openat() relative to their root, so paths
+ * are never rebuilt from the filesystem root.
+ */
+
+#define _GNU_SOURCE
+#include "dir_walk.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <fnmatch.h>
+#include <limits.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+#define DIR_WALK_DEFAULT_THREADS 8
+#define DIR_WALK_PER_DEVICE 4        /* Tasks running against one device at once */
+
+typedef struct WalkTask {
+    int root;
+    int depth;                       /* 0 for the root itself */
+    char *rel;                       /* Path relative to the root, "" for the root */
+    struct WalkTask *next;
+} WalkTask;
+
+typedef struct {
+    dev_t dev;
+    WalkTask *head;
+    WalkTask *tail;
+    int running;
+} DeviceQueue;
+
+typedef struct {
+    dev_t dev;
+    ino_t ino;
+    int root;
+    bool used;
+} VisitedSlot;
+
+typedef struct {
+    const DirWalkOptions *options;
+    ScanDirectory *scans;
+    int *root_fds;
+
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    DeviceQueue *devices;
+    int device_count;
+    int device_capacity;
+    int next_device;                 /* Round-robin cursor */
+    int pending;                     /* Tasks queued or running */
+
+    VisitedSlot *visited;            /* Open-addressed set of (root, directory) entered */
+    size_t visited_count;
+    size_t visited_capacity;         /* Power of two */
+} Walk;
+
+/* -------------------------------------------------------------------------- */
+/*                         Queues (caller holds lock)                         */
+/* -------------------------------------------------------------------------- */
+
+static int device_queue(Walk *w, dev_t dev) {
+    for (int i = 0; i < w->device_count; i++) {
+        if (w->devices[i].dev == dev) return i;
+    }
+
+    if (w->device_count >= w->device_capacity) {
+        int capacity = w->device_capacity > 0 ? w->device_capacity * 2 : 4;
+        DeviceQueue *devices = realloc(w->devices, sizeof(DeviceQueue) * capacity);
+        if (!devices) return -1;
+        w->devices = devices;
+        w->device_capacity = capacity;
+    }
+
+    DeviceQueue *q = &w->devices[w->device_count];
+    memset(q, 0, sizeof(*q));
+    q->dev = dev;
+    return w->device_count++;
+}
+
+static bool push_task(Walk *w, dev_t dev, int root, int depth, const char *rel) {
+    int d = device_queue(w, dev);
+    WalkTask *task = d >= 0 ? malloc(sizeof(WalkTask)) : NULL;
+    if (!task) return false;
+
+    task->root = root;
+    task->depth = depth;
+    task->rel = strdup(rel);
+    task->next = NULL;
+    if (!task->rel) {
+        free(task);
+        return false;
+    }
+
+    DeviceQueue *q = &w->devices[d];
+    if (q->tail) q->tail->next = task;
+    else q->head = task;
+    q->tail = task;
+    w->pending++;
+    return true;
+}
+
+/* Next task from a device that is below its concurrency cap */
+static WalkTask* take_task(Walk *w, int *device) {
+    for (int n = 0; n < w->device_count; n++) {
+        int d = (w->next_device + n) % w->device_count;
+        DeviceQueue *q = &w->devices[d];
+        if (!q->head || q->running >= DIR_WALK_PER_DEVICE) continue;
+
+        WalkTask *task = q->head;
+        q->head = task->next;
+        if (!q->head) q->tail = NULL;
+        q->running++;
+        w->next_device = (d + 1) % w->device_count;
+        *device = d;
+        return task;
+    }
+    return NULL;
+}
+
+static size_t visited_hash(dev_t dev, ino_t ino, int root) {
+    return (size_t)(((uint64_t)ino * 0x9E3779B97F4A7C15ull) ^ (uint64_t)dev ^ ((uint64_t)root << 48));
+}
+
+/* Insert a directory into the visited set of its root; false if it was already there */
+static bool mark_visited(Walk *w, dev_t dev, ino_t ino, int root) {
+    if (w->visited_count * 2 >= w->visited_capacity) {
+        size_t capacity = w->visited_capacity > 0 ? w->visited_capacity * 2 : 256;
+        VisitedSlot *slots = calloc(capacity, sizeof(VisitedSlot));
+        if (!slots) return true;
+
+        for (size_t i = 0; i < w->visited_capacity; i++) {
+            if (!w->visited[i].used) continue;
+            const VisitedSlot *v = &w->visited[i];
+            size_t h = visited_hash(v->dev, v->ino, v->root) & (capacity - 1);
+            while (slots[h].used) h = (h + 1) & (capacity - 1);
+            slots[h] = w->visited[i];
+        }
+        free(w->visited);
+        w->visited = slots;
+        w->visited_capacity = capacity;
+    }
+
+    size_t h = visited_hash(dev, ino, root) & (w->visited_capacity - 1);
+    while (w->visited[h].used) {
+        const VisitedSlot *v = &w->visited[h];
+        if (v->dev == dev && v->ino == ino && v->root == root) return false;
+        h = (h + 1) & (w->visited_capacity - 1);
+    }
+    w->visited[h].dev = dev;
+    w->visited[h].ino = ino;
+    w->visited[h].root = root;
+    w->visited[h].used = true;
+    w->visited_count++;
+    return true;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                              Reading a directory                           */
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief Everything found in one directory, merged into the walk afterwards
+ */
+typedef struct {
+    ScanDirectory files;
+    char **subdirs;
+    int subdir_count;
+    int subdir_capacity;
+} DirContents;
+
+bool dir_walk_excluded(const DirWalkOptions *options, const char *name, const char *rel) {
+    for (int i = 0; i < options->exclude_count; i++) {
+        if (fnmatch(options->excludes[i], name, 0) == 0 || fnmatch(options->excludes[i], rel, 0) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void add_subdir(DirContents *contents, const char *rel) {
+    if (contents->subdir_count >= contents->subdir_capacity) {
+        int capacity = contents->subdir_capacity > 0 ? contents->subdir_capacity * 2 : 16;
+        char **subdirs = realloc(contents->subdirs, sizeof(char*) * capacity);
+        if (!subdirs) return;
+        contents->subdirs = subdirs;
+        contents->subdir_capacity = capacity;
+    }
+    char *copy = strdup(rel);
+    if (copy) contents->subdirs[contents->subdir_count++] = copy;
+}
+
+static void handle_entry(const Walk *w, const WalkTask *task, int fd, const char *name,
+                         unsigned char type, DirContents *contents) {
+    if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) return;
+
+    const DirWalkOptions *options = w->options;
+    char rel[PATH_MAX];
+    if (task->rel[0]) snprintf(rel, sizeof(rel), "%s/%s", task->rel, name);
+    else snprintf(rel, sizeof(rel), "%s", name);
+
+    // Walking part of a larger tree: match excludes against the path within it
+    char full[2 * PATH_MAX];
+    const char *match = rel;
+    if (options->exclude_prefix && options->exclude_prefix[0]) {
+        snprintf(full, sizeof(full), "%s/%s", options->exclude_prefix, rel);
+        match = full;
+    }
+    if (dir_walk_excluded(options, name, match)) return;
+
+    // d_type saves a stat for plain files and directories; symlinks are followed
+    struct stat st;
+    bool have_stat = false;
+    if (type == DT_LNK || type == DT_UNKNOWN) {
+        if (fstatat(fd, name, &st, 0) != 0) return;
+        have_stat = true;
+        type = S_ISDIR(st.st_mode) ? DT_DIR : S_ISREG(st.st_mode) ? DT_REG : DT_UNKNOWN;
+    }
+
+    if (type == DT_DIR) {
+        if (options->recursive && (options->max_depth <= 0 || task->depth < options->max_depth)) {
+            add_subdir(contents, rel);
+        }
+    } else if (type == DT_REG) {
+        if (options->accept && !options->accept(name)) return;
+
+        // The thumbnail cache needs the file's identity, so kept files are stat()ed
+        if (!have_stat && fstatat(fd, name, &st, 0) != 0) return;
+        ThumbnailStamp stamp = {(int64_t)st.st_mtime, (int64_t)st.st_size, (uint64_t)st.st_ino};
+        scan_directory_add(&contents->files, rel, &stamp);
+    }
+}
+
+#ifdef __linux__
+struct linux_dirent64 {
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+#endif
+
+static void read_entries(const Walk *w, const WalkTask *task, int fd, DirContents *contents) {
+#ifdef __linux__
+    union {
+        char bytes[32768];
+        uint64_t align;
+    } buffer;
+
+    for (;;) {
+        long n = syscall(SYS_getdents64, fd, buffer.bytes, sizeof(buffer.bytes));
+        if (n <= 0) break;
+
+        for (long offset = 0; offset < n;) {
+            const struct linux_dirent64 *entry = (const struct linux_dirent64*)(buffer.bytes + offset);
+            handle_entry(w, task, fd, entry->d_name, entry->d_type, contents);
+            offset += entry->d_reclen;
+        }
+    }
+#else
+    int dup_fd = dup(fd);
+    DIR *dir = dup_fd >= 0 ? fdopendir(dup_fd) : NULL;
+    if (!dir) {
+        if (dup_fd >= 0) close(dup_fd);
+        return;
+    }
+
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        handle_entry(w, task, fd, entry->d_name, entry->d_type, contents);
+    }
+    closedir(dir);
+#endif
+}
+
+/* Read one directory and publish its files and subdirectories */
+static void run_task(Walk *w, const WalkTask *task) {
+    int fd = openat(w->root_fds[task->root], task->rel[0] ? task->rel : ".",
+                    O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) return;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return;
+    }
+    int64_t mtime_ns = (int64_t)st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+
+    ScanDirectory *scan = &w->scans[task->root];
+    pthread_mutex_lock(&w->lock);
+    bool first_visit = mark_visited(w, st.st_dev, st.st_ino, task->root);
+    if (first_visit) {
+        if (task->depth == 0) {
+            scan->dir_mtime_ns = mtime_ns;
+            scan->dir_inode = (uint64_t)st.st_ino;
+        } else {
+            scan_directory_add_subdir(scan, task->rel, mtime_ns, (uint64_t)st.st_ino);
+        }
+    }
+    pthread_mutex_unlock(&w->lock);
+
+    if (!first_visit) {
+        close(fd);
+        return;
+    }
+
+    DirContents contents;
+    memset(&contents, 0, sizeof(contents));
+    read_entries(w, task, fd, &contents);
+    close(fd);
+
+    pthread_mutex_lock(&w->lock);
+
+    // Hand the entries over without copying the names
+    if (contents.files.count > 0) {
+        int needed = scan->count + contents.files.count;
+        if (needed > scan->capacity) {
+            ScanEntry *entries = realloc(scan->entries, sizeof(ScanEntry) * needed);
+            if (entries) {
+                scan->entries = entries;
+                scan->capacity = needed;
+            }
+        }
+        if (needed <= scan->capacity) {
+            memcpy(scan->entries + scan->count, contents.files.entries, sizeof(ScanEntry) * contents.files.count);
+            scan->count = needed;
+            contents.files.count = 0;
+        }
+    }
+
+    for (int i = 0; i < contents.subdir_count; i++) {
+        push_task(w, st.st_dev, task->root, task->depth + 1, contents.subdirs[i]);
+    }
+    if (contents.subdir_count > 0) pthread_cond_broadcast(&w->wake);
+    pthread_mutex_unlock(&w->lock);
+
+    scan_directory_free(&contents.files);
+    for (int i = 0; i < contents.subdir_count; i++) {
+        free(contents.subdirs[i]);
+    }
+    free(contents.subdirs);
+}
+
+static void* walk_worker(void *data) {
+    Walk *w = data;
+
+    pthread_mutex_lock(&w->lock);
+    for (;;) {
+        int device;
+        WalkTask *task = take_task(w, &device);
+        if (task) {
+            pthread_mutex_unlock(&w->lock);
+            // Once cancelled the remaining tasks are drained without being read
+            if (!w->options->cancelled || !w->options->cancelled(w->options->cancel_data)) {
+                run_task(w, task);
+            }
+            free(task->rel);
+            free(task);
+            pthread_mutex_lock(&w->lock);
+
+            w->devices[device].running--;
+            w->pending--;
+            pthread_cond_broadcast(&w->wake);
+            continue;
+        }
+
+        if (w->pending == 0) break;
+        pthread_cond_wait(&w->wake, &w->lock);
+    }
+    pthread_mutex_unlock(&w->lock);
+    return NULL;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                 Public API                                 */
+/* -------------------------------------------------------------------------- */
+
+void dir_walk(const char *const *roots, int root_count, const DirWalkOptions *options,
+              ScanDirectory *scans, bool *opened) {
+    Walk w;
+    memset(&w, 0, sizeof(w));
+    w.options = options;
+    w.scans = scans;
+    w.root_fds = malloc(sizeof(int) * (root_count > 0 ? root_count : 1));
+    pthread_mutex_init(&w.lock, NULL);
+    pthread_cond_init(&w.wake, NULL);
+
+    for (int i = 0; i < root_count; i++) {
+        scan_directory_init(&scans[i]);
+
+        struct stat st;
+        int fd = w.root_fds ? open(roots[i], O_RDONLY | O_DIRECTORY | O_CLOEXEC) : -1;
+        if (fd >= 0 && fstat(fd, &st) != 0) {
+            close(fd);
+            fd = -1;
+        }
+        if (w.root_fds) w.root_fds[i] = fd;
+        if (opened) opened[i] = fd >= 0;
+
+        if (fd >= 0) push_task(&w, st.st_dev, i, 0, "");
+    }
+
+    int threads = options->threads > 0 ? options->threads : DIR_WALK_DEFAULT_THREADS;
+    pthread_t *workers = calloc(threads, sizeof(pthread_t));
+    int started = 0;
+    for (int i = 0; workers && i < threads; i++) {
+        if (pthread_create(&workers[i], NULL, walk_worker, &w) != 0) break;
+        started++;
+    }
+
+    // No threads at all: walk on this one
+    if (started == 0) walk_worker(&w);
+    for (int i = 0; i < started; i++) {
+        pthread_join(workers[i], NULL);
+    }
+    free(workers);
+
+    for (int i = 0; i < root_count; i++) {
+        scan_directory_sort(&scans[i]);
+        if (w.root_fds && w.root_fds[i] >= 0) close(w.root_fds[i]);
+    }
+
+    free(w.root_fds);
+    free(w.devices);
+    free(w.visited);
+    pthread_mutex_destroy(&w.lock);
+    pthread_cond_destroy(&w.wake);
+}
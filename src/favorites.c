@@ -0,0 +1,356 @@
+/**
+ * @file favorites.c
+ * @brief Journaled store of favorite wallpaper paths
+ *
+ * The set is an open-addressed table of paths keyed by XXH64, owned by the
+ * caller's thread. Changes go to the writer thread as a queue of journal
+ * lines. Compaction rebuilds the state from the files themselves rather
+ * than from the caller's set, so the two threads share only the queue.
+ *
+ * Replaying a journal over the base file it was folded into gives the same
+ * set, so a crash between writing the new base file and emptying the
+ * journal loses nothing. A last line cut short by a crash has no newline
+ * and is skipped.
+ */
+
+#define _GNU_SOURCE
+#include "favorites.h"
+#include "hash.h"
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+typedef struct {
+    uint64_t hash;
+    char *path;                 /* NULL for an empty slot */
+    bool favorite;              /* Unmarked paths stay, so lookups never see holes */
+} FavoriteSlot;
+
+typedef struct {
+    FavoriteSlot *slots;
+    int size;                   /* A power of two */
+    int used;
+    int count;                  /* Slots marked favorite */
+} FavoriteSet;
+
+typedef struct JournalRecord {
+    struct JournalRecord *next;
+    bool favorite;
+    char path[];
+} JournalRecord;
+
+struct FavoritesStore {
+    FavoriteSet set;
+    char path[4096];
+    char journal_path[4096];
+    int compact_after;
+    int journal_lines;          /* Lines in the journal; the writer's once it runs */
+
+    pthread_t thread;
+    bool thread_started;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;        /* Records queued or quit set */
+    pthread_cond_t idle;        /* Queue drained and written */
+    JournalRecord *head;
+    JournalRecord *tail;
+    bool busy;                  /* Writer is writing a batch */
+    bool quit;
+};
+
+/* -------------------------------------------------------------------------- */
+/*                                    Set                                     */
+/* -------------------------------------------------------------------------- */
+
+static uint64_t path_hash(const char *dir, size_t dir_len, const char *name) {
+    HashState state;
+    hash_reset(&state, 0);
+    hash_update(&state, dir, dir_len);
+    hash_update(&state, "/", 1);
+    hash_update(&state, name, strlen(name));
+    return hash_digest(&state);
+}
+
+static bool path_equals(const char *path, const char *dir, size_t dir_len, const char *name) {
+    return strncmp(path, dir, dir_len) == 0 && path[dir_len] == '/' && strcmp(path + dir_len + 1, name) == 0;
+}
+
+static int set_find(const FavoriteSet *set, uint64_t hash, const char *dir, size_t dir_len, const char *name) {
+    if (set->size == 0) return -1;
+    int mask = set->size - 1;
+    for (int slot = (int)(hash & (uint64_t)mask); set->slots[slot].path; slot = (slot + 1) & mask) {
+        if (set->slots[slot].hash == hash && path_equals(set->slots[slot].path, dir, dir_len, name)) {
+            return slot;
+        }
+    }
+    return -1;
+}
+
+static bool set_grow(FavoriteSet *set) {
+    int size = set->size > 0 ? set->size * 2 : 256;
+    FavoriteSlot *slots = calloc((size_t)size, sizeof(FavoriteSlot));
+    if (!slots) return false;
+
+    for (int i = 0; i < set->size; i++) {
+        if (!set->slots[i].path) continue;
+        int slot = (int)(set->slots[i].hash & (uint64_t)(size - 1));
+        while (slots[slot].path) slot = (slot + 1) & (size - 1);
+        slots[slot] = set->slots[i];
+    }
+    free(set->slots);
+    set->slots = slots;
+    set->size = size;
+    return true;
+}
+
+static bool set_put(FavoriteSet *set, const char *dir, size_t dir_len, const char *name, bool favorite) {
+    uint64_t hash = path_hash(dir, dir_len, name);
+    int slot = set_find(set, hash, dir, dir_len, name);
+    if (slot < 0) {
+        if (!favorite) return true;
+        if ((set->used + 1) * 2 > set->size && !set_grow(set)) return false;
+
+        size_t name_len = strlen(name);
+        char *path = malloc(dir_len + name_len + 2);
+        if (!path) return false;
+        memcpy(path, dir, dir_len);
+        path[dir_len] = '/';
+        memcpy(path + dir_len + 1, name, name_len + 1);
+
+        slot = (int)(hash & (uint64_t)(set->size - 1));
+        while (set->slots[slot].path) slot = (slot + 1) & (set->size - 1);
+        set->slots[slot].hash = hash;
+        set->slots[slot].path = path;
+        set->slots[slot].favorite = false;
+        set->used++;
+    }
+
+    FavoriteSlot *entry = &set->slots[slot];
+    if (entry->favorite != favorite) {
+        entry->favorite = favorite;
+        set->count += favorite ? 1 : -1;
+    }
+    return true;
+}
+
+/* Apply a whole path, split at its last slash; paths without one are ignored */
+static void set_put_path(FavoriteSet *set, const char *path, bool favorite) {
+    const char *slash = strrchr(path, '/');
+    if (slash) set_put(set, path, (size_t)(slash - path), slash + 1, favorite);
+}
+
+static void set_free(FavoriteSet *set) {
+    for (int i = 0; i < set->size; i++) {
+        free(set->slots[i].path);
+    }
+    free(set->slots);
+    memset(set, 0, sizeof(*set));
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                   Files                                    */
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief Read the base file and replay the journal over it
+ * @return Number of journal lines applied
+ */
+static int load_files(FavoriteSet *set, const char *path, const char *journal_path) {
+    char *line = NULL;
+    size_t capacity = 0;
+    ssize_t len;
+
+    FILE *f = fopen(path, "r");
+    if (f) {
+        while ((len = getline(&line, &capacity, f)) > 0) {
+            if (line[len - 1] == '\n') line[--len] = '\0';
+            if (len > 0) set_put_path(set, line, true);
+        }
+        fclose(f);
+    }
+
+    int lines = 0;
+    f = fopen(journal_path, "r");
+    if (f) {
+        while ((len = getline(&line, &capacity, f)) > 0) {
+            if (line[len - 1] != '\n') break;
+            line[len - 1] = '\0';
+            if (line[0] == '+' || line[0] == '-') {
+                set_put_path(set, line + 1, line[0] == '+');
+                lines++;
+            }
+        }
+        fclose(f);
+    }
+    free(line);
+    return lines;
+}
+
+/* Append a batch of records to the journal, freeing them; returns the lines written */
+static int append_journal(const char *journal_path, JournalRecord *records) {
+    FILE *f = fopen(journal_path, "a");
+    if (!f) fprintf(stderr, "Failed to save favorites to %s\n", journal_path);
+
+    int lines = 0;
+    while (records) {
+        JournalRecord *next = records->next;
+        if (f && fprintf(f, "%c%s\n", records->favorite ? '+' : '-', records->path) > 0) lines++;
+        free(records);
+        records = next;
+    }
+    if (f) fclose(f);
+    return lines;
+}
+
+/* Fold the journal into a new base file written beside the old one, then empty it */
+static bool compact_files(const char *path, const char *journal_path) {
+    FavoriteSet set;
+    memset(&set, 0, sizeof(set));
+    load_files(&set, path, journal_path);
+
+    char temp[4096 + 32];
+    snprintf(temp, sizeof(temp), "%s.%d.tmp", path, (int)getpid());
+    FILE *f = fopen(temp, "w");
+    bool ok = f != NULL;
+    for (int i = 0; ok && i < set.size; i++) {
+        if (set.slots[i].path && set.slots[i].favorite) {
+            ok = fprintf(f, "%s\n", set.slots[i].path) > 0;
+        }
+    }
+    if (f) ok = fclose(f) == 0 && ok;
+    set_free(&set);
+
+    if (ok) ok = rename(temp, path) == 0;
+    if (!ok) {
+        unlink(temp);
+        fprintf(stderr, "Failed to save favorites to %s\n", path);
+        return false;
+    }
+    unlink(journal_path);
+    return true;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                   Writer                                   */
+/* -------------------------------------------------------------------------- */
+
+/* Write one batch from the queue; the caller holds the lock, which is released meanwhile */
+static void write_batch(FavoritesStore *store) {
+    JournalRecord *batch = store->head;
+    store->head = store->tail = NULL;
+    store->busy = true;
+    pthread_mutex_unlock(&store->lock);
+
+    store->journal_lines += append_journal(store->journal_path, batch);
+    if (store->journal_lines >= store->compact_after &&
+        compact_files(store->path, store->journal_path)) {
+        store->journal_lines = 0;
+    }
+
+    pthread_mutex_lock(&store->lock);
+    store->busy = false;
+    pthread_cond_broadcast(&store->idle);
+}
+
+static void* writer_main(void *data) {
+    FavoritesStore *store = data;
+
+    pthread_mutex_lock(&store->lock);
+    for (;;) {
+        while (!store->head && !store->quit) {
+            pthread_cond_wait(&store->wake, &store->lock);
+        }
+        if (!store->head) break;
+        write_batch(store);
+    }
+    pthread_mutex_unlock(&store->lock);
+
+    if (store->journal_lines > 0) compact_files(store->path, store->journal_path);
+    return NULL;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                Public API                                  */
+/* -------------------------------------------------------------------------- */
+
+FavoritesStore* favorites_open(const char *path, int compact_after) {
+    FavoritesStore *store = calloc(1, sizeof(FavoritesStore));
+    if (!store) return NULL;
+
+    snprintf(store->path, sizeof(store->path), "%s", path);
+    snprintf(store->journal_path, sizeof(store->journal_path), "%s.journal", path);
+    store->compact_after = compact_after > 0 ? compact_after : FAVORITES_COMPACT_AFTER;
+    store->journal_lines = load_files(&store->set, store->path, store->journal_path);
+
+    pthread_mutex_init(&store->lock, NULL);
+    pthread_cond_init(&store->wake, NULL);
+    pthread_cond_init(&store->idle, NULL);
+
+    // Without a writer, changes are written as they are made
+    store->thread_started = pthread_create(&store->thread, NULL, writer_main, store) == 0;
+    return store;
+}
+
+void favorites_close(FavoritesStore *store) {
+    if (!store) return;
+
+    if (store->thread_started) {
+        pthread_mutex_lock(&store->lock);
+        store->quit = true;
+        pthread_cond_signal(&store->wake);
+        pthread_mutex_unlock(&store->lock);
+        pthread_join(store->thread, NULL);
+    } else if (store->journal_lines > 0) {
+        compact_files(store->path, store->journal_path);
+    }
+
+    pthread_cond_destroy(&store->idle);
+    pthread_cond_destroy(&store->wake);
+    pthread_mutex_destroy(&store->lock);
+    set_free(&store->set);
+    free(store);
+}
+
+bool favorites_contains(const FavoritesStore *store, const char *dir, size_t dir_len, const char *name) {
+    int slot = set_find(&store->set, path_hash(dir, dir_len, name), dir, dir_len, name);
+    return slot >= 0 && store->set.slots[slot].favorite;
+}
+
+void favorites_set(FavoritesStore *store, const char *dir, size_t dir_len, const char *name, bool favorite) {
+    if (favorites_contains(store, dir, dir_len, name) == favorite) return;
+    if (!set_put(&store->set, dir, dir_len, name, favorite)) return;
+
+    size_t name_len = strlen(name);
+    JournalRecord *record = malloc(sizeof(JournalRecord) + dir_len + name_len + 2);
+    if (!record) return;
+    record->next = NULL;
+    record->favorite = favorite;
+    memcpy(record->path, dir, dir_len);
+    record->path[dir_len] = '/';
+    memcpy(record->path + dir_len + 1, name, name_len + 1);
+
+    pthread_mutex_lock(&store->lock);
+    if (store->tail) store->tail->next = record;
+    else store->head = record;
+    store->tail = record;
+    if (store->thread_started) {
+        pthread_cond_signal(&store->wake);
+    } else {
+        write_batch(store);
+    }
+    pthread_mutex_unlock(&store->lock);
+}
+
+int favorites_count(const FavoritesStore *store) {
+    return store->set.count;
+}
+
+void favorites_flush(FavoritesStore *store) {
+    pthread_mutex_lock(&store->lock);
+    while (store->head || store->busy) {
+        pthread_cond_wait(&store->idle, &store->lock);
+    }
+    pthread_mutex_unlock(&store->lock);
+}
@@ -0,0 +1,232 @@
+/**
+ * @file hash.c
+ * @brief XXH64 and MD5 implementations
+ */
+
+#include "hash.h"
+#include <string.h>
+
+#define PRIME1 0x9E3779B185EBCA87ULL
+#define PRIME2 0xC2B2AE3D27D4EB4FULL
+#define PRIME3 0x165667B19E3779F9ULL
+#define PRIME4 0x85EBCA77C2B2AE63ULL
+#define PRIME5 0x27D4EB2F165667C5ULL
+
+static inline uint64_t rotl64(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+/* Little-endian reads regardless of host byte order or alignment */
+static inline uint64_t read64(const uint8_t *p) {
+    return (uint64_t)p[0] | (uint64_t)p[1] << 8 | (uint64_t)p[2] << 16 | (uint64_t)p[3] << 24 |
+           (uint64_t)p[4] << 32 | (uint64_t)p[5] << 40 | (uint64_t)p[6] << 48 | (uint64_t)p[7] << 56;
+}
+
+static inline uint32_t read32(const uint8_t *p) {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static inline uint64_t round64(uint64_t acc, uint64_t input) {
+    acc += input * PRIME2;
+    acc = rotl64(acc, 31);
+    return acc * PRIME1;
+}
+
+static inline uint64_t merge_round(uint64_t acc, uint64_t val) {
+    acc ^= round64(0, val);
+    return acc * PRIME1 + PRIME4;
+}
+
+/**
+ * @brief Fold the remaining (< 32) bytes into the hash and avalanche
+ */
+static uint64_t finalize(uint64_t h, const uint8_t *p, size_t len) {
+    while (len >= 8) {
+        h ^= round64(0, read64(p));
+        h = rotl64(h, 27) * PRIME1 + PRIME4;
+        p += 8;
+        len -= 8;
+    }
+    if (len >= 4) {
+        h ^= (uint64_t)read32(p) * PRIME1;
+        h = rotl64(h, 23) * PRIME2 + PRIME3;
+        p += 4;
+        len -= 4;
+    }
+    while (len > 0) {
+        h ^= (*p++) * PRIME5;
+        h = rotl64(h, 11) * PRIME1;
+        len--;
+    }
+
+    h ^= h >> 33;
+    h *= PRIME2;
+    h ^= h >> 29;
+    h *= PRIME3;
+    h ^= h >> 32;
+    return h;
+}
+
+static uint64_t converge(const uint64_t v[4]) {
+    uint64_t h = rotl64(v[0], 1) + rotl64(v[1], 7) + rotl64(v[2], 12) + rotl64(v[3], 18);
+    for (int i = 0; i < 4; i++) {
+        h = merge_round(h, v[i]);
+    }
+    return h;
+}
+
+uint64_t hash_xxh64(const void *data, size_t len, uint64_t seed) {
+    HashState state;
+    hash_reset(&state, seed);
+    hash_update(&state, data, len);
+    return hash_digest(&state);
+}
+
+void hash_reset(HashState *state, uint64_t seed) {
+    memset(state, 0, sizeof(*state));
+    state->seed = seed;
+    state->v[0] = seed + PRIME1 + PRIME2;
+    state->v[1] = seed + PRIME2;
+    state->v[2] = seed;
+    state->v[3] = seed - PRIME1;
+}
+
+void hash_update(HashState *state, const void *data, size_t len) {
+    const uint8_t *p = data;
+    state->total_len += len;
+
+    // Top up a partial stripe first
+    if (state->buffered > 0) {
+        size_t take = 32 - state->buffered;
+        if (take > len) take = len;
+        memcpy(state->buffer + state->buffered, p, take);
+        state->buffered += (uint32_t)take;
+        p += take;
+        len -= take;
+
+        if (state->buffered < 32) return;
+        for (int i = 0; i < 4; i++) {
+            state->v[i] = round64(state->v[i], read64(state->buffer + i * 8));
+        }
+        state->buffered = 0;
+    }
+
+    // Full 32-byte stripes straight from the input
+    while (len >= 32) {
+        for (int i = 0; i < 4; i++) {
+            state->v[i] = round64(state->v[i], read64(p + i * 8));
+        }
+        p += 32;
+        len -= 32;
+    }
+
+    if (len > 0) {
+        memcpy(state->buffer, p, len);
+        state->buffered = (uint32_t)len;
+    }
+}
+
+uint64_t hash_digest(const HashState *state) {
+    uint64_t h;
+    if (state->total_len >= 32) {
+        h = converge(state->v);
+    } else {
+        h = state->seed + PRIME5;
+    }
+    h += state->total_len;
+    return finalize(h, state->buffer, state->buffered);
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                    MD5                                     */
+/* -------------------------------------------------------------------------- */
+
+/* RFC 1321 */
+
+static const uint32_t md5_k[64] = {
+    0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+    0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+    0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+    0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+    0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+    0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+    0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+    0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391
+};
+
+static const uint8_t md5_r[64] = {
+    7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22,
+    5,  9, 14, 20, 5,  9, 14, 20, 5,  9, 14, 20, 5,  9, 14, 20,
+    4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23,
+    6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21
+};
+
+static void md5_block(uint32_t h[4], const uint8_t *block) {
+    uint32_t w[16];
+    for (int i = 0; i < 16; i++) {
+        w[i] = read32(block + i * 4);
+    }
+
+    uint32_t a = h[0], b = h[1], c = h[2], d = h[3];
+    for (int i = 0; i < 64; i++) {
+        uint32_t f;
+        int g;
+        if (i < 16) {
+            f = (b & c) | (~b & d);
+            g = i;
+        } else if (i < 32) {
+            f = (d & b) | (~d & c);
+            g = (5 * i + 1) % 16;
+        } else if (i < 48) {
+            f = b ^ c ^ d;
+            g = (3 * i + 5) % 16;
+        } else {
+            f = c ^ (b | ~d);
+            g = (7 * i) % 16;
+        }
+
+        uint32_t t = d;
+        d = c;
+        c = b;
+        uint32_t x = a + f + md5_k[i] + w[g];
+        b = b + ((x << md5_r[i]) | (x >> (32 - md5_r[i])));
+        a = t;
+    }
+
+    h[0] += a;
+    h[1] += b;
+    h[2] += c;
+    h[3] += d;
+}
+
+void hash_md5(const void *data, size_t len, uint8_t digest[16]) {
+    uint32_t h[4] = {0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476};
+    const uint8_t *p = data;
+    size_t remaining = len;
+
+    while (remaining >= 64) {
+        md5_block(h, p);
+        p += 64;
+        remaining -= 64;
+    }
+
+    // Final block(s): tail, 0x80, zero padding, bit length
+    uint8_t tail[128];
+    memset(tail, 0, sizeof(tail));
+    memcpy(tail, p, remaining);
+    tail[remaining] = 0x80;
+    size_t tail_len = remaining < 56 ? 64 : 128;
+    uint64_t bits = (uint64_t)len * 8;
+    for (int i = 0; i < 8; i++) {
+        tail[tail_len - 8 + i] = (uint8_t)(bits >> (8 * i));
+    }
+    md5_block(h, tail);
+    if (tail_len == 128) md5_block(h, tail + 64);
+
+    for (int i = 0; i < 4; i++) {
+        digest[i * 4 + 0] = (uint8_t)h[i];
+        digest[i * 4 + 1] = (uint8_t)(h[i] >> 8);
+        digest[i * 4 + 2] = (uint8_t)(h[i] >> 16);
+        digest[i * 4 + 3] = (uint8_t)(h[i] >> 24);
+    }
+}
@@ -0,0 +1,441 @@
+/**
+ * @file library_watch.c
+ * @brief inotify watcher for the wallpaper directories
+ *
+ * One watch per directory, each remembering which configured directory it
+ * belongs to and its path relative to it. A directory reached from two
+ * configured directories shares one inotify watch but has two entries, so
+ * its events are reported for both. New subdirectories are watched and
+ * listed as they appear; that listing happens after the watch is added, so
+ * files created in between are reported twice rather than missed, and a
+ * repeated add is harmless to apply.
+ */
+
+#define _GNU_SOURCE
+#include "library_watch.h"
+#include "dir_walk.h"
+#include "thumbnails.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#ifdef __linux__
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#endif
+
+#ifdef __linux__
+
+#define WATCH_DIR_MASK (IN_CREATE | IN_CLOSE_WRITE | IN_MOVED_TO | IN_DELETE | IN_MOVED_FROM | \
+                        IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR)
+
+typedef struct {
+    int wd;
+    int dir;                    /* Configured directory */
+    int depth;                  /* 0 for the configured directory itself */
+    char *rel;
+} WatchEntry;
+
+struct LibraryWatch {
+    SDL_Thread *thread;
+    int inotify_fd;
+    int stop_pipe[2];
+    Config config;
+    const char *excludes[MAX_EXCLUDES];
+    DirWalkOptions options;
+
+    WatchEntry *watches;        /* Watcher thread only */
+    int watch_count;
+    int watch_capacity;
+    bool warned_limit;
+
+    SDL_Mutex *lock;            /* Guards the queue */
+    LibraryChange *queue;
+    int queue_count;
+    int queue_capacity;
+};
+
+#else
+
+struct LibraryWatch {
+    int unused;
+};
+
+#endif
+
+static Uint32 watch_event_type = 0;
+
+Uint32 library_watch_event(void) {
+    if (watch_event_type == 0) {
+        watch_event_type = SDL_RegisterEvents(1);
+    }
+    return watch_event_type;
+}
+
+void library_watch_free_changes(LibraryChange *changes, int count) {
+    for (int i = 0; i < count; i++) {
+        free(changes[i].rel);
+    }
+    free(changes);
+}
+
+#ifdef __linux__
+
+/* -------------------------------------------------------------------------- */
+/*                                Change queue                                */
+/* -------------------------------------------------------------------------- */
+
+static void queue_change(LibraryWatch *watch, LibraryChangeKind kind, int dir, const char *rel,
+                         const ThumbnailStamp *stamp) {
+    char *copy = strdup(rel);
+    if (!copy) return;
+
+    SDL_LockMutex(watch->lock);
+    if (watch->queue_count >= watch->queue_capacity) {
+        int capacity = watch->queue_capacity > 0 ? watch->queue_capacity * 2 : 64;
+        LibraryChange *queue = realloc(watch->queue, sizeof(LibraryChange) * capacity);
+        if (!queue) {
+            SDL_UnlockMutex(watch->lock);
+            free(copy);
+            return;
+        }
+        watch->queue = queue;
+        watch->queue_capacity = capacity;
+    }
+
+    LibraryChange *change = &watch->queue[watch->queue_count++];
+    change->kind = kind;
+    change->dir = dir;
+    change->rel = copy;
+    if (stamp) change->stamp = *stamp;
+    else memset(&change->stamp, 0, sizeof(change->stamp));
+
+    // One event per batch; the main loop takes the whole queue at once
+    bool first = watch->queue_count == 1;
+    SDL_UnlockMutex(watch->lock);
+
+    if (first) {
+        SDL_Event event;
+        SDL_zero(event);
+        event.type = watch_event_type;
+        SDL_PushEvent(&event);
+    }
+}
+
+LibraryChange* library_watch_take(LibraryWatch *watch, int *count) {
+    SDL_LockMutex(watch->lock);
+    LibraryChange *changes = watch->queue;
+    *count = watch->queue_count;
+    watch->queue = NULL;
+    watch->queue_count = 0;
+    watch->queue_capacity = 0;
+    SDL_UnlockMutex(watch->lock);
+    return changes;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                  Watches                                   */
+/* -------------------------------------------------------------------------- */
+
+static const char* dir_path(const LibraryWatch *watch, int dir) {
+    return dir == 0 ? watch->config.wallpaper_dir : watch->config.wallpaper_dirs[dir - 1];
+}
+
+static void full_path(const LibraryWatch *watch, int dir, const char *rel, char *buffer, size_t size) {
+    if (rel[0]) snprintf(buffer, size, "%s/%s", dir_path(watch, dir), rel);
+    else snprintf(buffer, size, "%s", dir_path(watch, dir));
+}
+
+static void join_rel(const char *parent, const char *name, char *buffer, size_t size) {
+    if (parent[0]) snprintf(buffer, size, "%s/%s", parent, name);
+    else snprintf(buffer, size, "%s", name);
+}
+
+static void add_watch(LibraryWatch *watch, int dir, int depth, const char *rel) {
+    char path[4096];
+    full_path(watch, dir, rel, path, sizeof(path));
+
+    int wd = inotify_add_watch(watch->inotify_fd, path, WATCH_DIR_MASK);
+    if (wd < 0) {
+        if (!watch->warned_limit) {
+            fprintf(stderr, "Warning: cannot watch %s for changes: %s\n", path, strerror(errno));
+            watch->warned_limit = true;
+        }
+        return;
+    }
+
+    for (int i = 0; i < watch->watch_count; i++) {
+        const WatchEntry *entry = &watch->watches[i];
+        if (entry->wd == wd && entry->dir == dir && strcmp(entry->rel, rel) == 0) return;
+    }
+
+    if (watch->watch_count >= watch->watch_capacity) {
+        int capacity = watch->watch_capacity > 0 ? watch->watch_capacity * 2 : 32;
+        WatchEntry *watches = realloc(watch->watches, sizeof(WatchEntry) * capacity);
+        if (!watches) return;
+        watch->watches = watches;
+        watch->watch_capacity = capacity;
+    }
+
+    WatchEntry *entry = &watch->watches[watch->watch_count++];
+    entry->wd = wd;
+    entry->dir = dir;
+    entry->depth = depth;
+    entry->rel = strdup(rel);
+    if (!entry->rel) watch->watch_count--;
+}
+
+/* Forget the watches of a directory and everything below it */
+static void remove_watches(LibraryWatch *watch, int dir, const char *rel) {
+    size_t rel_len = strlen(rel);
+    for (int i = 0; i < watch->watch_count;) {
+        WatchEntry *entry = &watch->watches[i];
+        bool below = entry->dir == dir &&
+                     (rel_len == 0 || (strncmp(entry->rel, rel, rel_len) == 0 &&
+                                       (entry->rel[rel_len] == '\0' || entry->rel[rel_len] == '/')));
+        if (!below) {
+            i++;
+            continue;
+        }
+
+        // Another configured directory may share the inotify watch
+        bool shared = false;
+        for (int j = 0; j < watch->watch_count && !shared; j++) {
+            shared = j != i && watch->watches[j].wd == entry->wd;
+        }
+        if (!shared) inotify_rm_watch(watch->inotify_fd, entry->wd);
+
+        free(entry->rel);
+        watch->watches[i] = watch->watches[--watch->watch_count];
+    }
+}
+
+static bool accept_none(const char *name) {
+    (void)name;
+    return false;
+}
+
+/**
+ * @brief Watch a directory and the subdirectories within the depth limit
+ * @param report Also report the image files found as added
+ */
+static void watch_tree(LibraryWatch *watch, int dir, int depth, const char *rel, bool report) {
+    add_watch(watch, dir, depth, rel);
+    if (!watch->config.recursive && !report) return;
+
+    // List what is already there, relative to this directory
+    DirWalkOptions options = watch->options;
+    options.exclude_prefix = rel;
+    if (!report) options.accept = accept_none;
+    if (options.max_depth > 0) {
+        int remaining = options.max_depth - depth;
+        options.recursive = options.recursive && remaining > 0;
+        options.max_depth = remaining > 0 ? remaining : 0;
+    }
+    options.threads = 2;
+
+    char path[4096];
+    full_path(watch, dir, rel, path, sizeof(path));
+    const char *roots[] = {path};
+    ScanDirectory scan;
+    bool opened;
+    dir_walk(roots, 1, &options, &scan, &opened);
+
+    char child[4096];
+    for (int i = 0; opened && i < scan.subdir_count; i++) {
+        const char *sub = scan.subdirs[i].name;
+        int sub_depth = depth + 1;
+        for (const char *c = sub; *c; c++) sub_depth += *c == '/';
+        join_rel(rel, sub, child, sizeof(child));
+        add_watch(watch, dir, sub_depth, child);
+    }
+    for (int i = 0; report && opened && i < scan.count; i++) {
+        join_rel(rel, scan.entries[i].name, child, sizeof(child));
+        queue_change(watch, LIBRARY_CHANGE_ADDED, dir, child, &scan.entries[i].stamp);
+    }
+    scan_directory_free(&scan);
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                   Events                                   */
+/* -------------------------------------------------------------------------- */
+
+static void handle_event(LibraryWatch *watch, const WatchEntry *entry, const struct inotify_event *ev) {
+    if (ev->mask & (IN_DELETE_SELF | IN_MOVE_SELF)) {
+        // Subdirectories are reported by their parent; only the top needs this
+        if (entry->depth == 0) {
+            queue_change(watch, LIBRARY_CHANGE_REMOVED_DIR, entry->dir, "", NULL);
+            remove_watches(watch, entry->dir, "");
+        }
+        return;
+    }
+    if (ev->len == 0) return;
+
+    char rel[4096];
+    join_rel(entry->rel, ev->name, rel, sizeof(rel));
+    if (dir_walk_excluded(&watch->options, ev->name, rel)) return;
+
+    if (ev->mask & IN_ISDIR) {
+        if (ev->mask & (IN_DELETE | IN_MOVED_FROM)) {
+            queue_change(watch, LIBRARY_CHANGE_REMOVED_DIR, entry->dir, rel, NULL);
+            remove_watches(watch, entry->dir, rel);
+        } else if (ev->mask & (IN_CREATE | IN_MOVED_TO)) {
+            int max_depth = watch->config.max_depth;
+            if (watch->config.recursive && (max_depth <= 0 || entry->depth < max_depth)) {
+                watch_tree(watch, entry->dir, entry->depth + 1, rel, true);
+            }
+        }
+        return;
+    }
+
+    if (ev->mask & (IN_DELETE | IN_MOVED_FROM)) {
+        queue_change(watch, LIBRARY_CHANGE_REMOVED, entry->dir, rel, NULL);
+        return;
+    }
+
+    // Wait for a created file to be closed, unless it is a link and never will be
+    char path[4096];
+    struct stat st;
+    full_path(watch, entry->dir, rel, path, sizeof(path));
+    if ((ev->mask & IN_CREATE) && (lstat(path, &st) != 0 || !S_ISLNK(st.st_mode))) return;
+    if (!wallpaper_is_image_file(ev->name) || stat(path, &st) != 0 || !S_ISREG(st.st_mode)) return;
+
+    ThumbnailStamp stamp = {(int64_t)st.st_mtime, (int64_t)st.st_size, (uint64_t)st.st_ino};
+    queue_change(watch, LIBRARY_CHANGE_ADDED, entry->dir, rel, &stamp);
+}
+
+static void handle_events(LibraryWatch *watch, const char *buffer, ssize_t length) {
+    for (ssize_t offset = 0; offset < length;) {
+        const struct inotify_event *ev = (const struct inotify_event*)(buffer + offset);
+        offset += (ssize_t)sizeof(struct inotify_event) + ev->len;
+
+        if (ev->mask & IN_Q_OVERFLOW) {
+            queue_change(watch, LIBRARY_CHANGE_RESCAN, 0, "", NULL);
+            continue;
+        }
+        if (ev->mask & IN_IGNORED) {
+            for (int i = 0; i < watch->watch_count;) {
+                if (watch->watches[i].wd != ev->wd) {
+                    i++;
+                    continue;
+                }
+                free(watch->watches[i].rel);
+                watch->watches[i] = watch->watches[--watch->watch_count];
+            }
+            continue;
+        }
+
+        // Copied, since handling can add and remove entries
+        for (int i = 0; i < watch->watch_count; i++) {
+            if (watch->watches[i].wd != ev->wd) continue;
+            WatchEntry entry = watch->watches[i];
+            entry.rel = strdup(entry.rel);
+            if (!entry.rel) continue;
+            handle_event(watch, &entry, ev);
+            free(entry.rel);
+        }
+    }
+}
+
+static int watch_main(void *data) {
+    LibraryWatch *watch = data;
+
+    for (int dir = 0; dir <= watch->config.wallpaper_dirs_count; dir++) {
+        watch_tree(watch, dir, 0, "", false);
+    }
+
+    union {
+        char bytes[16384];
+        struct inotify_event align;
+    } buffer;
+
+    for (;;) {
+        struct pollfd fds[2] = {
+            {watch->inotify_fd, POLLIN, 0},
+            {watch->stop_pipe[0], POLLIN, 0}
+        };
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        if (fds[1].revents) break;
+
+        ssize_t length = read(watch->inotify_fd, buffer.bytes, sizeof(buffer.bytes));
+        if (length <= 0) continue;
+        handle_events(watch, buffer.bytes, length);
+    }
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                 Public API                                 */
+/* -------------------------------------------------------------------------- */
+
+LibraryWatch* library_watch_start(const Config *config) {
+    if (library_watch_event() == 0) return NULL;
+
+    LibraryWatch *watch = calloc(1, sizeof(LibraryWatch));
+    if (!watch) return NULL;
+    watch->stop_pipe[0] = watch->stop_pipe[1] = -1;
+    watch->config = *config;
+    watch->options = wallpaper_walk_options(&watch->config, watch->excludes);
+
+    watch->inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    watch->lock = SDL_CreateMutex();
+    if (watch->inotify_fd < 0 || !watch->lock || pipe2(watch->stop_pipe, O_CLOEXEC) != 0) {
+        fprintf(stderr, "Failed to start directory watcher\n");
+        library_watch_stop(watch);
+        return NULL;
+    }
+
+    watch->thread = SDL_CreateThread(watch_main, "library-watch", watch);
+    if (!watch->thread) {
+        fprintf(stderr, "Failed to start directory watcher: %s\n", SDL_GetError());
+        library_watch_stop(watch);
+        return NULL;
+    }
+    return watch;
+}
+
+void library_watch_stop(LibraryWatch *watch) {
+    if (!watch) return;
+
+    if (watch->thread) {
+        ssize_t written = write(watch->stop_pipe[1], "x", 1);
+        (void)written;
+        SDL_WaitThread(watch->thread, NULL);
+    }
+
+    for (int i = 0; i < watch->watch_count; i++) {
+        free(watch->watches[i].rel);
+    }
+    free(watch->watches);
+    library_watch_free_changes(watch->queue, watch->queue_count);
+    if (watch->inotify_fd >= 0) close(watch->inotify_fd);
+    if (watch->stop_pipe[0] >= 0) close(watch->stop_pipe[0]);
+    if (watch->stop_pipe[1] >= 0) close(watch->stop_pipe[1]);
+    if (watch->lock) SDL_DestroyMutex(watch->lock);
+    free(watch);
+}
+
+#else
+
+LibraryWatch* library_watch_start(const Config *config) {
+    (void)config;
+    return NULL;
+}
+
+LibraryChange* library_watch_take(LibraryWatch *watch, int *count) {
+    (void)watch;
+    *count = 0;
+    return NULL;
+}
+
+void library_watch_stop(LibraryWatch *watch) {
+    free(watch);
+}
+
+#endif
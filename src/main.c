@@ -6,6 +6,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <string.h>
 #include <SDL3/SDL.h>
 #ifdef HAVE_SDL_IMAGE
 #include <SDL3_image/SDL_image.h>
@@ -33,6 +34,112 @@ static void print_usage(const char *prog_name) {
     printf("  -v, --version       Show version information\n");
 }
 
+/**
+ * @brief Apply directory changes queued by the watcher
+ *
+ * The selection follows the wallpaper it was on, unless that one was removed.
+ */
+static void apply_library_changes(LibraryWatch *watch, WallpaperList *wallpapers, ThumbnailPipeline *pipeline,
+                                  const Config *config, int *selected_index) {
+    int count;
+    LibraryChange *changes = library_watch_take(watch, &count);
+    if (count == 0) return;
+    
+    char path[4096];
+    int selected = wallpaper_list_get(wallpapers, *selected_index);
+    char *selected_path = selected >= 0 ? SDL_strdup(wallpaper_list_path(wallpapers, selected, path, sizeof(path))) : NULL;
+    
+    bool rescan = false;
+    for (int i = 0; i < count; i++) {
+        rescan = rescan || changes[i].kind == LIBRARY_CHANGE_RESCAN;
+    }
+    
+    // Thumbnail jobs in flight are renumbered along with the list
+    bool changed = true;
+    if (rescan) {
+        wallpaper_list_reload(wallpapers, pipeline, config);
+    } else {
+        changed = wallpaper_list_apply_changes(wallpapers, pipeline, config, changes, count);
+    }
+    library_watch_free_changes(changes, count);
+    
+    if (changed) {
+        int visible = wallpaper_list_visible_count(wallpapers);
+        printf("Wallpaper directories changed, now %d wallpapers\n", wallpapers->count);
+        for (int i = 0; selected_path && i < visible; i++) {
+            wallpaper_list_path(wallpapers, wallpaper_list_get(wallpapers, i), path, sizeof(path));
+            if (strcmp(path, selected_path) == 0) {
+                *selected_index = i;
+                break;
+            }
+        }
+        if (*selected_index >= visible) *selected_index = visible > 0 ? visible - 1 : 0;
+    }
+    SDL_free(selected_path);
+}
+
+/**
+ * @brief Handle an event while the search bar is open
+ *
+ * Typed text extends the query and Backspace shortens it, refiltering as
+ * it goes. Enter closes the bar keeping the results; Escape clears them.
+ * The arrow keys still move the selection.
+ *
+ * @return Whether the event was consumed
+ */
+static bool handle_search_event(const SDL_Event *event, SDL_Window *window, WallpaperList *wallpapers,
+                                bool *search_mode, int *selected_index) {
+    char query[sizeof(wallpapers->search_query)];
+    memcpy(query, wallpapers->search_query, sizeof(query));
+    size_t len = strlen(query);
+    
+    if (event->type == SDL_EVENT_TEXT_INPUT) {
+        SDL_strlcat(query, event->text.text, sizeof(query));
+    } else if (event->type == SDL_EVENT_KEY_DOWN) {
+        switch (event->key.scancode) {
+            case SDL_SCANCODE_ESCAPE:
+                query[0] = '\0';
+                *search_mode = false;
+                SDL_StopTextInput(window);
+                break;
+                
+            case SDL_SCANCODE_RETURN:
+            case SDL_SCANCODE_KP_ENTER:
+                *search_mode = false;
+                SDL_StopTextInput(window);
+                break;
+                
+            case SDL_SCANCODE_BACKSPACE:
+                // Drop the last UTF-8 character, not just its final byte
+                while (len > 0 && ((unsigned char)query[--len] & 0xC0) == 0x80) {}
+                query[len] = '\0';
+                break;
+                
+            case SDL_SCANCODE_LEFT:
+            case SDL_SCANCODE_RIGHT:
+            case SDL_SCANCODE_UP:
+            case SDL_SCANCODE_DOWN:
+                return false;
+                
+            default:
+                // Letters arrive as text input; keep them from acting as shortcuts
+                return true;
+        }
+    } else {
+        return false;
+    }
+    
+    if (strcmp(query, wallpapers->search_query) != 0) {
+        if (query[0]) {
+            wallpaper_list_filter(wallpapers, query);
+        } else {
+            wallpaper_list_clear_filter(wallpapers);
+        }
+        *selected_index = 0;
+    }
+    return true;
+}
+
 /**
  * @brief Main function
  */
@@ -95,12 +202,7 @@ int main(int argc, char *argv[]) {
         printf("  Additional directory: %s\n", config.wallpaper_dirs[i]);
     }
     
-    WallpaperList wallpapers;
-    if (config.wallpaper_dirs_count > 0) {
-        wallpapers = wallpaper_list_scan_multiple(&config);
-    } else {
-        wallpapers = wallpaper_list_scan(config.wallpaper_dir);
-    }
+    WallpaperList wallpapers = wallpaper_list_scan_multiple(&config);
     
     if (wallpapers.count == 0) {
         fprintf(stderr, "No wallpapers found\n");
@@ -109,18 +211,20 @@ int main(int argc, char *argv[]) {
     }
     
     printf("Found %d wallpapers\n", wallpapers.count);
-    
-    // Generate thumbnails
-    printf("Generating thumbnails...\n");
-    wallpaper_list_generate_thumbnails(&wallpapers, &config);
 
     // Random mode with roulette animation
     if (random_mode) {
+        // The roulette spins through the whole list, so wait for every thumbnail
+        printf("Generating thumbnails...\n");
+        wallpaper_list_generate_thumbnails(&wallpapers, &config);
+        
         printf("Starting roulette animation...\n");
         RouletteContext *roulette = roulette_init(&config, &wallpapers);
         if (!roulette) {
             fprintf(stderr, "Failed to initialize roulette\n");
             wallpaper_list_free(&wallpapers);
+            thumbnail_cache_close();
+            wallpaper_favorites_close();
             SDL_Quit();
             return 1;
         }
@@ -129,15 +233,19 @@ int main(int argc, char *argv[]) {
         roulette_cleanup(roulette);
         
         // Apply the selected wallpaper
-        Wallpaper *selected = wallpaper_list_get(&wallpapers, selected_index);
-        if (selected) {
-            printf("Applying selected wallpaper: %s\n", selected->path);
-            wallpaper_apply(selected->path, &config);
-            wallpaper_generate_palette(selected->path, &config);
+        int selected = wallpaper_list_get(&wallpapers, selected_index);
+        if (selected >= 0) {
+            char path[4096];
+            wallpaper_list_path(&wallpapers, selected, path, sizeof(path));
+            printf("Applying selected wallpaper: %s\n", path);
+            wallpaper_apply(path, &config);
+            wallpaper_generate_palette(path, &config);
         }
         
         // Cleanup and exit
         wallpaper_list_free(&wallpapers);
+        thumbnail_cache_close();
+        wallpaper_favorites_close();
         SDL_Quit();
         return 0;
     }
@@ -170,16 +278,67 @@ int main(int argc, char *argv[]) {
 #endif
         fprintf(stderr, "Failed to initialize renderer\n");
         wallpaper_list_free(&wallpapers);
+        wallpaper_favorites_close();
         SDL_Quit();
         return 1;
     }
 
+    // Thumbnails are loaded for what is on screen (plus a screen either side)
+    // and stream in as they finish; items draw as placeholders until then.
+    // Without a pipeline they load on this thread as they come into view.
+    ThumbnailPipeline *pipeline = thumbnail_pipeline_create(&config);
+    wallpaper_list_set_thumbnail_budget(&wallpapers, (size_t)config.thumbnail_memory_mb * 1024 * 1024);
+
+    // Listings taken from the scan index may miss files edited in place;
+    // check them in the background and reload if anything changed
+    WallpaperRescan *rescan = wallpapers.from_index ? wallpaper_rescan_start(&config) : NULL;
+    
+    // Files added to or removed from the directories while open are applied
+    // in place on the next frame
+    LibraryWatch *watch = library_watch_start(&config);
+    bool library_changed = false;
+    
+    // The search bar state lives on whichever renderer is drawing
+#ifdef USE_SHADERS
+    SDL_Window *window = gl_renderer ? gl_renderer->window : renderer->window;
+    bool *search_mode = gl_renderer ? &gl_renderer->search_mode : &renderer->search_mode;
+    int *selected_index = gl_renderer ? &gl_renderer->selected_index : &renderer->selected_index;
+#else
+    SDL_Window *window = renderer->window;
+    bool *search_mode = &renderer->search_mode;
+    int *selected_index = &renderer->selected_index;
+#endif
+
     // Main event loop
     bool running = true;
     SDL_Event event;
     
     while (running) {
         while (SDL_PollEvent(&event)) {
+            if (rescan && event.type == wallpaper_rescan_event()) {
+                wallpaper_list_reload(&wallpapers, pipeline, &config);
+                printf("Wallpaper directories changed, now %d wallpapers\n", wallpapers.count);
+
+                int last_index = wallpaper_list_visible_count(&wallpapers) - 1;
+                if (last_index < 0) last_index = 0;
+#ifdef USE_SHADERS
+                if (gl_renderer) {
+                    if (gl_renderer->selected_index > last_index) gl_renderer->selected_index = last_index;
+                } else
+#endif
+                if (renderer->selected_index > last_index) renderer->selected_index = last_index;
+                continue;
+            }
+            
+            if (watch && event.type == library_watch_event()) {
+                library_changed = true;
+                continue;
+            }
+            
+            if (*search_mode && handle_search_event(&event, window, &wallpapers, search_mode, selected_index)) {
+                continue;
+            }
+
             switch (event.type) {
                 case SDL_EVENT_QUIT:
                     running = false;
@@ -209,13 +368,13 @@ int main(int argc, char *argv[]) {
                         case SDL_SCANCODE_L:
 #ifdef USE_SHADERS
                             if (gl_renderer) {
-                                if (gl_renderer->selected_index < wallpapers.count - 1) {
+                                if (gl_renderer->selected_index < wallpaper_list_visible_count(&wallpapers) - 1) {
                                     gl_renderer->selected_index++;
                                     gl_renderer->target_scroll -= 220;
                                 }
                             } else
 #endif
-                            renderer_select_next(renderer, wallpapers.count - 1, &config);
+                            renderer_select_next(renderer, wallpaper_list_visible_count(&wallpapers) - 1, &config);
                             break;
                             
                         case SDL_SCANCODE_UP:
@@ -225,7 +384,7 @@ int main(int argc, char *argv[]) {
                             
                         case SDL_SCANCODE_DOWN:
                         case SDL_SCANCODE_J:
-                            renderer_select_down(renderer, wallpapers.count - 1, &config);
+                            renderer_select_down(renderer, wallpaper_list_visible_count(&wallpapers) - 1, &config);
                             break;
                             
                         case SDL_SCANCODE_G:
@@ -252,6 +411,11 @@ int main(int argc, char *argv[]) {
                             printf("Favorites filter: %s\n", wallpapers.show_favorites_only ? "ON" : "OFF");
                             break;
                             
+                        case SDL_SCANCODE_S:
+                            *search_mode = true;
+                            SDL_StartTextInput(window);
+                            break;
+                            
                         case SDL_SCANCODE_SLASH:
                             renderer->show_help = !renderer->show_help;
                             break;
@@ -265,11 +429,13 @@ int main(int argc, char *argv[]) {
                             sel_idx = renderer->selected_index;
 #endif
                             if (sel_idx >= 0) {
-                                Wallpaper *wp = wallpaper_list_get(&wallpapers, sel_idx);
-                                if (wp) {
-                                    printf("Applying wallpaper: %s\n", wp->path);
-                                    wallpaper_apply(wp->path, &config);
-                                    wallpaper_generate_palette(wp->path, &config);
+                                int wp = wallpaper_list_get(&wallpapers, sel_idx);
+                                if (wp >= 0) {
+                                    char path[4096];
+                                    wallpaper_list_path(&wallpapers, wp, path, sizeof(path));
+                                    printf("Applying wallpaper: %s\n", path);
+                                    wallpaper_apply(path, &config);
+                                    wallpaper_generate_palette(path, &config);
                                     running = false;
                                 }
                             }
@@ -292,11 +458,13 @@ int main(int argc, char *argv[]) {
                                     renderer->selected_index = i;
                                     
                                     // Double-click to apply
-                                    Wallpaper *wp = wallpaper_list_get(&wallpapers, i);
-                                    if (wp) {
-                                        printf("Applying wallpaper: %s\n", wp->path);
-                                        wallpaper_apply(wp->path, &config);
-                                        wallpaper_generate_palette(wp->path, &config);
+                                    int wp = wallpaper_list_get(&wallpapers, i);
+                                    if (wp >= 0) {
+                                        char path[4096];
+                                        wallpaper_list_path(&wallpapers, wp, path, sizeof(path));
+                                        printf("Applying wallpaper: %s\n", path);
+                                        wallpaper_apply(path, &config);
+                                        wallpaper_generate_palette(path, &config);
                                         running = false;
                                     }
                                     break;
@@ -327,6 +495,38 @@ int main(int argc, char *argv[]) {
             }
         }
         
+        // Request the visible range with one screen of prefetch on each side;
+        // the selection is decoded first, then outwards in the direction of travel
+        int visible_count = wallpaper_list_visible_count(&wallpapers);
+        int first, last, focus;
+#ifdef USE_SHADERS
+        if (gl_renderer) {
+            gl_renderer_visible_range(gl_renderer, &config, visible_count, &first, &last);
+            focus = gl_renderer->selected_index;
+        } else
+#endif
+        {
+            renderer_visible_range(renderer, &config, visible_count, &first, &last);
+            focus = renderer->selected_index;
+        }
+        int margin = last - first;
+        wallpaper_list_request_range(&wallpapers, pipeline, &config, first - margin, last + margin, focus);
+        
+        // Pick up thumbnails finished since the last frame
+        if (pipeline && thumbnail_pipeline_outstanding(pipeline) > 0) {
+            wallpaper_list_collect_thumbnails(&wallpapers, pipeline);
+        }
+        
+        if (library_changed) {
+            library_changed = false;
+#ifdef USE_SHADERS
+            if (gl_renderer) {
+                apply_library_changes(watch, &wallpapers, pipeline, &config, &gl_renderer->selected_index);
+            } else
+#endif
+            apply_library_changes(watch, &wallpapers, pipeline, &config, &renderer->selected_index);
+        }
+        
         // Render
 #ifdef USE_SHADERS
         if (gl_renderer) {
@@ -338,6 +538,9 @@ int main(int argc, char *argv[]) {
     }
 
     // Cleanup
+    library_watch_stop(watch);
+    wallpaper_rescan_finish(rescan);
+    thumbnail_pipeline_destroy(pipeline);
 #ifdef USE_SHADERS
     if (gl_renderer) {
         gl_renderer_cleanup(gl_renderer);
@@ -345,6 +548,8 @@ int main(int argc, char *argv[]) {
 #endif
     renderer_cleanup(renderer);
     wallpaper_list_free(&wallpapers);
+    thumbnail_cache_close(); // Cached thumbnails point into the atlas mapping
+    wallpaper_favorites_close(); // Writes out the last toggles
     SDL_Quit();
     
     fflush(stdout);
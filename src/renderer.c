@@ -1,4 +1,5 @@
 #include "renderer.h"
+#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 
@@ -17,6 +18,13 @@ Renderer* renderer_init(const Config *config) {
     r->search_mode = false;
     r->show_help = false;
     
+    r->tex_cache = NULL;
+    r->tex_cache_capacity = 0;
+    r->tex_cache_bytes = 0;
+    r->tex_cache_budget = (size_t)(config->texture_cache_mb > 0 ? config->texture_cache_mb : 1) * 1024 * 1024;
+    r->tex_lru_head = -1;
+    r->tex_lru_tail = -1;
+    
     // Create window
     r->window = SDL_CreateWindow(
         "vista - wallpaper switcher",
@@ -42,6 +50,151 @@ Renderer* renderer_init(const Config *config) {
     return r;
 }
 
+static void tex_lru_unlink(Renderer *r, int index) {
+    TextureCacheEntry *e = &r->tex_cache[index];
+    
+    if (e->lru_prev >= 0) r->tex_cache[e->lru_prev].lru_next = e->lru_next;
+    else r->tex_lru_head = e->lru_next;
+    
+    if (e->lru_next >= 0) r->tex_cache[e->lru_next].lru_prev = e->lru_prev;
+    else r->tex_lru_tail = e->lru_prev;
+    
+    e->lru_prev = -1;
+    e->lru_next = -1;
+}
+
+static void tex_lru_push_front(Renderer *r, int index) {
+    TextureCacheEntry *e = &r->tex_cache[index];
+    
+    e->lru_prev = -1;
+    e->lru_next = r->tex_lru_head;
+    if (r->tex_lru_head >= 0) r->tex_cache[r->tex_lru_head].lru_prev = index;
+    r->tex_lru_head = index;
+    if (r->tex_lru_tail < 0) r->tex_lru_tail = index;
+}
+
+static void tex_cache_release(Renderer *r, int index) {
+    TextureCacheEntry *e = &r->tex_cache[index];
+    if (!e->texture) return;
+    
+    tex_lru_unlink(r, index);
+    SDL_DestroyTexture(e->texture);
+    r->tex_cache_bytes -= e->bytes;
+    e->texture = NULL;
+    e->generation = 0;
+    e->bytes = 0;
+}
+
+static bool tex_cache_reserve(Renderer *r, int count) {
+    if (count <= r->tex_cache_capacity) return true;
+    
+    int new_capacity = r->tex_cache_capacity > 0 ? r->tex_cache_capacity : 64;
+    while (new_capacity < count) new_capacity *= 2;
+    
+    TextureCacheEntry *entries = realloc(r->tex_cache, sizeof(TextureCacheEntry) * new_capacity);
+    if (!entries) return false;
+    
+    for (int i = r->tex_cache_capacity; i < new_capacity; i++) {
+        entries[i].texture = NULL;
+        entries[i].generation = 0;
+        entries[i].bytes = 0;
+        entries[i].lru_prev = -1;
+        entries[i].lru_next = -1;
+    }
+    
+    r->tex_cache = entries;
+    r->tex_cache_capacity = new_capacity;
+    return true;
+}
+
+/**
+ * @brief Get the texture for a wallpaper, uploading its thumbnail only if needed
+ *
+ * Textures stay resident across frames and are released least-recently-drawn
+ * first once the cache exceeds its VRAM budget. A slot is reused only while
+ * it holds the same thumbnail generation, so a replaced thumbnail or a
+ * wallpaper that moved to another index is uploaded again.
+ */
+static SDL_Texture* tex_cache_get(Renderer *r, int index, SDL_Surface *surf, uint64_t generation) {
+    if (index < 0 || !tex_cache_reserve(r, index + 1)) return NULL;
+    
+    TextureCacheEntry *e = &r->tex_cache[index];
+    if (e->texture && e->generation == generation) {
+        tex_lru_unlink(r, index);
+        tex_lru_push_front(r, index);
+        return e->texture;
+    }
+    
+    // Thumbnail is new or was replaced since the last upload
+    tex_cache_release(r, index);
+    
+    SDL_Texture *tex = SDL_CreateTextureFromSurface(r->renderer, surf);
+    if (!tex) return NULL;
+    
+    e = &r->tex_cache[index];
+    e->texture = tex;
+    e->generation = generation;
+    e->bytes = (size_t)surf->w * surf->h * 4;
+    r->tex_cache_bytes += e->bytes;
+    tex_lru_push_front(r, index);
+    
+    // Evict from the cold end, never the texture we are about to draw
+    while (r->tex_cache_bytes > r->tex_cache_budget && r->tex_lru_tail != index) {
+        tex_cache_release(r, r->tex_lru_tail);
+    }
+    
+    return tex;
+}
+
+/**
+ * @brief Draw a wallpaper's thumbnail, or a placeholder while it is loading
+ */
+static void draw_thumbnail(Renderer *r, const WallpaperList *list, int wp, const SDL_FRect *dest) {
+    SDL_Surface *thumb = wallpaper_list_thumb(list, wp);
+    SDL_Texture *tex = thumb ? tex_cache_get(r, wp, thumb, wallpaper_list_thumb_generation(list, wp)) : NULL;
+    
+    if (tex) {
+        SDL_RenderTexture(r->renderer, tex, NULL, dest);
+    } else {
+        SDL_SetRenderDrawColor(r->renderer, 45, 45, 50, 255);
+        SDL_RenderFillRect(r->renderer, dest);
+    }
+}
+
+/* Items of a strip laid out at origin + i * step that overlap [0, extent) for any scroll in [lo, hi] */
+static void strip_range(float lo, float hi, float origin, float size, float step, float extent,
+                        int *first, int *last) {
+    *first = (int)floorf((-lo - origin - size) / step) + 1;
+    *last = (int)ceilf((extent - hi - origin) / step);
+}
+
+void renderer_visible_range(const Renderer *r, const Config *config, int count, int *first, int *last) {
+    // Cover the whole scroll animation, not just the current frame
+    float lo, hi;
+    int spacing = 20;
+    
+    if (r->view_mode == VIEW_MODE_HORIZONTAL) {
+        lo = fminf(r->current_scroll, r->target_scroll);
+        hi = fmaxf(r->current_scroll, r->target_scroll);
+        strip_range(lo, hi, 20.0f, (float)config->thumbnail_width,
+                    (float)(config->thumbnail_width + spacing), (float)config->window_width, first, last);
+    } else {
+        int cols = config->thumbnails_per_row > 0 ? config->thumbnails_per_row : 1;
+        int first_row, last_row;
+        lo = fminf(r->current_scroll_y, r->target_scroll_y);
+        hi = fmaxf(r->current_scroll_y, r->target_scroll_y);
+        strip_range(lo, hi, 20.0f, (float)config->thumbnail_height,
+                    (float)(config->thumbnail_height + spacing), (float)config->window_height,
+                    &first_row, &last_row);
+        *first = first_row * cols;
+        *last = last_row * cols;
+    }
+    
+    if (*first < 0) *first = 0;
+    if (*last > count) *last = count;
+    if (*last < *first) *last = *first;
+}
+
 void renderer_draw_frame(Renderer *r, const WallpaperList *list, const Config *config) {
     // Smooth scroll animation (lerp)
     const float smoothness = 0.15f;
@@ -53,20 +206,20 @@ void renderer_draw_frame(Renderer *r, const WallpaperList *list, const Config *c
     SDL_RenderClear(r->renderer);
     
     int visible_count = wallpaper_list_visible_count(list);
+    int first, last;
+    renderer_visible_range(r, config, visible_count, &first, &last);
     
     if (r->view_mode == VIEW_MODE_HORIZONTAL) {
         // Draw horizontal strip
-        int x = 20 + (int)r->current_scroll;
-        int y = (config->window_height - config->thumbnail_height) / 2;
         int spacing = 20;
+        int x = 20 + (int)r->current_scroll + first * (config->thumbnail_width + spacing);
+        int y = (config->window_height - config->thumbnail_height) / 2;
         
-        for (int i = 0; i < visible_count; i++) {
-            Wallpaper *wp = wallpaper_list_get((WallpaperList*)list, i);
-            if (wp && wp->thumb) {
-                SDL_Texture *tex = SDL_CreateTextureFromSurface(r->renderer, wp->thumb);
-                
+        for (int i = first; i < last; i++) {
+            int wp = wallpaper_list_get(list, i);
+            if (wp >= 0) {
                 SDL_FRect dest = {(float)x, (float)y, (float)config->thumbnail_width, (float)config->thumbnail_height};
-                SDL_RenderTexture(r->renderer, tex, NULL, &dest);
+                draw_thumbnail(r, list, wp, &dest);
                 
                 // Highlight selected
                 if (i == r->selected_index) {
@@ -77,8 +230,6 @@ void renderer_draw_frame(Renderer *r, const WallpaperList *list, const Config *c
                     SDL_FRect border2 = {dest.x-2, dest.y-2, dest.w+4, dest.h+4};
                     SDL_RenderRect(r->renderer, &border2);
                 }
-                
-                SDL_DestroyTexture(tex);
             }
             
             x += config->thumbnail_width + spacing;
@@ -90,19 +241,17 @@ void renderer_draw_frame(Renderer *r, const WallpaperList *list, const Config *c
         int start_x = 20;
         int start_y = 20 + (int)r->current_scroll_y;
         
-        for (int i = 0; i < visible_count; i++) {
-            Wallpaper *wp = wallpaper_list_get((WallpaperList*)list, i);
-            if (wp && wp->thumb) {
+        for (int i = first; i < last; i++) {
+            int wp = wallpaper_list_get(list, i);
+            if (wp >= 0) {
                 int col = i % cols;
                 int row = i / cols;
                 
                 int x = start_x + col * (config->thumbnail_width + spacing);
                 int y = start_y + row * (config->thumbnail_height + spacing);
                 
-                SDL_Texture *tex = SDL_CreateTextureFromSurface(r->renderer, wp->thumb);
-                
                 SDL_FRect dest = {(float)x, (float)y, (float)config->thumbnail_width, (float)config->thumbnail_height};
-                SDL_RenderTexture(r->renderer, tex, NULL, &dest);
+                draw_thumbnail(r, list, wp, &dest);
                 
                 // Highlight selected
                 if (i == r->selected_index) {
@@ -113,12 +262,24 @@ void renderer_draw_frame(Renderer *r, const WallpaperList *list, const Config *c
                     SDL_FRect border2 = {dest.x-2, dest.y-2, dest.w+4, dest.h+4};
                     SDL_RenderRect(r->renderer, &border2);
                 }
-                
-                SDL_DestroyTexture(tex);
             }
         }
     }
     
+    // Search bar while typing, or while a query is narrowing the list
+    if (r->search_mode || list->search_query[0] != '\0') {
+        char line[sizeof(list->search_query) + 48];
+        snprintf(line, sizeof(line), "Search: %s%s  (%d)", list->search_query, r->search_mode ? "_" : "",
+                 visible_count);
+        
+        SDL_SetRenderDrawBlendMode(r->renderer, SDL_BLENDMODE_BLEND);
+        SDL_SetRenderDrawColor(r->renderer, 0, 0, 0, 200);
+        SDL_FRect bar = {0.0f, 0.0f, (float)config->window_width, 24.0f};
+        SDL_RenderFillRect(r->renderer, &bar);
+        SDL_SetRenderDrawColor(r->renderer, 100, 200, 255, 255);
+        SDL_RenderDebugText(r->renderer, 8.0f, 8.0f, line);
+    }
+    
     // Draw help overlay if enabled
     if (r->show_help) {
         renderer_draw_help_overlay(r);
@@ -202,11 +363,16 @@ void renderer_draw_help_overlay(Renderer *r) {
     // g - Toggle grid/horizontal view
     // f - Toggle favorite
     // F2 - Filter favorites
+    // s - Search (Enter keeps the results, Esc clears them)
     // / or ? - Toggle help
     // q or Esc - Quit
 }
 
 void renderer_cleanup(Renderer *r) {
+    for (int i = 0; i < r->tex_cache_capacity; i++) {
+        if (r->tex_cache[i].texture) SDL_DestroyTexture(r->tex_cache[i].texture);
+    }
+    free(r->tex_cache);
     if (r->renderer) SDL_DestroyRenderer(r->renderer);
     if (r->window) SDL_DestroyWindow(r->window);
     free(r);
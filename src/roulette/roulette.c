@@ -386,8 +386,8 @@ void roulette_render(RouletteContext *ctx, WallpaperList *wallpapers) {
         int item_index = (base_index + i) % visible_count;
         if (item_index < 0) item_index += visible_count;
         
-        Wallpaper *wp = wallpaper_list_get(wallpapers, item_index);
-        if (!wp || !wp->thumb) continue;
+        int wp = wallpaper_list_get(wallpapers, item_index);
+        if (wp < 0 || !wallpaper_list_thumb(wallpapers, wp)) continue;
         
         // Calculate position - use floating point for perfect alignment
         // The center should show the item at scroll_position
@@ -417,7 +417,7 @@ void roulette_render(RouletteContext *ctx, WallpaperList *wallpapers) {
         };
         
         // Create texture from surface if needed
-        SDL_Texture *texture = SDL_CreateTextureFromSurface(ctx->renderer, wp->thumb);
+        SDL_Texture *texture = SDL_CreateTextureFromSurface(ctx->renderer, wallpaper_list_thumb(wallpapers, wp));
         if (texture) {
             // Set alpha based on distance
             SDL_SetTextureAlphaMod(texture, (Uint8)(255 * dist_factor));
@@ -0,0 +1,338 @@
+/**
+ * @file scan_index.c
+ * @brief Directory listing index files
+ *
+ * File layout:
+ *
+ *   [ScanIndexHeader]
+ *   [entry_count x ScanIndexEntry]
+ *   [subdir_count x ScanIndexSubdir]
+ *   [names of both, each NUL-terminated]
+ *   [trigram_count x key][trigram_count + 1 x start][posting_count x posting]
+ *
+ * The trigram section is absent when trigram_count is 0.
+ * The checksum covers everything after the header, so a file cut short by a
+ * crash is rejected rather than half loaded. Files are written to a
+ * temporary name and renamed into place.
+ */
+
+#define _GNU_SOURCE
+#include "scan_index.h"
+#include "hash.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define SCAN_INDEX_MAGIC "VSTSCAN"
+#define SCAN_INDEX_VERSION 3
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t entry_count;
+    uint32_t subdir_count;
+    uint32_t trigram_count;
+    int64_t dir_mtime_ns;
+    uint64_t dir_inode;
+    uint64_t options_hash;
+    uint64_t names_size;
+    uint64_t posting_count;
+    uint64_t checksum;           /* XXH64 of everything after the header */
+} ScanIndexHeader;
+
+typedef struct {
+    ThumbnailStamp stamp;
+    uint32_t name_offset;        /* Into the names block */
+    uint32_t name_length;        /* Excluding the NUL */
+} ScanIndexEntry;
+
+typedef struct {
+    int64_t mtime_ns;
+    uint64_t inode;
+    uint32_t name_offset;
+    uint32_t name_length;
+} ScanIndexSubdir;
+
+void scan_directory_init(ScanDirectory *scan) {
+    memset(scan, 0, sizeof(*scan));
+}
+
+bool scan_directory_add(ScanDirectory *scan, const char *name, const ThumbnailStamp *stamp) {
+    if (scan->count >= scan->capacity) {
+        int capacity = scan->capacity > 0 ? scan->capacity * 2 : 32;
+        ScanEntry *entries = realloc(scan->entries, sizeof(ScanEntry) * capacity);
+        if (!entries) return false;
+        scan->entries = entries;
+        scan->capacity = capacity;
+    }
+
+    char *copy = strdup(name);
+    if (!copy) return false;
+
+    scan->entries[scan->count].name = copy;
+    scan->entries[scan->count].stamp = *stamp;
+    scan->count++;
+    return true;
+}
+
+bool scan_directory_add_subdir(ScanDirectory *scan, const char *name, int64_t mtime_ns, uint64_t inode) {
+    if (scan->subdir_count >= scan->subdir_capacity) {
+        int capacity = scan->subdir_capacity > 0 ? scan->subdir_capacity * 2 : 16;
+        ScanSubdir *subdirs = realloc(scan->subdirs, sizeof(ScanSubdir) * capacity);
+        if (!subdirs) return false;
+        scan->subdirs = subdirs;
+        scan->subdir_capacity = capacity;
+    }
+
+    char *copy = strdup(name);
+    if (!copy) return false;
+
+    scan->subdirs[scan->subdir_count].name = copy;
+    scan->subdirs[scan->subdir_count].mtime_ns = mtime_ns;
+    scan->subdirs[scan->subdir_count].inode = inode;
+    scan->subdir_count++;
+    return true;
+}
+
+static int compare_entries(const void *a, const void *b) {
+    return strcmp(((const ScanEntry*)a)->name, ((const ScanEntry*)b)->name);
+}
+
+static int compare_subdirs(const void *a, const void *b) {
+    return strcmp(((const ScanSubdir*)a)->name, ((const ScanSubdir*)b)->name);
+}
+
+void scan_directory_sort(ScanDirectory *scan) {
+    if (scan->count > 1) {
+        qsort(scan->entries, scan->count, sizeof(ScanEntry), compare_entries);
+    }
+    if (scan->subdir_count > 1) {
+        qsort(scan->subdirs, scan->subdir_count, sizeof(ScanSubdir), compare_subdirs);
+    }
+}
+
+bool scan_directory_equal(const ScanDirectory *a, const ScanDirectory *b) {
+    if (a->count != b->count) return false;
+
+    for (int i = 0; i < a->count; i++) {
+        const ScanEntry *x = &a->entries[i];
+        const ScanEntry *y = &b->entries[i];
+        if (strcmp(x->name, y->name) != 0 ||
+            x->stamp.mtime != y->stamp.mtime ||
+            x->stamp.size != y->stamp.size ||
+            x->stamp.inode != y->stamp.inode) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void scan_directory_free(ScanDirectory *scan) {
+    for (int i = 0; i < scan->count; i++) {
+        free(scan->entries[i].name);
+    }
+    for (int i = 0; i < scan->subdir_count; i++) {
+        free(scan->subdirs[i].name);
+    }
+    free(scan->entries);
+    free(scan->subdirs);
+    trigram_index_free(&scan->trigrams);
+    scan_directory_init(scan);
+}
+
+/* Copy a NUL-terminated name out of the names block, checking it stays inside */
+static char* name_at(const char *names, uint64_t names_size, uint32_t offset, uint32_t length) {
+    uint64_t end = (uint64_t)offset + length;
+    if (end >= names_size || names[end] != '\0') return NULL;
+    return strndup(names + offset, length);
+}
+
+static size_t trigram_section_size(uint64_t trigram_count, uint64_t posting_count) {
+    if (trigram_count == 0) return 0;
+    return (size_t)(trigram_count * 2 + 1 + posting_count) * sizeof(uint32_t);
+}
+
+/* Copy the trigram section out, checking it is ordered and stays within the entries */
+static bool read_trigrams(const uint8_t *section, uint32_t key_count, uint32_t posting_count,
+                          uint32_t entry_count, TrigramIndex *trigrams) {
+    trigrams->keys = malloc(sizeof(uint32_t) * key_count);
+    trigrams->starts = malloc(sizeof(uint32_t) * (key_count + 1));
+    trigrams->postings = malloc(sizeof(uint32_t) * (posting_count > 0 ? posting_count : 1));
+    if (!trigrams->keys || !trigrams->starts || !trigrams->postings) return false;
+    trigrams->key_count = key_count;
+    trigrams->posting_count = posting_count;
+
+    memcpy(trigrams->keys, section, sizeof(uint32_t) * key_count);
+    section += sizeof(uint32_t) * key_count;
+    memcpy(trigrams->starts, section, sizeof(uint32_t) * (key_count + 1));
+    section += sizeof(uint32_t) * (key_count + 1);
+    memcpy(trigrams->postings, section, sizeof(uint32_t) * posting_count);
+
+    if (trigrams->starts[0] != 0 || trigrams->starts[key_count] != posting_count) return false;
+    for (uint32_t i = 0; i < key_count; i++) {
+        if (trigrams->starts[i] >= trigrams->starts[i + 1]) return false;
+        if (i > 0 && trigrams->keys[i - 1] >= trigrams->keys[i]) return false;
+    }
+    for (uint32_t i = 0; i < posting_count; i++) {
+        if (trigrams->postings[i] >= entry_count) return false;
+    }
+    return true;
+}
+
+bool scan_index_load(const char *path, ScanDirectory *scan) {
+    scan_directory_init(scan);
+
+    FILE *file = fopen(path, "rb");
+    if (!file) return false;
+
+    ScanIndexHeader header;
+    bool ok = fread(&header, sizeof(header), 1, file) == 1 &&
+              memcmp(header.magic, SCAN_INDEX_MAGIC, sizeof(header.magic)) == 0 &&
+              header.version == SCAN_INDEX_VERSION &&
+              header.names_size <= ((uint64_t)header.entry_count + header.subdir_count) * 4096 &&
+              header.posting_count <= header.names_size &&
+              header.trigram_count <= header.posting_count;
+
+    // One read for the whole body; the header sizes are checked against it below
+    size_t body_size = 0;
+    uint8_t *body = NULL;
+    if (ok) {
+        body_size = (size_t)header.entry_count * sizeof(ScanIndexEntry) +
+                    (size_t)header.subdir_count * sizeof(ScanIndexSubdir) + (size_t)header.names_size +
+                    trigram_section_size(header.trigram_count, header.posting_count);
+        body = malloc(body_size > 0 ? body_size : 1);
+        ok = body && fread(body, 1, body_size, file) == body_size &&
+             hash_xxh64(body, body_size, 0) == header.checksum;
+    }
+    fclose(file);
+
+    if (ok) {
+        const ScanIndexEntry *entries = (const ScanIndexEntry*)body;
+        const ScanIndexSubdir *subdirs = (const ScanIndexSubdir*)(entries + header.entry_count);
+        const char *names = (const char*)(subdirs + header.subdir_count);
+
+        scan->entries = malloc(sizeof(ScanEntry) * (header.entry_count > 0 ? header.entry_count : 1));
+        scan->subdirs = malloc(sizeof(ScanSubdir) * (header.subdir_count > 0 ? header.subdir_count : 1));
+        scan->capacity = (int)header.entry_count;
+        scan->subdir_capacity = (int)header.subdir_count;
+        ok = scan->entries && scan->subdirs;
+
+        for (uint32_t i = 0; ok && i < header.entry_count; i++) {
+            char *name = name_at(names, header.names_size, entries[i].name_offset, entries[i].name_length);
+            if (!name) {
+                ok = false;
+                break;
+            }
+            scan->entries[scan->count].name = name;
+            scan->entries[scan->count].stamp = entries[i].stamp;
+            scan->count++;
+        }
+
+        for (uint32_t i = 0; ok && i < header.subdir_count; i++) {
+            char *name = name_at(names, header.names_size, subdirs[i].name_offset, subdirs[i].name_length);
+            if (!name) {
+                ok = false;
+                break;
+            }
+            scan->subdirs[scan->subdir_count].name = name;
+            scan->subdirs[scan->subdir_count].mtime_ns = subdirs[i].mtime_ns;
+            scan->subdirs[scan->subdir_count].inode = subdirs[i].inode;
+            scan->subdir_count++;
+        }
+
+        if (ok && header.trigram_count > 0) {
+            ok = read_trigrams((const uint8_t*)names + header.names_size, header.trigram_count,
+                               (uint32_t)header.posting_count, header.entry_count, &scan->trigrams);
+        }
+    }
+    free(body);
+
+    if (!ok) {
+        scan_directory_free(scan);
+        return false;
+    }
+
+    scan->dir_mtime_ns = header.dir_mtime_ns;
+    scan->dir_inode = header.dir_inode;
+    scan->options_hash = header.options_hash;
+    return true;
+}
+
+bool scan_index_save(const char *path, const ScanDirectory *scan) {
+    size_t names_size = 0;
+    for (int i = 0; i < scan->count; i++) {
+        names_size += strlen(scan->entries[i].name) + 1;
+    }
+    for (int i = 0; i < scan->subdir_count; i++) {
+        names_size += strlen(scan->subdirs[i].name) + 1;
+    }
+
+    const TrigramIndex *trigrams = &scan->trigrams;
+    size_t body_size = (size_t)scan->count * sizeof(ScanIndexEntry) +
+                       (size_t)scan->subdir_count * sizeof(ScanIndexSubdir) + names_size +
+                       trigram_section_size(trigrams->key_count, trigrams->posting_count);
+    uint8_t *body = calloc(1, body_size > 0 ? body_size : 1);
+    if (!body) return false;
+
+    ScanIndexEntry *entries = (ScanIndexEntry*)body;
+    ScanIndexSubdir *subdirs = (ScanIndexSubdir*)(entries + scan->count);
+    char *names = (char*)(subdirs + scan->subdir_count);
+    size_t offset = 0;
+    for (int i = 0; i < scan->count; i++) {
+        size_t length = strlen(scan->entries[i].name);
+        entries[i].stamp = scan->entries[i].stamp;
+        entries[i].name_offset = (uint32_t)offset;
+        entries[i].name_length = (uint32_t)length;
+        memcpy(names + offset, scan->entries[i].name, length + 1);
+        offset += length + 1;
+    }
+    for (int i = 0; i < scan->subdir_count; i++) {
+        size_t length = strlen(scan->subdirs[i].name);
+        subdirs[i].mtime_ns = scan->subdirs[i].mtime_ns;
+        subdirs[i].inode = scan->subdirs[i].inode;
+        subdirs[i].name_offset = (uint32_t)offset;
+        subdirs[i].name_length = (uint32_t)length;
+        memcpy(names + offset, scan->subdirs[i].name, length + 1);
+        offset += length + 1;
+    }
+    if (trigrams->key_count > 0) {
+        // The names leave this unaligned, hence the copies
+        uint8_t *section = (uint8_t*)names + names_size;
+        memcpy(section, trigrams->keys, sizeof(uint32_t) * trigrams->key_count);
+        section += sizeof(uint32_t) * trigrams->key_count;
+        memcpy(section, trigrams->starts, sizeof(uint32_t) * (trigrams->key_count + 1));
+        section += sizeof(uint32_t) * (trigrams->key_count + 1);
+        memcpy(section, trigrams->postings, sizeof(uint32_t) * trigrams->posting_count);
+    }
+
+    ScanIndexHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SCAN_INDEX_MAGIC, sizeof(header.magic));
+    header.version = SCAN_INDEX_VERSION;
+    header.entry_count = (uint32_t)scan->count;
+    header.subdir_count = (uint32_t)scan->subdir_count;
+    header.trigram_count = trigrams->key_count;
+    header.dir_mtime_ns = scan->dir_mtime_ns;
+    header.dir_inode = scan->dir_inode;
+    header.options_hash = scan->options_hash;
+    header.names_size = names_size;
+    header.posting_count = trigrams->posting_count;
+    header.checksum = hash_xxh64(body, body_size, 0);
+
+    char temp[4096];
+    snprintf(temp, sizeof(temp), "%s.%d.tmp", path, (int)getpid());
+
+    FILE *file = fopen(temp, "wb");
+    bool ok = file != NULL;
+    if (ok) {
+        ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+             fwrite(body, 1, body_size, file) == body_size;
+        ok = fclose(file) == 0 && ok;
+    }
+    free(body);
+
+    if (ok) ok = rename(temp, path) == 0;
+    if (!ok) unlink(temp);
+    return ok;
+}
@@ -0,0 +1,440 @@
+/**
+ * @file search.c
+ * @brief Incremental substring search over wallpaper names
+ */
+
+#define _GNU_SOURCE
+#include "search.h"
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/* Fuzzy scoring, after fzf */
+#define SCORE_MATCH 16
+#define SCORE_GAP_START -3
+#define SCORE_GAP_EXTENSION -1
+#define BONUS_BOUNDARY_WHITE 10   /* At the start or after a space */
+#define BONUS_BOUNDARY_PATH 9     /* After a '/' */
+#define BONUS_BOUNDARY 8          /* After '_', '-' or '.' */
+#define BONUS_CONSECUTIVE 4
+#define BONUS_FIRST_CHAR_MULTIPLIER 2
+
+static const char *mode_names[SEARCH_MODE_COUNT] = {"substring", "fuzzy"};
+
+static unsigned char fold(unsigned char c) {
+    return (c >= 'A' && c <= 'Z') ? (unsigned char)(c - 'A' + 'a') : c;
+}
+
+static int char_bit(unsigned char c) {
+    c = fold(c);
+    if (c >= 'a' && c <= 'z') return c - 'a';
+    if (c >= '0' && c <= '9') return 26 + (c - '0');
+    return 36 + c % 28;
+}
+
+/* Bit of each byte value, filled on first use */
+static uint64_t char_bits[256];
+
+static void init_char_bits(void) {
+    if (char_bits['a']) return;
+    for (int c = 0; c < 256; c++) {
+        char_bits[c] = 1ULL << char_bit((unsigned char)c);
+    }
+}
+
+uint64_t search_char_mask(const char *s, size_t len) {
+    init_char_bits();
+    uint64_t mask = 0;
+    for (size_t i = 0; i < len; i++) {
+        mask |= char_bits[(unsigned char)s[i]];
+    }
+    return mask;
+}
+
+/* Substring test for short names, cheaper than memmem()'s per-call setup */
+static bool contains(const char *name, size_t name_len, const char *query, size_t len) {
+    if (len > name_len) return false;
+    const char *last = name + name_len - len;
+    for (const char *p = name; p <= last; p++) {
+        if (*p == query[0] && memcmp(p + 1, query + 1, len - 1) == 0) return true;
+    }
+    return false;
+}
+
+/* Whether the mask alone decides a one-character query: letters and digits have a bit each */
+static bool mask_is_exact(const char *query, size_t len) {
+    unsigned char c = (unsigned char)query[0];
+    return len == 1 && ((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9'));
+}
+
+bool search_mode_parse(const char *name, SearchMode *mode) {
+    for (int i = 0; i < SEARCH_MODE_COUNT; i++) {
+        if (strcasecmp(name, mode_names[i]) == 0) {
+            *mode = (SearchMode)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char* search_mode_name(SearchMode mode) {
+    return mode < SEARCH_MODE_COUNT ? mode_names[mode] : "unknown";
+}
+
+void search_init(SearchEngine *engine) {
+    memset(engine, 0, sizeof(*engine));
+    engine->trigram_count = -1;
+}
+
+static void drop_levels(SearchEngine *engine, int keep) {
+    while (engine->level_count > keep) {
+        free(engine->levels[--engine->level_count].matches);
+    }
+}
+
+void search_free(SearchEngine *engine) {
+    drop_levels(engine, 0);
+    free(engine->folded);
+    free(engine->offsets);
+    free(engine->masks);
+    free(engine->scores);
+    trigram_index_free(&engine->trigrams);
+    search_init(engine);
+}
+
+void search_invalidate(SearchEngine *engine) {
+    drop_levels(engine, 0);
+    engine->valid = false;
+    trigram_index_free(&engine->trigrams);
+    engine->trigram_count = -1;
+}
+
+void search_set_mode(SearchEngine *engine, SearchMode mode) {
+    if (engine->mode == mode) return;
+    drop_levels(engine, 0);
+    engine->mode = mode;
+}
+
+void search_use_trigrams(SearchEngine *engine, bool enable) {
+    engine->use_trigrams = enable;
+    if (!enable) {
+        trigram_index_free(&engine->trigrams);
+        engine->trigram_count = -1;
+    }
+}
+
+void search_adopt_trigrams(SearchEngine *engine, TrigramIndex *trigrams, int count) {
+    trigram_index_free(&engine->trigrams);
+    engine->trigrams = *trigrams;
+    engine->trigram_count = count;
+    trigram_index_init(trigrams);
+}
+
+static void build_index(SearchEngine *engine, SearchText text, const void *data, int count) {
+    init_char_bits();
+    if (count + 1 > engine->capacity) {
+        engine->capacity = count + 1;
+        engine->offsets = realloc(engine->offsets, sizeof(uint32_t) * engine->capacity);
+        engine->masks = realloc(engine->masks, sizeof(uint64_t) * engine->capacity);
+        engine->scores = realloc(engine->scores, sizeof(uint16_t) * engine->capacity);
+    }
+
+    char buffer[4096];
+    engine->folded_size = 0;
+    for (int i = 0; i < count; i++) {
+        const char *name = text(data, i, buffer, sizeof(buffer));
+        size_t len = strlen(name);
+        if (engine->folded_size + len + 1 > engine->folded_capacity) {
+            size_t capacity = engine->folded_capacity > 0 ? engine->folded_capacity * 2 : 4096;
+            while (capacity < engine->folded_size + len + 1) capacity *= 2;
+            engine->folded = realloc(engine->folded, capacity);
+            engine->folded_capacity = capacity;
+        }
+
+        char *out = engine->folded + engine->folded_size;
+        uint64_t mask = 0;
+        for (size_t j = 0; j < len; j++) {
+            unsigned char c = (unsigned char)name[j];
+            out[j] = (char)fold(c);
+            mask |= char_bits[c];
+        }
+        out[len] = '\0';
+        engine->offsets[i] = (uint32_t)engine->folded_size;
+        engine->masks[i] = mask;
+        engine->folded_size += len + 1;
+    }
+
+    // Sentinel, so every name's length is the gap to the next offset
+    engine->offsets[count] = (uint32_t)engine->folded_size;
+    engine->count = count;
+    engine->valid = true;
+}
+
+/* Index the folded texts when the trigrams are missing or cover other texts */
+static void build_trigrams(SearchEngine *engine) {
+    const char **texts = malloc(sizeof(char*) * (engine->count > 0 ? engine->count : 1));
+    if (!texts) return;
+    for (int i = 0; i < engine->count; i++) {
+        texts[i] = engine->folded + engine->offsets[i];
+    }
+    if (trigram_index_build(&engine->trigrams, texts, engine->count)) {
+        engine->trigram_count = engine->count;
+    }
+    free(texts);
+}
+
+/* The names containing the query among those holding all its trigrams */
+static int search_trigrams(const SearchEngine *engine, const char *query, size_t len, int *out) {
+    uint32_t estimate = trigram_index_estimate(&engine->trigrams, query, len);
+    if (estimate == 0) return 0;
+
+    uint32_t *candidates = malloc(sizeof(uint32_t) * estimate);
+    if (!candidates) return -1;
+    int count = trigram_index_candidates(&engine->trigrams, query, len, candidates);
+
+    int found = 0;
+    for (int i = 0; i < count; i++) {
+        int index = (int)candidates[i];
+        const char *name = engine->folded + engine->offsets[index];
+        size_t name_len = engine->offsets[index + 1] - engine->offsets[index] - 1;
+        if (contains(name, name_len, query, len)) out[found++] = index;
+    }
+    free(candidates);
+    return found;
+}
+
+/* Every name containing the query, in one pass over the arena */
+static int search_all(const SearchEngine *engine, const char *query, size_t len, int *out) {
+    uint64_t mask = search_char_mask(query, len);
+    int found = 0;
+    if (mask_is_exact(query, len)) {
+        for (int index = 0; index < engine->count; index++) {
+            if (engine->masks[index] & mask) out[found++] = index;
+        }
+        return found;
+    }
+
+    for (int index = 0; index < engine->count; index++) {
+        if (mask & ~engine->masks[index]) continue;
+
+        const char *name = engine->folded + engine->offsets[index];
+        size_t name_len = engine->offsets[index + 1] - engine->offsets[index] - 1;
+        if (contains(name, name_len, query, len)) out[found++] = index;
+    }
+    return found;
+}
+
+/* The names among a previous result that also contain the longer query */
+static int search_refine(const SearchEngine *engine, const SearchLevel *from, const char *query, size_t len,
+                         int *out) {
+    uint64_t mask = search_char_mask(query, len);
+    int found = 0;
+    for (int i = 0; i < from->count; i++) {
+        int index = from->matches[i];
+        if (mask & ~engine->masks[index]) continue;
+
+        const char *name = engine->folded + engine->offsets[index];
+        size_t name_len = engine->offsets[index + 1] - engine->offsets[index] - 1;
+        if (contains(name, name_len, query, len)) out[found++] = index;
+    }
+    return found;
+}
+
+/* Bonus for a match at position i, by what precedes it */
+static int boundary_bonus(const char *text, size_t i) {
+    if (i == 0) return BONUS_BOUNDARY_WHITE;
+    switch (text[i - 1]) {
+        case ' ': return BONUS_BOUNDARY_WHITE;
+        case '/': return BONUS_BOUNDARY_PATH;
+        case '_': case '-': case '.': return BONUS_BOUNDARY;
+        default: return 0;
+    }
+}
+
+int search_fuzzy_score(const char *text, size_t len, const char *query, size_t query_len) {
+    // Earliest end of an in-order match...
+    size_t q = 0, end = 0;
+    for (size_t i = 0; i < len; i++) {
+        if (text[i] == query[q] && ++q == query_len) {
+            end = i + 1;
+            break;
+        }
+    }
+    if (q < query_len) return -1;
+
+    // ...and the latest start matching back from it, for the tightest span
+    size_t start = end;
+    while (start > 0) {
+        start--;
+        if (text[start] == query[q - 1] && --q == 0) break;
+    }
+
+    int score = 0, run_bonus = 0;
+    bool in_run = false, in_gap = false;
+    for (size_t i = start; i < end; i++) {
+        if (q < query_len && text[i] == query[q]) {
+            int bonus = boundary_bonus(text, i);
+            if (q == 0) bonus *= BONUS_FIRST_CHAR_MULTIPLIER;
+
+            // A run keeps the bonus of the character that started it
+            if (in_run) {
+                if (run_bonus > bonus) bonus = run_bonus;
+                if (BONUS_CONSECUTIVE > bonus) bonus = BONUS_CONSECUTIVE;
+            } else {
+                run_bonus = bonus;
+            }
+            score += SCORE_MATCH + bonus;
+            q++;
+            in_run = true;
+            in_gap = false;
+        } else {
+            score += in_gap ? SCORE_GAP_EXTENSION : SCORE_GAP_START;
+            in_run = false;
+            in_gap = true;
+        }
+    }
+    return score > 0 ? score : 0;
+}
+
+/* Names whose masks cover the query's, two masks per SSE2 compare */
+static int filter_masks(const uint64_t *masks, int count, uint64_t mask, int *out) {
+    int found = 0;
+    int i = 0;
+#if defined(__SSE2__)
+    __m128i want = _mm_set1_epi64x((long long)mask);
+    __m128i zero = _mm_setzero_si128();
+    for (; i + 4 <= count; i += 4) {
+        // Characters the query needs that a name lacks; zero bytes set bits
+        __m128i lo = _mm_andnot_si128(_mm_loadu_si128((const __m128i*)(masks + i)), want);
+        __m128i hi = _mm_andnot_si128(_mm_loadu_si128((const __m128i*)(masks + i + 2)), want);
+        unsigned bits = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(lo, zero)) |
+                        (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(hi, zero)) << 16;
+        if (bits == 0) continue;
+
+        // Branch-free append: always write, advance only on a match
+        for (int lane = 0; lane < 4; lane++) {
+            out[found] = i + lane;
+            found += ((bits >> (lane * 8)) & 0xFF) == 0xFF;
+        }
+    }
+#endif
+    for (; i < count; i++) {
+        out[found] = i;
+        found += (mask & ~masks[i]) == 0;
+    }
+    return found;
+}
+
+/* Order matches best first; stable, so equal scores keep list order */
+static void rank_matches(int *matches, int count, const uint16_t *scores) {
+    int *temp = malloc(sizeof(int) * (count > 0 ? count : 1));
+    if (!temp) return;
+
+    // Scores are 16 bits, so two byte-wide counting passes sort them fully
+    for (int shift = 0; shift < 16; shift += 8) {
+        int counts[256] = {0};
+        for (int i = 0; i < count; i++) {
+            counts[((uint16_t)~scores[matches[i]] >> shift) & 0xFF]++;
+        }
+        int position = 0;
+        for (int b = 0; b < 256; b++) {
+            int n = counts[b];
+            counts[b] = position;
+            position += n;
+        }
+        for (int i = 0; i < count; i++) {
+            temp[counts[((uint16_t)~scores[matches[i]] >> shift) & 0xFF]++] = matches[i];
+        }
+        memcpy(matches, temp, sizeof(int) * count);
+    }
+    free(temp);
+}
+
+/* Fuzzy matches from the mask-prefiltered names or a previous result, ranked */
+static int search_fuzzy(SearchEngine *engine, const SearchLevel *from, const char *query, size_t len,
+                        int *out) {
+    uint64_t mask = search_char_mask(query, len);
+    int candidates;
+    if (from) {
+        candidates = 0;
+        for (int i = 0; i < from->count; i++) {
+            out[candidates] = from->matches[i];
+            candidates += (mask & ~engine->masks[from->matches[i]]) == 0;
+        }
+    } else {
+        candidates = filter_masks(engine->masks, engine->count, mask, out);
+    }
+
+    int found = 0;
+    for (int i = 0; i < candidates; i++) {
+        int index = out[i];
+        const char *name = engine->folded + engine->offsets[index];
+        size_t name_len = engine->offsets[index + 1] - engine->offsets[index] - 1;
+        int score = search_fuzzy_score(name, name_len, query, len);
+        if (score < 0) continue;
+        engine->scores[index] = (uint16_t)(score < UINT16_MAX ? score : UINT16_MAX);
+        out[found++] = index;
+    }
+    rank_matches(out, found, engine->scores);
+    return found;
+}
+
+const int* search_query(SearchEngine *engine, SearchText text, const void *data, int count,
+                        const char *query, int *result_count) {
+    if (!engine->valid || engine->count != count) {
+        drop_levels(engine, 0);
+        build_index(engine, text, data, count);
+    }
+    if (engine->use_trigrams && engine->mode == SEARCH_SUBSTRING && engine->trigram_count != count) {
+        build_trigrams(engine);
+    }
+
+    char folded[SEARCH_MAX_QUERY];
+    size_t len = 0;
+    for (; query[len] && len < sizeof(folded) - 1; len++) {
+        folded[len] = (char)fold((unsigned char)query[len]);
+    }
+    folded[len] = '\0';
+
+    // Keep the cached results of queries this one extends
+    int keep = engine->level_count;
+    while (keep > 0 && (engine->levels[keep - 1].length > len ||
+                        memcmp(engine->query, folded, engine->levels[keep - 1].length) != 0)) {
+        keep--;
+    }
+    drop_levels(engine, keep);
+
+    if (keep > 0 && engine->levels[keep - 1].length == len) {
+        *result_count = engine->levels[keep - 1].count;
+        return engine->levels[keep - 1].matches;
+    }
+
+    const SearchLevel *from = keep > 0 ? &engine->levels[keep - 1] : NULL;
+    int limit = from ? from->count : count;
+    SearchLevel *level = &engine->levels[engine->level_count++];
+    level->length = len;
+    level->matches = malloc(sizeof(int) * (limit > 0 ? limit : 1));
+    level->count = -1;
+    if (engine->mode == SEARCH_FUZZY) {
+        level->count = search_fuzzy(engine, from, folded, len, level->matches);
+    }
+
+    // Trigrams win unless the results being refined are already fewer than
+    // the rarest trigram's postings
+    if (level->count < 0 && engine->trigram_count == count && len >= 3 &&
+        (!from || trigram_index_estimate(&engine->trigrams, folded, len) < (uint32_t)from->count)) {
+        level->count = search_trigrams(engine, folded, len, level->matches);
+    }
+    if (level->count < 0) {
+        level->count = from ? search_refine(engine, from, folded, len, level->matches)
+                            : search_all(engine, folded, len, level->matches);
+    }
+    memcpy(engine->query, folded, len + 1);
+
+    *result_count = level->count;
+    return level->matches;
+}
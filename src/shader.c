@@ -4,6 +4,7 @@
 #include "wallpaper.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <stddef.h>
 #include <string.h>
 #include <math.h>
 #include <SDL3/SDL.h>
@@ -59,6 +60,345 @@ GLuint shader_load(const char *path, GLenum type) {
     return shader;
 }
 
+/* Link a program from two compiled shaders, which are deleted either way; 0 on failure */
+static GLuint program_link(GLuint vertex_shader, GLuint fragment_shader) {
+    GLuint program = 0;
+    if (vertex_shader && fragment_shader) {
+        program = glCreateProgram();
+        glAttachShader(program, vertex_shader);
+        glAttachShader(program, fragment_shader);
+        glLinkProgram(program);
+        
+        GLint success;
+        glGetProgramiv(program, GL_LINK_STATUS, &success);
+        if (!success) {
+            char log[512];
+            glGetProgramInfoLog(program, 512, NULL, log);
+            fprintf(stderr, "Shader linking failed: %s\n", log);
+            glDeleteProgram(program);
+            program = 0;
+        }
+    }
+    
+    if (vertex_shader) glDeleteShader(vertex_shader);
+    if (fragment_shader) glDeleteShader(fragment_shader);
+    return program;
+}
+
+#define INITIAL_LAYERS 64
+#define BLUR_DOWNSAMPLE 2      // Blur at this fraction of the thumbnail size
+#define BLUR_PASSES 2          // Horizontal and vertical pass pairs; more is softer
+#define FRAME_CONSTANTS_BINDING 0
+
+// The uniform buffer takes the struct as it is, so it must match std140
+_Static_assert(sizeof(GLFrameConstants) == 96, "GLFrameConstants must match the std140 block");
+_Static_assert(offsetof(GLFrameConstants, window_size) == 64, "GLFrameConstants must match the std140 block");
+
+static void layer_unlink(GLRenderer *r, int layer) {
+    GLThumbLayer *l = &r->layers[layer];
+    
+    if (l->lru_prev >= 0) r->layers[l->lru_prev].lru_next = l->lru_next;
+    else r->lru_head = l->lru_next;
+    
+    if (l->lru_next >= 0) r->layers[l->lru_next].lru_prev = l->lru_prev;
+    else r->lru_tail = l->lru_prev;
+    
+    l->lru_prev = -1;
+    l->lru_next = -1;
+}
+
+static void layer_push_front(GLRenderer *r, int layer) {
+    GLThumbLayer *l = &r->layers[layer];
+    
+    l->lru_prev = -1;
+    l->lru_next = r->lru_head;
+    if (r->lru_head >= 0) r->layers[r->lru_head].lru_prev = layer;
+    r->lru_head = layer;
+    if (r->lru_tail < 0) r->lru_tail = layer;
+}
+
+static void layer_push_back(GLRenderer *r, int layer) {
+    GLThumbLayer *l = &r->layers[layer];
+    
+    l->lru_next = -1;
+    l->lru_prev = r->lru_tail;
+    if (r->lru_tail >= 0) r->layers[r->lru_tail].lru_next = layer;
+    r->lru_tail = layer;
+    if (r->lru_head < 0) r->lru_head = layer;
+}
+
+/**
+ * @brief Reallocate the texture array with more layers, keeping the ones uploaded
+ *
+ * GL 3.3 cannot resize a texture, so the old layers are copied across
+ * through a framebuffer. This happens a handful of times at most.
+ */
+static bool grow_layers(GLRenderer *r) {
+    int count = r->layer_count > 0 ? r->layer_count * 2 : INITIAL_LAYERS;
+    if (count > r->layer_limit) count = r->layer_limit;
+    if (count <= r->layer_count) return false;
+    
+    GLThumbLayer *layers = realloc(r->layers, sizeof(GLThumbLayer) * count);
+    if (!layers) return false;
+    r->layers = layers;
+    
+    while (glGetError() != GL_NO_ERROR) {}
+    GLuint array;
+    glGenTextures(1, &array);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, array);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, r->layer_width, r->layer_height, count,
+                 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    if (glGetError() != GL_NO_ERROR) {
+        // Out of video memory: make do with the layers there are
+        glDeleteTextures(1, &array);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, r->thumb_array);
+        r->layer_limit = r->layer_count;
+        return false;
+    }
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    
+    if (r->thumb_array) {
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, r->copy_fbo);
+        for (int i = 0; i < r->layer_count; i++) {
+            glFramebufferTextureLayer(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, r->thumb_array, 0, i);
+            glCopyTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, i, 0, 0, r->layer_width, r->layer_height);
+        }
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+        glDeleteTextures(1, &r->thumb_array);
+    }
+    r->thumb_array = array;
+    
+    // New layers are free, so they go to the cold end and are used first
+    for (int i = r->layer_count; i < count; i++) {
+        r->layers[i].generation = 0;
+        r->layers[i].wallpaper = -1;
+        r->layers[i].drawn_frame = 0;
+        r->layers[i].lru_prev = -1;
+        r->layers[i].lru_next = -1;
+        if (i > 0) layer_push_back(r, i);
+    }
+    r->layer_count = count;
+    return true;
+}
+
+static bool reserve_wallpapers(GLRenderer *r, int count) {
+    if (count <= r->wallpaper_capacity) return true;
+    
+    int new_capacity = r->wallpaper_capacity > 0 ? r->wallpaper_capacity : 64;
+    while (new_capacity < count) new_capacity *= 2;
+    
+    int *wallpaper_layers = realloc(r->wallpaper_layers, sizeof(int) * new_capacity);
+    if (!wallpaper_layers) return false;
+    memset(wallpaper_layers + r->wallpaper_capacity, 0, sizeof(int) * (new_capacity - r->wallpaper_capacity));
+    
+    r->wallpaper_layers = wallpaper_layers;
+    r->wallpaper_capacity = new_capacity;
+    return true;
+}
+
+/* Copy a thumbnail into a layer, clipped to the layer size */
+static void upload_layer(GLRenderer *r, int layer, SDL_Surface *surf) {
+    SDL_Surface *rgba = surf;
+    if (surf->format != SDL_PIXELFORMAT_RGBA32) {
+        rgba = SDL_ConvertSurface(surf, SDL_PIXELFORMAT_RGBA32);
+        if (!rgba) return;
+    }
+    
+    int width = rgba->w < r->layer_width ? rgba->w : r->layer_width;
+    int height = rgba->h < r->layer_height ? rgba->h : r->layer_height;
+    
+    glBindTexture(GL_TEXTURE_2D_ARRAY, r->thumb_array);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, rgba->pitch / 4);
+    SDL_LockSurface(rgba);
+    glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, width, height, 1,
+                    GL_RGBA, GL_UNSIGNED_BYTE, rgba->pixels);
+    SDL_UnlockSurface(rgba);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    
+    if (rgba != surf) SDL_DestroySurface(rgba);
+}
+
+/**
+ * @brief Layer holding a wallpaper's thumbnail, uploading it only if needed
+ *
+ * Layers stay resident across frames and are matched by thumbnail generation,
+ * which is never reused, so a wallpaper whose thumbnail was reloaded, or
+ * whose index now belongs to another file, misses and is uploaded again.
+ * The least recently drawn layer is reused once the array is at its limit,
+ * unless this frame already drew it: the instanced draw comes after every
+ * upload, so overwriting it would show one thumbnail in two places.
+ *
+ * @param generation wallpaper_list_thumb_generation() of surf
+ * @return Layer index, or 0 (the placeholder) if it could not be stored
+ */
+static int thumb_layer(GLRenderer *r, int wallpaper, SDL_Surface *surf, uint64_t generation) {
+    if (!r->thumb_array || !reserve_wallpapers(r, wallpaper + 1)) return 0;
+    
+    int layer = r->wallpaper_layers[wallpaper];
+    if (layer > 0 && r->layers[layer].generation == generation) {
+        r->layers[layer].drawn_frame = r->frame;
+        layer_unlink(r, layer);
+        layer_push_front(r, layer);
+        return layer;
+    }
+    
+    // The cold end is free or least recently drawn; grow rather than evict while allowed
+    layer = r->lru_tail;
+    if ((layer < 0 || r->layers[layer].generation) && grow_layers(r)) {
+        layer = r->lru_tail;
+    }
+    if (layer <= 0) return 0;
+    
+    // Every layer is in use this frame; the placeholder stands in until the next
+    if (r->layers[layer].generation && r->layers[layer].drawn_frame == r->frame) return 0;
+    
+    GLThumbLayer *l = &r->layers[layer];
+    if (l->wallpaper >= 0 && l->wallpaper < r->wallpaper_capacity &&
+        r->wallpaper_layers[l->wallpaper] == layer) {
+        r->wallpaper_layers[l->wallpaper] = 0;
+    }
+    
+    upload_layer(r, layer, surf);
+    l->generation = generation;
+    l->wallpaper = wallpaper;
+    l->drawn_frame = r->frame;
+    r->wallpaper_layers[wallpaper] = layer;
+    layer_unlink(r, layer);
+    layer_push_front(r, layer);
+    return layer;
+}
+
+/* Allocate the first layers and paint layer 0 with the placeholder grey */
+static bool init_layers(GLRenderer *r, const Config *config) {
+    r->layer_width = config->thumbnail_width > 0 ? config->thumbnail_width : 1;
+    r->layer_height = config->thumbnail_height > 0 ? config->thumbnail_height : 1;
+    
+    size_t budget = (size_t)(config->texture_cache_mb > 0 ? config->texture_cache_mb : 1) * 1024 * 1024;
+    size_t layer_bytes = (size_t)r->layer_width * r->layer_height * 4;
+    GLint max_layers = 256;
+    glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &max_layers);
+    size_t limit = budget / layer_bytes;
+    if (limit > (size_t)max_layers) limit = (size_t)max_layers;
+    if (limit < 2) limit = 2;
+    r->layer_limit = (int)limit;
+    
+    glGenFramebuffers(1, &r->copy_fbo);
+    if (!grow_layers(r)) return false;
+    
+    unsigned char *grey = malloc(layer_bytes);
+    if (!grey) return false;
+    for (size_t i = 0; i < layer_bytes; i += 4) {
+        grey[i] = 45;
+        grey[i + 1] = 45;
+        grey[i + 2] = 50;
+        grey[i + 3] = 255;
+    }
+    glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, 0, r->layer_width, r->layer_height, 1,
+                    GL_RGBA, GL_UNSIGNED_BYTE, grey);
+    free(grey);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    return true;
+}
+
+/* Set up the frosted background's program and textures; false leaves it off */
+static bool init_blur(GLRenderer *r) {
+    r->blur_program = program_link(shader_load("shaders/blur_vertex.glsl", GL_VERTEX_SHADER),
+                                   shader_load("shaders/blur_fragment.glsl", GL_FRAGMENT_SHADER));
+    if (!r->blur_program) return false;
+    r->uniforms.blur_source = glGetUniformLocation(r->blur_program, "source");
+    r->uniforms.blur_direction = glGetUniformLocation(r->blur_program, "direction");
+    
+    // Just the unit quad; the carousel VAO also carries the instance attributes
+    glGenVertexArrays(1, &r->blur_vao);
+    glBindVertexArray(r->blur_vao);
+    glBindBuffer(GL_ARRAY_BUFFER, r->vbo);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(2 * sizeof(float)));
+    glEnableVertexAttribArray(1);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+    
+    r->blur_width = r->layer_width / BLUR_DOWNSAMPLE > 0 ? r->layer_width / BLUR_DOWNSAMPLE : 1;
+    r->blur_height = r->layer_height / BLUR_DOWNSAMPLE > 0 ? r->layer_height / BLUR_DOWNSAMPLE : 1;
+    glGenTextures(2, r->blur_textures);
+    for (int i = 0; i < 2; i++) {
+        glBindTexture(GL_TEXTURE_2D, r->blur_textures[i]);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, r->blur_width, r->blur_height, 0,
+                     GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glGenFramebuffers(1, &r->blur_fbo);
+    return true;
+}
+
+/**
+ * @brief Blur a resident thumbnail into blur_textures[0] for the background
+ *
+ * The layer is downsampled by a linear blit, then blurred at that size by
+ * a separable Gaussian, ping-ponging between the two blur textures. The
+ * result is kept until a thumbnail of another generation is passed in, so
+ * most frames skip this and the main pass samples it once per pixel.
+ * Leaves the blur program and VAO bound.
+ *
+ * @param generation wallpaper_list_thumb_generation() of surf
+ * @return true if blur_textures[0] holds this thumbnail
+ */
+static bool blur_background(GLRenderer *r, SDL_Surface *surf, uint64_t generation, int layer) {
+    if (r->blur_generation == generation) return true;
+    
+    GLint draw_framebuffer, read_framebuffer, viewport[4];
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &draw_framebuffer);
+    glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &read_framebuffer);
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    
+    // Downsample only the part of the layer the thumbnail fills
+    int width = surf->w < r->layer_width ? surf->w : r->layer_width;
+    int height = surf->h < r->layer_height ? surf->h : r->layer_height;
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, r->copy_fbo);
+    glFramebufferTextureLayer(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, r->thumb_array, 0, layer);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, r->blur_fbo);
+    glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, r->blur_textures[0], 0);
+    glBlitFramebuffer(0, 0, width, height, 0, 0, r->blur_width, r->blur_height,
+                      GL_COLOR_BUFFER_BIT, GL_LINEAR);
+    
+    // Even passes blur across into [1], odd passes blur down back into [0]
+    glDisable(GL_BLEND);
+    glViewport(0, 0, r->blur_width, r->blur_height);
+    glUseProgram(r->blur_program);
+    glUniform1i(r->uniforms.blur_source, 1);
+    glBindVertexArray(r->blur_vao);
+    glActiveTexture(GL_TEXTURE1);
+    for (int pass = 0; pass < BLUR_PASSES * 2; pass++) {
+        int from = pass % 2;
+        glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
+                               r->blur_textures[1 - from], 0);
+        glBindTexture(GL_TEXTURE_2D, r->blur_textures[from]);
+        if (from == 0) {
+            glUniform2f(r->uniforms.blur_direction, 1.0f / r->blur_width, 0.0f);
+        } else {
+            glUniform2f(r->uniforms.blur_direction, 0.0f, 1.0f / r->blur_height);
+        }
+        glDrawArrays(GL_TRIANGLES, 0, 6);
+    }
+    glActiveTexture(GL_TEXTURE0);
+    glEnable(GL_BLEND);
+    
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, draw_framebuffer);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, read_framebuffer);
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    
+    r->blur_generation = generation;
+    return true;
+}
+
 GLRenderer* gl_renderer_init(const Config *config) {
     GLRenderer *r = malloc(sizeof(GLRenderer));
     if (!r) return NULL;
@@ -75,6 +415,26 @@ GLRenderer* gl_renderer_init(const Config *config) {
     r->search_mode = false;
     r->show_help = false;
     
+    r->thumb_array = 0;
+    r->copy_fbo = 0;
+    r->layer_count = 0;
+    r->layer_limit = 0;
+    r->layers = NULL;
+    r->wallpaper_layers = NULL;
+    r->wallpaper_capacity = 0;
+    r->lru_head = -1;
+    r->lru_tail = -1;
+    r->frame = 0;
+    r->blur_program = 0;
+    r->blur_vao = 0;
+    r->blur_fbo = 0;
+    r->blur_textures[0] = 0;
+    r->blur_textures[1] = 0;
+    r->blur_generation = 0;
+    r->instance_vbo = 0;
+    r->instances = NULL;
+    r->instance_capacity = 0;
+    
     // Initialize start time for animations
     start_time = SDL_GetTicks();
     
@@ -147,7 +507,8 @@ GLRenderer* gl_renderer_init(const Config *config) {
     GLuint vertex_shader = shader_load("shaders/vertex.glsl", GL_VERTEX_SHADER);
     GLuint fragment_shader = shader_load("shaders/fragment.glsl", GL_FRAGMENT_SHADER);
     
-    if (!vertex_shader || !fragment_shader) {
+    r->shader_program = program_link(vertex_shader, fragment_shader);
+    if (!r->shader_program) {
         fprintf(stderr, "Failed to load shaders\n");
         SDL_GL_DestroyContext(r->gl_context);
         SDL_DestroyWindow(r->window);
@@ -155,21 +516,19 @@ GLRenderer* gl_renderer_init(const Config *config) {
         return NULL;
     }
     
-    r->shader_program = glCreateProgram();
-    glAttachShader(r->shader_program, vertex_shader);
-    glAttachShader(r->shader_program, fragment_shader);
-    glLinkProgram(r->shader_program);
-    
-    GLint success;
-    glGetProgramiv(r->shader_program, GL_LINK_STATUS, &success);
-    if (!success) {
-        char log[512];
-        glGetProgramInfoLog(r->shader_program, 512, NULL, log);
-        fprintf(stderr, "Shader linking failed: %s\n", log);
+    // Resolve uniforms once; per-frame constants come from one uniform buffer
+    r->uniforms.thumbnails = glGetUniformLocation(r->shader_program, "thumbnails");
+    r->uniforms.background = glGetUniformLocation(r->shader_program, "backgroundTexture");
+    r->uniforms.frame_block = glGetUniformBlockIndex(r->shader_program, "FrameConstants");
+    if (r->uniforms.frame_block != GL_INVALID_INDEX) {
+        glUniformBlockBinding(r->shader_program, r->uniforms.frame_block, FRAME_CONSTANTS_BINDING);
     }
     
-    glDeleteShader(vertex_shader);
-    glDeleteShader(fragment_shader);
+    glGenBuffers(1, &r->frame_ubo);
+    glBindBuffer(GL_UNIFORM_BUFFER, r->frame_ubo);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(GLFrameConstants), NULL, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    glBindBufferBase(GL_UNIFORM_BUFFER, FRAME_CONSTANTS_BINDING, r->frame_ubo);
     
     // Setup VAO, VBO for rendering quads
     float vertices[] = {
@@ -195,9 +554,42 @@ GLRenderer* gl_renderer_init(const Config *config) {
     glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(2 * sizeof(float)));
     glEnableVertexAttribArray(1);
     
+    // Per-item attributes, streamed each frame and advanced once per instance
+    glGenBuffers(1, &r->instance_vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, r->instance_vbo);
+    const struct { GLuint location; GLint size; size_t offset; } instance_attributes[] = {
+        {2, 4, offsetof(GLInstance, quad)},
+        {3, 4, offsetof(GLInstance, thumbnail)},
+        {4, 4, offsetof(GLInstance, color)},
+        {5, 4, offsetof(GLInstance, params)},
+        {6, 2, offsetof(GLInstance, uv_scale)},
+    };
+    for (size_t i = 0; i < sizeof(instance_attributes) / sizeof(instance_attributes[0]); i++) {
+        GLuint location = instance_attributes[i].location;
+        glVertexAttribPointer(location, instance_attributes[i].size, GL_FLOAT, GL_FALSE,
+                              sizeof(GLInstance), (void*)instance_attributes[i].offset);
+        glEnableVertexAttribArray(location);
+        glVertexAttribDivisor(location, 1);
+    }
+    
     glBindBuffer(GL_ARRAY_BUFFER, 0);
     glBindVertexArray(0);
     
+    if (!init_layers(r, config)) {
+        fprintf(stderr, "Failed to allocate thumbnail textures\n");
+        gl_renderer_cleanup(r);
+        return NULL;
+    }
+    
+    if (config->frosted_background && !init_blur(r)) {
+        fprintf(stderr, "Frosted background unavailable, falling back to a plain tint\n");
+    }
+    
+    glUseProgram(r->shader_program);
+    glUniform1i(r->uniforms.thumbnails, 0);
+    glUniform1i(r->uniforms.background, 1);
+    glUseProgram(0);
+    
     // Enable blending for transparency
     glEnable(GL_BLEND);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
@@ -208,44 +600,6 @@ GLRenderer* gl_renderer_init(const Config *config) {
     return r;
 }
 
-// Helper function to calculate average color from thumbnail
-static void calculate_avg_color(SDL_Surface *surf, float *r, float *g, float *b) {
-    if (!surf || !surf->pixels) {
-        *r = *g = *b = 0.5f;
-        return;
-    }
-    
-    unsigned long long sum_r = 0, sum_g = 0, sum_b = 0;
-    int sample_count = 0;
-    int step = 4;
-    
-    SDL_LockSurface(surf);
-    
-    const SDL_PixelFormatDetails *format_details = SDL_GetPixelFormatDetails(surf->format);
-    
-    for (int y = 0; y < surf->h; y += step) {
-        for (int x = 0; x < surf->w; x += step) {
-            Uint32 pixel = ((Uint32*)surf->pixels)[y * (surf->pitch / 4) + x];
-            Uint8 pr, pg, pb;
-            SDL_GetRGB(pixel, format_details, NULL, &pr, &pg, &pb);
-            sum_r += pr;
-            sum_g += pg;
-            sum_b += pb;
-            sample_count++;
-        }
-    }
-    
-    SDL_UnlockSurface(surf);
-    
-    if (sample_count > 0) {
-        *r = (float)(sum_r / sample_count) / 255.0f;
-        *g = (float)(sum_g / sample_count) / 255.0f;
-        *b = (float)(sum_b / sample_count) / 255.0f;
-    } else {
-        *r = *g = *b = 0.5f;
-    }
-}
-
 // Helper to set up orthographic projection matrix
 static void setup_ortho_projection(float *projection, float width, float height) {
     float left = 0.0f, right = width;
@@ -262,18 +616,41 @@ static void setup_ortho_projection(float *projection, float width, float height)
     projection[15] = 1.0f;
 }
 
-// Helper to set up model matrix for a quad
-static void setup_model_matrix(float *model, float x, float y, float width, float height) {
-    memset(model, 0, 16 * sizeof(float));
-    model[0] = width;
-    model[5] = height;
-    model[10] = 1.0f;
-    model[12] = x;
-    model[13] = y;
-    model[15] = 1.0f;
+/* Room for count instances in the CPU-side staging array */
+static bool reserve_instances(GLRenderer *r, int count) {
+    if (count <= r->instance_capacity) return true;
+    
+    int new_capacity = r->instance_capacity > 0 ? r->instance_capacity : 64;
+    while (new_capacity < count) new_capacity *= 2;
+    
+    GLInstance *instances = realloc(r->instances, sizeof(GLInstance) * new_capacity);
+    if (!instances) return false;
+    
+    r->instances = instances;
+    r->instance_capacity = new_capacity;
+    return true;
+}
+
+void gl_renderer_visible_range(const GLRenderer *r, const Config *config, int count, int *first, int *last) {
+    // Thumbnails shrink away from the centre, so full size plus glow is an upper bound
+    const float spacing = (float)(config->thumbnail_width + 30);
+    const float glow_padding = 50.0f;
+    float half = (config->window_width / 2.0f + config->thumbnail_width / 2.0f + glow_padding) / spacing;
+    
+    // The carousel eases from current_scroll towards the selection
+    float lo = fminf(r->current_scroll, (float)r->selected_index);
+    float hi = fmaxf(r->current_scroll, (float)r->selected_index);
+    
+    *first = (int)floorf(lo - half);
+    *last = (int)ceilf(hi + half) + 1;
+    if (*first < 0) *first = 0;
+    if (*last > count) *last = count;
+    if (*last < *first) *last = *first;
 }
 
 void gl_renderer_draw_frame(GLRenderer *r, const WallpaperList *list, const Config *config) {
+    r->frame++;
+    
     // CRITICAL: Clear with transparent background!
     glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
     glClear(GL_COLOR_BUFFER_BIT);
@@ -281,9 +658,11 @@ void gl_renderer_draw_frame(GLRenderer *r, const WallpaperList *list, const Conf
     glUseProgram(r->shader_program);
     glBindVertexArray(r->vao);
     
+    GLFrameConstants frame;
+    memset(&frame, 0, sizeof(frame));
+    
     // CRITICAL: Update time uniform for animations!
-    float current_time = (float)(SDL_GetTicks() - start_time) / 1000.0f;
-    glUniform1f(glGetUniformLocation(r->shader_program, "time"), current_time);
+    frame.time = (float)(SDL_GetTicks() - start_time) / 1000.0f;
     
     // =====================
     // SMOOTH SCROLL ANIMATION
@@ -303,43 +682,59 @@ void gl_renderer_draw_frame(GLRenderer *r, const WallpaperList *list, const Conf
         r->current_scroll = r->target_scroll;
     }
     
-    float windowSize[2] = {(float)config->window_width, (float)config->window_height};
-    glUniform2fv(glGetUniformLocation(r->shader_program, "windowSize"), 1, windowSize);
+    frame.window_size[0] = (float)config->window_width;
+    frame.window_size[1] = (float)config->window_height;
     
     // Corner radius for rounded edges
-    glUniform1f(glGetUniformLocation(r->shader_program, "cornerRadius"), 15.0f);
+    frame.corner_radius = 15.0f;
     
     int visible_count = wallpaper_list_visible_count(list);
-    float projection[16], model[16];
     
-    setup_ortho_projection(projection, (float)config->window_width, (float)config->window_height);
-    glUniformMatrix4fv(glGetUniformLocation(r->shader_program, "projection"), 1, GL_FALSE, projection);
+    // Flat carousel: is_3d, tilt_x and depth_3d stay zero
+    setup_ortho_projection(frame.projection, (float)config->window_width, (float)config->window_height);
+    
+    // One upload for every draw this frame
+    glBindBuffer(GL_UNIFORM_BUFFER, r->frame_ubo);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(frame), &frame);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    
+    // Every thumbnail samples the one array; items pick their layer
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, r->thumb_array);
+    
+    // The background and every visible item are instances of one draw, in
+    // back-to-front order; the most items are those the carousel can show
+    int first = 0, last = 0;
+    if (r->view_mode == 0) {
+        gl_renderer_visible_range(r, config, visible_count, &first, &last);
+    }
+    if (!reserve_instances(r, last - first + 1)) {
+        glBindVertexArray(0);
+        SDL_GL_SwapWindow(r->window);
+        return;
+    }
+    int instance_count = 0;
     
     // === FIRST PASS: Render frosted glass background ===
-    Wallpaper *selected_wp = wallpaper_list_get((WallpaperList*)list, r->selected_index);
-    if (selected_wp && selected_wp->thumb) {
-        GLuint bg_texture;
-        glGenTextures(1, &bg_texture);
-        glBindTexture(GL_TEXTURE_2D, bg_texture);
-        
-        SDL_Surface *surf = selected_wp->thumb;
-        const SDL_PixelFormatDetails *format_details = SDL_GetPixelFormatDetails(surf->format);
-        GLenum format = (format_details->bytes_per_pixel == 4) ? GL_RGBA : GL_RGB;
+    // The thumbnail's aspect sizes the quad; with the frosted background on it
+    // is also blurred (once per selection) and sampled, otherwise only tinted
+    int selected_wp = wallpaper_list_get(list, r->selected_index);
+    if (selected_wp >= 0 && wallpaper_list_thumb(list, selected_wp)) {
+        SDL_Surface *surf = wallpaper_list_thumb(list, selected_wp);
         
-        SDL_LockSurface(surf);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, surf->w, surf->h, 0, format, GL_UNSIGNED_BYTE, surf->pixels);
-        SDL_UnlockSurface(surf);
-        
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-        
-        // Set background mode
-        glUniform1f(glGetUniformLocation(r->shader_program, "isBackground"), 1.0f);
-        glUniform1f(glGetUniformLocation(r->shader_program, "selected"), 0.0f);
-        glUniform1f(glGetUniformLocation(r->shader_program, "is3D"), 0.0f);
-        glUniform1f(glGetUniformLocation(r->shader_program, "rotationY"), 0.0f);
+        bool frosted = false;
+        if (r->blur_program) {
+            uint64_t generation = wallpaper_list_thumb_generation(list, selected_wp);
+            int layer = thumb_layer(r, selected_wp, surf, generation);
+            frosted = layer > 0 && blur_background(r, surf, generation, layer);
+            glUseProgram(r->shader_program);
+            glBindVertexArray(r->vao);
+        }
+        if (frosted) {
+            glActiveTexture(GL_TEXTURE1);
+            glBindTexture(GL_TEXTURE_2D, r->blur_textures[0]);
+            glActiveTexture(GL_TEXTURE0);
+        }
         
         // Cover scaling (maintain aspect ratio)
         float window_aspect = (float)config->window_width / (float)config->window_height;
@@ -357,11 +752,14 @@ void gl_renderer_draw_frame(GLRenderer *r, const WallpaperList *list, const Conf
         float offset_x = (config->window_width - scale_w) / 2.0f;
         float offset_y = (config->window_height - scale_h) / 2.0f;
         
-        setup_model_matrix(model, offset_x, offset_y, scale_w, scale_h);
-        glUniformMatrix4fv(glGetUniformLocation(r->shader_program, "model"), 1, GL_FALSE, model);
-        
-        glDrawArrays(GL_TRIANGLES, 0, 6);
-        glDeleteTextures(1, &bg_texture);
+        GLInstance *bg = &r->instances[instance_count++];
+        memset(bg, 0, sizeof(*bg));
+        bg->quad[0] = offset_x;
+        bg->quad[1] = offset_y;
+        bg->quad[2] = scale_w;
+        bg->quad[3] = scale_h;
+        bg->params[2] = 1.0f; // Background mode
+        bg->params[3] = frosted ? 1.0f : 0.0f;
     }
     
     // === SECOND PASS: Render thumbnails with glow ===
@@ -373,9 +771,9 @@ void gl_renderer_draw_frame(GLRenderer *r, const WallpaperList *list, const Conf
         // GLOW EXPANSION: Extra pixels around thumbnail for glow effect
         const float GLOW_PADDING = 50.0f;
         
-        for (int i = 0; i < visible_count; i++) {
-            Wallpaper *wp = wallpaper_list_get((WallpaperList*)list, i);
-            if (wp && wp->thumb) {
+        for (int i = first; i < last; i++) {
+            int wp = wallpaper_list_get(list, i);
+            if (wp >= 0) {
                 // USE SMOOTH SCROLL POSITION instead of integer selected_index
                 float index_offset = (float)i - r->current_scroll;
                 
@@ -403,56 +801,57 @@ void gl_renderer_draw_frame(GLRenderer *r, const WallpaperList *list, const Conf
                 float quad_w = scaled_width + GLOW_PADDING * 2;
                 float quad_h = scaled_height + GLOW_PADDING * 2;
                 
-                float rotation_y = index_offset * 0.1f;
-                
-                // Create texture
-                GLuint texture;
-                glGenTextures(1, &texture);
-                glBindTexture(GL_TEXTURE_2D, texture);
+                // Cull items whose glow falls wholly outside the window
+                if (quad_x + quad_w <= 0.0f || quad_x >= config->window_width) continue;
                 
-                SDL_Surface *surf = wp->thumb;
-                const SDL_PixelFormatDetails *format_details = SDL_GetPixelFormatDetails(surf->format);
-                GLenum format = (format_details->bytes_per_pixel == 4) ? GL_RGBA : GL_RGB;
-                
-                SDL_LockSurface(surf);
-                glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, surf->w, surf->h, 0, format, GL_UNSIGNED_BYTE, surf->pixels);
-                SDL_UnlockSurface(surf);
+                float rotation_y = index_offset * 0.1f;
                 
-                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+                // Resident layer, or the placeholder while the thumbnail loads
+                SDL_Surface *surf = wallpaper_list_thumb(list, wp);
+                int layer = surf ? thumb_layer(r, wp, surf, wallpaper_list_thumb_generation(list, wp)) : 0;
                 
-                // Set uniforms - use smooth selected value!
-                glUniform1f(glGetUniformLocation(r->shader_program, "selected"), selected);
-                glUniform1f(glGetUniformLocation(r->shader_program, "isBackground"), 0.0f);
-                glUniform1f(glGetUniformLocation(r->shader_program, "is3D"), 0.0f);
-                glUniform1f(glGetUniformLocation(r->shader_program, "rotationY"), rotation_y);
-                glUniform1f(glGetUniformLocation(r->shader_program, "tiltX"), 0.0f);
-                glUniform1f(glGetUniformLocation(r->shader_program, "depth3D"), 0.0f);
+                GLInstance *item = &r->instances[instance_count++];
+                item->quad[0] = quad_x;
+                item->quad[1] = quad_y;
+                item->quad[2] = quad_w;
+                item->quad[3] = quad_h;
                 
                 // CRITICAL: Pass the ACTUAL thumbnail position and size
-                float thumbnailPos[2] = {thumb_x, thumb_y};
-                float thumbnailSize[2] = {(float)scaled_width, (float)scaled_height};
-                glUniform2fv(glGetUniformLocation(r->shader_program, "thumbnailPos"), 1, thumbnailPos);
-                glUniform2fv(glGetUniformLocation(r->shader_program, "thumbnailSize"), 1, thumbnailSize);
+                item->thumbnail[0] = thumb_x;
+                item->thumbnail[1] = thumb_y;
+                item->thumbnail[2] = (float)scaled_width;
+                item->thumbnail[3] = (float)scaled_height;
                 
-                // Average color for glow
-                float avg_r, avg_g, avg_b;
-                calculate_avg_color(surf, &avg_r, &avg_g, &avg_b);
-                float avgColor[3] = {avg_r, avg_g, avg_b};
-                glUniform3fv(glGetUniformLocation(r->shader_program, "avgColor"), 1, avgColor);
+                // Average color for glow, worked out when the thumbnail was made,
+                // and the smooth selected value
+                const ThumbnailPalette *palette = wallpaper_list_palette(list, wp);
+                for (int c = 0; c < 3; c++) {
+                    item->color[c] = palette ? palette->average[c] / 255.0f : 0.5f;
+                }
+                item->color[3] = selected;
                 
-                // Model matrix for the EXPANDED quad (includes glow padding)
-                setup_model_matrix(model, quad_x, quad_y, quad_w, quad_h);
-                glUniformMatrix4fv(glGetUniformLocation(r->shader_program, "model"), 1, GL_FALSE, model);
+                item->params[0] = rotation_y;
+                item->params[1] = (float)layer;
+                item->params[2] = 0.0f;
+                item->params[3] = 0.0f;
                 
-                glDrawArrays(GL_TRIANGLES, 0, 6);
-                glDeleteTextures(1, &texture);
+                // Smaller thumbnails fill only the corner of their layer
+                item->uv_scale[0] = layer > 0 ? fminf((float)surf->w / r->layer_width, 1.0f) : 1.0f;
+                item->uv_scale[1] = layer > 0 ? fminf((float)surf->h / r->layer_height, 1.0f) : 1.0f;
             }
         }
     }
     
+    // Orphan last frame's storage so the upload never waits on the GPU
+    if (instance_count > 0) {
+        glBindBuffer(GL_ARRAY_BUFFER, r->instance_vbo);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(GLInstance) * r->instance_capacity, NULL, GL_STREAM_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(GLInstance) * instance_count, r->instances);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glDrawArraysInstanced(GL_TRIANGLES, 0, 6, instance_count);
+    }
+    
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
     glBindVertexArray(0);
     SDL_GL_SwapWindow(r->window);
 }
@@ -462,6 +861,17 @@ void gl_renderer_cleanup(GLRenderer *r) {
     
     if (r->vao) glDeleteVertexArrays(1, &r->vao);
     if (r->vbo) glDeleteBuffers(1, &r->vbo);
+    if (r->instance_vbo) glDeleteBuffers(1, &r->instance_vbo);
+    if (r->frame_ubo) glDeleteBuffers(1, &r->frame_ubo);
+    if (r->blur_vao) glDeleteVertexArrays(1, &r->blur_vao);
+    if (r->blur_fbo) glDeleteFramebuffers(1, &r->blur_fbo);
+    if (r->blur_textures[0]) glDeleteTextures(2, r->blur_textures);
+    if (r->blur_program) glDeleteProgram(r->blur_program);
+    free(r->instances);
+    if (r->thumb_array) glDeleteTextures(1, &r->thumb_array);
+    if (r->copy_fbo) glDeleteFramebuffers(1, &r->copy_fbo);
+    free(r->layers);
+    free(r->wallpaper_layers);
     if (r->shader_program) glDeleteProgram(r->shader_program);
     if (r->gl_context) SDL_GL_DestroyContext(r->gl_context);
     if (r->window) SDL_DestroyWindow(r->window);
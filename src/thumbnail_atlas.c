@@ -0,0 +1,522 @@
+/**
+ * @file thumbnail_atlas.c
+ * @brief Packed, memory-mapped thumbnail cache file
+ *
+ * File layout:
+ *
+ *   [AtlasHeader, padded to ATLAS_ALIGN]
+ *   [chunk 0][chunk 1]...
+ *
+ * Each chunk:
+ *
+ *   [ATLAS_CHUNK_SLOTS x AtlasEntry, padded to ATLAS_ALIGN]
+ *   [ATLAS_CHUNK_SLOTS x slot_stride bytes of image data, padded to ATLAS_ALIGN]
+ *
+ * Entry i of a chunk describes slot i of the same chunk. Slots are handed out
+ * in order and an entry only becomes VALID after its pixels are written, so a
+ * crash mid-write leaves at worst an unused slot behind.
+ *
+ * A slot holds raw pixels or a shorter compressed encoding; pages past the end
+ * of the data are never written and stay holes in the sparse file. An alias
+ * entry shares the data of an earlier slot and leaves its own slot empty.
+ *
+ * Replaced entries are only marked DEAD, since lookups hand out pointers into
+ * their slots. Once dead slots outnumber live ones, the next writable open
+ * copies the live entries into a fresh file and renames it over the old one;
+ * processes still mapping the old file keep reading it undisturbed.
+ */
+
+#define _GNU_SOURCE
+#include "thumbnail_atlas.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define ATLAS_MAGIC "VSTATLAS"
+#define ATLAS_VERSION 5
+#define ATLAS_CHUNK_SLOTS 256
+#define ATLAS_ALIGN 65536      /* Covers 4K and 16K pages */
+#define ATLAS_COMPACT_MIN_DEAD ATLAS_CHUNK_SLOTS  /* Dead slots worth rewriting the file for */
+
+#define ATLAS_ENTRY_EMPTY 0
+#define ATLAS_ENTRY_VALID 1
+#define ATLAS_ENTRY_DEAD  2
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    uint32_t slot_stride;
+    uint32_t chunk_slots;
+    uint32_t reserved[9];
+} AtlasHeader;
+
+typedef struct {
+    uint8_t key[THUMBNAIL_ATLAS_KEY_SIZE];
+    uint32_t state;
+    int32_t data_slot;           /* Slot holding the pixels, own slot unless an alias */
+    ThumbnailStamp stamp;        /* Source file the pixels were made from */
+    uint32_t codec;              /* Encoding tag chosen by the caller */
+    uint32_t length;             /* Bytes of data in the slot */
+    uint8_t info[THUMBNAIL_ATLAS_INFO_SIZE]; /* Caller's summary of the pixels */
+    uint8_t reserved[8];
+} AtlasEntry;
+
+struct ThumbnailAtlas {
+    int fd;
+    bool writable;
+    int width;
+    int height;
+    size_t slot_stride;
+    size_t index_size;           /**< Entry table bytes per chunk, aligned */
+    size_t chunk_size;           /**< Total bytes per chunk, aligned */
+
+    uint8_t **chunks;            /**< Mapping of each chunk */
+    int chunk_count;
+    int chunk_capacity;
+    int next_slot;               /**< First never-used slot */
+    int live_count;
+
+    int32_t *table;              /**< Open-addressed key -> slot map, -1 = empty */
+    int table_size;              /**< Power of two */
+    int table_used;
+
+    pthread_mutex_t lock;
+};
+
+static size_t align_up(size_t value, size_t align) {
+    return (value + align - 1) / align * align;
+}
+
+static AtlasEntry* entry_at(ThumbnailAtlas *a, int slot) {
+    AtlasEntry *index = (AtlasEntry*)a->chunks[slot / ATLAS_CHUNK_SLOTS];
+    return &index[slot % ATLAS_CHUNK_SLOTS];
+}
+
+static uint8_t* pixels_at(ThumbnailAtlas *a, int slot) {
+    uint8_t *chunk = a->chunks[slot / ATLAS_CHUNK_SLOTS];
+    return chunk + a->index_size + (size_t)(slot % ATLAS_CHUNK_SLOTS) * a->slot_stride;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                 Key Table                                  */
+/* -------------------------------------------------------------------------- */
+
+static uint32_t key_hash(const uint8_t *key) {
+    uint32_t h;
+    memcpy(&h, key, sizeof(h));
+    return h;
+}
+
+/**
+ * @brief Find the table position holding key, or the empty position for it
+ */
+static int table_probe(ThumbnailAtlas *a, const uint8_t *key) {
+    int mask = a->table_size - 1;
+    int pos = (int)(key_hash(key) & (uint32_t)mask);
+
+    while (a->table[pos] >= 0) {
+        if (memcmp(entry_at(a, a->table[pos])->key, key, THUMBNAIL_ATLAS_KEY_SIZE) == 0) {
+            return pos;
+        }
+        pos = (pos + 1) & mask;
+    }
+    return pos;
+}
+
+static bool table_resize(ThumbnailAtlas *a, int new_size) {
+    int32_t *old = a->table;
+    int old_size = a->table_size;
+
+    a->table = malloc(sizeof(int32_t) * new_size);
+    if (!a->table) {
+        a->table = old;
+        return false;
+    }
+    memset(a->table, 0xff, sizeof(int32_t) * new_size);
+    a->table_size = new_size;
+
+    for (int i = 0; i < old_size; i++) {
+        if (old[i] >= 0) {
+            a->table[table_probe(a, entry_at(a, old[i])->key)] = old[i];
+        }
+    }
+    free(old);
+    return true;
+}
+
+/**
+ * @brief Point key at slot
+ * @return Slot previously holding the key, or -1
+ */
+static int table_insert(ThumbnailAtlas *a, const uint8_t *key, int slot) {
+    if ((a->table_used + 1) * 2 > a->table_size && !table_resize(a, a->table_size * 2)) {
+        return -1;
+    }
+
+    int pos = table_probe(a, key);
+    int previous = a->table[pos];
+    if (previous < 0) a->table_used++;
+    a->table[pos] = slot;
+    return previous;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                  Chunks                                    */
+/* -------------------------------------------------------------------------- */
+
+static bool map_chunk(ThumbnailAtlas *a, int chunk) {
+    if (chunk >= a->chunk_capacity) {
+        int new_capacity = a->chunk_capacity > 0 ? a->chunk_capacity * 2 : 8;
+        uint8_t **chunks = realloc(a->chunks, sizeof(uint8_t*) * new_capacity);
+        if (!chunks) return false;
+        a->chunks = chunks;
+        a->chunk_capacity = new_capacity;
+    }
+
+    off_t offset = (off_t)ATLAS_ALIGN + (off_t)chunk * (off_t)a->chunk_size;
+    int prot = a->writable ? PROT_READ | PROT_WRITE : PROT_READ;
+    void *map = mmap(NULL, a->chunk_size, prot, MAP_SHARED, a->fd, offset);
+    if (map == MAP_FAILED) {
+        fprintf(stderr, "Failed to map thumbnail atlas chunk: %s\n", strerror(errno));
+        return false;
+    }
+
+    a->chunks[chunk] = map;
+    a->chunk_count = chunk + 1;
+    return true;
+}
+
+/**
+ * @brief Extend the file by one chunk and map it
+ */
+static bool add_chunk(ThumbnailAtlas *a) {
+    off_t new_size = (off_t)ATLAS_ALIGN + (off_t)(a->chunk_count + 1) * (off_t)a->chunk_size;
+
+    // The file is sparse, so untouched slots cost no disk space
+    if (ftruncate(a->fd, new_size) != 0) {
+        fprintf(stderr, "Failed to grow thumbnail atlas: %s\n", strerror(errno));
+        return false;
+    }
+    return map_chunk(a, a->chunk_count);
+}
+
+static bool write_header(ThumbnailAtlas *a) {
+    AtlasHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, ATLAS_MAGIC, sizeof(header.magic));
+    header.version = ATLAS_VERSION;
+    header.width = (uint32_t)a->width;
+    header.height = (uint32_t)a->height;
+    header.slot_stride = (uint32_t)a->slot_stride;
+    header.chunk_slots = ATLAS_CHUNK_SLOTS;
+
+    if (ftruncate(a->fd, 0) != 0 || ftruncate(a->fd, ATLAS_ALIGN) != 0) return false;
+    return pwrite(a->fd, &header, sizeof(header), 0) == (ssize_t)sizeof(header);
+}
+
+static bool header_matches(ThumbnailAtlas *a) {
+    AtlasHeader header;
+    if (pread(a->fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header)) return false;
+
+    return memcmp(header.magic, ATLAS_MAGIC, sizeof(header.magic)) == 0 &&
+           header.version == ATLAS_VERSION &&
+           header.width == (uint32_t)a->width &&
+           header.height == (uint32_t)a->height &&
+           header.slot_stride == (uint32_t)a->slot_stride &&
+           header.chunk_slots == ATLAS_CHUNK_SLOTS;
+}
+
+/**
+ * @brief Reserve the next free slot (lock held)
+ * @return Slot, or -1 if the file could not grow
+ */
+static int reserve_slot(ThumbnailAtlas *a) {
+    int slot = a->next_slot;
+    if (slot / ATLAS_CHUNK_SLOTS >= a->chunk_count && !add_chunk(a)) {
+        return -1;
+    }
+    a->next_slot++;
+    return slot;
+}
+
+/**
+ * @brief Make a fully written entry visible (lock held)
+ */
+static void publish_entry(ThumbnailAtlas *a, int slot, const uint8_t *key) {
+    AtlasEntry *entry = entry_at(a, slot);
+    __atomic_store_n(&entry->state, ATLAS_ENTRY_VALID, __ATOMIC_RELEASE);
+
+    int previous = table_insert(a, key, slot);
+    if (previous >= 0) {
+        entry_at(a, previous)->state = ATLAS_ENTRY_DEAD;
+    } else {
+        a->live_count++;
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                 Public API                                 */
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief Map an atlas file and index its entries, recreating it if it does not match
+ */
+static ThumbnailAtlas* open_file(const char *path, int width, int height) {
+    ThumbnailAtlas *a = calloc(1, sizeof(ThumbnailAtlas));
+    if (!a) return NULL;
+
+    a->width = width;
+    a->height = height;
+    a->slot_stride = align_up((size_t)width * height * 4, 64);
+    a->index_size = align_up(sizeof(AtlasEntry) * ATLAS_CHUNK_SLOTS, ATLAS_ALIGN);
+    a->chunk_size = a->index_size + align_up(a->slot_stride * ATLAS_CHUNK_SLOTS, ATLAS_ALIGN);
+    pthread_mutex_init(&a->lock, NULL);
+
+    a->fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (a->fd < 0) {
+        fprintf(stderr, "Failed to open thumbnail atlas %s: %s\n", path, strerror(errno));
+        pthread_mutex_destroy(&a->lock);
+        free(a);
+        return NULL;
+    }
+
+    // Only one process appends at a time; others read what is already there
+    a->writable = flock(a->fd, LOCK_EX | LOCK_NB) == 0;
+
+    struct stat st;
+    bool valid = fstat(a->fd, &st) == 0 && st.st_size >= ATLAS_ALIGN && header_matches(a);
+    if (!valid) {
+        if (!a->writable || !write_header(a)) {
+            fprintf(stderr, "Thumbnail atlas %s is unusable\n", path);
+            thumbnail_atlas_close(a);
+            return NULL;
+        }
+        st.st_size = ATLAS_ALIGN;
+    }
+
+    a->table_size = 1024;
+    a->table = malloc(sizeof(int32_t) * a->table_size);
+    if (!a->table) {
+        thumbnail_atlas_close(a);
+        return NULL;
+    }
+    memset(a->table, 0xff, sizeof(int32_t) * a->table_size);
+
+    // Map every complete chunk and index its live entries
+    int chunks = (int)((st.st_size - ATLAS_ALIGN) / (off_t)a->chunk_size);
+    for (int c = 0; c < chunks; c++) {
+        if (!map_chunk(a, c)) {
+            thumbnail_atlas_close(a);
+            return NULL;
+        }
+
+        for (int i = 0; i < ATLAS_CHUNK_SLOTS; i++) {
+            int slot = c * ATLAS_CHUNK_SLOTS + i;
+            AtlasEntry *e = entry_at(a, slot);
+            if (e->state == ATLAS_ENTRY_EMPTY) continue;
+
+            a->next_slot = slot + 1;
+            if (e->state == ATLAS_ENTRY_VALID && (e->data_slot < 0 || e->data_slot > slot)) {
+                e->state = ATLAS_ENTRY_DEAD;
+            }
+            if (e->state == ATLAS_ENTRY_VALID) {
+                int previous = table_insert(a, e->key, slot);
+                if (previous >= 0) {
+                    entry_at(a, previous)->state = ATLAS_ENTRY_DEAD;
+                } else {
+                    a->live_count++;
+                }
+            }
+        }
+    }
+
+    return a;
+}
+
+/**
+ * @brief Copy the live entries of a freshly opened atlas into a new file at path
+ *
+ * Slots are renumbered in order, so an alias still follows the slot holding
+ * its data. Data whose own entry was replaced but which an alias still
+ * shares is carried over under a DEAD entry, as it was in the old file.
+ *
+ * @return Atlas on the new file, or NULL if the old one should be kept
+ */
+static ThumbnailAtlas* compact(ThumbnailAtlas *a, const char *path) {
+    char temp[4096];
+    if (snprintf(temp, sizeof(temp), "%s.compact", path) >= (int)sizeof(temp)) return NULL;
+    unlink(temp);
+
+    ThumbnailAtlas *b = open_file(temp, a->width, a->height);
+    if (!b) return NULL;
+    int *moved = malloc(sizeof(int) * (a->next_slot > 0 ? a->next_slot : 1));
+    bool ok = b->writable && moved;
+
+    for (int slot = 0; ok && slot < a->next_slot; slot++) moved[slot] = -1;
+    for (int slot = 0; ok && slot < a->next_slot; slot++) {
+        AtlasEntry *e = entry_at(a, slot);
+        if (e->state != ATLAS_ENTRY_VALID) continue;
+
+        int data = e->data_slot;
+        if (data != slot && moved[data] < 0) {
+            // Shared data that lost its own entry
+            int kept = reserve_slot(b);
+            ok = kept >= 0;
+            if (!ok) break;
+            AtlasEntry *k = entry_at(b, kept);
+            *k = *entry_at(a, data);
+            k->state = ATLAS_ENTRY_DEAD;
+            k->data_slot = kept;
+            memcpy(pixels_at(b, kept), pixels_at(a, data), k->length);
+            moved[data] = kept;
+        }
+
+        int copy = reserve_slot(b);
+        ok = copy >= 0;
+        if (!ok) break;
+        if (data == slot) {
+            memcpy(pixels_at(b, copy), pixels_at(a, slot), e->length);
+            moved[slot] = copy;
+        }
+        AtlasEntry *c = entry_at(b, copy);
+        *c = *e;
+        c->state = ATLAS_ENTRY_EMPTY;
+        c->data_slot = moved[data];
+        publish_entry(b, copy, c->key);
+    }
+    free(moved);
+
+    if (!ok || rename(temp, path) != 0) {
+        thumbnail_atlas_close(b);
+        unlink(temp);
+        return NULL;
+    }
+    return b;
+}
+
+ThumbnailAtlas* thumbnail_atlas_open(const char *path, int width, int height) {
+    if (width <= 0 || height <= 0) return NULL;
+
+    ThumbnailAtlas *a = open_file(path, width, height);
+    int dead = a ? a->next_slot - a->live_count : 0;
+    if (a && a->writable && dead >= ATLAS_COMPACT_MIN_DEAD && dead > a->live_count) {
+        ThumbnailAtlas *compacted = compact(a, path);
+        if (compacted) {
+            thumbnail_atlas_close(a);
+            a = compacted;
+        }
+    }
+    return a;
+}
+
+void thumbnail_atlas_close(ThumbnailAtlas *a) {
+    if (!a) return;
+
+    for (int c = 0; c < a->chunk_count; c++) {
+        if (a->chunks[c]) munmap(a->chunks[c], a->chunk_size);
+    }
+    free(a->chunks);
+    free(a->table);
+    if (a->fd >= 0) close(a->fd);
+    pthread_mutex_destroy(&a->lock);
+    free(a);
+}
+
+static bool stamp_equal(const ThumbnailStamp *a, const ThumbnailStamp *b) {
+    return a->mtime == b->mtime && a->size == b->size && a->inode == b->inode;
+}
+
+const void* thumbnail_atlas_lookup(ThumbnailAtlas *a, const uint8_t key[THUMBNAIL_ATLAS_KEY_SIZE],
+                                   const ThumbnailStamp *stamp, uint32_t *codec, size_t *length,
+                                   void *info) {
+    const void *data = NULL;
+
+    pthread_mutex_lock(&a->lock);
+    int slot = a->table[table_probe(a, key)];
+    // A stale entry is reported as a miss; storing the new thumbnail retires it
+    if (slot >= 0 && (!stamp || stamp_equal(&entry_at(a, slot)->stamp, stamp))) {
+        AtlasEntry *entry = entry_at(a, slot);
+        data = pixels_at(a, entry->data_slot);
+        if (codec) *codec = entry->codec;
+        if (length) *length = entry->length;
+        if (info) memcpy(info, entry->info, THUMBNAIL_ATLAS_INFO_SIZE);
+    }
+    pthread_mutex_unlock(&a->lock);
+
+    return data;
+}
+
+bool thumbnail_atlas_store(ThumbnailAtlas *a, const uint8_t key[THUMBNAIL_ATLAS_KEY_SIZE],
+                           const ThumbnailStamp *stamp, uint32_t codec, const void *data, size_t length,
+                           const void *info) {
+    if (!a->writable || length > a->slot_stride) return false;
+
+    // Reserve a slot under the lock, then copy the data without holding it
+    pthread_mutex_lock(&a->lock);
+    int slot = reserve_slot(a);
+    if (slot < 0) {
+        pthread_mutex_unlock(&a->lock);
+        return false;
+    }
+    uint8_t *dst = pixels_at(a, slot);
+    AtlasEntry *entry = entry_at(a, slot);
+    pthread_mutex_unlock(&a->lock);
+
+    memcpy(dst, data, length);
+    memcpy(entry->key, key, THUMBNAIL_ATLAS_KEY_SIZE);
+    entry->stamp = *stamp;
+    entry->data_slot = slot;
+    entry->codec = codec;
+    entry->length = (uint32_t)length;
+    if (info) memcpy(entry->info, info, THUMBNAIL_ATLAS_INFO_SIZE);
+    else memset(entry->info, 0, THUMBNAIL_ATLAS_INFO_SIZE);
+
+    // Publish: the entry only becomes valid once its data is in place
+    pthread_mutex_lock(&a->lock);
+    publish_entry(a, slot, key);
+    pthread_mutex_unlock(&a->lock);
+
+    return true;
+}
+
+bool thumbnail_atlas_alias(ThumbnailAtlas *a, const uint8_t key[THUMBNAIL_ATLAS_KEY_SIZE],
+                           const ThumbnailStamp *stamp, const uint8_t target[THUMBNAIL_ATLAS_KEY_SIZE]) {
+    if (!a->writable) return false;
+
+    pthread_mutex_lock(&a->lock);
+    int target_slot = a->table[table_probe(a, target)];
+    int slot = target_slot >= 0 ? reserve_slot(a) : -1;
+    if (slot < 0) {
+        pthread_mutex_unlock(&a->lock);
+        return false;
+    }
+
+    AtlasEntry *entry = entry_at(a, slot);
+    AtlasEntry *target_entry = entry_at(a, target_slot);
+    memcpy(entry->key, key, THUMBNAIL_ATLAS_KEY_SIZE);
+    entry->stamp = *stamp;
+    entry->data_slot = target_entry->data_slot;
+    entry->codec = target_entry->codec;
+    entry->length = target_entry->length;
+    memcpy(entry->info, target_entry->info, THUMBNAIL_ATLAS_INFO_SIZE);
+    publish_entry(a, slot, key);
+    pthread_mutex_unlock(&a->lock);
+
+    return true;
+}
+
+int thumbnail_atlas_count(ThumbnailAtlas *a) {
+    pthread_mutex_lock(&a->lock);
+    int count = a->live_count;
+    pthread_mutex_unlock(&a->lock);
+    return count;
+}
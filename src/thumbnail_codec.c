@@ -0,0 +1,445 @@
+/**
+ * @file thumbnail_codec.c
+ * @brief Encoders and decoders for cached thumbnail pixels
+ */
+
+#include "thumbnail_codec.h"
+#include <stdlib.h>
+#include <string.h>
+
+static const char *codec_names[THUMBNAIL_CODEC_COUNT] = {
+    "raw", "qoi", "lz4", "png"
+};
+
+bool thumbnail_codec_parse(const char *name, ThumbnailCodec *codec) {
+    for (int i = 0; i < THUMBNAIL_CODEC_COUNT; i++) {
+        if (strcmp(name, codec_names[i]) == 0) {
+            *codec = (ThumbnailCodec)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char* thumbnail_codec_name(ThumbnailCodec codec) {
+    return (codec >= 0 && codec < THUMBNAIL_CODEC_COUNT) ? codec_names[codec] : "unknown";
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                    QOI                                     */
+/* -------------------------------------------------------------------------- */
+
+/* See https://qoiformat.org/qoi-specification.pdf */
+
+#define QOI_OP_INDEX 0x00
+#define QOI_OP_DIFF  0x40
+#define QOI_OP_LUMA  0x80
+#define QOI_OP_RUN   0xc0
+#define QOI_OP_RGB   0xfe
+#define QOI_OP_RGBA  0xff
+#define QOI_MASK_2   0xc0
+#define QOI_HEADER_SIZE 14
+#define QOI_PADDING_SIZE 8
+
+static const uint8_t qoi_padding[QOI_PADDING_SIZE] = {0, 0, 0, 0, 0, 0, 0, 1};
+
+typedef union {
+    struct { uint8_t r, g, b, a; } rgba;
+    uint32_t v;
+} QoiPixel;
+
+static inline int qoi_hash(QoiPixel p) {
+    return (p.rgba.r * 3 + p.rgba.g * 5 + p.rgba.b * 7 + p.rgba.a * 11) % 64;
+}
+
+static void write_be32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
+}
+
+static uint32_t read_be32(const uint8_t *p) {
+    return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+}
+
+static size_t qoi_encode(const uint8_t *pixels, int width, int height, int pitch,
+                         uint8_t *out, size_t capacity) {
+    if (capacity < thumbnail_codec_bound(THUMBNAIL_CODEC_QOI, width, height)) return 0;
+
+    uint8_t *op = out;
+    memcpy(op, "qoif", 4);
+    write_be32(op + 4, (uint32_t)width);
+    write_be32(op + 8, (uint32_t)height);
+    op[12] = 4;   // channels
+    op[13] = 0;   // sRGB with linear alpha
+    op += QOI_HEADER_SIZE;
+
+    QoiPixel index[64];
+    memset(index, 0, sizeof(index));
+    QoiPixel prev = {{0, 0, 0, 255}};
+    int run = 0;
+    long remaining = (long)width * height;
+
+    for (int y = 0; y < height; y++) {
+        const uint8_t *row = pixels + (size_t)y * pitch;
+        for (int x = 0; x < width; x++) {
+            QoiPixel px;
+            memcpy(&px, row + x * 4, 4);
+            remaining--;
+
+            if (px.v == prev.v) {
+                run++;
+                if (run == 62 || remaining == 0) {
+                    *op++ = QOI_OP_RUN | (run - 1);
+                    run = 0;
+                }
+                continue;
+            }
+
+            if (run > 0) {
+                *op++ = QOI_OP_RUN | (run - 1);
+                run = 0;
+            }
+
+            int hash = qoi_hash(px);
+            if (index[hash].v == px.v) {
+                *op++ = QOI_OP_INDEX | hash;
+            } else {
+                index[hash] = px;
+
+                if (px.rgba.a == prev.rgba.a) {
+                    int8_t vr = (int8_t)(px.rgba.r - prev.rgba.r);
+                    int8_t vg = (int8_t)(px.rgba.g - prev.rgba.g);
+                    int8_t vb = (int8_t)(px.rgba.b - prev.rgba.b);
+                    int8_t vg_r = (int8_t)(vr - vg);
+                    int8_t vg_b = (int8_t)(vb - vg);
+
+                    if (vr > -3 && vr < 2 && vg > -3 && vg < 2 && vb > -3 && vb < 2) {
+                        *op++ = QOI_OP_DIFF | (vr + 2) << 4 | (vg + 2) << 2 | (vb + 2);
+                    } else if (vg_r > -9 && vg_r < 8 && vg > -33 && vg < 32 && vg_b > -9 && vg_b < 8) {
+                        *op++ = QOI_OP_LUMA | (vg + 32);
+                        *op++ = (uint8_t)((vg_r + 8) << 4 | (vg_b + 8));
+                    } else {
+                        *op++ = QOI_OP_RGB;
+                        *op++ = px.rgba.r;
+                        *op++ = px.rgba.g;
+                        *op++ = px.rgba.b;
+                    }
+                } else {
+                    *op++ = QOI_OP_RGBA;
+                    *op++ = px.rgba.r;
+                    *op++ = px.rgba.g;
+                    *op++ = px.rgba.b;
+                    *op++ = px.rgba.a;
+                }
+            }
+            prev = px;
+        }
+    }
+
+    memcpy(op, qoi_padding, QOI_PADDING_SIZE);
+    op += QOI_PADDING_SIZE;
+    return (size_t)(op - out);
+}
+
+static bool qoi_decode(const uint8_t *data, size_t length, uint8_t *pixels,
+                       int width, int height, int pitch) {
+    if (length < QOI_HEADER_SIZE + QOI_PADDING_SIZE ||
+        memcmp(data, "qoif", 4) != 0 ||
+        read_be32(data + 4) != (uint32_t)width ||
+        read_be32(data + 8) != (uint32_t)height) {
+        return false;
+    }
+
+    const uint8_t *ip = data + QOI_HEADER_SIZE;
+    const uint8_t *iend = data + length - QOI_PADDING_SIZE;
+
+    QoiPixel index[64];
+    memset(index, 0, sizeof(index));
+    QoiPixel px = {{0, 0, 0, 255}};
+    int run = 0;
+
+    for (int y = 0; y < height; y++) {
+        uint8_t *row = pixels + (size_t)y * pitch;
+        for (int x = 0; x < width; x++) {
+            if (run > 0) {
+                run--;
+            } else {
+                if (ip >= iend) return false;
+                int b1 = *ip++;
+
+                if (b1 == QOI_OP_RGB) {
+                    if (iend - ip < 3) return false;
+                    px.rgba.r = ip[0];
+                    px.rgba.g = ip[1];
+                    px.rgba.b = ip[2];
+                    ip += 3;
+                } else if (b1 == QOI_OP_RGBA) {
+                    if (iend - ip < 4) return false;
+                    memcpy(&px, ip, 4);
+                    ip += 4;
+                } else if ((b1 & QOI_MASK_2) == QOI_OP_INDEX) {
+                    px = index[b1];
+                } else if ((b1 & QOI_MASK_2) == QOI_OP_DIFF) {
+                    px.rgba.r += ((b1 >> 4) & 0x03) - 2;
+                    px.rgba.g += ((b1 >> 2) & 0x03) - 2;
+                    px.rgba.b += (b1 & 0x03) - 2;
+                } else if ((b1 & QOI_MASK_2) == QOI_OP_LUMA) {
+                    if (ip >= iend) return false;
+                    int b2 = *ip++;
+                    int vg = (b1 & 0x3f) - 32;
+                    px.rgba.r += vg - 8 + ((b2 >> 4) & 0x0f);
+                    px.rgba.g += vg;
+                    px.rgba.b += vg - 8 + (b2 & 0x0f);
+                } else {
+                    run = b1 & 0x3f;
+                }
+
+                index[qoi_hash(px)] = px;
+            }
+            memcpy(row + x * 4, &px, 4);
+        }
+    }
+
+    return true;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                    LZ4                                     */
+/* -------------------------------------------------------------------------- */
+
+/* Block format only, see https://github.com/lz4/lz4/blob/dev/doc/lz4_Block_format.md */
+
+#define LZ4_HASH_BITS 12
+#define LZ4_MIN_MATCH 4
+#define LZ4_MF_LIMIT 12         /* Last match must start this far from the end */
+#define LZ4_LAST_LITERALS 5     /* Last bytes are always literals */
+#define LZ4_MAX_OFFSET 65535
+
+static inline uint32_t read_u32(const uint8_t *p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint32_t lz4_hash(uint32_t sequence) {
+    return (sequence * 2654435761u) >> (32 - LZ4_HASH_BITS);
+}
+
+static uint8_t* lz4_write_length(uint8_t *op, size_t length) {
+    while (length >= 255) {
+        *op++ = 255;
+        length -= 255;
+    }
+    *op++ = (uint8_t)length;
+    return op;
+}
+
+/**
+ * @brief Emit one sequence; a match_length of 0 means literals only
+ * @return New output position, or NULL if it would not fit
+ */
+static uint8_t* lz4_write_sequence(uint8_t *op, uint8_t *oend, const uint8_t *literals,
+                                   size_t literal_length, size_t offset, size_t match_length) {
+    size_t needed = 1 + literal_length + literal_length / 255 + 1 + 2 + match_length / 255 + 1;
+    if ((size_t)(oend - op) < needed) return NULL;
+
+    uint8_t *token = op++;
+    *token = (uint8_t)((literal_length >= 15 ? 15 : literal_length) << 4);
+    if (literal_length >= 15) op = lz4_write_length(op, literal_length - 15);
+    memcpy(op, literals, literal_length);
+    op += literal_length;
+
+    if (match_length == 0) return op;
+
+    *op++ = (uint8_t)offset;
+    *op++ = (uint8_t)(offset >> 8);
+    size_t ml = match_length - LZ4_MIN_MATCH;
+    *token |= (uint8_t)(ml >= 15 ? 15 : ml);
+    if (ml >= 15) op = lz4_write_length(op, ml - 15);
+    return op;
+}
+
+static size_t lz4_compress(const uint8_t *src, size_t size, uint8_t *dst, size_t capacity) {
+    uint32_t table[1 << LZ4_HASH_BITS];
+    memset(table, 0, sizeof(table));
+
+    const uint8_t *ip = src;
+    const uint8_t *anchor = src;
+    const uint8_t *end = src + size;
+    uint8_t *op = dst;
+    uint8_t *oend = dst + capacity;
+
+    if (size > LZ4_MF_LIMIT) {
+        const uint8_t *mflimit = end - LZ4_MF_LIMIT;
+        const uint8_t *matchlimit = end - LZ4_LAST_LITERALS;
+
+        while (ip <= mflimit) {
+            uint32_t sequence = read_u32(ip);
+            uint32_t h = lz4_hash(sequence);
+            const uint8_t *ref = src + table[h];
+            table[h] = (uint32_t)(ip - src);
+
+            if (ref >= ip || ip - ref > LZ4_MAX_OFFSET || read_u32(ref) != sequence) {
+                ip++;
+                continue;
+            }
+
+            // Extend backwards over pending literals, then forwards
+            while (ip > anchor && ref > src && ip[-1] == ref[-1]) {
+                ip--;
+                ref--;
+            }
+            const uint8_t *match_end = ip + LZ4_MIN_MATCH;
+            const uint8_t *r = ref + LZ4_MIN_MATCH;
+            while (match_end < matchlimit && *match_end == *r) {
+                match_end++;
+                r++;
+            }
+
+            op = lz4_write_sequence(op, oend, anchor, (size_t)(ip - anchor),
+                                    (size_t)(ip - ref), (size_t)(match_end - ip));
+            if (!op) return 0;
+
+            ip = match_end;
+            anchor = ip;
+        }
+    }
+
+    op = lz4_write_sequence(op, oend, anchor, (size_t)(end - anchor), 0, 0);
+    return op ? (size_t)(op - dst) : 0;
+}
+
+static bool lz4_read_length(const uint8_t **ip, const uint8_t *iend, size_t *length) {
+    uint8_t b;
+    do {
+        if (*ip >= iend) return false;
+        b = *(*ip)++;
+        *length += b;
+    } while (b == 255);
+    return true;
+}
+
+static bool lz4_decompress(const uint8_t *src, size_t size, uint8_t *dst, size_t dst_size) {
+    const uint8_t *ip = src;
+    const uint8_t *iend = src + size;
+    uint8_t *op = dst;
+    uint8_t *oend = dst + dst_size;
+
+    while (ip < iend) {
+        uint8_t token = *ip++;
+
+        size_t literal_length = token >> 4;
+        if (literal_length == 15 && !lz4_read_length(&ip, iend, &literal_length)) return false;
+        if (literal_length > (size_t)(iend - ip) || literal_length > (size_t)(oend - op)) return false;
+        memcpy(op, ip, literal_length);
+        ip += literal_length;
+        op += literal_length;
+
+        // The last sequence has no match part
+        if (ip == iend) break;
+
+        if (iend - ip < 2) return false;
+        size_t offset = (size_t)ip[0] | (size_t)ip[1] << 8;
+        ip += 2;
+        if (offset == 0 || offset > (size_t)(op - dst)) return false;
+
+        size_t match_length = token & 0x0f;
+        if (match_length == 15 && !lz4_read_length(&ip, iend, &match_length)) return false;
+        match_length += LZ4_MIN_MATCH;
+        if (match_length > (size_t)(oend - op)) return false;
+
+        // Byte copy: the match may overlap the bytes being written
+        const uint8_t *match = op - offset;
+        for (size_t i = 0; i < match_length; i++) {
+            op[i] = match[i];
+        }
+        op += match_length;
+    }
+
+    return op == oend;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                 Public API                                 */
+/* -------------------------------------------------------------------------- */
+
+size_t thumbnail_codec_bound(ThumbnailCodec codec, int width, int height) {
+    size_t raw = (size_t)width * height * 4;
+    switch (codec) {
+        case THUMBNAIL_CODEC_RAW: return raw;
+        case THUMBNAIL_CODEC_QOI: return (size_t)width * height * 5 + QOI_HEADER_SIZE + QOI_PADDING_SIZE;
+        case THUMBNAIL_CODEC_LZ4: return raw + raw / 255 + 16;
+        default: return 0;
+    }
+}
+
+size_t thumbnail_codec_encode(ThumbnailCodec codec, const uint8_t *pixels, int width, int height,
+                              int pitch, uint8_t *out, size_t capacity) {
+    size_t row_bytes = (size_t)width * 4;
+
+    switch (codec) {
+        case THUMBNAIL_CODEC_RAW:
+            if (capacity < row_bytes * height) return 0;
+            for (int y = 0; y < height; y++) {
+                memcpy(out + y * row_bytes, pixels + (size_t)y * pitch, row_bytes);
+            }
+            return row_bytes * height;
+
+        case THUMBNAIL_CODEC_QOI:
+            return qoi_encode(pixels, width, height, pitch, out, capacity);
+
+        case THUMBNAIL_CODEC_LZ4: {
+            if ((size_t)pitch == row_bytes) {
+                return lz4_compress(pixels, row_bytes * height, out, capacity);
+            }
+
+            // LZ4 works on a flat buffer, so pack padded rows first
+            uint8_t *packed = malloc(row_bytes * height);
+            if (!packed) return 0;
+            thumbnail_codec_encode(THUMBNAIL_CODEC_RAW, pixels, width, height, pitch,
+                                   packed, row_bytes * height);
+            size_t length = lz4_compress(packed, row_bytes * height, out, capacity);
+            free(packed);
+            return length;
+        }
+
+        default:
+            return 0;
+    }
+}
+
+bool thumbnail_codec_decode(ThumbnailCodec codec, const uint8_t *data, size_t length,
+                            uint8_t *pixels, int width, int height, int pitch) {
+    size_t row_bytes = (size_t)width * 4;
+
+    switch (codec) {
+        case THUMBNAIL_CODEC_RAW:
+            if (length != row_bytes * height) return false;
+            for (int y = 0; y < height; y++) {
+                memcpy(pixels + (size_t)y * pitch, data + y * row_bytes, row_bytes);
+            }
+            return true;
+
+        case THUMBNAIL_CODEC_QOI:
+            return qoi_decode(data, length, pixels, width, height, pitch);
+
+        case THUMBNAIL_CODEC_LZ4: {
+            if ((size_t)pitch == row_bytes) {
+                return lz4_decompress(data, length, pixels, row_bytes * height);
+            }
+
+            uint8_t *packed = malloc(row_bytes * height);
+            if (!packed) return false;
+            bool ok = lz4_decompress(data, length, packed, row_bytes * height) &&
+                      thumbnail_codec_decode(THUMBNAIL_CODEC_RAW, packed, row_bytes * height,
+                                             pixels, width, height, pitch);
+            free(packed);
+            return ok;
+        }
+
+        default:
+            return false;
+    }
+}
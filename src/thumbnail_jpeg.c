@@ -0,0 +1,157 @@
+/**
+ * @file thumbnail_jpeg.c
+ * @brief Reduced-size JPEG decoding for thumbnails
+ *
+ * libjpeg can skip most of the inverse DCT work by scaling 8x8 blocks down
+ * to 4x4, 2x2 or 1x1 pixels during decode. For a 6000x4000 photo decoded at
+ * 1/8 that is 750x500 pixels instead of 24 million, with a matching drop in
+ * memory. Without libjpeg every open fails and callers use their generic
+ * loader.
+ */
+
+#include "thumbnail_jpeg.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef HAVE_LIBJPEG
+#include <setjmp.h>
+#include <jpeglib.h>
+
+typedef struct {
+    struct jpeg_error_mgr mgr;   /**< Must be first: libjpeg passes this pointer back */
+    jmp_buf jump;                /**< Where fatal errors return to */
+} JpegError;
+
+struct ThumbnailJpeg {
+    struct jpeg_decompress_struct cinfo;
+    JpegError err;
+    FILE *file;
+    uint8_t *row;                /**< RGB scratch row when libjpeg cannot emit RGBA */
+};
+
+/* Fatal errors unwind to the setjmp in the calling function */
+static void jpeg_error_exit(j_common_ptr cinfo) {
+    JpegError *err = (JpegError*)cinfo->err;
+    longjmp(err->jump, 1);
+}
+
+/* Corrupt-data warnings are common in the wild and not worth a log line */
+static void jpeg_output_message(j_common_ptr cinfo) {
+    (void)cinfo;
+}
+#endif
+
+int thumbnail_jpeg_scale_denom(int width, int height, int min_width, int min_height) {
+    // libjpeg rounds scaled dimensions up
+    for (int denom = 8; denom > 1; denom /= 2) {
+        if ((width + denom - 1) / denom >= min_width && (height + denom - 1) / denom >= min_height) {
+            return denom;
+        }
+    }
+    return 1;
+}
+
+ThumbnailJpeg* thumbnail_jpeg_open(const char *path, int min_width, int min_height,
+                                   int *width, int *height) {
+#ifdef HAVE_LIBJPEG
+    FILE *file = fopen(path, "rb");
+    if (!file) return NULL;
+
+    ThumbnailJpeg *jpeg = calloc(1, sizeof(ThumbnailJpeg));
+    if (!jpeg) {
+        fclose(file);
+        return NULL;
+    }
+    jpeg->file = file;
+
+    jpeg->cinfo.err = jpeg_std_error(&jpeg->err.mgr);
+    jpeg->err.mgr.error_exit = jpeg_error_exit;
+    jpeg->err.mgr.output_message = jpeg_output_message;
+    if (setjmp(jpeg->err.jump)) {
+        thumbnail_jpeg_close(jpeg);
+        return NULL;
+    }
+
+    jpeg_create_decompress(&jpeg->cinfo);
+    jpeg_stdio_src(&jpeg->cinfo, file);
+    jpeg_read_header(&jpeg->cinfo, TRUE);
+
+    jpeg->cinfo.scale_num = 1;
+    jpeg->cinfo.scale_denom = thumbnail_jpeg_scale_denom((int)jpeg->cinfo.image_width,
+                                                         (int)jpeg->cinfo.image_height,
+                                                         min_width, min_height);
+    // The result is scaled down again, so cheap chroma upsampling is invisible
+    jpeg->cinfo.do_fancy_upsampling = FALSE;
+#ifdef JCS_EXTENSIONS
+    jpeg->cinfo.out_color_space = JCS_EXT_RGBA;
+#else
+    jpeg->cinfo.out_color_space = JCS_RGB;
+#endif
+    jpeg_calc_output_dimensions(&jpeg->cinfo);
+
+    *width = (int)jpeg->cinfo.output_width;
+    *height = (int)jpeg->cinfo.output_height;
+    return jpeg;
+#else
+    (void)path;
+    (void)min_width;
+    (void)min_height;
+    (void)width;
+    (void)height;
+    return NULL;
+#endif
+}
+
+bool thumbnail_jpeg_read(ThumbnailJpeg *jpeg, uint8_t *pixels, int pitch) {
+#ifdef HAVE_LIBJPEG
+    if (setjmp(jpeg->err.jump)) {
+        return false;
+    }
+
+    jpeg_start_decompress(&jpeg->cinfo);
+
+#ifndef JCS_EXTENSIONS
+    jpeg->row = malloc((size_t)jpeg->cinfo.output_width * 3);
+    if (!jpeg->row) return false;
+#endif
+
+    while (jpeg->cinfo.output_scanline < jpeg->cinfo.output_height) {
+        uint8_t *dest = pixels + (size_t)jpeg->cinfo.output_scanline * pitch;
+#ifdef JCS_EXTENSIONS
+        JSAMPROW row = dest;
+        jpeg_read_scanlines(&jpeg->cinfo, &row, 1);
+#else
+        JSAMPROW row = jpeg->row;
+        jpeg_read_scanlines(&jpeg->cinfo, &row, 1);
+        for (JDIMENSION x = 0; x < jpeg->cinfo.output_width; x++) {
+            dest[x * 4 + 0] = jpeg->row[x * 3 + 0];
+            dest[x * 4 + 1] = jpeg->row[x * 3 + 1];
+            dest[x * 4 + 2] = jpeg->row[x * 3 + 2];
+            dest[x * 4 + 3] = 255;
+        }
+#endif
+    }
+
+    jpeg_finish_decompress(&jpeg->cinfo);
+    return true;
+#else
+    (void)jpeg;
+    (void)pixels;
+    (void)pitch;
+    return false;
+#endif
+}
+
+void thumbnail_jpeg_close(ThumbnailJpeg *jpeg) {
+#ifdef HAVE_LIBJPEG
+    if (!jpeg) return;
+
+    jpeg_destroy_decompress(&jpeg->cinfo);
+    if (jpeg->file) fclose(jpeg->file);
+    free(jpeg->row);
+    free(jpeg);
+#else
+    (void)jpeg;
+#endif
+}
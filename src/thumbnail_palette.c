@@ -0,0 +1,94 @@
+/**
+ * @file thumbnail_palette.c
+ * @brief Average and dominant colours of a thumbnail
+ */
+
+#include "thumbnail_palette.h"
+#include <string.h>
+
+#define BIN_BITS 3
+#define BIN_COUNT (1 << (BIN_BITS * 3))
+#define MIN_DISTANCE 48      /* Dominant colours closer than this in RGB count as one */
+
+typedef struct {
+    uint32_t count;
+    uint32_t sum[3];
+} ColorBin;
+
+static void bin_mean(const ColorBin *bin, uint8_t out[3]) {
+    for (int c = 0; c < 3; c++) {
+        out[c] = (uint8_t)((bin->sum[c] + bin->count / 2) / bin->count);
+    }
+}
+
+static int distance_squared(const uint8_t *a, const uint8_t *b) {
+    int dr = a[0] - b[0], dg = a[1] - b[1], db = a[2] - b[2];
+    return dr * dr + dg * dg + db * db;
+}
+
+void thumbnail_palette_compute(const uint8_t *pixels, int width, int height, int pitch,
+                               ThumbnailPalette *palette) {
+    memset(palette, 0, sizeof(*palette));
+    if (!pixels || width <= 0 || height <= 0) return;
+
+    ColorBin bins[BIN_COUNT];
+    memset(bins, 0, sizeof(bins));
+    uint64_t sum[3] = {0, 0, 0};
+
+    for (int y = 0; y < height; y++) {
+        const uint8_t *p = pixels + (size_t)y * pitch;
+        for (int x = 0; x < width; x++, p += 4) {
+            int bin = (p[0] >> (8 - BIN_BITS)) << (BIN_BITS * 2) |
+                      (p[1] >> (8 - BIN_BITS)) << BIN_BITS |
+                      (p[2] >> (8 - BIN_BITS));
+            bins[bin].count++;
+            for (int c = 0; c < 3; c++) {
+                bins[bin].sum[c] += p[c];
+                sum[c] += p[c];
+            }
+        }
+    }
+
+    uint64_t total = (uint64_t)width * height;
+    for (int c = 0; c < 3; c++) {
+        palette->average[c] = (uint8_t)((sum[c] + total / 2) / total);
+    }
+    palette->average[3] = 255;
+
+    // Fullest bins first, skipping near-duplicates of colours already taken
+    bool taken[BIN_COUNT];
+    memset(taken, 0, sizeof(taken));
+    int found = 0;
+    while (found < THUMBNAIL_PALETTE_COLORS) {
+        int best = -1;
+        uint8_t best_color[3];
+        for (int b = 0; b < BIN_COUNT; b++) {
+            if (taken[b] || bins[b].count == 0) continue;
+            if (best >= 0 && bins[b].count <= bins[best].count) continue;
+
+            uint8_t color[3];
+            bin_mean(&bins[b], color);
+            bool distinct = true;
+            for (int i = 0; i < found && distinct; i++) {
+                distinct = distance_squared(color, palette->colors[i]) >= MIN_DISTANCE * MIN_DISTANCE;
+            }
+            if (!distinct) {
+                taken[b] = true;
+                continue;
+            }
+            best = b;
+            memcpy(best_color, color, sizeof(best_color));
+        }
+        if (best < 0) break;
+
+        taken[best] = true;
+        memcpy(palette->colors[found], best_color, 3);
+        uint64_t share = ((uint64_t)bins[best].count * 255 + total / 2) / total;
+        palette->colors[found][3] = (uint8_t)(share > 0 ? share : 1);
+        found++;
+    }
+}
+
+bool thumbnail_palette_known(const ThumbnailPalette *palette) {
+    return palette->average[3] != 0;
+}
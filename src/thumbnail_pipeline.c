@@ -0,0 +1,508 @@
+/**
+ * @file thumbnail_pipeline.c
+ * @brief Staged worker-pool thumbnail generation
+ */
+
+#define _GNU_SOURCE
+#include "thumbnail_pipeline.h"
+#include "thumbnails.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief Pipeline stages, in the order a job travels through them
+ */
+typedef enum {
+    STAGE_LOOKUP,    /**< Try the on-disk cache */
+    STAGE_DECODE,    /**< Decode the original image */
+    STAGE_SCALE,     /**< Downscale to thumbnail size */
+    STAGE_STORE,     /**< Write the thumbnail to the cache */
+    STAGE_COUNT
+} PipelineStage;
+
+static const char *stage_names[STAGE_COUNT] = {
+    "thumb-lookup", "thumb-decode", "thumb-scale", "thumb-store"
+};
+
+/**
+ * @brief One wallpaper's trip through the pipeline
+ */
+typedef struct ThumbnailJob {
+    int index;                     /**< Wallpaper index, -1 once discarded; main thread only */
+    SDL_AtomicInt position;        /**< Display index, for scheduling; moved by the main thread */
+    bool cancelled;                /**< Dropped because it scrolled out of range */
+    char *path;
+    ThumbnailStamp stamp;
+    SDL_Surface *original;
+    SDL_Surface *thumb;
+    ThumbnailPalette palette;      /**< Colours of thumb, from the cache or worked out once */
+    struct ThumbnailJob *next;     /**< Link in the finished-job stack */
+    struct ThumbnailJob *submitted_prev; /**< Links among jobs not yet polled; main thread only */
+    struct ThumbnailJob *submitted_next;
+} ThumbnailJob;
+
+/**
+ * @brief Ring-buffer job queue, optionally bounded, served by schedule score
+ */
+typedef struct {
+    ThumbnailJob **items;
+    int capacity;          /**< Allocated slots */
+    int limit;             /**< Maximum queued jobs, 0 for unbounded */
+    int head;
+    int count;
+    bool cancellable;      /**< Jobs out of range are dropped instead of served */
+    bool closed;
+    SDL_Mutex *lock;
+    SDL_Condition *not_empty;
+    SDL_Condition *not_full;
+} JobQueue;
+
+typedef struct {
+    ThumbnailPipeline *pipeline;
+    PipelineStage stage;
+} StageWorker;
+
+struct ThumbnailPipeline {
+    int width;
+    int height;
+    ThumbnailFilter filter;
+    int workers_per_stage;
+    JobQueue stages[STAGE_COUNT];
+    void *finished;                /**< Lock-free stack of finished jobs, newest first */
+    ThumbnailJob *ready;           /**< Finished jobs claimed by the main thread, oldest first */
+    ThumbnailJob *submitted;       /**< Every job not yet polled, wherever it is, for renumbering */
+    SDL_Semaphore *finished_sem;   /**< Signalled per finished job, for blocking polls only */
+    SDL_Thread **threads;          /**< STAGE_COUNT * workers_per_stage threads */
+    StageWorker workers[STAGE_COUNT];
+    SDL_AtomicInt outstanding;     /**< Submitted but not yet polled */
+    SDL_AtomicInt shutting_down;
+    ThumbnailSchedule schedule;    /**< Selection and wanted range, guarded by schedule_lock */
+    SDL_Mutex *schedule_lock;
+};
+
+/* -------------------------------------------------------------------------- */
+/*                                 Job Queue                                  */
+/* -------------------------------------------------------------------------- */
+
+static bool queue_init(JobQueue *q, int limit, bool cancellable) {
+    memset(q, 0, sizeof(*q));
+    q->limit = limit;
+    q->cancellable = cancellable;
+    q->capacity = limit > 0 ? limit : 64;
+    q->items = malloc(sizeof(ThumbnailJob*) * q->capacity);
+    q->lock = SDL_CreateMutex();
+    q->not_empty = SDL_CreateCondition();
+    q->not_full = SDL_CreateCondition();
+    return q->items && q->lock && q->not_empty && q->not_full;
+}
+
+static void queue_destroy(JobQueue *q) {
+    free(q->items);
+    if (q->lock) SDL_DestroyMutex(q->lock);
+    if (q->not_empty) SDL_DestroyCondition(q->not_empty);
+    if (q->not_full) SDL_DestroyCondition(q->not_full);
+}
+
+static bool queue_grow(JobQueue *q) {
+    int new_capacity = q->capacity * 2;
+    ThumbnailJob **items = malloc(sizeof(ThumbnailJob*) * new_capacity);
+    if (!items) return false;
+
+    for (int i = 0; i < q->count; i++) {
+        items[i] = q->items[(q->head + i) % q->capacity];
+    }
+    free(q->items);
+    q->items = items;
+    q->capacity = new_capacity;
+    q->head = 0;
+    return true;
+}
+
+/**
+ * @brief Append a job, blocking while a bounded queue is full
+ */
+static void queue_push(JobQueue *q, ThumbnailJob *job) {
+    SDL_LockMutex(q->lock);
+    while (q->limit > 0 && q->count >= q->limit) {
+        SDL_WaitCondition(q->not_full, q->lock);
+    }
+    if (q->count >= q->capacity && !queue_grow(q)) {
+        // Out of memory: block until a consumer makes room
+        while (q->count >= q->capacity) {
+            SDL_WaitCondition(q->not_full, q->lock);
+        }
+    }
+    q->items[(q->head + q->count) % q->capacity] = job;
+    q->count++;
+    SDL_SignalCondition(q->not_empty);
+    SDL_UnlockMutex(q->lock);
+}
+
+/**
+ * @brief Remove the job with the lowest score, oldest first among equals
+ *
+ * In a cancellable queue, jobs the schedule no longer wants are removed in
+ * the same pass and returned through @p cancelled, linked by their next
+ * field. Queues are short (at most a few screens of thumbnails), so a linear
+ * scan is cheaper than keeping a heap up to date as the selection moves.
+ *
+ * @return Job, or NULL if the queue is empty and closed or only had cancelled jobs
+ */
+static ThumbnailJob* queue_pop(JobQueue *q, const ThumbnailSchedule *schedule, ThumbnailJob **cancelled) {
+    SDL_LockMutex(q->lock);
+
+    ThumbnailJob *job = NULL;
+    while (!job) {
+        while (q->count == 0 && !q->closed) {
+            SDL_WaitCondition(q->not_empty, q->lock);
+        }
+        if (q->count == 0) break;
+
+        // Compact the ring in place, keeping the best job's slot
+        int best = -1;
+        uint32_t best_score = UINT32_MAX;
+        int kept = 0;
+        for (int i = 0; i < q->count; i++) {
+            ThumbnailJob *candidate = q->items[(q->head + i) % q->capacity];
+            int position = SDL_GetAtomicInt(&candidate->position);
+            if (q->cancellable && !thumbnail_schedule_keep(schedule, position)) {
+                candidate->cancelled = true;
+                candidate->next = *cancelled;
+                *cancelled = candidate;
+                continue;
+            }
+
+            uint32_t score = thumbnail_schedule_score(schedule, position);
+            if (score < best_score) {
+                best_score = score;
+                best = kept;
+            }
+            q->items[(q->head + kept) % q->capacity] = candidate;
+            kept++;
+        }
+
+        if (best >= 0) {
+            job = q->items[(q->head + best) % q->capacity];
+            for (int i = best; i < kept - 1; i++) {
+                q->items[(q->head + i) % q->capacity] = q->items[(q->head + i + 1) % q->capacity];
+            }
+            kept--;
+        }
+
+        if (kept < q->count) SDL_BroadcastCondition(q->not_full);
+        q->count = kept;
+
+        // Everything was cancelled: let the caller finish those before waiting again
+        if (!job && *cancelled) break;
+    }
+
+    SDL_UnlockMutex(q->lock);
+    return job;
+}
+
+static void queue_close(JobQueue *q) {
+    SDL_LockMutex(q->lock);
+    q->closed = true;
+    SDL_BroadcastCondition(q->not_empty);
+    SDL_UnlockMutex(q->lock);
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                  Workers                                   */
+/* -------------------------------------------------------------------------- */
+
+static void job_free(ThumbnailJob *job) {
+    if (job->original) SDL_DestroySurface(job->original);
+    if (job->thumb) SDL_DestroySurface(job->thumb);
+    free(job->path);
+    free(job);
+}
+
+/**
+ * @brief Run one stage on a job
+ * @return Stage the job moves to, or STAGE_COUNT when it is finished
+ */
+static PipelineStage stage_run(ThumbnailPipeline *p, PipelineStage stage, ThumbnailJob *job) {
+    switch (stage) {
+        case STAGE_LOOKUP:
+            job->thumb = thumbnail_cache_load(job->path, &job->stamp, p->width, p->height, &job->palette);
+            if (job->thumb) return STAGE_COUNT;
+
+            // Thumbnails from the old PNG cache only need storing again
+            job->thumb = thumbnail_cache_migrate(job->path, &job->stamp, p->width, p->height);
+            if (!job->thumb) return STAGE_DECODE;
+            thumbnail_compute_palette(job->thumb, &job->palette);
+            return STAGE_STORE;
+
+        case STAGE_DECODE:
+            job->original = thumbnail_decode(job->path, p->width, p->height);
+            return job->original ? STAGE_SCALE : STAGE_COUNT;
+
+        case STAGE_SCALE:
+            job->thumb = thumbnail_scale(job->original, p->width, p->height, p->filter);
+            SDL_DestroySurface(job->original);
+            job->original = NULL;
+            if (!job->thumb) return STAGE_COUNT;
+            thumbnail_compute_palette(job->thumb, &job->palette);
+            return STAGE_STORE;
+
+        case STAGE_STORE:
+            if (!thumbnail_cache_store(job->path, &job->stamp, job->thumb, &job->palette)) {
+                fprintf(stderr, "Failed to cache thumbnail for %s\n", job->path);
+            }
+            return STAGE_COUNT;
+
+        default:
+            return STAGE_COUNT;
+    }
+}
+
+/**
+ * @brief Hand a finished job to the main thread without taking a lock
+ *
+ * Workers only ever push onto the stack and the main thread only ever takes
+ * the whole stack at once, so a plain compare-and-swap push is ABA-safe.
+ */
+static void finished_push(ThumbnailPipeline *p, ThumbnailJob *job) {
+    void *head;
+    do {
+        head = SDL_GetAtomicPointer(&p->finished);
+        job->next = head;
+    } while (!SDL_CompareAndSwapAtomicPointer(&p->finished, head, job));
+
+    SDL_SignalSemaphore(p->finished_sem);
+}
+
+/**
+ * @brief Take the oldest finished job (main thread only)
+ */
+static ThumbnailJob* finished_take(ThumbnailPipeline *p) {
+    if (!p->ready) {
+        // Claim everything published so far and restore completion order
+        ThumbnailJob *stack = SDL_SetAtomicPointer(&p->finished, NULL);
+        while (stack) {
+            ThumbnailJob *next = stack->next;
+            stack->next = p->ready;
+            p->ready = stack;
+            stack = next;
+        }
+    }
+
+    ThumbnailJob *job = p->ready;
+    if (job) p->ready = job->next;
+    return job;
+}
+
+static int stage_worker_main(void *data) {
+    StageWorker *worker = data;
+    ThumbnailPipeline *p = worker->pipeline;
+    JobQueue *queue = &p->stages[worker->stage];
+
+    for (;;) {
+        ThumbnailSchedule schedule;
+        SDL_LockMutex(p->schedule_lock);
+        schedule = p->schedule;
+        SDL_UnlockMutex(p->schedule_lock);
+
+        ThumbnailJob *cancelled = NULL;
+        ThumbnailJob *job = queue_pop(queue, &schedule, &cancelled);
+        bool any_cancelled = cancelled != NULL;
+
+        // Cancelled jobs still go back so the main thread can request them again later
+        while (cancelled) {
+            ThumbnailJob *next = cancelled->next;
+            if (SDL_GetAtomicInt(&p->shutting_down)) job_free(cancelled);
+            else finished_push(p, cancelled);
+            cancelled = next;
+        }
+
+        if (!job) {
+            if (any_cancelled) continue;
+            break;
+        }
+        if (SDL_GetAtomicInt(&p->shutting_down)) {
+            job_free(job);
+            continue;
+        }
+
+        PipelineStage next = stage_run(p, worker->stage, job);
+        if (next < STAGE_COUNT) {
+            queue_push(&p->stages[next], job);
+        } else {
+            finished_push(p, job);
+        }
+    }
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                 Public API                                 */
+/* -------------------------------------------------------------------------- */
+
+ThumbnailPipeline* thumbnail_pipeline_create(const Config *config) {
+    ThumbnailPipeline *p = calloc(1, sizeof(ThumbnailPipeline));
+    if (!p) return NULL;
+
+    p->width = config->thumbnail_width;
+    p->height = config->thumbnail_height;
+    p->workers_per_stage = config->thumbnail_threads > 0 ? config->thumbnail_threads
+                                                         : SDL_GetNumLogicalCPUCores();
+    if (p->workers_per_stage < 1) p->workers_per_stage = 1;
+
+    ThumbnailCodec codec;
+    thumbnail_options_parse(config, &codec, &p->filter);
+    if (!thumbnail_cache_open(p->width, p->height, codec)) {
+        fprintf(stderr, "Thumbnail cache unavailable, thumbnails will not be saved\n");
+    }
+
+    // Submissions are unbounded so the caller never blocks; the queues between
+    // stages are bounded to cap the number of full-size images in memory.
+    // Jobs can be cancelled up to the decode; once decoded they are finished.
+    p->finished_sem = SDL_CreateSemaphore(0);
+    p->schedule_lock = SDL_CreateMutex();
+    thumbnail_schedule_init(&p->schedule);
+    bool ok = queue_init(&p->stages[STAGE_LOOKUP], 0, true) && p->finished_sem && p->schedule_lock;
+    for (int s = STAGE_DECODE; s < STAGE_COUNT; s++) {
+        ok = queue_init(&p->stages[s], p->workers_per_stage * 2, s == STAGE_DECODE) && ok;
+    }
+
+    p->threads = calloc((size_t)STAGE_COUNT * p->workers_per_stage, sizeof(SDL_Thread*));
+    if (!ok || !p->threads) {
+        fprintf(stderr, "Failed to allocate thumbnail pipeline\n");
+        thumbnail_pipeline_destroy(p);
+        return NULL;
+    }
+
+    for (int s = 0; s < STAGE_COUNT; s++) {
+        p->workers[s].pipeline = p;
+        p->workers[s].stage = (PipelineStage)s;
+
+        for (int i = 0; i < p->workers_per_stage; i++) {
+            SDL_Thread *thread = SDL_CreateThread(stage_worker_main, stage_names[s], &p->workers[s]);
+            if (!thread) {
+                fprintf(stderr, "Failed to start thumbnail worker: %s\n", SDL_GetError());
+                thumbnail_pipeline_destroy(p);
+                return NULL;
+            }
+            p->threads[s * p->workers_per_stage + i] = thread;
+        }
+    }
+
+    printf("Thumbnail pipeline: %d workers per stage\n", p->workers_per_stage);
+    return p;
+}
+
+void thumbnail_pipeline_submit(ThumbnailPipeline *p, int index, int position, const char *path,
+                               const ThumbnailStamp *stamp) {
+    ThumbnailJob *job = calloc(1, sizeof(ThumbnailJob));
+    if (!job) return;
+
+    job->index = index;
+    SDL_SetAtomicInt(&job->position, position);
+    job->stamp = *stamp;
+    job->path = strdup(path);
+    if (!job->path) {
+        free(job);
+        return;
+    }
+
+    job->submitted_next = p->submitted;
+    if (p->submitted) p->submitted->submitted_prev = job;
+    p->submitted = job;
+
+    SDL_AddAtomicInt(&p->outstanding, 1);
+    queue_push(&p->stages[STAGE_LOOKUP], job);
+}
+
+int thumbnail_pipeline_poll(ThumbnailPipeline *p, ThumbnailResult *results, int max, bool wait) {
+    int n = 0;
+
+    while (n < max) {
+        ThumbnailJob *job = finished_take(p);
+        if (!job) {
+            if (!wait || n > 0 || SDL_GetAtomicInt(&p->outstanding) == 0) break;
+            SDL_WaitSemaphoreTimeout(p->finished_sem, 100);
+            continue;
+        }
+
+        if (job->submitted_prev) job->submitted_prev->submitted_next = job->submitted_next;
+        else p->submitted = job->submitted_next;
+        if (job->submitted_next) job->submitted_next->submitted_prev = job->submitted_prev;
+        SDL_AddAtomicInt(&p->outstanding, -1);
+
+        // The wallpaper was removed while the job was running
+        if (job->index < 0) {
+            job_free(job);
+            continue;
+        }
+
+        results[n].index = job->index;
+        results[n].thumb = job->thumb;
+        results[n].palette = job->palette;
+        results[n].cancelled = job->cancelled;
+        job->thumb = NULL;
+        job_free(job);
+        n++;
+    }
+
+    return n;
+}
+
+void thumbnail_pipeline_set_focus(ThumbnailPipeline *p, int focus, int keep_first, int keep_last) {
+    SDL_LockMutex(p->schedule_lock);
+    thumbnail_schedule_update(&p->schedule, focus, keep_first, keep_last, SDL_GetTicksNS());
+    SDL_UnlockMutex(p->schedule_lock);
+}
+
+void thumbnail_pipeline_renumber(ThumbnailPipeline *p, const int *map, int count) {
+    // Workers never read the index, so it can be rewritten wherever the job is
+    for (ThumbnailJob *job = p->submitted; job; job = job->submitted_next) {
+        if (job->index < 0) continue;
+        job->index = map && job->index < count ? map[job->index] : -1;
+    }
+}
+
+void thumbnail_pipeline_reposition(ThumbnailPipeline *p, const int *positions, int count) {
+    for (ThumbnailJob *job = p->submitted; job; job = job->submitted_next) {
+        int position = job->index >= 0 && job->index < count ? positions[job->index] : -1;
+        SDL_SetAtomicInt(&job->position, position);
+    }
+}
+
+int thumbnail_pipeline_outstanding(ThumbnailPipeline *p) {
+    return SDL_GetAtomicInt(&p->outstanding);
+}
+
+void thumbnail_pipeline_destroy(ThumbnailPipeline *p) {
+    if (!p) return;
+
+    SDL_SetAtomicInt(&p->shutting_down, 1);
+
+    // Shut stages down front to back: once every worker of a stage has exited
+    // nothing can push into the next queue, so it is safe to close it
+    for (int s = 0; s < STAGE_COUNT; s++) {
+        if (p->stages[s].lock) queue_close(&p->stages[s]);
+
+        if (p->threads) {
+            for (int i = 0; i < p->workers_per_stage; i++) {
+                SDL_Thread *thread = p->threads[s * p->workers_per_stage + i];
+                if (thread) SDL_WaitThread(thread, NULL);
+            }
+        }
+    }
+
+    ThumbnailJob *job;
+    while ((job = finished_take(p)) != NULL) {
+        job_free(job);
+    }
+
+    for (int s = 0; s < STAGE_COUNT; s++) {
+        queue_destroy(&p->stages[s]);
+    }
+    if (p->finished_sem) SDL_DestroySemaphore(p->finished_sem);
+    if (p->schedule_lock) SDL_DestroyMutex(p->schedule_lock);
+    free(p->threads);
+    free(p);
+}
@@ -0,0 +1,566 @@
+/**
+ * @file thumbnail_resample.c
+ * @brief Area-averaging and Lanczos downscaler for thumbnails
+ *
+ * Resizing is separable: a horizontal pass turns each source row into a
+ * row of the target width, then a vertical pass blends those rows. Each
+ * pass uses a precomputed table holding, for every output pixel, the first
+ * source index and a fixed number of 14-bit weights summing to 1.0. Tables
+ * are padded to the same tap count for every output so the SIMD loops have
+ * no per-pixel bounds to check.
+ *
+ * The SIMD loops interleave two taps into 16-bit lanes and use pmaddwd to
+ * multiply and add both at once, the same arithmetic as the scalar loop.
+ */
+
+#define _GNU_SOURCE
+#include "thumbnail_resample.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define RESAMPLE_X86 1
+#include <immintrin.h>
+#endif
+
+#define PRECISION_BITS 14
+#define PRECISION_ONE (1 << PRECISION_BITS)
+#define PRECISION_HALF (1 << (PRECISION_BITS - 1))
+
+#define LANCZOS_LOBES 3.0
+
+typedef enum {
+    KERNEL_AREA,      /**< Exact pixel coverage; linear when upscaling */
+    KERNEL_LANCZOS    /**< Lanczos-3, widened by the reduction factor */
+} ResampleKernel;
+
+/**
+ * @brief Weights for one resampling direction
+ */
+typedef struct {
+    int taps;            /**< Weights per output pixel, the same for all */
+    int *start;          /**< First source index per output pixel */
+    int16_t *weights;    /**< taps weights per output pixel */
+} FilterTable;
+
+typedef void (*HorizontalPass)(const uint8_t *src, int src_pitch, uint8_t *dst, int dst_pitch,
+                               int dst_w, int rows, const FilterTable *t);
+typedef void (*VerticalPass)(const uint8_t *src, int src_pitch, uint8_t *dst, int dst_pitch,
+                             int width, int dst_h, const FilterTable *t);
+
+static const char *filter_names[THUMBNAIL_FILTER_COUNT] = {"box", "lanczos"};
+static const char *isa_names[RESAMPLE_ISA_COUNT] = {"scalar", "sse2", "avx2"};
+
+static ResampleIsa forced_isa = RESAMPLE_ISA_COUNT;
+
+bool thumbnail_filter_parse(const char *name, ThumbnailFilter *filter) {
+    for (int i = 0; i < THUMBNAIL_FILTER_COUNT; i++) {
+        if (strcasecmp(name, filter_names[i]) == 0) {
+            *filter = (ThumbnailFilter)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char* thumbnail_filter_name(ThumbnailFilter filter) {
+    return filter < THUMBNAIL_FILTER_COUNT ? filter_names[filter] : "unknown";
+}
+
+const char* thumbnail_resample_isa_name(ResampleIsa isa) {
+    return isa < RESAMPLE_ISA_COUNT ? isa_names[isa] : "unknown";
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                Filter Tables                               */
+/* -------------------------------------------------------------------------- */
+
+static double sinc(double x) {
+    if (x == 0.0) return 1.0;
+    x *= M_PI;
+    return sin(x) / x;
+}
+
+/**
+ * @brief Weight of the source pixel whose centre is x source pixels from the
+ *        output pixel's centre
+ */
+static double kernel_weight(ResampleKernel kernel, double x, double scale) {
+    if (kernel == KERNEL_AREA) {
+        if (scale <= 1.0) {
+            double w = 1.0 - fabs(x);
+            return w > 0.0 ? w : 0.0;
+        }
+        // Overlap of [x - 0.5, x + 0.5) with [-scale / 2, scale / 2)
+        double lo = fmax(x - 0.5, -scale * 0.5);
+        double hi = fmin(x + 0.5, scale * 0.5);
+        return hi > lo ? hi - lo : 0.0;
+    }
+
+    double t = x / fmax(scale, 1.0);
+    if (fabs(t) >= LANCZOS_LOBES) return 0.0;
+    return sinc(t) * sinc(t / LANCZOS_LOBES);
+}
+
+static void table_free(FilterTable *t) {
+    free(t->start);
+    free(t->weights);
+    memset(t, 0, sizeof(*t));
+}
+
+static bool table_build(FilterTable *t, int src_len, int dst_len, ResampleKernel kernel) {
+    memset(t, 0, sizeof(*t));
+
+    double scale = (double)src_len / dst_len;
+    double support = kernel == KERNEL_AREA ? fmax(scale * 0.5, 1.0)
+                                           : LANCZOS_LOBES * fmax(scale, 1.0);
+    int window = (int)ceil(support * 2.0) + 2;
+
+    int *lo = malloc(sizeof(int) * dst_len);
+    int *count = malloc(sizeof(int) * dst_len);
+    double *fw = malloc(sizeof(double) * dst_len * window);
+    if (!lo || !count || !fw) {
+        free(lo);
+        free(count);
+        free(fw);
+        return false;
+    }
+
+    // Float weights over each output's window, trimmed of zero taps
+    int taps = 1;
+    for (int i = 0; i < dst_len; i++) {
+        double center = (i + 0.5) * scale;
+        int first = (int)floor(center - support);
+        int last = (int)ceil(center + support);
+        if (first < 0) first = 0;
+        if (last > src_len) last = src_len;
+
+        double *w = fw + (size_t)i * window;
+        int n = 0;
+        lo[i] = -1;
+        for (int j = first; j < last; j++) {
+            double v = kernel_weight(kernel, j + 0.5 - center, scale);
+            if (lo[i] < 0) {
+                if (v == 0.0) continue;
+                lo[i] = j;
+            }
+            w[n++] = v;
+        }
+        while (n > 0 && w[n - 1] == 0.0) n--;
+        if (lo[i] < 0) {
+            // Can only happen on degenerate sizes; sample the nearest pixel
+            lo[i] = (int)center < src_len ? (int)center : src_len - 1;
+            w[0] = 1.0;
+            n = 1;
+        }
+        count[i] = n;
+        if (n > taps) taps = n;
+    }
+    if (taps > src_len) taps = src_len;
+
+    t->taps = taps;
+    t->start = malloc(sizeof(int) * dst_len);
+    t->weights = calloc((size_t)dst_len * taps, sizeof(int16_t));
+    if (!t->start || !t->weights) {
+        table_free(t);
+        free(lo);
+        free(count);
+        free(fw);
+        return false;
+    }
+
+    // Pad every output to the same tap count, shifting the window left at the end
+    for (int i = 0; i < dst_len; i++) {
+        int start = lo[i];
+        if (start + taps > src_len) start = src_len - taps;
+        int shift = lo[i] - start;
+        t->start[i] = start;
+
+        const double *w = fw + (size_t)i * window;
+        double total = 0.0;
+        for (int k = 0; k < count[i]; k++) total += w[k];
+
+        int16_t *iw = t->weights + (size_t)i * taps;
+        int sum = 0, largest = shift;
+        for (int k = 0; k < count[i]; k++) {
+            iw[shift + k] = (int16_t)lrint(w[k] / total * PRECISION_ONE);
+            sum += iw[shift + k];
+            if (abs(iw[shift + k]) > abs(iw[largest])) largest = shift + k;
+        }
+        // Rounding leftovers go to the largest weight so each row sums to exactly 1.0
+        iw[largest] = (int16_t)(iw[largest] + PRECISION_ONE - sum);
+    }
+
+    free(lo);
+    free(count);
+    free(fw);
+    return true;
+}
+
+static inline uint8_t clamp_pixel(int32_t acc) {
+    acc >>= PRECISION_BITS;
+    return (uint8_t)(acc < 0 ? 0 : acc > 255 ? 255 : acc);
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                   Scalar                                   */
+/* -------------------------------------------------------------------------- */
+
+static void horizontal_scalar(const uint8_t *src, int src_pitch, uint8_t *dst, int dst_pitch,
+                              int dst_w, int rows, const FilterTable *t) {
+    for (int y = 0; y < rows; y++) {
+        const uint8_t *in = src + (size_t)y * src_pitch;
+        uint8_t *out = dst + (size_t)y * dst_pitch;
+        for (int x = 0; x < dst_w; x++) {
+            const uint8_t *s = in + t->start[x] * 4;
+            const int16_t *w = t->weights + (size_t)x * t->taps;
+            int32_t acc[4] = {PRECISION_HALF, PRECISION_HALF, PRECISION_HALF, PRECISION_HALF};
+            for (int k = 0; k < t->taps; k++) {
+                for (int c = 0; c < 4; c++) {
+                    acc[c] += s[k * 4 + c] * w[k];
+                }
+            }
+            for (int c = 0; c < 4; c++) {
+                out[x * 4 + c] = clamp_pixel(acc[c]);
+            }
+        }
+    }
+}
+
+static void vertical_scalar(const uint8_t *src, int src_pitch, uint8_t *dst, int dst_pitch,
+                            int width, int dst_h, const FilterTable *t) {
+    for (int y = 0; y < dst_h; y++) {
+        const uint8_t *in = src + (size_t)t->start[y] * src_pitch;
+        const int16_t *w = t->weights + (size_t)y * t->taps;
+        uint8_t *out = dst + (size_t)y * dst_pitch;
+        for (int i = 0; i < width * 4; i++) {
+            int32_t acc = PRECISION_HALF;
+            for (int k = 0; k < t->taps; k++) {
+                acc += in[(size_t)k * src_pitch + i] * w[k];
+            }
+            out[i] = clamp_pixel(acc);
+        }
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                    SSE2                                    */
+/* -------------------------------------------------------------------------- */
+
+#ifdef RESAMPLE_X86
+
+static inline uint32_t load_pixel(const uint8_t *p) {
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+/* Two 16-bit weights packed the way pmaddwd pairs them with interleaved taps */
+static inline int32_t weight_pair(int16_t a, int16_t b) {
+    return (int32_t)((uint32_t)(uint16_t)a | (uint32_t)(uint16_t)b << 16);
+}
+
+/**
+ * @brief Accumulate taps [k, taps) of one output pixel, two at a time
+ */
+__attribute__((target("sse2")))
+static inline __m128i horizontal_taps_sse2(__m128i acc, const uint8_t *s, const int16_t *w,
+                                           int k, int taps) {
+    const __m128i zero = _mm_setzero_si128();
+    for (; k + 1 < taps; k += 2) {
+        __m128i px = _mm_unpacklo_epi8(_mm_cvtsi32_si128((int)load_pixel(s + k * 4)),
+                                       _mm_cvtsi32_si128((int)load_pixel(s + k * 4 + 4)));
+        px = _mm_unpacklo_epi8(px, zero);
+        acc = _mm_add_epi32(acc, _mm_madd_epi16(px, _mm_set1_epi32(weight_pair(w[k], w[k + 1]))));
+    }
+    if (k < taps) {
+        __m128i px = _mm_unpacklo_epi8(_mm_cvtsi32_si128((int)load_pixel(s + k * 4)), zero);
+        px = _mm_unpacklo_epi8(px, zero);
+        acc = _mm_add_epi32(acc, _mm_madd_epi16(px, _mm_set1_epi32(weight_pair(w[k], 0))));
+    }
+    return acc;
+}
+
+__attribute__((target("sse2")))
+static inline uint32_t pack_pixel_sse2(__m128i acc) {
+    acc = _mm_srai_epi32(acc, PRECISION_BITS);
+    acc = _mm_packs_epi32(acc, acc);
+    acc = _mm_packus_epi16(acc, acc);
+    return (uint32_t)_mm_cvtsi128_si32(acc);
+}
+
+__attribute__((target("sse2")))
+static void horizontal_sse2(const uint8_t *src, int src_pitch, uint8_t *dst, int dst_pitch,
+                            int dst_w, int rows, const FilterTable *t) {
+    for (int y = 0; y < rows; y++) {
+        const uint8_t *in = src + (size_t)y * src_pitch;
+        uint8_t *out = dst + (size_t)y * dst_pitch;
+        for (int x = 0; x < dst_w; x++) {
+            __m128i acc = horizontal_taps_sse2(_mm_set1_epi32(PRECISION_HALF), in + t->start[x] * 4,
+                                               t->weights + (size_t)x * t->taps, 0, t->taps);
+            uint32_t px = pack_pixel_sse2(acc);
+            memcpy(out + x * 4, &px, 4);
+        }
+    }
+}
+
+__attribute__((target("sse2")))
+static void vertical_sse2(const uint8_t *src, int src_pitch, uint8_t *dst, int dst_pitch,
+                          int width, int dst_h, const FilterTable *t) {
+    const __m128i zero = _mm_setzero_si128();
+    for (int y = 0; y < dst_h; y++) {
+        const uint8_t *in = src + (size_t)t->start[y] * src_pitch;
+        const int16_t *w = t->weights + (size_t)y * t->taps;
+        uint8_t *out = dst + (size_t)y * dst_pitch;
+
+        int x = 0;
+        for (; x + 4 <= width; x += 4) {
+            __m128i acc0 = _mm_set1_epi32(PRECISION_HALF);
+            __m128i acc1 = acc0, acc2 = acc0, acc3 = acc0;
+            for (int k = 0; k < t->taps; k += 2) {
+                const uint8_t *row = in + (size_t)k * src_pitch + x * 4;
+                __m128i a = _mm_loadu_si128((const __m128i*)row);
+                __m128i b = k + 1 < t->taps ? _mm_loadu_si128((const __m128i*)(row + src_pitch)) : zero;
+                __m128i wk = _mm_set1_epi32(weight_pair(w[k], k + 1 < t->taps ? w[k + 1] : 0));
+
+                // Byte-interleave the two rows, then widen: pixel n is a pair per channel
+                __m128i lo = _mm_unpacklo_epi8(a, b);
+                __m128i hi = _mm_unpackhi_epi8(a, b);
+                acc0 = _mm_add_epi32(acc0, _mm_madd_epi16(_mm_unpacklo_epi8(lo, zero), wk));
+                acc1 = _mm_add_epi32(acc1, _mm_madd_epi16(_mm_unpackhi_epi8(lo, zero), wk));
+                acc2 = _mm_add_epi32(acc2, _mm_madd_epi16(_mm_unpacklo_epi8(hi, zero), wk));
+                acc3 = _mm_add_epi32(acc3, _mm_madd_epi16(_mm_unpackhi_epi8(hi, zero), wk));
+            }
+            __m128i p01 = _mm_packs_epi32(_mm_srai_epi32(acc0, PRECISION_BITS),
+                                          _mm_srai_epi32(acc1, PRECISION_BITS));
+            __m128i p23 = _mm_packs_epi32(_mm_srai_epi32(acc2, PRECISION_BITS),
+                                          _mm_srai_epi32(acc3, PRECISION_BITS));
+            _mm_storeu_si128((__m128i*)(out + x * 4), _mm_packus_epi16(p01, p23));
+        }
+
+        for (; x < width; x++) {
+            for (int c = 0; c < 4; c++) {
+                int32_t acc = PRECISION_HALF;
+                for (int k = 0; k < t->taps; k++) {
+                    acc += in[(size_t)k * src_pitch + x * 4 + c] * w[k];
+                }
+                out[x * 4 + c] = clamp_pixel(acc);
+            }
+        }
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                    AVX2                                    */
+/* -------------------------------------------------------------------------- */
+
+__attribute__((target("avx2")))
+static void horizontal_avx2(const uint8_t *src, int src_pitch, uint8_t *dst, int dst_pitch,
+                            int dst_w, int rows, const FilterTable *t) {
+    // Interleave pixels 0/1 and 2/3 channel by channel within each half
+    const __m128i shuffle = _mm_setr_epi8(0, 4, 1, 5, 2, 6, 3, 7, 8, 12, 9, 13, 10, 14, 11, 15);
+
+    for (int y = 0; y < rows; y++) {
+        const uint8_t *in = src + (size_t)y * src_pitch;
+        uint8_t *out = dst + (size_t)y * dst_pitch;
+        for (int x = 0; x < dst_w; x++) {
+            const uint8_t *s = in + t->start[x] * 4;
+            const int16_t *w = t->weights + (size_t)x * t->taps;
+
+            // Four taps per step: pixels 0/1 in the low lane, 2/3 in the high lane
+            __m256i acc4 = _mm256_setzero_si256();
+            int k = 0;
+            for (; k + 3 < t->taps; k += 4) {
+                __m128i px = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(s + k * 4)), shuffle);
+                __m256i wk = _mm256_setr_epi32(weight_pair(w[k], w[k + 1]), weight_pair(w[k], w[k + 1]),
+                                               weight_pair(w[k], w[k + 1]), weight_pair(w[k], w[k + 1]),
+                                               weight_pair(w[k + 2], w[k + 3]), weight_pair(w[k + 2], w[k + 3]),
+                                               weight_pair(w[k + 2], w[k + 3]), weight_pair(w[k + 2], w[k + 3]));
+                acc4 = _mm256_add_epi32(acc4, _mm256_madd_epi16(_mm256_cvtepu8_epi16(px), wk));
+            }
+
+            __m128i acc = _mm_add_epi32(_mm256_castsi256_si128(acc4), _mm256_extracti128_si256(acc4, 1));
+            acc = horizontal_taps_sse2(_mm_add_epi32(acc, _mm_set1_epi32(PRECISION_HALF)), s, w, k, t->taps);
+            uint32_t px = pack_pixel_sse2(acc);
+            memcpy(out + x * 4, &px, 4);
+        }
+    }
+}
+
+__attribute__((target("avx2")))
+static void vertical_avx2(const uint8_t *src, int src_pitch, uint8_t *dst, int dst_pitch,
+                          int width, int dst_h, const FilterTable *t) {
+    const __m256i zero = _mm256_setzero_si256();
+    for (int y = 0; y < dst_h; y++) {
+        const uint8_t *in = src + (size_t)t->start[y] * src_pitch;
+        const int16_t *w = t->weights + (size_t)y * t->taps;
+        uint8_t *out = dst + (size_t)y * dst_pitch;
+
+        // Unpacks and packs both work per 128-bit lane, so lane order comes back intact
+        int x = 0;
+        for (; x + 8 <= width; x += 8) {
+            __m256i acc0 = _mm256_set1_epi32(PRECISION_HALF);
+            __m256i acc1 = acc0, acc2 = acc0, acc3 = acc0;
+            for (int k = 0; k < t->taps; k += 2) {
+                const uint8_t *row = in + (size_t)k * src_pitch + x * 4;
+                __m256i a = _mm256_loadu_si256((const __m256i*)row);
+                __m256i b = k + 1 < t->taps ? _mm256_loadu_si256((const __m256i*)(row + src_pitch)) : zero;
+                __m256i wk = _mm256_set1_epi32(weight_pair(w[k], k + 1 < t->taps ? w[k + 1] : 0));
+
+                __m256i lo = _mm256_unpacklo_epi8(a, b);
+                __m256i hi = _mm256_unpackhi_epi8(a, b);
+                acc0 = _mm256_add_epi32(acc0, _mm256_madd_epi16(_mm256_unpacklo_epi8(lo, zero), wk));
+                acc1 = _mm256_add_epi32(acc1, _mm256_madd_epi16(_mm256_unpackhi_epi8(lo, zero), wk));
+                acc2 = _mm256_add_epi32(acc2, _mm256_madd_epi16(_mm256_unpacklo_epi8(hi, zero), wk));
+                acc3 = _mm256_add_epi32(acc3, _mm256_madd_epi16(_mm256_unpackhi_epi8(hi, zero), wk));
+            }
+            __m256i p01 = _mm256_packs_epi32(_mm256_srai_epi32(acc0, PRECISION_BITS),
+                                             _mm256_srai_epi32(acc1, PRECISION_BITS));
+            __m256i p23 = _mm256_packs_epi32(_mm256_srai_epi32(acc2, PRECISION_BITS),
+                                             _mm256_srai_epi32(acc3, PRECISION_BITS));
+            _mm256_storeu_si256((__m256i*)(out + x * 4), _mm256_packus_epi16(p01, p23));
+        }
+
+        if (x < width) {
+            // Remaining columns: same loop as SSE2, on a view starting at x
+            FilterTable rest = *t;
+            rest.start = &t->start[y];
+            rest.weights = (int16_t*)w;
+            vertical_sse2(src + x * 4, src_pitch, out + x * 4, dst_pitch, width - x, 1, &rest);
+        }
+    }
+}
+
+#endif /* RESAMPLE_X86 */
+
+/* -------------------------------------------------------------------------- */
+/*                                  Dispatch                                  */
+/* -------------------------------------------------------------------------- */
+
+static bool isa_supported(ResampleIsa isa) {
+    switch (isa) {
+        case RESAMPLE_ISA_SCALAR:
+            return true;
+#ifdef RESAMPLE_X86
+        case RESAMPLE_ISA_SSE2:
+            return __builtin_cpu_supports("sse2");
+        case RESAMPLE_ISA_AVX2:
+            return __builtin_cpu_supports("avx2");
+#endif
+        default:
+            return false;
+    }
+}
+
+ResampleIsa thumbnail_resample_isa(void) {
+    if (forced_isa != RESAMPLE_ISA_COUNT) return forced_isa;
+    if (isa_supported(RESAMPLE_ISA_AVX2)) return RESAMPLE_ISA_AVX2;
+    if (isa_supported(RESAMPLE_ISA_SSE2)) return RESAMPLE_ISA_SSE2;
+    return RESAMPLE_ISA_SCALAR;
+}
+
+bool thumbnail_resample_force_isa(ResampleIsa isa) {
+    if (isa == RESAMPLE_ISA_COUNT) {
+        forced_isa = RESAMPLE_ISA_COUNT;
+        return true;
+    }
+    if (!isa_supported(isa)) return false;
+    forced_isa = isa;
+    return true;
+}
+
+static void select_passes(HorizontalPass *h, VerticalPass *v) {
+    switch (thumbnail_resample_isa()) {
+#ifdef RESAMPLE_X86
+        case RESAMPLE_ISA_AVX2:
+            *h = horizontal_avx2;
+            *v = vertical_avx2;
+            return;
+        case RESAMPLE_ISA_SSE2:
+            *h = horizontal_sse2;
+            *v = vertical_sse2;
+            return;
+#endif
+        default:
+            *h = horizontal_scalar;
+            *v = vertical_scalar;
+            return;
+    }
+}
+
+/**
+ * @brief One separable resize with a single kernel
+ */
+static bool resample_kernel(const uint8_t *src, int src_w, int src_h, int src_pitch,
+                            uint8_t *dst, int dst_w, int dst_h, int dst_pitch,
+                            ResampleKernel kernel) {
+    HorizontalPass horizontal;
+    VerticalPass vertical;
+    select_passes(&horizontal, &vertical);
+
+    if (src_w == dst_w && src_h == dst_h) {
+        for (int y = 0; y < dst_h; y++) {
+            memcpy(dst + (size_t)y * dst_pitch, src + (size_t)y * src_pitch, (size_t)dst_w * 4);
+        }
+        return true;
+    }
+
+    FilterTable table;
+    uint8_t *tmp = NULL;
+    const uint8_t *rows = src;
+    int rows_pitch = src_pitch;
+
+    if (src_w != dst_w) {
+        if (!table_build(&table, src_w, dst_w, kernel)) return false;
+        if (src_h == dst_h) {
+            horizontal(src, src_pitch, dst, dst_pitch, dst_w, src_h, &table);
+            table_free(&table);
+            return true;
+        }
+
+        rows_pitch = dst_w * 4;
+        tmp = malloc((size_t)rows_pitch * src_h);
+        if (!tmp) {
+            table_free(&table);
+            return false;
+        }
+        horizontal(src, src_pitch, tmp, rows_pitch, dst_w, src_h, &table);
+        table_free(&table);
+        rows = tmp;
+    }
+
+    bool ok = table_build(&table, src_h, dst_h, kernel);
+    if (ok) {
+        vertical(rows, rows_pitch, dst, dst_pitch, dst_w, dst_h, &table);
+        table_free(&table);
+    }
+    free(tmp);
+    return ok;
+}
+
+bool thumbnail_resample(const uint8_t *src, int src_w, int src_h, int src_pitch,
+                        uint8_t *dst, int dst_w, int dst_h, int dst_pitch,
+                        ThumbnailFilter filter) {
+    if (src_w <= 0 || src_h <= 0 || dst_w <= 0 || dst_h <= 0) return false;
+
+    if (filter != THUMBNAIL_FILTER_LANCZOS) {
+        return resample_kernel(src, src_w, src_h, src_pitch, dst, dst_w, dst_h, dst_pitch, KERNEL_AREA);
+    }
+
+    // Lanczos taps grow with the reduction, so do the bulk of it with cheap area averaging
+    int mid_w = src_w > dst_w * 2 ? dst_w * 2 : src_w;
+    int mid_h = src_h > dst_h * 2 ? dst_h * 2 : src_h;
+    if (mid_w == src_w && mid_h == src_h) {
+        return resample_kernel(src, src_w, src_h, src_pitch, dst, dst_w, dst_h, dst_pitch, KERNEL_LANCZOS);
+    }
+
+    uint8_t *mid = malloc((size_t)mid_w * mid_h * 4);
+    if (!mid) return false;
+
+    bool ok = resample_kernel(src, src_w, src_h, src_pitch, mid, mid_w, mid_h, mid_w * 4, KERNEL_AREA) &&
+              resample_kernel(mid, mid_w, mid_h, mid_w * 4, dst, dst_w, dst_h, dst_pitch, KERNEL_LANCZOS);
+    free(mid);
+    return ok;
+}
@@ -0,0 +1,70 @@
+/**
+ * @file thumbnail_schedule.c
+ * @brief Distance and direction based thumbnail job priorities
+ */
+
+#include "thumbnail_schedule.h"
+#include <math.h>
+#include <stdlib.h>
+
+/* The selection counts as stopped after this long without moving */
+#define SCHEDULE_IDLE_NS (300ull * 1000000ull)
+
+/* Cap on how much more a step behind costs than a step ahead */
+#define SCHEDULE_MAX_BEHIND_WEIGHT 10
+
+void thumbnail_schedule_init(ThumbnailSchedule *s) {
+    s->active = false;
+    s->focus = 0;
+    s->keep_first = 0;
+    s->keep_last = 0;
+    s->velocity = 0.0f;
+    s->last_move_ns = 0;
+}
+
+void thumbnail_schedule_update(ThumbnailSchedule *s, int focus, int keep_first, int keep_last,
+                               uint64_t now_ns) {
+    if (!s->active) {
+        s->velocity = 0.0f;
+        s->last_move_ns = now_ns;
+    } else if (focus != s->focus) {
+        // A first step after a pause counts as moving over the idle period
+        uint64_t elapsed = now_ns - s->last_move_ns;
+        if (elapsed > SCHEDULE_IDLE_NS) elapsed = SCHEDULE_IDLE_NS;
+        if (elapsed < 1000000) elapsed = 1000000;
+
+        float instant = (float)(focus - s->focus) * 1e9f / (float)elapsed;
+        if (instant * s->velocity <= 0.0f) {
+            // Starting or reversing takes effect at once
+            s->velocity = instant;
+        } else {
+            s->velocity = 0.5f * (s->velocity + instant);
+        }
+        s->last_move_ns = now_ns;
+    } else if (now_ns - s->last_move_ns > SCHEDULE_IDLE_NS) {
+        s->velocity = 0.0f;
+    }
+
+    s->active = true;
+    s->focus = focus;
+    s->keep_first = keep_first;
+    s->keep_last = keep_last;
+}
+
+bool thumbnail_schedule_keep(const ThumbnailSchedule *s, int position) {
+    return !s->active || (position >= s->keep_first && position < s->keep_last);
+}
+
+uint32_t thumbnail_schedule_score(const ThumbnailSchedule *s, int position) {
+    if (!s->active) return 0;
+
+    int offset = position - s->focus;
+    uint32_t distance = (uint32_t)abs(offset);
+
+    bool behind = (offset < 0 && s->velocity > 0.0f) || (offset > 0 && s->velocity < 0.0f);
+    if (!behind) return distance;
+
+    // The faster the selection moves, the less the strip it leaves matters
+    float speed = fminf(fabsf(s->velocity), (float)(SCHEDULE_MAX_BEHIND_WEIGHT - 2));
+    return distance * (2 + (uint32_t)speed);
+}
@@ -4,17 +4,33 @@
 #include <stdlib.h>
 #include <string.h>
 #include <strings.h>
-#include <dirent.h>
 #include <sys/stat.h>
 #include <unistd.h>
 #include <pwd.h>
-#include <openssl/md5.h>
+#include <fcntl.h>
+#include <time.h>
 #include <SDL3/SDL.h>
+#include "thumbnail_atlas.h"
+#include "thumbnail_jpeg.h"
+#include "thumbnail_resample.h"
+#include "hash.h"
+#include "scan_index.h"
+#include "dir_walk.h"
+#include "favorites.h"
 #ifdef HAVE_SDL_IMAGE
 #include <SDL3_image/SDL_image.h>
 #endif
 
-static bool is_image_file(const char *filename) {
+static ThumbnailAtlas *cache_atlas = NULL;
+static ThumbnailCodec cache_codec = THUMBNAIL_CODEC_RAW;
+static FavoritesStore *favorites_store = NULL;
+static char cache_dir[512];
+static uint64_t thumb_generation = 0;  /* Last generation handed to an attached thumbnail */
+
+/* Bytes hashed from each of the head, middle and tail of a file */
+#define FINGERPRINT_BLOCK (64 * 1024)
+
+bool wallpaper_is_image_file(const char *filename) {
     const char *ext = strrchr(filename, '.');
     if (!ext) return false;
     
@@ -41,97 +57,871 @@ static void get_cache_dir(char *buffer, size_t size) {
     mkdir(buffer, 0755);
 }
 
-static void compute_md5(const char *path, char *output) {
-    unsigned char digest[MD5_DIGEST_LENGTH];
-    MD5_CTX ctx;
-    MD5_Init(&ctx);
-    MD5_Update(&ctx, path, strlen(path));
-    MD5_Final(digest, &ctx);
+static bool stamp_file(const char *path, ThumbnailStamp *stamp) {
+    struct stat st;
+    if (stat(path, &st) != 0) {
+        memset(stamp, 0, sizeof(*stamp));
+        return false;
+    }
+    
+    stamp->mtime = (int64_t)st.st_mtime;
+    stamp->size = (int64_t)st.st_size;
+    stamp->inode = (uint64_t)st.st_ino;
+    return true;
+}
+
+/**
+ * @brief Cache key for a file's location
+ */
+static void compute_path_key(const char *path, uint8_t key[THUMBNAIL_ATLAS_KEY_SIZE]) {
+    size_t len = strlen(path);
+    uint64_t h[2] = {
+        hash_xxh64(path, len, 0),
+        hash_xxh64(path, len, 0x9E3779B97F4A7C15ULL)
+    };
+    memcpy(key, h, sizeof(h));
+}
+
+/**
+ * @brief Cache key for a file's contents, independent of where it lives
+ *
+ * Hashes the file size plus its first, middle and last blocks, so even an
+ * 8K image costs three small reads rather than a full pass.
+ *
+ * @return false if the file could not be read
+ */
+static bool compute_content_key(const char *path, const ThumbnailStamp *stamp,
+                                uint8_t key[THUMBNAIL_ATLAS_KEY_SIZE]) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
     
-    for (int i = 0; i < MD5_DIGEST_LENGTH; i++) {
-        sprintf(&output[i*2], "%02x", digest[i]);
+    uint8_t *block = malloc(FINGERPRINT_BLOCK);
+    if (!block) {
+        close(fd);
+        return false;
     }
-    output[MD5_DIGEST_LENGTH * 2] = '\0';
+    
+    int64_t size = stamp->size;
+    int64_t offsets[3] = {0, size / 2 - FINGERPRINT_BLOCK / 2, size - FINGERPRINT_BLOCK};
+    int blocks = 3;
+    if (size <= 3 * FINGERPRINT_BLOCK) {
+        // Small enough to hash whole
+        blocks = (int)((size + FINGERPRINT_BLOCK - 1) / FINGERPRINT_BLOCK);
+        for (int i = 0; i < blocks; i++) offsets[i] = (int64_t)i * FINGERPRINT_BLOCK;
+    }
+    
+    HashState state;
+    hash_reset(&state, (uint64_t)size);
+    bool ok = true;
+    for (int i = 0; i < blocks && ok; i++) {
+        ssize_t n = pread(fd, block, FINGERPRINT_BLOCK, (off_t)offsets[i]);
+        if (n < 0) {
+            ok = false;
+        } else {
+            hash_update(&state, block, (size_t)n);
+        }
+    }
+    
+    free(block);
+    close(fd);
+    if (!ok) return false;
+    
+    uint64_t h[2] = { hash_digest(&state), (uint64_t)size };
+    memcpy(key, h, sizeof(h));
+    return true;
 }
 
-WallpaperList wallpaper_list_scan(const char *dir) {
+static void get_scan_index_path(const char *dir, char *buffer, size_t size) {
+    char base[512];
+    get_cache_dir(base, sizeof(base));
+    snprintf(base + strlen(base), sizeof(base) - strlen(base), "/scan");
+    mkdir(base, 0755);
+    snprintf(buffer, size, "%s/%016llx.idx", base,
+             (unsigned long long)hash_xxh64(dir, strlen(dir), 0));
+}
+
+static bool stat_directory(const char *dir, int64_t *mtime_ns, uint64_t *inode) {
+    struct stat st;
+    if (stat(dir, &st) != 0) return false;
+    *mtime_ns = (int64_t)st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+    *inode = (uint64_t)st.st_ino;
+    return true;
+}
+
+DirWalkOptions wallpaper_walk_options(const Config *config, const char *excludes[MAX_EXCLUDES]) {
+    DirWalkOptions options;
+    memset(&options, 0, sizeof(options));
+    options.recursive = config->recursive;
+    options.max_depth = config->max_depth;
+    for (int i = 0; i < config->excludes_count; i++) {
+        excludes[i] = config->excludes[i];
+    }
+    options.excludes = excludes;
+    options.exclude_count = config->excludes_count;
+    options.accept = wallpaper_is_image_file;
+    return options;
+}
+
+/* Identifies the options an index was built with, so changing them forces a re-read */
+static uint64_t walk_options_hash(const DirWalkOptions *options) {
+    int32_t fields[2] = {options->recursive ? 1 : 0, options->recursive ? options->max_depth : 0};
+    HashState state;
+    hash_reset(&state, 0);
+    hash_update(&state, fields, sizeof(fields));
+    for (int i = 0; i < options->exclude_count; i++) {
+        hash_update(&state, options->excludes[i], strlen(options->excludes[i]) + 1);
+    }
+    return hash_digest(&state);
+}
+
+/**
+ * @brief Whether an indexed listing still matches the tree on disk
+ *
+ * Adding, removing or renaming a file changes the mtime of the directory
+ * holding it, so only the directories need a stat(), not the files.
+ */
+static bool scan_index_current(const char *dir, const ScanDirectory *scan, uint64_t options_hash) {
+    if (scan->dir_mtime_ns == 0 || scan->options_hash != options_hash) return false;
+    
+    int64_t mtime_ns;
+    uint64_t inode;
+    if (!stat_directory(dir, &mtime_ns, &inode) ||
+        mtime_ns != scan->dir_mtime_ns || inode != scan->dir_inode) {
+        return false;
+    }
+    
+    char path[4096];
+    for (int i = 0; i < scan->subdir_count; i++) {
+        const ScanSubdir *subdir = &scan->subdirs[i];
+        snprintf(path, sizeof(path), "%s/%s", dir, subdir->name);
+        if (!stat_directory(path, &mtime_ns, &inode) ||
+            mtime_ns != subdir->mtime_ns || inode != subdir->inode) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Build the trigrams of a listing's paths, numbered like its entries */
+static bool index_listing(ScanDirectory *scan) {
+    const char **names = malloc(sizeof(char*) * (scan->count > 0 ? scan->count : 1));
+    if (!names) return false;
+    for (int i = 0; i < scan->count; i++) {
+        names[i] = scan->entries[i].name;
+    }
+    bool ok = trigram_index_build(&scan->trigrams, names, scan->count);
+    free(names);
+    return ok;
+}
+
+/**
+ * @brief Finish a listing read from disk before it is saved
+ *
+ * A directory modified within the last couple of seconds may change again
+ * without its mtime moving on coarse-timestamp filesystems, so a listing
+ * containing one is marked untrusted and the next start reads it again.
+ * With @p trigrams set, the entry paths are indexed for searching.
+ */
+static void finish_listing(ScanDirectory *scan, uint64_t options_hash, bool trigrams) {
+    scan->options_hash = options_hash;
+    if (trigrams) index_listing(scan);
+    
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    int64_t racy_ns = (int64_t)now.tv_sec * 1000000000LL + now.tv_nsec - 2000000000LL;
+    
+    bool racy = scan->dir_mtime_ns > racy_ns;
+    for (int i = 0; i < scan->subdir_count && !racy; i++) {
+        racy = scan->subdirs[i].mtime_ns > racy_ns;
+    }
+    if (racy) scan->dir_mtime_ns = 0;
+}
+
+/**
+ * @brief List directories, each from its scan index if its tree is unchanged
+ *
+ * The ones that changed are walked together, so separate disks and mounts
+ * are read in parallel.
+ *
+ * @param trigrams Whether the listings need their trigrams; an index saved
+ *                 without them gets them added
+ * @param opened Receives, per directory, whether it could be listed
+ * @param from_index Set to true if any index was used
+ */
+static void load_directories(const char *const *dirs, int count, const DirWalkOptions *options,
+                             bool trigrams, ScanDirectory *scans, bool *opened, bool *from_index) {
+    uint64_t options_hash = walk_options_hash(options);
+    const char *stale_dirs[MAX_WALLPAPER_DIRS + 1];
+    int stale[MAX_WALLPAPER_DIRS + 1];
+    char index_paths[MAX_WALLPAPER_DIRS + 1][1024];
+    int stale_count = 0;
+    
+    for (int i = 0; i < count; i++) {
+        get_scan_index_path(dirs[i], index_paths[i], sizeof(index_paths[i]));
+        if (scan_index_load(index_paths[i], &scans[i])) {
+            if (scan_index_current(dirs[i], &scans[i], options_hash)) {
+                opened[i] = true;
+                *from_index = true;
+                if (trigrams && scans[i].trigrams.key_count == 0 && scans[i].count > 0 &&
+                    index_listing(&scans[i])) {
+                    scan_index_save(index_paths[i], &scans[i]);
+                }
+                continue;
+            }
+            scan_directory_free(&scans[i]);
+        }
+        stale_dirs[stale_count] = dirs[i];
+        stale[stale_count++] = i;
+    }
+    if (stale_count == 0) return;
+    
+    ScanDirectory walked[MAX_WALLPAPER_DIRS + 1];
+    bool walked_opened[MAX_WALLPAPER_DIRS + 1];
+    dir_walk(stale_dirs, stale_count, options, walked, walked_opened);
+    
+    for (int i = 0; i < stale_count; i++) {
+        int index = stale[i];
+        scans[index] = walked[i];
+        opened[index] = walked_opened[i];
+        if (!walked_opened[i]) continue;
+        
+        finish_listing(&scans[index], options_hash, trigrams);
+        scan_index_save(index_paths[index], &scans[index]);
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                List storage                                */
+/* -------------------------------------------------------------------------- */
+
+/* Copy a string into the arena, returning its offset */
+static uint32_t arena_add(WallpaperList *list, const char *s, size_t len) {
+    if (list->strings_size + len + 1 > list->strings_capacity) {
+        size_t capacity = list->strings_capacity > 0 ? list->strings_capacity * 2 : 4096;
+        while (capacity < list->strings_size + len + 1) capacity *= 2;
+        list->strings = realloc(list->strings, capacity);
+        list->strings_capacity = capacity;
+    }
+    
+    uint32_t offset = (uint32_t)list->strings_size;
+    memcpy(list->strings + offset, s, len);
+    list->strings[offset + len] = '\0';
+    list->strings_size += len + 1;
+    return offset;
+}
+
+/*
+ * Copy the strings still in use into a fresh arena, leaving the names of
+ * removed wallpapers behind. Directory paths are all kept: they are few,
+ * and prefix_table refers to them by number.
+ */
+static void arena_compact(WallpaperList *list) {
+    char *old = list->strings;
+    list->strings_capacity = list->strings_size - list->strings_dead;
+    list->strings = malloc(list->strings_capacity > 0 ? list->strings_capacity : 1);
+    list->strings_size = 0;
+    list->strings_dead = 0;
+    
+    for (int p = 0; p < list->prefix_count; p++) {
+        const char *dir = old + list->prefix_offsets[p];
+        list->prefix_offsets[p] = arena_add(list, dir, strlen(dir));
+    }
+    for (int i = 0; i < list->count; i++) {
+        const char *name = old + list->name_offsets[i];
+        list->name_offsets[i] = arena_add(list, name, strlen(name));
+    }
+    free(old);
+}
+
+static const char* prefix_string(const WallpaperList *list, int prefix) {
+    return list->strings + list->prefix_offsets[prefix];
+}
+
+static void prefix_table_grow(WallpaperList *list) {
+    int size = list->prefix_table_size > 0 ? list->prefix_table_size * 2 : 64;
+    free(list->prefix_table);
+    list->prefix_table = malloc(sizeof(int) * size);
+    list->prefix_table_size = size;
+    for (int i = 0; i < size; i++) list->prefix_table[i] = -1;
+    
+    for (int p = 0; p < list->prefix_count; p++) {
+        const char *dir = prefix_string(list, p);
+        int slot = (int)(hash_xxh64(dir, strlen(dir), 0) & (uint64_t)(size - 1));
+        while (list->prefix_table[slot] >= 0) slot = (slot + 1) & (size - 1);
+        list->prefix_table[slot] = p;
+    }
+}
+
+/**
+ * @brief Look up a directory path among the interned ones
+ * @param add Intern it if it is not there yet
+ * @return Directory index, or -1 if absent and not added
+ */
+static int find_prefix(WallpaperList *list, const char *dir, size_t len, bool add) {
+    if (add && (list->prefix_count + 1) * 2 > list->prefix_table_size) prefix_table_grow(list);
+    if (list->prefix_table_size == 0) return -1;
+    
+    int mask = list->prefix_table_size - 1;
+    int slot = (int)(hash_xxh64(dir, len, 0) & (uint64_t)mask);
+    for (; list->prefix_table[slot] >= 0; slot = (slot + 1) & mask) {
+        const char *existing = prefix_string(list, list->prefix_table[slot]);
+        if (strncmp(existing, dir, len) == 0 && existing[len] == '\0') return list->prefix_table[slot];
+    }
+    if (!add) return -1;
+    
+    if (list->prefix_count >= list->prefix_capacity) {
+        list->prefix_capacity = list->prefix_capacity > 0 ? list->prefix_capacity * 2 : 16;
+        list->prefix_offsets = realloc(list->prefix_offsets, sizeof(uint32_t) * list->prefix_capacity);
+    }
+    list->prefix_offsets[list->prefix_count] = arena_add(list, dir, len);
+    list->prefix_table[slot] = list->prefix_count;
+    return list->prefix_count++;
+}
+
+static bool favorite_bit(const WallpaperList *list, int index) {
+    return (list->favorites[index >> 6] >> (index & 63)) & 1;
+}
+
+static void set_favorite_bit(WallpaperList *list, int index, bool on) {
+    uint64_t bit = 1ULL << (index & 63);
+    if (on) list->favorites[index >> 6] |= bit;
+    else list->favorites[index >> 6] &= ~bit;
+}
+
+static void reserve_wallpapers(WallpaperList *list, int needed) {
+    if (needed <= list->capacity) return;
+    
+    int capacity = list->capacity > 0 ? list->capacity : 32;
+    while (capacity < needed) capacity *= 2;
+    list->name_offsets = realloc(list->name_offsets, sizeof(uint32_t) * capacity);
+    list->prefixes = realloc(list->prefixes, sizeof(uint32_t) * capacity);
+    list->stamps = realloc(list->stamps, sizeof(ThumbnailStamp) * capacity);
+    list->thumbs = realloc(list->thumbs, sizeof(ThumbnailSlot) * capacity);
+    
+    // Bits past count are kept clear so favorites can be counted word by word
+    size_t old_words = ((size_t)list->capacity + 63) / 64;
+    size_t words = ((size_t)capacity + 63) / 64;
+    list->favorites = realloc(list->favorites, sizeof(uint64_t) * words);
+    memset(list->favorites + old_words, 0, sizeof(uint64_t) * (words - old_words));
+    if (list->filtered_indices) {
+        list->filtered_indices = realloc(list->filtered_indices, sizeof(int) * capacity);
+    }
+    list->capacity = capacity;
+}
+
+/**
+ * @brief Store a wallpaper at index, moving the ones from there on up by one
+ *
+ * Links and directory ends that refer to the moved wallpapers are left for
+ * the caller to renumber.
+ *
+ * @param dir Directory holding the file
+ * @param name Filename
+ */
+static void store_wallpaper(WallpaperList *list, int index, const char *dir, size_t dir_len,
+                             const char *name, const ThumbnailStamp *stamp) {
+    reserve_wallpapers(list, list->count + 1);
+    search_invalidate(&list->search);
+    
+    int moved = list->count - index;
+    memmove(&list->name_offsets[index + 1], &list->name_offsets[index], sizeof(uint32_t) * moved);
+    memmove(&list->prefixes[index + 1], &list->prefixes[index], sizeof(uint32_t) * moved);
+    memmove(&list->stamps[index + 1], &list->stamps[index], sizeof(ThumbnailStamp) * moved);
+    memmove(&list->thumbs[index + 1], &list->thumbs[index], sizeof(ThumbnailSlot) * moved);
+    for (int i = list->count; i > index; i--) {
+        set_favorite_bit(list, i, favorite_bit(list, i - 1));
+    }
+    list->count++;
+    
+    list->name_offsets[index] = arena_add(list, name, strlen(name));
+    list->prefixes[index] = (uint32_t)find_prefix(list, dir, dir_len, true);
+    list->stamps[index] = *stamp;
+    set_favorite_bit(list, index, false);
+    
+    ThumbnailSlot *slot = &list->thumbs[index];
+    memset(slot, 0, sizeof(*slot));
+    slot->lru_prev = slot->lru_next = -1;
+    slot->state = THUMB_STATE_NONE;
+}
+
+/**
+ * @brief Append a file found under a configured directory
+ * @param rel Path relative to dir
+ */
+static void append_wallpaper(WallpaperList *list, const char *dir, const char *rel, const ThumbnailStamp *stamp) {
+    const char *slash = strrchr(rel, '/');
+    if (!slash) {
+        store_wallpaper(list, list->count, dir, strlen(dir), rel, stamp);
+        return;
+    }
+    
+    // In a subdirectory: the directory part joins the configured one
+    char subdir[4096];
+    int len = snprintf(subdir, sizeof(subdir), "%s/%.*s", dir, (int)(slash - rel), rel);
+    if (len < 0 || (size_t)len >= sizeof(subdir)) return;
+    store_wallpaper(list, list->count, subdir, (size_t)len, slash + 1, stamp);
+}
+
+static void append_directory(WallpaperList *list, const char *dir, const ScanDirectory *scan) {
+    reserve_wallpapers(list, list->count + scan->count);
+    for (int i = 0; i < scan->count; i++) {
+        append_wallpaper(list, dir, scan->entries[i].name, &scan->entries[i].stamp);
+    }
+}
+
+static WallpaperList wallpaper_list_new(void) {
     WallpaperList list = {0};
-    list.capacity = 32;
-    list.items = malloc(sizeof(Wallpaper) * list.capacity);
+    reserve_wallpapers(&list, 32);
     list.search_query[0] = '\0';
     list.filtered_indices = NULL;
     list.filtered_count = 0;
+    list.filter_active = false;
     list.show_favorites_only = false;
+    search_init(&list.search);
+    list.thumb_lru_head = -1;
+    list.thumb_lru_tail = -1;
+    return list;
+}
+
+/**
+ * @brief Append the wallpapers of several directories, in the order given
+ *
+ * When searching paths, the listings' trigrams are joined into one index
+ * for the search engine, so no index is built at startup.
+ *
+ * @param opened Receives, per directory, whether it could be listed
+ */
+static void scan_into(WallpaperList *list, const char *const *dirs, int count,
+                      const DirWalkOptions *options, bool *opened) {
+    ScanDirectory scans[MAX_WALLPAPER_DIRS + 1];
+    bool from_index = false;
+    load_directories(dirs, count, options, list->search_paths, scans, opened, &from_index);
+    
+    TrigramIndex trigrams;
+    trigram_index_init(&trigrams);
+    bool trigrams_complete = list->search_paths && list->count == 0;
+    for (int i = 0; i < count; i++) {
+        int first = list->count;
+        if (opened[i]) append_directory(list, dirs[i], &scans[i]);
+        
+        // A path too long to store would shift the numbering; leave the build to the engine
+        trigrams_complete = trigrams_complete && list->count - first == scans[i].count &&
+                            (scans[i].count == 0 || scans[i].trigrams.key_count > 0) &&
+                            trigram_index_append(&trigrams, &scans[i].trigrams, (uint32_t)first);
+        scan_directory_free(&scans[i]);
+        list->dir_lengths[list->dir_count] = strlen(dirs[i]);
+        list->dir_ends[list->dir_count++] = list->count;
+    }
+    list->from_index = list->from_index || from_index;
+    
+    search_use_trigrams(&list->search, list->search_paths);
+    if (trigrams_complete) search_adopt_trigrams(&list->search, &trigrams, list->count);
+    trigram_index_free(&trigrams);
+}
+
+WallpaperList wallpaper_list_scan(const char *dir) {
+    WallpaperList list = wallpaper_list_new();
     
-    DIR *d = opendir(dir);
-    if (!d) {
+    DirWalkOptions options;
+    memset(&options, 0, sizeof(options));
+    options.accept = wallpaper_is_image_file;
+    
+    bool opened;
+    scan_into(&list, &dir, 1, &options, &opened);
+    if (!opened) {
         fprintf(stderr, "Failed to open directory: %s\n", dir);
         return list;
     }
     
-    struct dirent *entry;
-    while ((entry = readdir(d)) != NULL) {
-        if (!is_image_file(entry->d_name)) continue;
-        
-        // Expand capacity if needed
-        if (list.count >= list.capacity) {
-            list.capacity *= 2;
-            list.items = realloc(list.items, sizeof(Wallpaper) * list.capacity);
-        }
-        
-        Wallpaper *wp = &list.items[list.count++];
+    // Load favorites after scanning
+    wallpaper_list_load_favorites(&list);
+    
+    return list;
+}
+
+static size_t thumbnail_bytes(const SDL_Surface *thumb) {
+    return (size_t)thumb->pitch * thumb->h;
+}
+
+static void lru_unlink(WallpaperList *list, int index) {
+    ThumbnailSlot *slot = &list->thumbs[index];
+    if (slot->lru_prev >= 0) list->thumbs[slot->lru_prev].lru_next = slot->lru_next;
+    else list->thumb_lru_head = slot->lru_next;
+    if (slot->lru_next >= 0) list->thumbs[slot->lru_next].lru_prev = slot->lru_prev;
+    else list->thumb_lru_tail = slot->lru_prev;
+    slot->lru_prev = slot->lru_next = -1;
+}
+
+static void lru_push_head(WallpaperList *list, int index) {
+    ThumbnailSlot *slot = &list->thumbs[index];
+    slot->lru_prev = -1;
+    slot->lru_next = list->thumb_lru_head;
+    if (list->thumb_lru_head >= 0) list->thumbs[list->thumb_lru_head].lru_prev = index;
+    else list->thumb_lru_tail = index;
+    list->thumb_lru_head = index;
+}
+
+/* Free a resident thumbnail; it is loaded again when next requested */
+static void thumbnail_release(WallpaperList *list, int index) {
+    ThumbnailSlot *slot = &list->thumbs[index];
+    if (slot->thumb) {
+        lru_unlink(list, index);
+        list->thumb_bytes -= thumbnail_bytes(slot->thumb);
+        SDL_DestroySurface(slot->thumb);
+        slot->thumb = NULL;
+    }
+    slot->state = THUMB_STATE_NONE;
+    slot->generation = 0;
+}
+
+/* Free least recently viewed thumbnails until under budget, sparing the current view */
+static void thumbnail_trim(WallpaperList *list) {
+    while (list->thumb_budget > 0 && list->thumb_bytes > list->thumb_budget) {
+        int index = list->thumb_lru_tail;
+        if (index < 0) break;
         
-        // Full path
-        wp->path = malloc(strlen(dir) + strlen(entry->d_name) + 2);
-        sprintf(wp->path, "%s/%s", dir, entry->d_name);
+        if (list->view_generation > 0 && list->thumbs[index].view_generation == list->view_generation) break;
         
-        // Filename only
-        wp->name = strdup(entry->d_name);
-        wp->thumb = NULL;
-        wp->is_favorite = false;
+        thumbnail_release(list, index);
+    }
+}
+
+/* Take ownership of a finished thumbnail (NULL if it failed) and its colours */
+static void thumbnail_attach(WallpaperList *list, int index, SDL_Surface *thumb,
+                             const ThumbnailPalette *palette) {
+    ThumbnailSlot *slot = &list->thumbs[index];
+    if (slot->thumb) {
+        lru_unlink(list, index);
+        list->thumb_bytes -= thumbnail_bytes(slot->thumb);
+        SDL_DestroySurface(slot->thumb);
     }
     
-    closedir(d);
+    slot->thumb = thumb;
+    if (!thumb) {
+        slot->state = THUMB_STATE_FAILED;
+        slot->generation = 0;
+        return;
+    }
+    slot->state = THUMB_STATE_LOADED;
+    slot->generation = ++thumb_generation;
+    list->thumb_bytes += thumbnail_bytes(thumb);
+    slot->palette = *palette;
     
-    // Load favorites after scanning
-    wallpaper_list_load_favorites(&list);
+    // Arrivals the view has already scrolled past go first
+    if (list->view_generation > 0 && slot->view_generation != list->view_generation &&
+        list->thumb_lru_tail >= 0) {
+        slot->lru_next = -1;
+        slot->lru_prev = list->thumb_lru_tail;
+        list->thumbs[list->thumb_lru_tail].lru_next = index;
+        list->thumb_lru_tail = index;
+    } else {
+        lru_push_head(list, index);
+    }
+}
+
+void wallpaper_list_set_thumbnail_budget(WallpaperList *list, size_t bytes) {
+    list->thumb_budget = bytes;
+    thumbnail_trim(list);
+}
+
+/* Give queued jobs the display positions their wallpapers have in the view now */
+static void reposition_jobs(WallpaperList *list, ThumbnailPipeline *pipeline) {
+    int *positions = malloc(sizeof(int) * (list->count > 0 ? list->count : 1));
+    if (!positions) return;
     
-    return list;
+    for (int i = 0; i < list->count; i++) positions[i] = -1;
+    int visible = wallpaper_list_visible_count(list);
+    for (int i = 0; i < visible; i++) positions[wallpaper_list_get(list, i)] = i;
+    thumbnail_pipeline_reposition(pipeline, positions, list->count);
+    free(positions);
+}
+
+void wallpaper_list_request_range(WallpaperList *list, ThumbnailPipeline *pipeline,
+                                  const Config *config, int first, int last, int focus) {
+    int visible = wallpaper_list_visible_count(list);
+    if (first < 0) first = 0;
+    if (last > visible) last = visible;
+    
+    list->view_generation++;
+    
+    // Queued jobs outside the range are cancelled and come back as NONE, judged
+    // by where their wallpaper is now if a filter or file change moved it
+    if (pipeline) {
+        if (list->positions_stale && thumbnail_pipeline_outstanding(pipeline) > 0) {
+            reposition_jobs(list, pipeline);
+        }
+        list->positions_stale = false;
+        thumbnail_pipeline_set_focus(pipeline, focus, first, last);
+    }
+    
+    char path[4096];
+    for (int i = first; i < last; i++) {
+        int index = wallpaper_list_get(list, i);
+        if (index < 0) continue;
+        ThumbnailSlot *slot = &list->thumbs[index];
+        slot->view_generation = list->view_generation;
+        
+        switch (slot->state) {
+            case THUMB_STATE_LOADED:
+                if (list->thumb_lru_head != index) {
+                    lru_unlink(list, index);
+                    lru_push_head(list, index);
+                }
+                break;
+            case THUMB_STATE_NONE:
+                wallpaper_list_path(list, index, path, sizeof(path));
+                if (pipeline) {
+                    thumbnail_pipeline_submit(pipeline, index, i, path, &list->stamps[index]);
+                    slot->state = THUMB_STATE_PENDING;
+                } else {
+                    ThumbnailPalette palette;
+                    SDL_Surface *thumb = thumbnail_load_or_cache(path, config->thumbnail_width,
+                                                                 config->thumbnail_height, list->thumb_codec,
+                                                                 list->thumb_filter, &palette);
+                    thumbnail_attach(list, index, thumb, &palette);
+                }
+                break;
+            case THUMB_STATE_PENDING:
+            case THUMB_STATE_FAILED:
+                break;
+        }
+    }
+    
+    thumbnail_trim(list);
 }
 
 void wallpaper_list_generate_thumbnails(WallpaperList *list, const Config *config) {
+    ThumbnailPipeline *pipeline = thumbnail_pipeline_create(config);
+    if (!pipeline) {
+        // Fall back to generating on the calling thread
+        ThumbnailCodec codec;
+        ThumbnailFilter filter;
+        thumbnail_options_parse(config, &codec, &filter);
+        char path[4096];
+        for (int i = 0; i < list->count; i++) {
+            if (list->thumbs[i].state != THUMB_STATE_NONE) continue;
+            ThumbnailPalette palette;
+            SDL_Surface *thumb = thumbnail_load_or_cache(
+                wallpaper_list_path(list, i, path, sizeof(path)),
+                config->thumbnail_width,
+                config->thumbnail_height,
+                codec,
+                filter,
+                &palette
+            );
+            thumbnail_attach(list, i, thumb, &palette);
+            printf("Generated thumbnail for %s\n", wallpaper_list_name(list, i));
+        }
+        return;
+    }
+    
+    wallpaper_list_request_thumbnails(list, pipeline);
+    while (thumbnail_pipeline_outstanding(pipeline) > 0) {
+        ThumbnailResult results[64];
+        int n = thumbnail_pipeline_poll(pipeline, results, 64, true);
+        for (int i = 0; i < n; i++) {
+            thumbnail_attach(list, results[i].index, results[i].thumb, &results[i].palette);
+            printf("Generated thumbnail for %s\n", wallpaper_list_name(list, results[i].index));
+        }
+    }
+    
+    thumbnail_pipeline_destroy(pipeline);
+}
+
+void wallpaper_list_request_thumbnails(WallpaperList *list, ThumbnailPipeline *pipeline) {
+    char path[4096];
     for (int i = 0; i < list->count; i++) {
-        list->items[i].thumb = thumbnail_load_or_cache(
-            list->items[i].path,
-            config->thumbnail_width,
-            config->thumbnail_height
-        );
-        printf("Generated thumbnail for %s\n", list->items[i].name);
+        if (list->thumbs[i].state == THUMB_STATE_NONE) {
+            wallpaper_list_path(list, i, path, sizeof(path));
+            thumbnail_pipeline_submit(pipeline, i, i, path, &list->stamps[i]);
+            list->thumbs[i].state = THUMB_STATE_PENDING;
+        }
+    }
+}
+
+int wallpaper_list_collect_thumbnails(WallpaperList *list, ThumbnailPipeline *pipeline) {
+    ThumbnailResult results[64];
+    int total = 0;
+    int n;
+    
+    while ((n = thumbnail_pipeline_poll(pipeline, results, 64, false)) > 0) {
+        for (int i = 0; i < n; i++) {
+            if (results[i].cancelled) {
+                list->thumbs[results[i].index].state = THUMB_STATE_NONE;
+                continue;
+            }
+            thumbnail_attach(list, results[i].index, results[i].thumb, &results[i].palette);
+        }
+        total += n;
     }
+    
+    if (total > 0) thumbnail_trim(list);
+    return total;
 }
 
-SDL_Surface* thumbnail_load_or_cache(const char *path, int width, int height) {
-    char cache_dir[512];
-    char md5[MD5_DIGEST_LENGTH * 2 + 1];
-    char cache_path[768];
+bool thumbnail_cache_open(int width, int height, ThumbnailCodec codec) {
+    if (cache_atlas) return true;
     
+    char atlas_path[768];
     get_cache_dir(cache_dir, sizeof(cache_dir));
-    compute_md5(path, md5);
-    snprintf(cache_path, sizeof(cache_path), "%s/%s_%dx%d.png", cache_dir, md5, width, height);
+    snprintf(atlas_path, sizeof(atlas_path), "%s/thumbs_%dx%d.atlas", cache_dir, width, height);
     
-    // Try to load from cache
+    cache_atlas = thumbnail_atlas_open(atlas_path, width, height);
+    cache_codec = codec;
+    if (cache_atlas) {
+        printf("Thumbnail cache: %s (%d entries, writing %s)\n", atlas_path,
+               thumbnail_atlas_count(cache_atlas), thumbnail_codec_name(codec));
+    }
+    return cache_atlas != NULL;
+}
+
+void thumbnail_cache_close(void) {
+    thumbnail_atlas_close(cache_atlas);
+    cache_atlas = NULL;
+}
+
+static SDL_Surface* load_png_io(SDL_IOStream *io) {
 #ifdef HAVE_SDL_IMAGE
-    SDL_Surface *thumb = IMG_Load(cache_path);
+    return IMG_Load_IO(io, true);
 #else
-    // SDL3 has built-in PNG support
-    SDL_Surface *thumb = SDL_LoadPNG(cache_path);
+    return SDL_LoadPNG_IO(io, true);
 #endif
-    if (thumb) {
-        return thumb;
+}
+
+/**
+ * @brief Convert a loaded thumbnail to the cache pixel format and check its size
+ * @return Thumbnail (the input is consumed), or NULL if it does not fit
+ */
+static SDL_Surface* adopt_thumbnail(SDL_Surface *surf, int width, int height) {
+    if (!surf) return NULL;
+    
+    if (surf->format != SDL_PIXELFORMAT_RGBA32) {
+        SDL_Surface *converted = SDL_ConvertSurface(surf, SDL_PIXELFORMAT_RGBA32);
+        SDL_DestroySurface(surf);
+        surf = converted;
     }
+    if (surf && (surf->w != width || surf->h != height)) {
+        SDL_DestroySurface(surf);
+        surf = NULL;
+    }
+    return surf;
+}
 
-    // Cache miss - load original and create thumbnail
+/**
+ * @brief Turn an atlas entry back into a surface
+ */
+static SDL_Surface* surface_from_cache(const void *data, uint32_t codec, size_t length,
+                                       int width, int height) {
+    // Raw slots are wrapped in place; the surface never owns or copies the pixels
+    if (codec == THUMBNAIL_CODEC_RAW && length == (size_t)width * height * 4) {
+        return SDL_CreateSurfaceFrom(width, height, SDL_PIXELFORMAT_RGBA32, (void*)data, width * 4);
+    }
+    
+    if (codec == THUMBNAIL_CODEC_PNG) {
+        SDL_IOStream *io = SDL_IOFromConstMem(data, length);
+        return io ? adopt_thumbnail(load_png_io(io), width, height) : NULL;
+    }
+    
+    SDL_Surface *thumb = SDL_CreateSurface(width, height, SDL_PIXELFORMAT_RGBA32);
+    if (thumb && !thumbnail_codec_decode((ThumbnailCodec)codec, data, length,
+                                         thumb->pixels, width, height, thumb->pitch)) {
+        SDL_DestroySurface(thumb);
+        thumb = NULL;
+    }
+    return thumb;
+}
+
+// The palette travels in the atlas entry's info bytes
+_Static_assert(sizeof(ThumbnailPalette) == THUMBNAIL_ATLAS_INFO_SIZE, "palette must fill the atlas info");
+
+SDL_Surface* thumbnail_cache_load(const char *path, const ThumbnailStamp *stamp, int width, int height,
+                                  ThumbnailPalette *palette) {
+    if (!cache_atlas) return NULL;
+    
+    // Fast probe by location, then by contents for moved or renamed files
+    uint8_t path_key[THUMBNAIL_ATLAS_KEY_SIZE];
+    compute_path_key(path, path_key);
+    
+    uint32_t codec;
+    size_t length;
+    ThumbnailPalette info;
+    const void *data = thumbnail_atlas_lookup(cache_atlas, path_key, stamp, &codec, &length, &info);
+    if (!data) {
+        uint8_t content_key[THUMBNAIL_ATLAS_KEY_SIZE];
+        if (!compute_content_key(path, stamp, content_key)) return NULL;
+        
+        data = thumbnail_atlas_lookup(cache_atlas, content_key, NULL, &codec, &length, &info);
+        if (!data) return NULL;
+        
+        // Remember the new location so the next start hits the fast probe
+        thumbnail_atlas_alias(cache_atlas, path_key, stamp, content_key);
+    }
+    
+    // A corrupt entry is a miss; regenerating it replaces the entry
+    SDL_Surface *thumb = surface_from_cache(data, codec, length, width, height);
+    if (thumb && palette) *palette = info;
+    return thumb;
+}
+
+SDL_Surface* thumbnail_cache_migrate(const char *path, const ThumbnailStamp *stamp, int width, int height) {
+    if (!cache_atlas) return NULL;
+    
+    // Older versions wrote <md5 of path>_<w>x<h>.png next to the atlas
+    uint8_t digest[16];
+    char md5[33];
+    char legacy_path[768];
+    hash_md5(path, strlen(path), digest);
+    for (int i = 0; i < 16; i++) {
+        sprintf(&md5[i * 2], "%02x", digest[i]);
+    }
+    snprintf(legacy_path, sizeof(legacy_path), "%s/%s_%dx%d.png", cache_dir, md5, width, height);
+    
+    struct stat st;
+    if (stat(legacy_path, &st) != 0) return NULL;
+    
+    // Those files were never invalidated, so only trust one newer than the image
+    SDL_Surface *thumb = NULL;
+    if ((int64_t)st.st_mtime >= stamp->mtime) {
+        SDL_IOStream *io = SDL_IOFromFile(legacy_path, "rb");
+        thumb = io ? adopt_thumbnail(load_png_io(io), width, height) : NULL;
+    }
+    
+    unlink(legacy_path);
+    return thumb;
+}
+
+static bool is_jpeg_file(const char *path) {
+    const char *ext = strrchr(path, '.');
+    return ext && (strcasecmp(ext, ".jpg") == 0 || strcasecmp(ext, ".jpeg") == 0);
+}
+
+/**
+ * @brief Decode a JPEG at the smallest DCT scale that still covers the thumbnail
+ * @return RGBA32 surface, or NULL to fall back to the generic loaders
+ */
+static SDL_Surface* decode_jpeg_reduced(const char *path, int min_width, int min_height) {
+    int width, height;
+    ThumbnailJpeg *jpeg = thumbnail_jpeg_open(path, min_width, min_height, &width, &height);
+    if (!jpeg) return NULL;
+    
+    SDL_Surface *surf = SDL_CreateSurface(width, height, SDL_PIXELFORMAT_RGBA32);
+    if (surf && !thumbnail_jpeg_read(jpeg, surf->pixels, surf->pitch)) {
+        SDL_DestroySurface(surf);
+        surf = NULL;
+    }
+    
+    thumbnail_jpeg_close(jpeg);
+    return surf;
+}
+
+SDL_Surface* thumbnail_decode(const char *path, int min_width, int min_height) {
     SDL_Surface *original = NULL;
+    
+    if (is_jpeg_file(path)) {
+        original = decode_jpeg_reduced(path, min_width, min_height);
+        if (original) return original;
+    }
+    
 #ifdef HAVE_SDL_IMAGE
     original = IMG_Load(path);
 #else
@@ -144,117 +934,391 @@ SDL_Surface* thumbnail_load_or_cache(const char *path, int width, int height) {
         } else if (strcasecmp(ext, ".bmp") == 0) {
             original = SDL_LoadBMP(path);
         } else if (strcasecmp(ext, ".jpg") == 0 || strcasecmp(ext, ".jpeg") == 0) {
-            // SDL3 has built-in JPEG support via stb_image
-            // Try loading as a generic image file using SDL_LoadBMP_IO with stb_image fallback
-            // Actually, SDL3 core only has BMP and PNG. For JPG, we need SDL_image or stb_image
-            fprintf(stderr, "Warning: JPEG format requires SDL_image. Skipping %s\n", path);
+            // SDL3 core only has BMP and PNG; JPEGs need libjpeg (above) or SDL_image
+            fprintf(stderr, "Warning: JPEG format requires libjpeg or SDL_image. Skipping %s\n", path);
         }
     }
 #endif
     if (!original) {
         fprintf(stderr, "Failed to load image %s: %s\n", path, SDL_GetError());
-        return NULL;
+    }
+    return original;
+}
+
+SDL_Surface* thumbnail_scale(SDL_Surface *original, int width, int height, ThumbnailFilter filter) {
+    // The resampler works on 4-byte pixels; the JPEG path already delivers RGBA32
+    SDL_Surface *rgba = original;
+    if (original->format != SDL_PIXELFORMAT_RGBA32) {
+        rgba = SDL_ConvertSurface(original, SDL_PIXELFORMAT_RGBA32);
+        if (!rgba) return NULL;
     }
     
-    // Create scaled surface
-    thumb = SDL_CreateSurface(width, height, SDL_PIXELFORMAT_RGBA8888);
+    SDL_Surface *thumb = SDL_CreateSurface(width, height, SDL_PIXELFORMAT_RGBA32);
+    bool ok = thumb && SDL_LockSurface(rgba);
+    if (ok) {
+        ok = thumbnail_resample(rgba->pixels, rgba->w, rgba->h, rgba->pitch,
+                                thumb->pixels, width, height, thumb->pitch, filter);
+        SDL_UnlockSurface(rgba);
+    }
     
-    SDL_Rect dest = {0, 0, width, height};
-    SDL_BlitSurfaceScaled(original, NULL, thumb, &dest, SDL_SCALEMODE_LINEAR);
+    if (rgba != original) SDL_DestroySurface(rgba);
+    if (!ok && thumb) {
+        SDL_DestroySurface(thumb);
+        thumb = NULL;
+    }
+    return thumb;
+}
+
+static size_t encode_png(SDL_Surface *thumb, uint8_t *out, size_t capacity) {
+    SDL_IOStream *io = SDL_IOFromDynamicMem();
+    if (!io) return 0;
     
-    // Save to cache
 #ifdef HAVE_SDL_IMAGE
-    IMG_SavePNG(thumb, cache_path);
+    bool ok = IMG_SavePNG_IO(thumb, io, false);
 #else
-    // SDL3 has built-in PNG saving
-    SDL_SavePNG(thumb, cache_path);
+    bool ok = SDL_SavePNG_IO(thumb, io, false);
 #endif
     
+    size_t length = 0;
+    if (ok) {
+        Sint64 size = SDL_GetIOSize(io);
+        void *mem = SDL_GetPointerProperty(SDL_GetIOProperties(io),
+                                           SDL_PROP_IOSTREAM_DYNAMIC_MEMORY_POINTER, NULL);
+        if (mem && size > 0 && (size_t)size <= capacity) {
+            memcpy(out, mem, (size_t)size);
+            length = (size_t)size;
+        }
+    }
+    
+    SDL_CloseIO(io);
+    return length;
+}
+
+/**
+ * @brief Encode a thumbnail with the configured codec
+ *
+ * Falls back to raw if the encoding fails or would not be smaller.
+ */
+static size_t encode_thumbnail(SDL_Surface *thumb, uint8_t *out, size_t capacity, uint32_t *codec) {
+    size_t raw_size = (size_t)thumb->w * thumb->h * 4;
+    size_t length = 0;
+    
+    *codec = cache_codec;
+    if (cache_codec == THUMBNAIL_CODEC_PNG) {
+        length = encode_png(thumb, out, raw_size);
+    } else if (cache_codec != THUMBNAIL_CODEC_RAW) {
+        length = thumbnail_codec_encode(cache_codec, thumb->pixels, thumb->w, thumb->h,
+                                        thumb->pitch, out, capacity);
+    }
+    
+    if (length == 0 || length >= raw_size) {
+        *codec = THUMBNAIL_CODEC_RAW;
+        length = thumbnail_codec_encode(THUMBNAIL_CODEC_RAW, thumb->pixels, thumb->w, thumb->h,
+                                        thumb->pitch, out, capacity);
+    }
+    return length;
+}
+
+void thumbnail_compute_palette(SDL_Surface *thumb, ThumbnailPalette *palette) {
+    SDL_Surface *rgba = thumb;
+    if (thumb->format != SDL_PIXELFORMAT_RGBA32) {
+        rgba = SDL_ConvertSurface(thumb, SDL_PIXELFORMAT_RGBA32);
+    }
+    
+    memset(palette, 0, sizeof(*palette));
+    if (rgba && SDL_LockSurface(rgba)) {
+        thumbnail_palette_compute(rgba->pixels, rgba->w, rgba->h, rgba->pitch, palette);
+        SDL_UnlockSurface(rgba);
+    }
+    if (rgba && rgba != thumb) SDL_DestroySurface(rgba);
+}
+
+bool thumbnail_cache_store(const char *path, const ThumbnailStamp *stamp, SDL_Surface *thumb,
+                           const ThumbnailPalette *palette) {
+    if (!cache_atlas) return false;
+    
+    SDL_Surface *rgba = thumb;
+    if (thumb->format != SDL_PIXELFORMAT_RGBA32) {
+        rgba = SDL_ConvertSurface(thumb, SDL_PIXELFORMAT_RGBA32);
+        if (!rgba) return false;
+    }
+    
+    size_t capacity = 0;
+    for (int c = THUMBNAIL_CODEC_RAW; c < THUMBNAIL_CODEC_PNG; c++) {
+        size_t bound = thumbnail_codec_bound((ThumbnailCodec)c, rgba->w, rgba->h);
+        if (bound > capacity) capacity = bound;
+    }
+    uint8_t *encoded = malloc(capacity);
+    
+    uint32_t codec = THUMBNAIL_CODEC_RAW;
+    size_t length = 0;
+    if (encoded && SDL_LockSurface(rgba)) {
+        length = encode_thumbnail(rgba, encoded, capacity, &codec);
+        SDL_UnlockSurface(rgba);
+    }
+    if (rgba != thumb) SDL_DestroySurface(rgba);
+    
+    // Data lives under the content key; the path key is an alias to it
+    uint8_t path_key[THUMBNAIL_ATLAS_KEY_SIZE];
+    uint8_t content_key[THUMBNAIL_ATLAS_KEY_SIZE];
+    compute_path_key(path, path_key);
+    
+    bool ok = length > 0;
+    if (ok && compute_content_key(path, stamp, content_key)) {
+        ok = thumbnail_atlas_store(cache_atlas, content_key, stamp, codec, encoded, length, palette) &&
+             thumbnail_atlas_alias(cache_atlas, path_key, stamp, content_key);
+    } else if (ok) {
+        ok = thumbnail_atlas_store(cache_atlas, path_key, stamp, codec, encoded, length, palette);
+    }
+    
+    free(encoded);
+    return ok;
+}
+
+void thumbnail_options_parse(const Config *config, ThumbnailCodec *codec, ThumbnailFilter *filter) {
+    if (!thumbnail_codec_parse(config->thumbnail_cache_format, codec)) {
+        fprintf(stderr, "Unknown thumbnail_cache_format '%s', using raw\n", config->thumbnail_cache_format);
+        *codec = THUMBNAIL_CODEC_RAW;
+    }
+    if (!thumbnail_filter_parse(config->thumbnail_filter, filter)) {
+        fprintf(stderr, "Unknown thumbnail_filter '%s', using box\n", config->thumbnail_filter);
+        *filter = THUMBNAIL_FILTER_BOX;
+    }
+}
+
+SDL_Surface* thumbnail_load_or_cache(const char *path, int width, int height, ThumbnailCodec codec,
+                                     ThumbnailFilter filter, ThumbnailPalette *palette) {
+    thumbnail_cache_open(width, height, codec);
+    
+    ThumbnailStamp stamp;
+    stamp_file(path, &stamp);
+    
+    ThumbnailPalette colors;
+    if (!palette) palette = &colors;
+    
+    // Try to load from cache
+    SDL_Surface *thumb = thumbnail_cache_load(path, &stamp, width, height, palette);
+    if (thumb) {
+        return thumb;
+    }
+    
+    // Carry over a thumbnail from the old per-image cache
+    thumb = thumbnail_cache_migrate(path, &stamp, width, height);
+    if (thumb) {
+        thumbnail_compute_palette(thumb, palette);
+        thumbnail_cache_store(path, &stamp, thumb, palette);
+        return thumb;
+    }
+
+    // Cache miss - load original and create thumbnail
+    SDL_Surface *original = thumbnail_decode(path, width, height);
+    if (!original) {
+        return NULL;
+    }
+    
+    thumb = thumbnail_scale(original, width, height, filter);
     SDL_DestroySurface(original);
+    
+    if (thumb) {
+        thumbnail_compute_palette(thumb, palette);
+        thumbnail_cache_store(path, &stamp, thumb, palette);
+    }
     return thumb;
 }
 
 void wallpaper_list_free(WallpaperList *list) {
     for (int i = 0; i < list->count; i++) {
-        free(list->items[i].path);
-        free(list->items[i].name);
-        if (list->items[i].thumb) {
-            SDL_DestroySurface(list->items[i].thumb);
+        if (list->thumbs[i].thumb) {
+            SDL_DestroySurface(list->thumbs[i].thumb);
         }
     }
-    free(list->items);
+    free(list->name_offsets);
+    free(list->prefixes);
+    free(list->stamps);
+    free(list->thumbs);
+    free(list->favorites);
+    free(list->strings);
+    free(list->prefix_offsets);
+    free(list->prefix_table);
+    search_free(&list->search);
     if (list->filtered_indices) {
         free(list->filtered_indices);
     }
 }
 
-void wallpaper_list_filter(WallpaperList *list, const char *query) {
-    strncpy(list->search_query, query, sizeof(list->search_query) - 1);
-    list->search_query[sizeof(list->search_query) - 1] = '\0';
+/* Path of a wallpaper relative to the configured directory it was found in */
+static const char* relative_path(const WallpaperList *list, int index, size_t dir_len,
+                                 char *buffer, size_t size) {
+    const char *subdir = prefix_string(list, (int)list->prefixes[index]) + dir_len;
+    if (*subdir == '\0') return wallpaper_list_name(list, index);
+    snprintf(buffer, size, "%s/%s", subdir + 1, wallpaper_list_name(list, index));
+    return buffer;
+}
+
+/* Configured directory a wallpaper was listed from */
+static int directory_of(const WallpaperList *list, int index) {
+    int lo = 0, hi = list->dir_count - 1;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (list->dir_ends[mid] <= index) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+/* What a query is matched against: the name, or the path below its configured directory */
+static const char* search_text(const void *data, int index, char *buffer, size_t size) {
+    const WallpaperList *list = data;
+    if (!list->search_paths) return wallpaper_list_name(list, index);
+    return relative_path(list, index, list->dir_lengths[directory_of(list, index)], buffer, size);
+}
+
+static bool view_matches(const WallpaperList *list, int index) {
+    if (list->show_favorites_only && !favorite_bit(list, index)) return false;
+    if (list->search_query[0] == '\0') return true;
     
-    if (list->filtered_indices) {
+    char buffer[4096];
+    return strcasestr(search_text(list, index, buffer, sizeof(buffer)), list->search_query) != NULL;
+}
+
+/* Whether the view is in rank order rather than list order */
+static bool view_ranked(const WallpaperList *list) {
+    return list->search_query[0] != '\0' && list->search.mode == SEARCH_FUZZY;
+}
+
+/* Build the view from scratch after the query, the favorites filter or the list changed */
+static void view_rebuild(WallpaperList *list) {
+    list->filter_active = list->search_query[0] != '\0' || list->show_favorites_only;
+    list->filtered_count = 0;
+    list->view_stale = false;
+    list->positions_stale = true;
+    if (!list->filter_active) {
         free(list->filtered_indices);
+        list->filtered_indices = NULL;
+        return;
     }
     
-    list->filtered_indices = malloc(sizeof(int) * list->count);
-    list->filtered_count = 0;
+    // Sized for the whole list so a favorite can always be added in place,
+    // and kept while the query is typed
+    if (!list->filtered_indices) {
+        list->filtered_indices = malloc(sizeof(int) * (list->capacity > 0 ? list->capacity : 1));
+    }
+    
+    if (list->search_query[0] != '\0') {
+        int count;
+        const int *matches = search_query(&list->search, search_text, list, list->count,
+                                          list->search_query, &count);
+        for (int i = 0; i < count; i++) {
+            if (!list->show_favorites_only || favorite_bit(list, matches[i])) {
+                list->filtered_indices[list->filtered_count++] = matches[i];
+            }
+        }
+        return;
+    }
     
     for (int i = 0; i < list->count; i++) {
-        bool name_matches = strcasestr(list->items[i].name, query) != NULL;
-        bool favorites_ok = !list->show_favorites_only || list->items[i].is_favorite;
-        
-        if (name_matches && favorites_ok) {
+        if (favorite_bit(list, i)) {
             list->filtered_indices[list->filtered_count++] = i;
         }
     }
 }
 
+/* Position of a wallpaper in the view, or where it would go */
+static int view_position(const WallpaperList *list, int index) {
+    int lo = 0, hi = list->filtered_count;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (list->filtered_indices[mid] < index) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+/*
+ * Add or drop one wallpaper after its favorite flag changed. A ranked view
+ * has no position to find by index, so it is marked for view_refresh().
+ */
+static void view_update(WallpaperList *list, int index) {
+    if (!list->filter_active) return;
+    list->positions_stale = true;
+    if (view_ranked(list)) {
+        list->view_stale = true;
+        return;
+    }
+    
+    int pos = view_position(list, index);
+    bool present = pos < list->filtered_count && list->filtered_indices[pos] == index;
+    bool wanted = view_matches(list, index);
+    if (wanted && !present) {
+        memmove(&list->filtered_indices[pos + 1], &list->filtered_indices[pos],
+                sizeof(int) * (list->filtered_count - pos));
+        list->filtered_indices[pos] = index;
+        list->filtered_count++;
+    } else if (!wanted && present) {
+        memmove(&list->filtered_indices[pos], &list->filtered_indices[pos + 1],
+                sizeof(int) * (list->filtered_count - pos - 1));
+        list->filtered_count--;
+    }
+}
+
+/* Rebuild a ranked view once after a batch of view_update() calls */
+static void view_refresh(WallpaperList *list) {
+    if (list->view_stale) view_rebuild(list);
+}
+
+void wallpaper_list_filter(WallpaperList *list, const char *query) {
+    if (query != list->search_query) {
+        strncpy(list->search_query, query, sizeof(list->search_query) - 1);
+        list->search_query[sizeof(list->search_query) - 1] = '\0';
+    }
+    view_rebuild(list);
+}
+
 void wallpaper_list_clear_filter(WallpaperList *list) {
     list->search_query[0] = '\0';
-    if (list->filtered_indices) {
-        free(list->filtered_indices);
-        list->filtered_indices = NULL;
-    }
-    list->filtered_count = 0;
+    view_rebuild(list);
 }
 
-Wallpaper* wallpaper_list_get(WallpaperList *list, int index) {
-    if (list->filtered_count > 0) {
+int wallpaper_list_get(const WallpaperList *list, int index) {
+    if (list->filter_active) {
         if (index >= 0 && index < list->filtered_count) {
-            return &list->items[list->filtered_indices[index]];
-        }
-    } else if (list->show_favorites_only) {
-        int fav_count = 0;
-        for (int i = 0; i < list->count; i++) {
-            if (list->items[i].is_favorite) {
-                if (fav_count == index) {
-                    return &list->items[i];
-                }
-                fav_count++;
-            }
-        }
-    } else {
-        if (index >= 0 && index < list->count) {
-            return &list->items[index];
+            return list->filtered_indices[index];
         }
+    } else if (index >= 0 && index < list->count) {
+        return index;
     }
-    return NULL;
+    return -1;
+}
+
+const char* wallpaper_list_name(const WallpaperList *list, int wallpaper) {
+    return list->strings + list->name_offsets[wallpaper];
+}
+
+const char* wallpaper_list_path(const WallpaperList *list, int wallpaper, char *buffer, size_t size) {
+    snprintf(buffer, size, "%s/%s", prefix_string(list, (int)list->prefixes[wallpaper]),
+             wallpaper_list_name(list, wallpaper));
+    return buffer;
+}
+
+SDL_Surface* wallpaper_list_thumb(const WallpaperList *list, int wallpaper) {
+    return list->thumbs[wallpaper].thumb;
+}
+
+uint64_t wallpaper_list_thumb_generation(const WallpaperList *list, int wallpaper) {
+    return list->thumbs[wallpaper].generation;
+}
+
+const ThumbnailPalette* wallpaper_list_palette(const WallpaperList *list, int wallpaper) {
+    const ThumbnailPalette *palette = &list->thumbs[wallpaper].palette;
+    return thumbnail_palette_known(palette) ? palette : NULL;
+}
+
+bool wallpaper_list_is_favorite(const WallpaperList *list, int wallpaper) {
+    return favorite_bit(list, wallpaper);
 }
 
 int wallpaper_list_visible_count(const WallpaperList *list) {
-    if (list->filtered_count > 0) {
-        return list->filtered_count;
-    }
-    
-    if (list->show_favorites_only) {
-        int count = 0;
-        for (int i = 0; i < list->count; i++) {
-            if (list->items[i].is_favorite) count++;
-        }
-        return count;
-    }
-    
-    return list->count;
+    return list->filter_active ? list->filtered_count : list->count;
 }
 
 static void get_favorites_path(char *buffer, size_t size) {
@@ -280,118 +1344,585 @@ static void get_favorites_path(char *buffer, size_t size) {
     }
 }
 
+/* The favorites store, opened on first use */
+static FavoritesStore* get_favorites(void) {
+    if (!favorites_store) {
+        char path[512];
+        get_favorites_path(path, sizeof(path));
+        favorites_store = favorites_open(path, 0);
+    }
+    return favorites_store;
+}
+
+void wallpaper_favorites_close(void) {
+    favorites_close(favorites_store);
+    favorites_store = NULL;
+}
+
 void wallpaper_toggle_favorite(WallpaperList *list, int index) {
-    Wallpaper *wp = wallpaper_list_get(list, index);
-    if (wp) {
-        wp->is_favorite = !wp->is_favorite;
-        wallpaper_list_save_favorites(list);
-        printf("%s %s\n", wp->is_favorite ? "Added to favorites:" : "Removed from favorites:", wp->name);
+    int wallpaper = wallpaper_list_get(list, index);
+    if (wallpaper >= 0) {
+        bool favorite = !favorite_bit(list, wallpaper);
+        set_favorite_bit(list, wallpaper, favorite);
+        view_update(list, wallpaper);
+        view_refresh(list);
+        
+        // Queued for the writer thread; the frame never waits on the disk
+        FavoritesStore *store = get_favorites();
+        if (store) {
+            const char *dir = prefix_string(list, (int)list->prefixes[wallpaper]);
+            favorites_set(store, dir, strlen(dir), wallpaper_list_name(list, wallpaper), favorite);
+        }
+        printf("%s %s\n", favorite ? "Added to favorites:" : "Removed from favorites:",
+               wallpaper_list_name(list, wallpaper));
     }
 }
 
 void wallpaper_list_toggle_favorites_filter(WallpaperList *list) {
     list->show_favorites_only = !list->show_favorites_only;
+    view_rebuild(list);
+}
+
+void wallpaper_list_load_favorites(WallpaperList *list) {
+    FavoritesStore *store = get_favorites();
+    if (!store || favorites_count(store) == 0) return;
     
-    // Rebuild filter
-    if (list->show_favorites_only || strlen(list->search_query) > 0) {
-        if (list->filtered_indices) {
-            free(list->filtered_indices);
+    // One hash lookup per wallpaper, however many favorites there are
+    for (int i = 0; i < list->count; i++) {
+        const char *dir = prefix_string(list, (int)list->prefixes[i]);
+        if (favorites_contains(store, dir, strlen(dir), wallpaper_list_name(list, i))) {
+            set_favorite_bit(list, i, true);
+            view_update(list, i);
+        }
+    }
+    view_refresh(list);
+}
+
+struct WallpaperRescan {
+    SDL_Thread *thread;
+    SDL_AtomicInt cancelled;
+    Config config;
+    int dir_count;
+    const char *dirs[MAX_WALLPAPER_DIRS + 1];
+    char index_paths[MAX_WALLPAPER_DIRS + 1][1024];
+};
+
+static Uint32 rescan_event_type = 0;
+
+Uint32 wallpaper_rescan_event(void) {
+    if (rescan_event_type == 0) {
+        rescan_event_type = SDL_RegisterEvents(1);
+    }
+    return rescan_event_type;
+}
+
+/* Whether two listings recorded the same subdirectories with the same mtimes */
+static bool same_subdirs(const ScanDirectory *a, const ScanDirectory *b) {
+    if (a->subdir_count != b->subdir_count) return false;
+    for (int i = 0; i < a->subdir_count; i++) {
+        if (strcmp(a->subdirs[i].name, b->subdirs[i].name) != 0 ||
+            a->subdirs[i].mtime_ns != b->subdirs[i].mtime_ns ||
+            a->subdirs[i].inode != b->subdirs[i].inode) {
+            return false;
         }
+    }
+    return true;
+}
+
+static bool rescan_cancelled(void *data) {
+    WallpaperRescan *rescan = data;
+    return SDL_GetAtomicInt(&rescan->cancelled) != 0;
+}
+
+static int rescan_main(void *data) {
+    WallpaperRescan *rescan = data;
+    bool changed = false;
+    
+    const char *excludes[MAX_EXCLUDES];
+    DirWalkOptions options = wallpaper_walk_options(&rescan->config, excludes);
+    options.cancelled = rescan_cancelled;
+    options.cancel_data = rescan;
+    uint64_t options_hash = walk_options_hash(&options);
+    
+    ScanDirectory fresh[MAX_WALLPAPER_DIRS + 1];
+    bool opened[MAX_WALLPAPER_DIRS + 1];
+    dir_walk(rescan->dirs, rescan->dir_count, &options, fresh, opened);
+    
+    for (int i = 0; i < rescan->dir_count; i++) {
+        if (!opened[i] || SDL_GetAtomicInt(&rescan->cancelled)) {
+            scan_directory_free(&fresh[i]);
+            continue;
+        }
+        finish_listing(&fresh[i], options_hash, rescan->config.search_index);
         
-        list->filtered_indices = malloc(sizeof(int) * list->count);
-        list->filtered_count = 0;
+        ScanDirectory saved;
+        bool have_index = scan_index_load(rescan->index_paths[i], &saved);
+        bool differs = !have_index || !scan_directory_equal(&fresh[i], &saved);
+        if (differs || saved.dir_mtime_ns != fresh[i].dir_mtime_ns ||
+            saved.options_hash != options_hash || !same_subdirs(&fresh[i], &saved) ||
+            saved.trigrams.posting_count != fresh[i].trigrams.posting_count) {
+            scan_index_save(rescan->index_paths[i], &fresh[i]);
+        }
+        changed = changed || differs;
         
+        scan_directory_free(&fresh[i]);
+        scan_directory_free(&saved);
+    }
+    
+    if (changed && !SDL_GetAtomicInt(&rescan->cancelled)) {
+        SDL_Event event;
+        SDL_zero(event);
+        event.type = rescan_event_type;
+        SDL_PushEvent(&event);
+    }
+    return 0;
+}
+
+WallpaperRescan* wallpaper_rescan_start(const Config *config) {
+    if (wallpaper_rescan_event() == 0) return NULL;
+    
+    WallpaperRescan *rescan = calloc(1, sizeof(WallpaperRescan));
+    if (!rescan) return NULL;
+    
+    // Paths are worked out here; the cache directory lookup is not thread-safe
+    rescan->config = *config;
+    rescan->dir_count = 1 + config->wallpaper_dirs_count;
+    for (int i = 0; i < rescan->dir_count; i++) {
+        rescan->dirs[i] = i == 0 ? rescan->config.wallpaper_dir : rescan->config.wallpaper_dirs[i - 1];
+        get_scan_index_path(rescan->dirs[i], rescan->index_paths[i], sizeof(rescan->index_paths[i]));
+    }
+    
+    rescan->thread = SDL_CreateThread(rescan_main, "wallpaper-rescan", rescan);
+    if (!rescan->thread) {
+        fprintf(stderr, "Failed to start wallpaper rescan: %s\n", SDL_GetError());
+        wallpaper_rescan_finish(rescan);
+        return NULL;
+    }
+    return rescan;
+}
+
+void wallpaper_rescan_finish(WallpaperRescan *rescan) {
+    if (!rescan) return;
+    
+    SDL_SetAtomicInt(&rescan->cancelled, 1);
+    if (rescan->thread) SDL_WaitThread(rescan->thread, NULL);
+    free(rescan);
+}
+
+void wallpaper_list_reload(WallpaperList *list, ThumbnailPipeline *pipeline, const Config *config) {
+    WallpaperList fresh = wallpaper_list_scan_multiple(config);
+    fresh.thumb_budget = list->thumb_budget;
+    fresh.show_favorites_only = list->show_favorites_only;
+    
+    // Hash the old paths so unchanged thumbnails and pending jobs can be found in one pass
+    int slots = 64;
+    while (slots < list->count * 2) slots *= 2;
+    int *table = malloc(sizeof(int) * slots);
+    int *map = malloc(sizeof(int) * (list->count > 0 ? list->count : 1));
+    if (table && map) {
+        char path[4096], old_path[4096];
+        for (int i = 0; i < slots; i++) table[i] = -1;
         for (int i = 0; i < list->count; i++) {
-            bool name_matches = strlen(list->search_query) == 0 || 
-                                strcasestr(list->items[i].name, list->search_query) != NULL;
-            bool favorites_ok = !list->show_favorites_only || list->items[i].is_favorite;
-            
-            if (name_matches && favorites_ok) {
-                list->filtered_indices[list->filtered_count++] = i;
+            map[i] = -1;
+            ThumbnailState state = list->thumbs[i].state;
+            if (state != THUMB_STATE_LOADED && state != THUMB_STATE_PENDING) continue;
+            wallpaper_list_path(list, i, path, sizeof(path));
+            int slot = (int)(hash_xxh64(path, strlen(path), 0) & (uint64_t)(slots - 1));
+            while (table[slot] >= 0) slot = (slot + 1) & (slots - 1);
+            table[slot] = i;
+        }
+        
+        for (int i = 0; i < fresh.count; i++) {
+            wallpaper_list_path(&fresh, i, path, sizeof(path));
+            int slot = (int)(hash_xxh64(path, strlen(path), 0) & (uint64_t)(slots - 1));
+            for (; table[slot] >= 0; slot = (slot + 1) & (slots - 1)) {
+                int old = table[slot];
+                if (strcmp(wallpaper_list_path(list, old, old_path, sizeof(old_path)), path) != 0) continue;
+                
+                if (memcmp(&list->stamps[old], &fresh.stamps[i], sizeof(fresh.stamps[i])) != 0) break;
+                if (list->thumbs[old].state == THUMB_STATE_PENDING) {
+                    fresh.thumbs[i].state = THUMB_STATE_PENDING;
+                    map[old] = i;
+                } else {
+                    thumbnail_attach(&fresh, i, list->thumbs[old].thumb, &list->thumbs[old].palette);
+                    fresh.thumbs[i].generation = list->thumbs[old].generation;  // Same surface
+                    lru_unlink(list, old);
+                    list->thumbs[old].thumb = NULL;
+                    list->thumbs[old].state = THUMB_STATE_NONE;
+                }
+                break;
             }
         }
-    } else {
-        wallpaper_list_clear_filter(list);
     }
+    
+    // Jobs still wanted follow their file; the rest are dropped
+    if (pipeline) thumbnail_pipeline_renumber(pipeline, table ? map : NULL, table ? list->count : 0);
+    free(table);
+    free(map);
+    
+    memcpy(fresh.search_query, list->search_query, sizeof(fresh.search_query));
+    view_rebuild(&fresh);
+    
+    wallpaper_list_free(list);
+    *list = fresh;
 }
 
-void wallpaper_list_load_favorites(WallpaperList *list) {
-    char path[512];
-    get_favorites_path(path, sizeof(path));
+/* Configured directory a watcher change refers to */
+static const char* configured_dir(const Config *config, int dir) {
+    return dir == 0 ? config->wallpaper_dir : config->wallpaper_dirs[dir - 1];
+}
+
+/**
+ * @brief Binary search a directory's items by path relative to it
+ * @return Index of the item, or where it would be inserted if not found
+ */
+static int find_in_directory(const WallpaperList *list, int dir, size_t dir_len,
+                             const char *rel, bool *found) {
+    int lo = dir > 0 ? list->dir_ends[dir - 1] : 0;
+    int hi = list->dir_ends[dir];
+    char buffer[4096];
+    *found = false;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        int cmp = strcmp(relative_path(list, mid, dir_len, buffer, sizeof(buffer)), rel);
+        if (cmp == 0) {
+            *found = true;
+            return mid;
+        }
+        if (cmp < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+/* What a batch of changes does to a wallpaper already in the list */
+enum {
+    CHANGE_REMOVED = 1,    /* Dropped from the list */
+    CHANGE_REWRITTEN = 2   /* Kept, with a new stamp and no thumbnail */
+};
+
+/**
+ * @brief A file a batch of changes adds to the list
+ */
+typedef struct {
+    int dir;               /**< Configured directory it was found in */
+    const char *rel;       /**< Path relative to that directory, owned by the change */
+    ThumbnailStamp stamp;
+    int position;          /**< Index of the wallpaper it goes before */
+    bool dropped;          /**< Removed again later in the batch */
+} PendingInsert;
+
+/* Slot of a file in the pending-insert table, or the empty slot it would take */
+static int pending_slot(const int *table, int mask, const PendingInsert *pending, int dir, const char *rel) {
+    int slot = (int)(hash_xxh64(rel, strlen(rel), (uint64_t)dir) & (uint64_t)mask);
+    for (; table[slot] >= 0; slot = (slot + 1) & mask) {
+        const PendingInsert *insert = &pending[table[slot]];
+        if (insert->dir == dir && strcmp(insert->rel, rel) == 0) break;
+    }
+    return slot;
+}
+
+/* Listing order: by configured directory, then by relative path */
+static int compare_pending(const void *a, const void *b) {
+    const PendingInsert *x = a, *y = b;
+    if (x->dir != y->dir) return x->dir < y->dir ? -1 : 1;
+    return strcmp(x->rel, y->rel);
+}
+
+/**
+ * @brief Drop removed wallpapers and insert new ones in a single pass
+ *
+ * The arrays are built afresh, and LRU links, the view and directory ends
+ * are renumbered through the old-to-new index map, so the cost is one pass
+ * over the list however many changes the batch holds.
+ *
+ * @param fate CHANGE_ flags of each wallpaper in the list
+ * @param inserts New files in listing order
+ * @param insert_count Number of new files
+ * @param map Receives the new index of each wallpaper, -1 if removed
+ */
+static void merge_changes(WallpaperList *list, const Config *config, const uint8_t *fate,
+                          const PendingInsert *inserts, int insert_count, int *map) {
+    int upper = list->count + insert_count;
+    for (int i = 0; i < list->count; i++) {
+        if (!(fate[i] & CHANGE_REMOVED)) continue;
+        thumbnail_release(list, i);
+        list->strings_dead += strlen(wallpaper_list_name(list, i)) + 1;
+        upper--;
+    }
     
-    FILE *f = fopen(path, "r");
-    if (!f) return;
+    int capacity = list->capacity > 0 ? list->capacity : 32;
+    while (capacity < upper) capacity *= 2;
+    uint32_t *name_offsets = malloc(sizeof(uint32_t) * capacity);
+    uint32_t *prefixes = malloc(sizeof(uint32_t) * capacity);
+    ThumbnailStamp *stamps = malloc(sizeof(ThumbnailStamp) * capacity);
+    ThumbnailSlot *thumbs = malloc(sizeof(ThumbnailSlot) * capacity);
+    uint64_t *favorites = calloc(((size_t)capacity + 63) / 64, sizeof(uint64_t));
+    int *added = malloc(sizeof(int) * (insert_count > 0 ? insert_count : 1));
+    int added_count = 0;
     
-    char line[1024];
-    while (fgets(line, sizeof(line), f)) {
-        // Remove newline
-        line[strcspn(line, "\n")] = 0;
-        
-        // Find matching wallpaper
-        for (int i = 0; i < list->count; i++) {
-            if (strcmp(list->items[i].path, line) == 0) {
-                list->items[i].is_favorite = true;
-                break;
+    FavoritesStore *store = get_favorites();
+    int ends[MAX_WALLPAPER_DIRS + 1] = {0};
+    int n = 0;
+    int next = 0;
+    int dir = 0;
+    for (int i = 0; i <= list->count; i++) {
+        // New files go in ahead of the wallpaper they sort before
+        for (; next < insert_count && inserts[next].position == i; next++) {
+            const PendingInsert *insert = &inserts[next];
+            char subdir[4096];
+            const char *dir_path = configured_dir(config, insert->dir);
+            const char *name = insert->rel;
+            const char *slash = strrchr(insert->rel, '/');
+            int len = (int)strlen(dir_path);
+            if (slash) {
+                len = snprintf(subdir, sizeof(subdir), "%s/%.*s", dir_path, (int)(slash - insert->rel), insert->rel);
+                if (len < 0 || (size_t)len >= sizeof(subdir)) continue;
+                dir_path = subdir;
+                name = slash + 1;
+            }
+    
+            name_offsets[n] = arena_add(list, name, strlen(name));
+            prefixes[n] = (uint32_t)find_prefix(list, dir_path, (size_t)len, true);
+            stamps[n] = insert->stamp;
+            memset(&thumbs[n], 0, sizeof(thumbs[n]));
+            thumbs[n].lru_prev = thumbs[n].lru_next = -1;
+            thumbs[n].state = THUMB_STATE_NONE;
+            if (store && favorites_contains(store, dir_path, (size_t)len, name)) {
+                favorites[n >> 6] |= 1ULL << (n & 63);
+            }
+            ends[insert->dir] = n + 1;
+            added[added_count++] = n++;
+        }
+        if (i == list->count) break;
+    
+        while (dir < list->dir_count && i >= list->dir_ends[dir]) dir++;
+        if (fate[i] & CHANGE_REMOVED) {
+            map[i] = -1;
+            continue;
+        }
+        name_offsets[n] = list->name_offsets[i];
+        prefixes[n] = list->prefixes[i];
+        stamps[n] = list->stamps[i];
+        thumbs[n] = list->thumbs[i];
+        if (favorite_bit(list, i)) favorites[n >> 6] |= 1ULL << (n & 63);
+        ends[dir] = n + 1;
+        map[i] = n++;
+    }
+    
+    free(list->name_offsets);
+    free(list->prefixes);
+    free(list->stamps);
+    free(list->thumbs);
+    free(list->favorites);
+    list->name_offsets = name_offsets;
+    list->prefixes = prefixes;
+    list->stamps = stamps;
+    list->thumbs = thumbs;
+    list->favorites = favorites;
+    if (list->filtered_indices && capacity > list->capacity) {
+        list->filtered_indices = realloc(list->filtered_indices, sizeof(int) * capacity);
+    }
+    list->capacity = capacity;
+    list->count = n;
+    list->positions_stale = true;
+    search_invalidate(&list->search);
+    
+    // An empty directory ends where the one before it does
+    for (int d = 0; d < list->dir_count; d++) {
+        if (d > 0 && ends[d] < ends[d - 1]) ends[d] = ends[d - 1];
+        list->dir_ends[d] = ends[d];
+    }
+    
+    // Removed wallpapers were released, so only kept ones are linked
+    for (int i = 0; i < n; i++) {
+        ThumbnailSlot *slot = &list->thumbs[i];
+        if (slot->lru_prev >= 0) slot->lru_prev = map[slot->lru_prev];
+        if (slot->lru_next >= 0) slot->lru_next = map[slot->lru_next];
+    }
+    if (list->thumb_lru_head >= 0) list->thumb_lru_head = map[list->thumb_lru_head];
+    if (list->thumb_lru_tail >= 0) list->thumb_lru_tail = map[list->thumb_lru_tail];
+    
+    if (list->filter_active) {
+        int kept = 0;
+        for (int i = 0; i < list->filtered_count; i++) {
+            int index = map[list->filtered_indices[i]];
+            if (index >= 0) list->filtered_indices[kept++] = index;
+        }
+    
+        if (view_ranked(list)) {
+            // New files have no rank to go in at; view_refresh() runs the query again
+            list->view_stale = list->view_stale || added_count > 0;
+            list->filtered_count = kept;
+        } else {
+            // Both are in list order: merge the new matches in from the back
+            int matches = 0;
+            for (int a = 0; a < added_count; a++) {
+                if (view_matches(list, added[a])) added[matches++] = added[a];
+            }
+            int out = kept + matches;
+            int f = kept - 1;
+            for (int a = matches - 1; a >= 0; ) {
+                if (f >= 0 && list->filtered_indices[f] > added[a]) list->filtered_indices[--out] = list->filtered_indices[f--];
+                else list->filtered_indices[--out] = added[a--];
             }
+            list->filtered_count = kept + matches;
         }
     }
+    free(added);
     
-    fclose(f);
+    if (list->strings_dead > list->strings_size / 2) arena_compact(list);
 }
 
-void wallpaper_list_save_favorites(const WallpaperList *list) {
-    char path[512];
-    get_favorites_path(path, sizeof(path));
+bool wallpaper_list_apply_changes(WallpaperList *list, ThumbnailPipeline *pipeline, const Config *config,
+                                  const LibraryChange *changes, int count) {
+    int table_size = 16;
+    while (table_size < count * 2) table_size *= 2;
+    uint8_t *fate = calloc(list->count > 0 ? list->count : 1, 1);
+    PendingInsert *pending = malloc(sizeof(PendingInsert) * (count > 0 ? count : 1));
+    int *table = malloc(sizeof(int) * table_size);
+    int *map = malloc(sizeof(int) * (list->count > 0 ? list->count : 1));
+    if (!fate || !pending || !table || !map) {
+        free(fate);
+        free(pending);
+        free(table);
+        free(map);
+        return false;
+    }
+    for (int i = 0; i < table_size; i++) table[i] = -1;
+    for (int i = 0; i < list->count; i++) map[i] = i;
     
-    FILE *f = fopen(path, "w");
-    if (!f) {
-        fprintf(stderr, "Failed to save favorites to %s\n", path);
-        return;
+    // Work out, in order, what the batch does to each file against the list
+    // as it stands, so a file added and removed again is never inserted
+    bool changed = false;
+    int pending_count = 0;
+    for (int c = 0; c < count; c++) {
+        const LibraryChange *change = &changes[c];
+        if (change->dir < 0 || change->dir >= list->dir_count) continue;
+    
+        size_t dir_len = strlen(configured_dir(config, change->dir));
+        bool found;
+        int index = find_in_directory(list, change->dir, dir_len, change->rel, &found);
+        int slot;
+    
+        switch (change->kind) {
+            case LIBRARY_CHANGE_ADDED:
+                if (found) {
+                    fate[index] &= ~CHANGE_REMOVED;
+                    if (memcmp(&list->stamps[index], &change->stamp, sizeof(change->stamp)) != 0) {
+                        // Rewritten in place: the thumbnail is regenerated on demand
+                        thumbnail_release(list, index);
+                        list->stamps[index] = change->stamp;
+                        fate[index] |= CHANGE_REWRITTEN;
+                        changed = true;
+                    }
+                    break;
+                }
+    
+                slot = pending_slot(table, table_size - 1, pending, change->dir, change->rel);
+                if (table[slot] < 0) {
+                    table[slot] = pending_count;
+                    pending[pending_count].dir = change->dir;
+                    pending[pending_count].rel = change->rel;
+                    pending[pending_count].position = index;
+                    pending_count++;
+                }
+                pending[table[slot]].stamp = change->stamp;
+                pending[table[slot]].dropped = false;
+                break;
+    
+            case LIBRARY_CHANGE_REMOVED:
+                if (found) fate[index] |= CHANGE_REMOVED;
+                slot = pending_slot(table, table_size - 1, pending, change->dir, change->rel);
+                if (table[slot] >= 0) pending[table[slot]].dropped = true;
+                break;
+    
+            case LIBRARY_CHANGE_REMOVED_DIR: {
+                // Everything under "rel/" sorts together; "" is the whole directory
+                char prefix[4096];
+                snprintf(prefix, sizeof(prefix), "%s%s", change->rel, change->rel[0] ? "/" : "");
+                size_t prefix_len = strlen(prefix);
+                index = find_in_directory(list, change->dir, dir_len, prefix, &found);
+    
+                int end = list->dir_ends[change->dir];
+                char rel[4096];
+                for (; index < end && strncmp(relative_path(list, index, dir_len, rel, sizeof(rel)),
+                                              prefix, prefix_len) == 0; index++) {
+                    fate[index] |= CHANGE_REMOVED;
+                }
+                for (int i = 0; i < pending_count; i++) {
+                    if (pending[i].dir == change->dir && strncmp(pending[i].rel, prefix, prefix_len) == 0) {
+                        pending[i].dropped = true;
+                    }
+                }
+                break;
+            }
+    
+            case LIBRARY_CHANGE_RESCAN:
+                break;
+        }
     }
     
-    for (int i = 0; i < list->count; i++) {
-        if (list->items[i].is_favorite) {
-            fprintf(f, "%s\n", list->items[i].path);
+    int inserts = 0;
+    for (int i = 0; i < pending_count; i++) {
+        if (!pending[i].dropped) pending[inserts++] = pending[i];
+    }
+    bool removed = false;
+    for (int i = 0; i < list->count && !removed; i++) {
+        removed = (fate[i] & CHANGE_REMOVED) != 0;
+    }
+    int old_count = list->count;
+    if (inserts > 0 || removed) {
+        qsort(pending, inserts, sizeof(PendingInsert), compare_pending);
+        merge_changes(list, config, fate, pending, inserts, map);
+        changed = true;
+    }
+    
+    // Jobs follow their wallpaper; those of removed or rewritten files are dropped
+    if (pipeline && changed) {
+        for (int i = 0; i < old_count; i++) {
+            if (fate[i] & CHANGE_REWRITTEN) map[i] = -1;
         }
+        thumbnail_pipeline_renumber(pipeline, map, old_count);
     }
     
-    fclose(f);
+    free(fate);
+    free(pending);
+    free(table);
+    free(map);
+    view_refresh(list);
+    return changed;
 }
 
 WallpaperList wallpaper_list_scan_multiple(const Config *config) {
-    WallpaperList list = wallpaper_list_scan(config->wallpaper_dir);
+    WallpaperList list = wallpaper_list_new();
     
-    // Scan additional directories
+    const char *dirs[MAX_WALLPAPER_DIRS + 1];
+    int count = 0;
+    dirs[count++] = config->wallpaper_dir;
     for (int i = 0; i < config->wallpaper_dirs_count; i++) {
-        DIR *d = opendir(config->wallpaper_dirs[i]);
-        if (!d) {
-            fprintf(stderr, "Warning: Failed to open directory: %s\n", config->wallpaper_dirs[i]);
-            continue;
-        }
-        
-        struct dirent *entry;
-        while ((entry = readdir(d)) != NULL) {
-            if (!is_image_file(entry->d_name)) continue;
-            
-            // Expand capacity if needed
-            if (list.count >= list.capacity) {
-                list.capacity *= 2;
-                list.items = realloc(list.items, sizeof(Wallpaper) * list.capacity);
-            }
-            
-            Wallpaper *wp = &list.items[list.count++];
-            
-            // Full path
-            wp->path = malloc(strlen(config->wallpaper_dirs[i]) + strlen(entry->d_name) + 2);
-            sprintf(wp->path, "%s/%s", config->wallpaper_dirs[i], entry->d_name);
-            
-            // Filename only
-            wp->name = strdup(entry->d_name);
-            wp->thumb = NULL;
-            wp->is_favorite = false;
-        }
-        
-        closedir(d);
+        dirs[count++] = config->wallpaper_dirs[i];
+    }
+    
+    // All directories are listed at once, so separate disks are read in parallel
+    const char *excludes[MAX_EXCLUDES];
+    DirWalkOptions options = wallpaper_walk_options(config, excludes);
+    bool opened[MAX_WALLPAPER_DIRS + 1];
+    list.search_paths = config->search_index;
+    SearchMode mode;
+    if (!search_mode_parse(config->search_mode, &mode)) {
+        fprintf(stderr, "Unknown search_mode '%s', using substring\n", config->search_mode);
+        mode = SEARCH_SUBSTRING;
+    }
+    search_set_mode(&list.search, mode);
+    thumbnail_options_parse(config, &list.thumb_codec, &list.thumb_filter);
+    scan_into(&list, dirs, count, &options, opened);
+    
+    if (!opened[0]) {
+        fprintf(stderr, "Failed to open directory: %s\n", dirs[0]);
+    }
+    for (int i = 1; i < count; i++) {
+        if (!opened[i]) fprintf(stderr, "Warning: Failed to open directory: %s\n", dirs[i]);
     }
     
     // Load favorites for all wallpapers
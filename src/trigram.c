@@ -0,0 +1,308 @@
+/**
+ * @file trigram.c
+ * @brief Trigram inverted index for substring search
+ *
+ * Built in two passes over the texts: the first numbers the distinct
+ * trigrams through a paged lookup table and counts the texts holding each,
+ * the second writes every text into its trigrams' lists, sized exactly by
+ * the counts. Real names share few distinct trigrams, so the table stays
+ * small and no (trigram, text) pairs are ever stored or sorted.
+ */
+
+#include "trigram.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_QUERY_TRIGRAMS 256
+
+static unsigned char fold(unsigned char c) {
+    return (c >= 'A' && c <= 'Z') ? (unsigned char)(c - 'A' + 'a') : c;
+}
+
+static uint32_t trigram_at(const char *p) {
+    return (uint32_t)fold((unsigned char)p[0]) << 16 |
+           (uint32_t)fold((unsigned char)p[1]) << 8 |
+           (uint32_t)fold((unsigned char)p[2]);
+}
+
+void trigram_index_init(TrigramIndex *index) {
+    memset(index, 0, sizeof(*index));
+}
+
+void trigram_index_free(TrigramIndex *index) {
+    free(index->keys);
+    free(index->starts);
+    free(index->postings);
+    trigram_index_init(index);
+}
+
+#define TABLE_PAGE_BITS 12
+#define TABLE_PAGES (1 << (24 - TABLE_PAGE_BITS))
+#define TABLE_PAGE_MASK ((1u << TABLE_PAGE_BITS) - 1)
+
+/*
+ * Dense numbering of the distinct trigrams met while building. Direct
+ * lookup through pages of the 24-bit key space, allocated as trigrams
+ * appear; text uses few leading bytes, so only a few pages ever exist.
+ */
+typedef struct {
+    uint32_t *pages[TABLE_PAGES]; /* Number + 1 of each trigram, 0 if not met */
+    uint32_t *keys;           /* Trigram of each number */
+    uint32_t *counts;         /* Texts containing it */
+    int32_t *last;            /* Last text seen with it, so a repeat counts once */
+    uint32_t count;           /* Numbers handed out */
+    uint32_t capacity;        /* Numbers allocated */
+} TrigramTable;
+
+static bool table_grow(TrigramTable *table) {
+    uint32_t capacity = table->capacity > 0 ? table->capacity * 2 : 1024;
+    uint32_t *keys = realloc(table->keys, sizeof(uint32_t) * capacity);
+    if (keys) table->keys = keys;
+    uint32_t *counts = realloc(table->counts, sizeof(uint32_t) * capacity);
+    if (counts) table->counts = counts;
+    int32_t *last = realloc(table->last, sizeof(int32_t) * capacity);
+    if (last) table->last = last;
+    if (!keys || !counts || !last) return false;
+    table->capacity = capacity;
+    return true;
+}
+
+/* Hand out the next number to a trigram not met before; UINT32_MAX if out of memory */
+static uint32_t table_add(TrigramTable *table, uint32_t key) {
+    uint32_t **page = &table->pages[key >> TABLE_PAGE_BITS];
+    if (!*page) {
+        *page = calloc(TABLE_PAGE_MASK + 1, sizeof(uint32_t));
+        if (!*page) return UINT32_MAX;
+    }
+    if (table->count == table->capacity && !table_grow(table)) return UINT32_MAX;
+
+    uint32_t number = table->count++;
+    (*page)[key & TABLE_PAGE_MASK] = number + 1;
+    table->keys[number] = key;
+    table->counts[number] = 0;
+    table->last[number] = -1;
+    return number;
+}
+
+static inline uint32_t table_number(TrigramTable *table, uint32_t key) {
+    const uint32_t *page = table->pages[key >> TABLE_PAGE_BITS];
+    if (page && page[key & TABLE_PAGE_MASK]) return page[key & TABLE_PAGE_MASK] - 1;
+    return table_add(table, key);
+}
+
+static void table_free(TrigramTable *table) {
+    for (int i = 0; i < TABLE_PAGES; i++) {
+        free(table->pages[i]);
+    }
+    free(table->keys);
+    free(table->counts);
+    free(table->last);
+    free(table);
+}
+
+/* Orders (trigram << 32 | number) pairs, so by trigram */
+static int compare_pairs(const void *a, const void *b) {
+    uint64_t pa = *(const uint64_t*)a;
+    uint64_t pb = *(const uint64_t*)b;
+    return (pa > pb) - (pa < pb);
+}
+
+bool trigram_index_build(TrigramIndex *index, const char *const *texts, int count) {
+    trigram_index_free(index);
+
+    TrigramTable *table = calloc(1, sizeof(TrigramTable));
+    if (!table) return false;
+
+    // Count the texts containing each trigram
+    bool ok = table_grow(table);
+    for (int i = 0; ok && i < count; i++) {
+        const char *text = texts[i];
+        size_t len = strlen(text);
+        for (size_t j = 0; j + 3 <= len; j++) {
+            uint32_t number = table_number(table, trigram_at(text + j));
+            if (number == UINT32_MAX) {
+                ok = false;
+                break;
+            }
+            if (table->last[number] != i) {
+                table->last[number] = i;
+                table->counts[number]++;
+                index->posting_count++;
+            }
+        }
+    }
+
+    uint32_t numbers = table->count > 0 ? table->count : 1;
+    uint64_t *order = ok ? malloc(sizeof(uint64_t) * numbers) : NULL;
+    uint32_t *positions = ok ? malloc(sizeof(uint32_t) * numbers) : NULL;
+    index->keys = malloc(sizeof(uint32_t) * numbers);
+    index->starts = malloc(sizeof(uint32_t) * (table->count + 1));
+    index->postings = malloc(sizeof(uint32_t) * (index->posting_count > 0 ? index->posting_count : 1));
+    if (!ok || !order || !positions || !index->keys || !index->starts || !index->postings) {
+        free(order);
+        free(positions);
+        table_free(table);
+        trigram_index_free(index);
+        return false;
+    }
+
+    // Lay the posting lists out in key order
+    for (uint32_t number = 0; number < table->count; number++) {
+        order[number] = (uint64_t)table->keys[number] << 32 | number;
+    }
+    qsort(order, table->count, sizeof(uint64_t), compare_pairs);
+
+    uint32_t position = 0;
+    for (uint32_t k = 0; k < table->count; k++) {
+        uint32_t number = (uint32_t)order[k];
+        index->keys[k] = table->keys[number];
+        index->starts[k] = position;
+        positions[number] = position;
+        position += table->counts[number];
+        table->last[number] = -1;
+    }
+    index->starts[table->count] = position;
+    index->key_count = table->count;
+
+    // Texts are visited in order, so each list comes out ascending
+    for (int i = 0; i < count; i++) {
+        const char *text = texts[i];
+        size_t len = strlen(text);
+        for (size_t j = 0; j + 3 <= len; j++) {
+            uint32_t number = table_number(table, trigram_at(text + j));
+            if (table->last[number] != i) {
+                table->last[number] = i;
+                index->postings[positions[number]++] = (uint32_t)i;
+            }
+        }
+    }
+
+    free(order);
+    free(positions);
+    table_free(table);
+    return true;
+}
+
+bool trigram_index_append(TrigramIndex *index, const TrigramIndex *other, uint32_t offset) {
+    if (other->key_count == 0) return true;
+
+    uint32_t key_capacity = index->key_count + other->key_count;
+    uint32_t posting_count = index->posting_count + other->posting_count;
+    uint32_t *keys = malloc(sizeof(uint32_t) * key_capacity);
+    uint32_t *starts = malloc(sizeof(uint32_t) * (key_capacity + 1));
+    uint32_t *postings = malloc(sizeof(uint32_t) * posting_count);
+    if (!keys || !starts || !postings) {
+        free(keys);
+        free(starts);
+        free(postings);
+        return false;
+    }
+
+    // Merge the key lists; a shared trigram takes this index's texts, then the other's
+    uint32_t a = 0, b = 0, k = 0, p = 0;
+    while (a < index->key_count || b < other->key_count) {
+        bool take_a = a < index->key_count && (b >= other->key_count || index->keys[a] <= other->keys[b]);
+        bool take_b = b < other->key_count && (a >= index->key_count || other->keys[b] <= index->keys[a]);
+
+        keys[k] = take_a ? index->keys[a] : other->keys[b];
+        starts[k++] = p;
+        if (take_a) {
+            for (uint32_t i = index->starts[a]; i < index->starts[a + 1]; i++) {
+                postings[p++] = index->postings[i];
+            }
+            a++;
+        }
+        if (take_b) {
+            for (uint32_t i = other->starts[b]; i < other->starts[b + 1]; i++) {
+                postings[p++] = other->postings[i] + offset;
+            }
+            b++;
+        }
+    }
+    starts[k] = p;
+
+    trigram_index_free(index);
+    index->keys = keys;
+    index->starts = starts;
+    index->postings = postings;
+    index->key_count = k;
+    index->posting_count = p;
+    return true;
+}
+
+/* Find a trigram's postings; false if no text has it */
+static bool find_postings(const TrigramIndex *index, uint32_t key, uint32_t *start, uint32_t *end) {
+    uint32_t lo = 0, hi = index->key_count;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (index->keys[mid] < key) lo = mid + 1;
+        else hi = mid;
+    }
+    if (lo >= index->key_count || index->keys[lo] != key) return false;
+    *start = index->starts[lo];
+    *end = index->starts[lo + 1];
+    return true;
+}
+
+uint32_t trigram_index_estimate(const TrigramIndex *index, const char *query, size_t len) {
+    uint32_t best = UINT32_MAX;
+    for (size_t i = 0; i + 3 <= len; i++) {
+        uint32_t start, end;
+        if (!find_postings(index, trigram_at(query + i), &start, &end)) return 0;
+        if (end - start < best) best = end - start;
+    }
+    return best == UINT32_MAX ? 0 : best;
+}
+
+/* First position in [from, end) whose posting is at least value, probing ahead in growing steps */
+static uint32_t gallop(const uint32_t *postings, uint32_t from, uint32_t end, uint32_t value) {
+    uint32_t step = 1;
+    uint32_t lo = from, hi = from;
+    while (hi < end && postings[hi] < value) {
+        lo = hi + 1;
+        hi = from + step;
+        step *= 2;
+    }
+    if (hi > end) hi = end;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (postings[mid] < value) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+int trigram_index_candidates(const TrigramIndex *index, const char *query, size_t len, uint32_t *out) {
+    uint32_t starts[MAX_QUERY_TRIGRAMS], ends[MAX_QUERY_TRIGRAMS];
+    int lists = 0;
+    for (size_t i = 0; i + 3 <= len && lists < MAX_QUERY_TRIGRAMS; i++) {
+        uint32_t start, end;
+        if (!find_postings(index, trigram_at(query + i), &start, &end)) return 0;
+
+        // Shortest first, so the candidate set starts small and stays small
+        int at = lists++;
+        while (at > 0 && ends[at - 1] - starts[at - 1] > end - start) {
+            starts[at] = starts[at - 1];
+            ends[at] = ends[at - 1];
+            at--;
+        }
+        starts[at] = start;
+        ends[at] = end;
+    }
+    if (lists == 0) return 0;
+
+    int count = (int)(ends[0] - starts[0]);
+    memcpy(out, index->postings + starts[0], sizeof(uint32_t) * count);
+
+    for (int l = 1; l < lists && count > 0; l++) {
+        uint32_t position = starts[l];
+        int kept = 0;
+        for (int i = 0; i < count; i++) {
+            position = gallop(index->postings, position, ends[l], out[i]);
+            if (position >= ends[l]) break;
+            if (index->postings[position] == out[i]) out[kept++] = out[i];
+        }
+        count = kept;
+    }
+    return count;
+}
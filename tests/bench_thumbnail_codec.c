@@ -0,0 +1,152 @@
+/**
+ * @file bench_thumbnail_codec.c
+ * @brief Per-thumbnail encode/decode timing of the cache codecs
+ *
+ * Usage: bench_thumbnail_codec [image.png|image.bmp] [width] [height]
+ *
+ * Without an image a synthetic photo-like thumbnail is used. Not part of the
+ * test suite; build the bench_thumbnail_codec target and run it by hand.
+ */
+
+#define _GNU_SOURCE
+#include "../include/thumbnail_codec.h"
+#include <SDL3/SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <math.h>
+#include <time.h>
+
+#define ITERATIONS 200
+
+static double now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+/* Smooth gradients plus a little noise, roughly like a downscaled photo */
+static SDL_Surface* synthetic_thumbnail(int width, int height) {
+    SDL_Surface *surf = SDL_CreateSurface(width, height, SDL_PIXELFORMAT_RGBA32);
+    if (!surf) return NULL;
+
+    uint32_t seed = 1;
+    for (int y = 0; y < height; y++) {
+        uint8_t *row = (uint8_t*)surf->pixels + y * surf->pitch;
+        for (int x = 0; x < width; x++) {
+            seed = seed * 1103515245u + 12345u;
+            int noise = (int)(seed >> 29) - 4;
+            double fx = (double)x / width, fy = (double)y / height;
+            row[x * 4 + 0] = (uint8_t)SDL_clamp(128 + 100 * sin(fx * 6.0) + noise, 0, 255);
+            row[x * 4 + 1] = (uint8_t)SDL_clamp(90 + 80 * cos(fy * 4.0 + fx) + noise, 0, 255);
+            row[x * 4 + 2] = (uint8_t)SDL_clamp(60 + 150 * fy + noise, 0, 255);
+            row[x * 4 + 3] = 255;
+        }
+    }
+    return surf;
+}
+
+static SDL_Surface* load_thumbnail(const char *path, int width, int height) {
+    const char *ext = strrchr(path, '.');
+    SDL_Surface *original = (ext && strcasecmp(ext, ".bmp") == 0) ? SDL_LoadBMP(path) : SDL_LoadPNG(path);
+    if (!original) {
+        fprintf(stderr, "Failed to load %s: %s\n", path, SDL_GetError());
+        return NULL;
+    }
+
+    SDL_Surface *thumb = SDL_CreateSurface(width, height, SDL_PIXELFORMAT_RGBA32);
+    if (thumb) {
+        SDL_Rect dest = {0, 0, width, height};
+        SDL_BlitSurfaceScaled(original, NULL, thumb, &dest, SDL_SCALEMODE_LINEAR);
+    }
+    SDL_DestroySurface(original);
+    return thumb;
+}
+
+static void report(const char *name, size_t length, size_t raw_size, double encode_us, double decode_us) {
+    printf("%-6s %10zu %8.2fx %12.1f %12.1f\n", name, length,
+           (double)raw_size / (double)length, encode_us, decode_us);
+}
+
+static void bench_codec(ThumbnailCodec codec, SDL_Surface *thumb) {
+    size_t raw_size = (size_t)thumb->w * thumb->h * 4;
+    size_t capacity = thumbnail_codec_bound(codec, thumb->w, thumb->h);
+    uint8_t *encoded = malloc(capacity);
+    uint8_t *decoded = malloc(raw_size);
+    size_t length = 0;
+
+    double start = now_us();
+    for (int i = 0; i < ITERATIONS; i++) {
+        length = thumbnail_codec_encode(codec, thumb->pixels, thumb->w, thumb->h, thumb->pitch,
+                                        encoded, capacity);
+    }
+    double encode_us = (now_us() - start) / ITERATIONS;
+
+    bool ok = true;
+    start = now_us();
+    for (int i = 0; i < ITERATIONS; i++) {
+        ok = thumbnail_codec_decode(codec, encoded, length, decoded, thumb->w, thumb->h, thumb->w * 4) && ok;
+    }
+    double decode_us = (now_us() - start) / ITERATIONS;
+
+    if (ok && length > 0) {
+        report(thumbnail_codec_name(codec), length, raw_size, encode_us, decode_us);
+    } else {
+        printf("%-6s failed\n", thumbnail_codec_name(codec));
+    }
+
+    free(encoded);
+    free(decoded);
+}
+
+/* PNG goes through SDL, as in the thumbnail cache */
+static void bench_png(SDL_Surface *thumb) {
+    size_t raw_size = (size_t)thumb->w * thumb->h * 4;
+    Sint64 length = 0;
+    void *png = NULL;
+
+    double start = now_us();
+    for (int i = 0; i < ITERATIONS; i++) {
+        SDL_IOStream *io = SDL_IOFromDynamicMem();
+        SDL_SavePNG_IO(thumb, io, false);
+        if (i == ITERATIONS - 1) {
+            length = SDL_GetIOSize(io);
+            png = malloc((size_t)length);
+            memcpy(png, SDL_GetPointerProperty(SDL_GetIOProperties(io),
+                                               SDL_PROP_IOSTREAM_DYNAMIC_MEMORY_POINTER, NULL),
+                   (size_t)length);
+        }
+        SDL_CloseIO(io);
+    }
+    double encode_us = (now_us() - start) / ITERATIONS;
+
+    start = now_us();
+    for (int i = 0; i < ITERATIONS; i++) {
+        SDL_Surface *decoded = SDL_LoadPNG_IO(SDL_IOFromConstMem(png, (size_t)length), true);
+        SDL_DestroySurface(decoded);
+    }
+    double decode_us = (now_us() - start) / ITERATIONS;
+
+    report("png", (size_t)length, raw_size, encode_us, decode_us);
+    free(png);
+}
+
+int main(int argc, char **argv) {
+    int width = argc > 2 ? atoi(argv[2]) : 200;
+    int height = argc > 3 ? atoi(argv[3]) : 150;
+
+    SDL_Surface *thumb = argc > 1 ? load_thumbnail(argv[1], width, height)
+                                  : synthetic_thumbnail(width, height);
+    if (!thumb) return 1;
+
+    printf("%dx%d thumbnail, %d iterations\n\n", width, height, ITERATIONS);
+    printf("%-6s %10s %9s %12s %12s\n", "codec", "bytes", "ratio", "encode (us)", "decode (us)");
+    bench_codec(THUMBNAIL_CODEC_RAW, thumb);
+    bench_codec(THUMBNAIL_CODEC_QOI, thumb);
+    bench_codec(THUMBNAIL_CODEC_LZ4, thumb);
+    bench_png(thumb);
+
+    SDL_DestroySurface(thumb);
+    return 0;
+}
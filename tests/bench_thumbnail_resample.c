@@ -0,0 +1,133 @@
+/**
+ * @file bench_thumbnail_resample.c
+ * @brief Thumbnail downscaling time: SDL linear blit vs the resampler
+ *
+ * Usage: bench_thumbnail_resample [image.png|image.bmp ...]
+ *
+ * Each image is scaled to 200x150. Without arguments a synthetic 6000x4000
+ * and a 1920x1080 image are used. Not part of the test suite; build the
+ * bench_thumbnail_resample target and run it by hand.
+ */
+
+#define _GNU_SOURCE
+#include "../include/thumbnail_resample.h"
+#include <SDL3/SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+
+#define THUMB_W 200
+#define THUMB_H 150
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+/* Fine detail everywhere, which is where linear scaling aliases */
+static SDL_Surface* synthetic_image(int width, int height) {
+    SDL_Surface *surf = SDL_CreateSurface(width, height, SDL_PIXELFORMAT_RGBA32);
+    if (!surf) return NULL;
+
+    for (int y = 0; y < height; y++) {
+        uint8_t *row = (uint8_t*)surf->pixels + y * surf->pitch;
+        for (int x = 0; x < width; x++) {
+            row[x * 4 + 0] = (uint8_t)(x * 255 / width);
+            row[x * 4 + 1] = ((x ^ y) & 4) ? 220 : 30;
+            row[x * 4 + 2] = (uint8_t)(y * 255 / height);
+            row[x * 4 + 3] = 255;
+        }
+    }
+    return surf;
+}
+
+static SDL_Surface* load_image(const char *path) {
+    const char *ext = strrchr(path, '.');
+    SDL_Surface *surf = (ext && strcasecmp(ext, ".bmp") == 0) ? SDL_LoadBMP(path) : SDL_LoadPNG(path);
+    if (!surf) fprintf(stderr, "Failed to load %s: %s\n", path, SDL_GetError());
+    return surf;
+}
+
+static int iterations_for(SDL_Surface *src) {
+    long pixels = (long)src->w * src->h;
+    return pixels > 4000000 ? 5 : pixels > 500000 ? 20 : 100;
+}
+
+static double bench_sdl_linear(SDL_Surface *src) {
+    SDL_Surface *thumb = SDL_CreateSurface(THUMB_W, THUMB_H, SDL_PIXELFORMAT_RGBA32);
+    SDL_Rect dest = {0, 0, THUMB_W, THUMB_H};
+    int iterations = iterations_for(src);
+
+    double start = now_ms();
+    for (int i = 0; i < iterations; i++) {
+        SDL_BlitSurfaceScaled(src, NULL, thumb, &dest, SDL_SCALEMODE_LINEAR);
+    }
+    double elapsed = (now_ms() - start) / iterations;
+
+    SDL_DestroySurface(thumb);
+    return elapsed;
+}
+
+/* Includes the conversion to RGBA32, as thumbnail_scale() does */
+static double bench_resample(SDL_Surface *src, ThumbnailFilter filter, ResampleIsa isa) {
+    uint8_t *thumb = malloc(THUMB_W * THUMB_H * 4);
+    int iterations = iterations_for(src);
+    thumbnail_resample_force_isa(isa);
+
+    double start = now_ms();
+    for (int i = 0; i < iterations; i++) {
+        SDL_Surface *rgba = src->format == SDL_PIXELFORMAT_RGBA32 ? src
+                                                                 : SDL_ConvertSurface(src, SDL_PIXELFORMAT_RGBA32);
+        thumbnail_resample(rgba->pixels, rgba->w, rgba->h, rgba->pitch,
+                           thumb, THUMB_W, THUMB_H, THUMB_W * 4, filter);
+        if (rgba != src) SDL_DestroySurface(rgba);
+    }
+    double elapsed = (now_ms() - start) / iterations;
+
+    thumbnail_resample_force_isa(RESAMPLE_ISA_COUNT);
+    free(thumb);
+    return elapsed;
+}
+
+static void bench_image(const char *label, SDL_Surface *src) {
+    printf("%s (%dx%d, %s)\n", label, src->w, src->h, SDL_GetPixelFormatName(src->format));
+    printf("  %-22s %8.2f ms\n", "sdl linear", bench_sdl_linear(src));
+
+    for (int f = 0; f < THUMBNAIL_FILTER_COUNT; f++) {
+        for (int isa = 0; isa < RESAMPLE_ISA_COUNT; isa++) {
+            if (!thumbnail_resample_force_isa((ResampleIsa)isa)) continue;
+
+            char name[32];
+            snprintf(name, sizeof(name), "%s %s", thumbnail_filter_name((ThumbnailFilter)f),
+                     thumbnail_resample_isa_name((ResampleIsa)isa));
+            printf("  %-22s %8.2f ms\n", name, bench_resample(src, (ThumbnailFilter)f, (ResampleIsa)isa));
+        }
+    }
+    printf("\n");
+}
+
+int main(int argc, char **argv) {
+    printf("Scaling to %dx%d\n\n", THUMB_W, THUMB_H);
+
+    if (argc > 1) {
+        for (int i = 1; i < argc; i++) {
+            SDL_Surface *src = load_image(argv[i]);
+            if (!src) continue;
+            bench_image(argv[i], src);
+            SDL_DestroySurface(src);
+        }
+        return 0;
+    }
+
+    static const int sizes[][2] = {{6000, 4000}, {1920, 1080}};
+    for (int i = 0; i < 2; i++) {
+        SDL_Surface *src = synthetic_image(sizes[i][0], sizes[i][1]);
+        if (!src) return 1;
+        bench_image("synthetic", src);
+        SDL_DestroySurface(src);
+    }
+    return 0;
+}
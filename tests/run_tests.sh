@@ -34,9 +34,9 @@ fi
 # Build tests
 echo -e "${YELLOW}Building tests...${NC}"
 if [ -f "build.ninja" ]; then
-    ninja test_config
+    ninja test_config test_hash test_thumbnail_atlas test_thumbnail_palette test_thumbnail_codec test_thumbnail_jpeg test_thumbnail_resample test_thumbnail_schedule test_scan_index test_dir_walk test_search test_trigram test_favorites
 else
-    make test_config
+    make test_config test_hash test_thumbnail_atlas test_thumbnail_palette test_thumbnail_codec test_thumbnail_jpeg test_thumbnail_resample test_thumbnail_schedule test_scan_index test_dir_walk test_search test_trigram test_favorites
 fi
 
 echo ""
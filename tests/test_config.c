@@ -39,9 +39,20 @@ TEST(config_default_values) {
     ASSERT_EQ(300, config.window_height);
     ASSERT_EQ(5, config.thumbnails_per_row);
     ASSERT_FALSE(config.use_shaders);
+    ASSERT_FALSE(config.frosted_background);
     ASSERT_FALSE(config.use_wal);
     ASSERT_FALSE(config.reload_i3);
     ASSERT_EQ(0, config.wallpaper_dirs_count);
+    ASSERT_FALSE(config.recursive);
+    ASSERT_EQ(0, config.max_depth);
+    ASSERT_FALSE(config.search_index);
+    ASSERT_STR_EQ("substring", config.search_mode);
+    ASSERT_EQ(0, config.excludes_count);
+    ASSERT_EQ(256, config.texture_cache_mb);
+    ASSERT_EQ(0, config.thumbnail_threads);
+    ASSERT_STR_EQ("raw", config.thumbnail_cache_format);
+    ASSERT_STR_EQ("box", config.thumbnail_filter);
+    ASSERT_EQ(256, config.thumbnail_memory_mb);
     
     TEST_PASS();
 }
@@ -79,6 +90,43 @@ TEST(config_parse_multiple_wallpaper_dirs) {
     TEST_PASS();
 }
 
+TEST(config_parse_recursive_scan) {
+    const char *content = 
+        "recursive = true\n"
+        "max_depth = 3\n"
+        "exclude_1 = .git\n"
+        "exclude_2 = archive/*\n";
+    
+    char *path = create_temp_config(content);
+    ASSERT(path != NULL);
+    
+    Config config = config_parse(path);
+    ASSERT_TRUE(config.recursive);
+    ASSERT_EQ(3, config.max_depth);
+    ASSERT_EQ(2, config.excludes_count);
+    ASSERT_STR_EQ(".git", config.excludes[0]);
+    ASSERT_STR_EQ("archive/*", config.excludes[1]);
+    
+    cleanup_temp_config(path);
+    TEST_PASS();
+}
+
+TEST(config_parse_search_settings) {
+    const char *content = 
+        "search_index = true\n"
+        "search_mode = fuzzy\n";
+    
+    char *path = create_temp_config(content);
+    ASSERT(path != NULL);
+    
+    Config config = config_parse(path);
+    ASSERT_TRUE(config.search_index);
+    ASSERT_STR_EQ("fuzzy", config.search_mode);
+    
+    cleanup_temp_config(path);
+    TEST_PASS();
+}
+
 TEST(config_parse_feh_command) {
     const char *content = 
         "feh_command = feh --bg-fill\n";
@@ -128,6 +176,7 @@ TEST(config_parse_window_dimensions) {
 TEST(config_parse_boolean_true) {
     const char *content = 
         "use_shaders = true\n"
+        "frosted_background = true\n"
         "use_wal = 1\n"
         "reload_i3 = true\n";
     
@@ -136,6 +185,7 @@ TEST(config_parse_boolean_true) {
     
     Config config = config_parse(path);
     ASSERT_TRUE(config.use_shaders);
+    ASSERT_TRUE(config.frosted_background);
     ASSERT_TRUE(config.use_wal);
     ASSERT_TRUE(config.reload_i3);
     
@@ -175,6 +225,76 @@ TEST(config_parse_thumbnails_per_row) {
     TEST_PASS();
 }
 
+TEST(config_parse_texture_cache_mb) {
+    const char *content = 
+        "texture_cache_mb = 64\n";
+    
+    char *path = create_temp_config(content);
+    ASSERT(path != NULL);
+    
+    Config config = config_parse(path);
+    ASSERT_EQ(64, config.texture_cache_mb);
+    
+    cleanup_temp_config(path);
+    TEST_PASS();
+}
+
+TEST(config_parse_thumbnail_threads) {
+    const char *content = 
+        "thumbnail_threads = 6\n";
+    
+    char *path = create_temp_config(content);
+    ASSERT(path != NULL);
+    
+    Config config = config_parse(path);
+    ASSERT_EQ(6, config.thumbnail_threads);
+    
+    cleanup_temp_config(path);
+    TEST_PASS();
+}
+
+TEST(config_parse_thumbnail_cache_format) {
+    const char *content = 
+        "thumbnail_cache_format = qoi\n";
+    
+    char *path = create_temp_config(content);
+    ASSERT(path != NULL);
+    
+    Config config = config_parse(path);
+    ASSERT_STR_EQ("qoi", config.thumbnail_cache_format);
+    
+    cleanup_temp_config(path);
+    TEST_PASS();
+}
+
+TEST(config_parse_thumbnail_filter) {
+    const char *content = 
+        "thumbnail_filter = lanczos\n";
+    
+    char *path = create_temp_config(content);
+    ASSERT(path != NULL);
+    
+    Config config = config_parse(path);
+    ASSERT_STR_EQ("lanczos", config.thumbnail_filter);
+    
+    cleanup_temp_config(path);
+    TEST_PASS();
+}
+
+TEST(config_parse_thumbnail_memory_mb) {
+    const char *content = 
+        "thumbnail_memory_mb = 0\n";
+    
+    char *path = create_temp_config(content);
+    ASSERT(path != NULL);
+    
+    Config config = config_parse(path);
+    ASSERT_EQ(0, config.thumbnail_memory_mb);
+    
+    cleanup_temp_config(path);
+    TEST_PASS();
+}
+
 TEST(config_parse_comments_ignored) {
     const char *content = 
         "# This is a comment\n"
@@ -355,12 +475,19 @@ int main(void) {
     RUN_TEST(config_default_values);
     RUN_TEST(config_parse_wallpaper_dir);
     RUN_TEST(config_parse_multiple_wallpaper_dirs);
+    RUN_TEST(config_parse_recursive_scan);
+    RUN_TEST(config_parse_search_settings);
     RUN_TEST(config_parse_feh_command);
     RUN_TEST(config_parse_thumbnail_dimensions);
     RUN_TEST(config_parse_window_dimensions);
     RUN_TEST(config_parse_boolean_true);
     RUN_TEST(config_parse_boolean_false);
     RUN_TEST(config_parse_thumbnails_per_row);
+    RUN_TEST(config_parse_texture_cache_mb);
+    RUN_TEST(config_parse_thumbnail_threads);
+    RUN_TEST(config_parse_thumbnail_cache_format);
+    RUN_TEST(config_parse_thumbnail_filter);
+    RUN_TEST(config_parse_thumbnail_memory_mb);
     RUN_TEST(config_parse_comments_ignored);
     RUN_TEST(config_parse_whitespace_handling);
     RUN_TEST(config_parse_quoted_values);
@@ -0,0 +1,218 @@
+/**
+ * @file test_dir_walk.c
+ * @brief Tests for parallel directory traversal
+ */
+
+#define _GNU_SOURCE
+#include "test_framework.h"
+#include "../include/dir_walk.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+/* Helpers to build a throwaway tree under /tmp */
+static char tree_root[256];
+
+static void make_dir(const char *rel) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s", tree_root, rel);
+    mkdir(path, 0755);
+}
+
+static void make_file(const char *rel) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s", tree_root, rel);
+    FILE *f = fopen(path, "w");
+    if (f) {
+        fputs(rel, f);
+        fclose(f);
+    }
+}
+
+static void make_link(const char *target, const char *rel) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s", tree_root, rel);
+    if (symlink(target, path) != 0) perror("symlink");
+}
+
+static void build_tree(void) {
+    snprintf(tree_root, sizeof(tree_root), "/tmp/vista_test_walk_%d", getpid());
+    mkdir(tree_root, 0755);
+    make_dir("nature");
+    make_dir("nature/forest");
+    make_dir("nature/forest/deep");
+    make_dir("city");
+    make_dir(".git");
+    make_file("top.jpg");
+    make_file("notes.txt");
+    make_file("nature/lake.png");
+    make_file("nature/forest/pine.jpg");
+    make_file("nature/forest/deep/moss.jpg");
+    make_file("city/night.jpg");
+    make_file("city/night_thumb.jpg");
+    make_file(".git/index.jpg");
+    make_link("..", "nature/up");         // Loop back to the root
+    make_link("city/night.jpg", "alias.jpg");
+}
+
+static void remove_tree(void) {
+    char command[512];
+    snprintf(command, sizeof(command), "rm -rf '%s'", tree_root);
+    if (system(command) != 0) fprintf(stderr, "Failed to remove %s\n", tree_root);
+}
+
+static bool accept_images(const char *name) {
+    const char *ext = strrchr(name, '.');
+    return ext && (strcasecmp(ext, ".jpg") == 0 || strcasecmp(ext, ".png") == 0);
+}
+
+static bool has_entry(const ScanDirectory *scan, const char *name) {
+    for (int i = 0; i < scan->count; i++) {
+        if (strcmp(scan->entries[i].name, name) == 0) return true;
+    }
+    return false;
+}
+
+static DirWalkOptions default_options(void) {
+    DirWalkOptions options;
+    memset(&options, 0, sizeof(options));
+    options.accept = accept_images;
+    return options;
+}
+
+static void walk_tree(const DirWalkOptions *options, ScanDirectory *scan, bool *opened) {
+    const char *roots[] = {tree_root};
+    dir_walk(roots, 1, options, scan, opened);
+}
+
+/* -------------------------------------------------------------------------- */
+/*                               Test Cases                                    */
+/* -------------------------------------------------------------------------- */
+
+TEST(dir_walk_top_level_only) {
+    DirWalkOptions options = default_options();
+    ScanDirectory scan;
+    bool opened = false;
+    walk_tree(&options, &scan, &opened);
+
+    ASSERT_TRUE(opened);
+    ASSERT_EQ(2, scan.count);
+    ASSERT_STR_EQ("alias.jpg", scan.entries[0].name);
+    ASSERT_STR_EQ("top.jpg", scan.entries[1].name);
+    ASSERT_EQ(0, scan.subdir_count);
+    ASSERT_TRUE(scan.dir_mtime_ns != 0);
+    ASSERT_TRUE(scan.entries[1].stamp.size == (int64_t)strlen("top.jpg"));
+
+    scan_directory_free(&scan);
+    TEST_PASS();
+}
+
+TEST(dir_walk_recursive_follows_loop_once) {
+    DirWalkOptions options = default_options();
+    options.recursive = true;
+    options.threads = 3;
+    ScanDirectory scan;
+    walk_tree(&options, &scan, NULL);
+
+    // Every image once, named relative to the root; "nature/up" leads back
+    // to the root, which has already been listed
+    ASSERT_EQ(8, scan.count);
+    ASSERT_TRUE(has_entry(&scan, "nature/forest/deep/moss.jpg"));
+    ASSERT_TRUE(has_entry(&scan, "city/night_thumb.jpg"));
+    ASSERT_TRUE(has_entry(&scan, ".git/index.jpg"));
+    ASSERT_FALSE(has_entry(&scan, "nature/up/top.jpg"));
+    ASSERT_FALSE(has_entry(&scan, "notes.txt"));
+
+    // Sorted, so listings compare consistently
+    for (int i = 1; i < scan.count; i++) {
+        ASSERT_TRUE(strcmp(scan.entries[i - 1].name, scan.entries[i].name) < 0);
+    }
+    ASSERT_EQ(5, scan.subdir_count);
+    ASSERT_STR_EQ(".git", scan.subdirs[0].name);
+    ASSERT_STR_EQ("nature/forest/deep", scan.subdirs[4].name);
+
+    scan_directory_free(&scan);
+    TEST_PASS();
+}
+
+TEST(dir_walk_max_depth) {
+    DirWalkOptions options = default_options();
+    options.recursive = true;
+    options.max_depth = 1;
+    ScanDirectory scan;
+    walk_tree(&options, &scan, NULL);
+
+    ASSERT_TRUE(has_entry(&scan, "nature/lake.png"));
+    ASSERT_FALSE(has_entry(&scan, "nature/forest/pine.jpg"));
+    ASSERT_EQ(6, scan.count);
+
+    scan_directory_free(&scan);
+    TEST_PASS();
+}
+
+TEST(dir_walk_excludes) {
+    const char *excludes[] = {".git", "*_thumb.jpg", "nature/forest"};
+    DirWalkOptions options = default_options();
+    options.recursive = true;
+    options.excludes = excludes;
+    options.exclude_count = 3;
+    ScanDirectory scan;
+    walk_tree(&options, &scan, NULL);
+
+    ASSERT_FALSE(has_entry(&scan, ".git/index.jpg"));
+    ASSERT_FALSE(has_entry(&scan, "city/night_thumb.jpg"));
+    ASSERT_FALSE(has_entry(&scan, "nature/forest/pine.jpg"));
+    ASSERT_TRUE(has_entry(&scan, "nature/lake.png"));
+    ASSERT_TRUE(has_entry(&scan, "city/night.jpg"));
+    ASSERT_EQ(4, scan.count);
+
+    scan_directory_free(&scan);
+    TEST_PASS();
+}
+
+TEST(dir_walk_several_roots) {
+    char nature[512], missing[512];
+    snprintf(nature, sizeof(nature), "%s/nature", tree_root);
+    snprintf(missing, sizeof(missing), "%s/missing", tree_root);
+    const char *roots[] = {tree_root, missing, nature};
+
+    DirWalkOptions options = default_options();
+    options.recursive = true;
+    ScanDirectory scans[3];
+    bool opened[3];
+    dir_walk(roots, 3, &options, scans, opened);
+
+    // Overlapping roots are each listed in full
+    ASSERT_TRUE(opened[0]);
+    ASSERT_FALSE(opened[1]);
+    ASSERT_TRUE(opened[2]);
+    ASSERT_EQ(8, scans[0].count);
+    ASSERT_EQ(0, scans[1].count);
+    ASSERT_TRUE(has_entry(&scans[2], "forest/pine.jpg"));
+    ASSERT_TRUE(has_entry(&scans[2], "up/top.jpg"));
+
+    for (int i = 0; i < 3; i++) scan_directory_free(&scans[i]);
+    TEST_PASS();
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                Main Runner                                  */
+/* -------------------------------------------------------------------------- */
+
+int main(void) {
+    TEST_SUITE_BEGIN("Directory Walk Tests");
+
+    build_tree();
+    RUN_TEST(dir_walk_top_level_only);
+    RUN_TEST(dir_walk_recursive_follows_loop_once);
+    RUN_TEST(dir_walk_max_depth);
+    RUN_TEST(dir_walk_excludes);
+    RUN_TEST(dir_walk_several_roots);
+    remove_tree();
+
+    TEST_SUITE_END();
+    RETURN_TEST_RESULT();
+}
@@ -0,0 +1,217 @@
+/**
+ * @file test_favorites.c
+ * @brief Tests for the journaled favorites store
+ */
+
+#define _GNU_SOURCE
+#include "test_framework.h"
+#include "../include/favorites.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static char store_path[256];
+static char journal_path[300];
+
+static void remove_files(void) {
+    unlink(store_path);
+    unlink(journal_path);
+}
+
+static void use_files(const char *name) {
+    snprintf(store_path, sizeof(store_path), "/tmp/vista_test_%s_%d.txt", name, getpid());
+    snprintf(journal_path, sizeof(journal_path), "%s.journal", store_path);
+    remove_files();
+}
+
+static void write_file(const char *path, const char *text) {
+    FILE *f = fopen(path, "w");
+    if (f) {
+        fputs(text, f);
+        fclose(f);
+    }
+}
+
+static int count_lines(const char *path) {
+    FILE *f = fopen(path, "r");
+    if (!f) return -1;
+    int lines = 0;
+    for (int c; (c = fgetc(f)) != EOF;) {
+        if (c == '\n') lines++;
+    }
+    fclose(f);
+    return lines;
+}
+
+static bool contains(const FavoritesStore *store, const char *dir, const char *name) {
+    return favorites_contains(store, dir, strlen(dir), name);
+}
+
+static void set(FavoritesStore *store, const char *dir, const char *name, bool favorite) {
+    favorites_set(store, dir, strlen(dir), name, favorite);
+}
+
+/* -------------------------------------------------------------------------- */
+/*                               Test Cases                                    */
+/* -------------------------------------------------------------------------- */
+
+TEST(favorites_survive_reopen) {
+    use_files("favorites_reopen");
+    FavoritesStore *store = favorites_open(store_path, 0);
+    ASSERT_TRUE(store != NULL);
+    ASSERT_EQ(0, favorites_count(store));
+
+    set(store, "/walls", "lake.jpg", true);
+    set(store, "/walls/city", "night.png", true);
+    set(store, "/walls", "forest.png", true);
+    set(store, "/walls", "forest.png", false);
+    ASSERT_EQ(2, favorites_count(store));
+    ASSERT_TRUE(contains(store, "/walls", "lake.jpg"));
+    ASSERT_FALSE(contains(store, "/walls", "forest.png"));
+    // The split between directory and name is part of the path, not the key
+    ASSERT_TRUE(contains(store, "/walls", "city/night.png"));
+    favorites_close(store);
+
+    // Closing folds the journal into the base file
+    ASSERT_EQ(2, count_lines(store_path));
+    ASSERT_TRUE(access(journal_path, F_OK) != 0);
+
+    store = favorites_open(store_path, 0);
+    ASSERT_TRUE(store != NULL);
+    ASSERT_EQ(2, favorites_count(store));
+    ASSERT_TRUE(contains(store, "/walls", "lake.jpg"));
+    ASSERT_TRUE(contains(store, "/walls/city", "night.png"));
+    ASSERT_FALSE(contains(store, "/walls", "forest.png"));
+    favorites_close(store);
+
+    remove_files();
+    TEST_PASS();
+}
+
+TEST(favorites_journal_compacts_at_limit) {
+    use_files("favorites_compact");
+    FavoritesStore *store = favorites_open(store_path, 4);
+    ASSERT_TRUE(store != NULL);
+
+    set(store, "/walls", "a.jpg", true);
+    set(store, "/walls", "b.jpg", true);
+    set(store, "/walls", "c.jpg", true);
+    favorites_flush(store);
+    ASSERT_EQ(3, count_lines(journal_path));
+    ASSERT_EQ(-1, count_lines(store_path));
+
+    // The fourth line reaches the limit and the journal is folded in
+    set(store, "/walls", "b.jpg", false);
+    favorites_flush(store);
+    ASSERT_EQ(2, count_lines(store_path));
+    ASSERT_EQ(-1, count_lines(journal_path));
+
+    set(store, "/walls", "d.jpg", true);
+    favorites_flush(store);
+    ASSERT_EQ(1, count_lines(journal_path));
+
+    // A store opened while a journal is pending sees base file and journal together
+    FavoritesStore *other = favorites_open(store_path, 4);
+    ASSERT_TRUE(other != NULL);
+    ASSERT_EQ(3, favorites_count(other));
+    ASSERT_TRUE(contains(other, "/walls", "d.jpg"));
+    ASSERT_FALSE(contains(other, "/walls", "b.jpg"));
+    favorites_close(other);
+
+    favorites_close(store);
+    remove_files();
+    TEST_PASS();
+}
+
+TEST(favorites_journal_ignores_cut_line) {
+    use_files("favorites_cut");
+    write_file(store_path, "/walls/a.jpg\n/walls/b.jpg\n");
+    write_file(journal_path, "-/walls/a.jpg\n+/walls/c.jpg\n+/walls/d.j");
+
+    FavoritesStore *store = favorites_open(store_path, 0);
+    ASSERT_TRUE(store != NULL);
+    ASSERT_EQ(2, favorites_count(store));
+    ASSERT_FALSE(contains(store, "/walls", "a.jpg"));
+    ASSERT_TRUE(contains(store, "/walls", "b.jpg"));
+    ASSERT_TRUE(contains(store, "/walls", "c.jpg"));
+    ASSERT_FALSE(contains(store, "/walls", "d.j"));
+    favorites_close(store);
+
+    remove_files();
+    TEST_PASS();
+}
+
+TEST(favorites_read_plain_list) {
+    // A favorites file from before the journal: one path per line, nothing else
+    use_files("favorites_plain");
+    write_file(store_path, "/walls/a.jpg\n\n/walls/deep/b.png\n/walls/a.jpg\n/missing/c.jpg");
+
+    FavoritesStore *store = favorites_open(store_path, 0);
+    ASSERT_TRUE(store != NULL);
+    ASSERT_EQ(3, favorites_count(store));
+    ASSERT_TRUE(contains(store, "/walls", "a.jpg"));
+    ASSERT_TRUE(contains(store, "/walls/deep", "b.png"));
+    ASSERT_TRUE(contains(store, "/missing", "c.jpg"));
+
+    // Untouched favorites are written back, missing files included
+    set(store, "/walls", "a.jpg", false);
+    favorites_close(store);
+    ASSERT_EQ(2, count_lines(store_path));
+
+    store = favorites_open(store_path, 0);
+    ASSERT_TRUE(store != NULL);
+    ASSERT_TRUE(contains(store, "/missing", "c.jpg"));
+    ASSERT_FALSE(contains(store, "/walls", "a.jpg"));
+    favorites_close(store);
+
+    remove_files();
+    TEST_PASS();
+}
+
+TEST(favorites_many_toggles) {
+    use_files("favorites_many");
+    FavoritesStore *store = favorites_open(store_path, 64);
+    ASSERT_TRUE(store != NULL);
+
+    char name[32];
+    for (int i = 0; i < 2000; i++) {
+        snprintf(name, sizeof(name), "%d.jpg", i);
+        set(store, "/walls", name, true);
+    }
+    for (int i = 0; i < 2000; i += 2) {
+        snprintf(name, sizeof(name), "%d.jpg", i);
+        set(store, "/walls", name, false);
+    }
+    ASSERT_EQ(1000, favorites_count(store));
+    favorites_close(store);
+
+    store = favorites_open(store_path, 64);
+    ASSERT_TRUE(store != NULL);
+    ASSERT_EQ(1000, favorites_count(store));
+    for (int i = 0; i < 2000; i++) {
+        snprintf(name, sizeof(name), "%d.jpg", i);
+        ASSERT_EQ(i % 2 == 1, contains(store, "/walls", name));
+    }
+    favorites_close(store);
+
+    remove_files();
+    TEST_PASS();
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                Main Runner                                  */
+/* -------------------------------------------------------------------------- */
+
+int main(void) {
+    TEST_SUITE_BEGIN("Favorites Tests");
+
+    RUN_TEST(favorites_survive_reopen);
+    RUN_TEST(favorites_journal_compacts_at_limit);
+    RUN_TEST(favorites_journal_ignores_cut_line);
+    RUN_TEST(favorites_read_plain_list);
+    RUN_TEST(favorites_many_toggles);
+
+    TEST_SUITE_END();
+    RETURN_TEST_RESULT();
+}
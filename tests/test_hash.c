@@ -0,0 +1,110 @@
+/**
+ * @file test_hash.c
+ * @brief Tests for XXH64 and MD5 hashing
+ */
+
+#include "test_framework.h"
+#include "../include/hash.h"
+#include <stdio.h>
+#include <stdint.h>
+
+/* Reference digests from the xxHash project for data[i] = i * 7 + 3 */
+static uint8_t data[1000];
+
+static void fill_data(void) {
+    for (int i = 0; i < (int)sizeof(data); i++) {
+        data[i] = (uint8_t)(i * 7 + 3);
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+/*                               Test Cases                                    */
+/* -------------------------------------------------------------------------- */
+
+TEST(hash_empty_input) {
+    ASSERT_TRUE(hash_xxh64("", 0, 0) == 0xEF46DB3751D8E999ULL);
+    TEST_PASS();
+}
+
+TEST(hash_known_vectors) {
+    fill_data();
+
+    // Lengths on both sides of every tail and stripe boundary
+    ASSERT_TRUE(hash_xxh64(data, 3, 0) == 0x31D2363F52E564C9ULL);
+    ASSERT_TRUE(hash_xxh64(data, 4, 0) == 0x9BB64B7D66EE9FDAULL);
+    ASSERT_TRUE(hash_xxh64(data, 8, 0) == 0xDAB99D95C6F90092ULL);
+    ASSERT_TRUE(hash_xxh64(data, 31, 0) == 0xA2AA5F33CC4A6119ULL);
+    ASSERT_TRUE(hash_xxh64(data, 32, 0) == 0x23C3C17EF790FD97ULL);
+    ASSERT_TRUE(hash_xxh64(data, 33, 0) == 0x50A7CFC7BA588784ULL);
+    ASSERT_TRUE(hash_xxh64(data, 1000, 0) == 0x5F235FA033F1A3FBULL);
+    ASSERT_TRUE(hash_xxh64("abc", 3, 0) == 0x44BC2CF5AD770999ULL);
+    TEST_PASS();
+}
+
+TEST(hash_seeded) {
+    fill_data();
+
+    ASSERT_TRUE(hash_xxh64(data, 100, 12345) == 0xACB8A02891FEA7D2ULL);
+    ASSERT_TRUE(hash_xxh64(data, 1000, 0x9E3779B97F4A7C15ULL) == 0x442ACD0A822E86F6ULL);
+    TEST_PASS();
+}
+
+TEST(hash_incremental_matches_oneshot) {
+    fill_data();
+
+    // Feed in uneven pieces that straddle stripe boundaries
+    static const size_t pieces[] = {1, 30, 2, 64, 5, 300, 598};
+    HashState state;
+    hash_reset(&state, 7);
+
+    size_t offset = 0;
+    for (size_t i = 0; i < sizeof(pieces) / sizeof(pieces[0]); i++) {
+        hash_update(&state, data + offset, pieces[i]);
+        offset += pieces[i];
+    }
+
+    ASSERT_EQ(1000, (int)offset);
+    ASSERT_TRUE(hash_digest(&state) == hash_xxh64(data, 1000, 7));
+    TEST_PASS();
+}
+
+TEST(hash_md5_vectors) {
+    static const uint8_t empty[16] = {
+        0xd4, 0x1d, 0x8c, 0xd9, 0x8f, 0x00, 0xb2, 0x04, 0xe9, 0x80, 0x09, 0x98, 0xec, 0xf8, 0x42, 0x7e
+    };
+    static const uint8_t abc[16] = {
+        0x90, 0x01, 0x50, 0x98, 0x3c, 0xd2, 0x4f, 0xb0, 0xd6, 0x96, 0x3f, 0x7d, 0x28, 0xe1, 0x7f, 0x72
+    };
+    // 140 bytes: spans two blocks and needs an extra padding block
+    static const uint8_t long_path[16] = {
+        0x8e, 0x34, 0xb8, 0x66, 0x9d, 0xf2, 0x1e, 0x5e, 0x32, 0x59, 0x9a, 0x81, 0x46, 0x6a, 0x5c, 0x91
+    };
+    const char *path = "/home/user/Pictures/wallpapers/mountain_sunrise_4k_wallpaper_final.png"
+                       "/home/user/Pictures/wallpapers/mountain_sunrise_4k_wallpaper_final.png";
+    uint8_t digest[16];
+
+    hash_md5("", 0, digest);
+    ASSERT_TRUE(memcmp(digest, empty, 16) == 0);
+    hash_md5("abc", 3, digest);
+    ASSERT_TRUE(memcmp(digest, abc, 16) == 0);
+    hash_md5(path, strlen(path), digest);
+    ASSERT_TRUE(memcmp(digest, long_path, 16) == 0);
+    TEST_PASS();
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                Main Runner                                  */
+/* -------------------------------------------------------------------------- */
+
+int main(void) {
+    TEST_SUITE_BEGIN("Hash Tests");
+
+    RUN_TEST(hash_empty_input);
+    RUN_TEST(hash_known_vectors);
+    RUN_TEST(hash_seeded);
+    RUN_TEST(hash_incremental_matches_oneshot);
+    RUN_TEST(hash_md5_vectors);
+
+    TEST_SUITE_END();
+    RETURN_TEST_RESULT();
+}
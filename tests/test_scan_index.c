@@ -0,0 +1,185 @@
+/**
+ * @file test_scan_index.c
+ * @brief Tests for directory scan index files
+ */
+
+#define _GNU_SOURCE
+#include "test_framework.h"
+#include "../include/scan_index.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+/* Helper to build a unique temporary index path */
+static const char* temp_index_path(void) {
+    static char path[256];
+    snprintf(path, sizeof(path), "/tmp/vista_test_scan_%d.idx", getpid());
+    return path;
+}
+
+static void add_file(ScanDirectory *scan, const char *name, int64_t size) {
+    ThumbnailStamp stamp = {1700000000 + size, size, (uint64_t)size * 7};
+    scan_directory_add(scan, name, &stamp);
+}
+
+/* -------------------------------------------------------------------------- */
+/*                               Test Cases                                    */
+/* -------------------------------------------------------------------------- */
+
+TEST(scan_index_round_trip) {
+    const char *path = temp_index_path();
+    ScanDirectory scan, loaded;
+    scan_directory_init(&scan);
+    add_file(&scan, "sunset.jpg", 1000);
+    add_file(&scan, "a long name with spaces.png", 20);
+    add_file(&scan, "\xc3\xa9t\xc3\xa9.bmp", 3);
+    add_file(&scan, "nature/forest/pine.jpg", 4);
+    scan_directory_add_subdir(&scan, "nature/forest", 1700000000000000002LL, 8);
+    scan_directory_add_subdir(&scan, "nature", 1700000000000000001LL, 7);
+    scan_directory_sort(&scan);
+    scan.dir_mtime_ns = 1700000000123456789LL;
+    scan.dir_inode = 42;
+    scan.options_hash = 0x1234567890abcdefULL;
+
+    ASSERT_TRUE(scan_index_save(path, &scan));
+    ASSERT_TRUE(scan_index_load(path, &loaded));
+    ASSERT_EQ(4, loaded.count);
+    ASSERT_TRUE(loaded.dir_mtime_ns == 1700000000123456789LL);
+    ASSERT_TRUE(loaded.dir_inode == 42);
+    ASSERT_TRUE(loaded.options_hash == 0x1234567890abcdefULL);
+    ASSERT_TRUE(scan_directory_equal(&scan, &loaded));
+    ASSERT_STR_EQ("a long name with spaces.png", loaded.entries[0].name);
+    ASSERT_STR_EQ("nature/forest/pine.jpg", loaded.entries[1].name);
+    
+    ASSERT_EQ(2, loaded.subdir_count);
+    ASSERT_STR_EQ("nature", loaded.subdirs[0].name);
+    ASSERT_TRUE(loaded.subdirs[0].mtime_ns == 1700000000000000001LL);
+    ASSERT_TRUE(loaded.subdirs[0].inode == 7);
+    ASSERT_STR_EQ("nature/forest", loaded.subdirs[1].name);
+
+    scan_directory_free(&scan);
+    scan_directory_free(&loaded);
+    unlink(path);
+    TEST_PASS();
+}
+
+TEST(scan_index_stores_trigrams) {
+    const char *path = temp_index_path();
+    ScanDirectory scan, loaded;
+    scan_directory_init(&scan);
+    add_file(&scan, "lake.jpg", 1);
+    add_file(&scan, "nature/Lake Shore.png", 2);
+    add_file(&scan, "ab.png", 3);
+    scan_directory_sort(&scan);
+
+    const char *names[3];
+    for (int i = 0; i < scan.count; i++) names[i] = scan.entries[i].name;
+    ASSERT_TRUE(trigram_index_build(&scan.trigrams, names, scan.count));
+
+    ASSERT_TRUE(scan_index_save(path, &scan));
+    ASSERT_TRUE(scan_index_load(path, &loaded));
+    ASSERT_EQ(scan.trigrams.key_count, loaded.trigrams.key_count);
+    ASSERT_EQ(scan.trigrams.posting_count, loaded.trigrams.posting_count);
+    ASSERT_TRUE(memcmp(scan.trigrams.keys, loaded.trigrams.keys,
+                       sizeof(uint32_t) * scan.trigrams.key_count) == 0);
+    ASSERT_TRUE(memcmp(scan.trigrams.postings, loaded.trigrams.postings,
+                       sizeof(uint32_t) * scan.trigrams.posting_count) == 0);
+
+    uint32_t candidates[3];
+    ASSERT_EQ(2, trigram_index_candidates(&loaded.trigrams, "lake", 4, candidates));
+
+    scan_directory_free(&scan);
+    scan_directory_free(&loaded);
+    unlink(path);
+    TEST_PASS();
+}
+
+TEST(scan_index_empty_directory) {
+    const char *path = temp_index_path();
+    ScanDirectory scan, loaded;
+    scan_directory_init(&scan);
+    scan.dir_mtime_ns = 5;
+
+    ASSERT_TRUE(scan_index_save(path, &scan));
+    ASSERT_TRUE(scan_index_load(path, &loaded));
+    ASSERT_EQ(0, loaded.count);
+    ASSERT_TRUE(loaded.dir_mtime_ns == 5);
+
+    scan_directory_free(&loaded);
+    unlink(path);
+    TEST_PASS();
+}
+
+TEST(scan_index_rejects_damaged_files) {
+    const char *path = temp_index_path();
+    ScanDirectory scan, loaded;
+    scan_directory_init(&scan);
+    add_file(&scan, "one.jpg", 1);
+    add_file(&scan, "two.jpg", 2);
+    ASSERT_TRUE(scan_index_save(path, &scan));
+    scan_directory_free(&scan);
+
+    // Flip a byte in a name: the checksum no longer matches
+    FILE *file = fopen(path, "r+b");
+    ASSERT_TRUE(file != NULL);
+    fseek(file, -3, SEEK_END);
+    fputc('X', file);
+    fclose(file);
+    ASSERT_FALSE(scan_index_load(path, &loaded));
+    ASSERT_EQ(0, loaded.count);
+
+    // Cut short, as after a crash
+    ASSERT_EQ(0, truncate(path, 20));
+    ASSERT_FALSE(scan_index_load(path, &loaded));
+
+    ASSERT_FALSE(scan_index_load("/nonexistent/vista.idx", &loaded));
+    unlink(path);
+    TEST_PASS();
+}
+
+TEST(scan_directory_equal_compares_stamps) {
+    ScanDirectory a, b;
+    scan_directory_init(&a);
+    scan_directory_init(&b);
+    add_file(&a, "x.jpg", 10);
+    add_file(&a, "y.jpg", 11);
+    add_file(&b, "y.jpg", 11);
+    add_file(&b, "x.jpg", 10);
+
+    // Readdir order does not matter once sorted
+    scan_directory_sort(&a);
+    scan_directory_sort(&b);
+    ASSERT_TRUE(scan_directory_equal(&a, &b));
+
+    // Edited in place: same name, new size
+    b.entries[1].stamp.size = 99;
+    ASSERT_FALSE(scan_directory_equal(&a, &b));
+
+    // A file added
+    b.entries[1].stamp.size = 11;
+    add_file(&b, "z.jpg", 12);
+    ASSERT_FALSE(scan_directory_equal(&a, &b));
+
+    scan_directory_free(&a);
+    scan_directory_free(&b);
+    TEST_PASS();
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                Main Runner                                  */
+/* -------------------------------------------------------------------------- */
+
+int main(void) {
+    TEST_SUITE_BEGIN("Scan Index Tests");
+
+    RUN_TEST(scan_index_round_trip);
+    RUN_TEST(scan_index_stores_trigrams);
+    RUN_TEST(scan_index_empty_directory);
+    RUN_TEST(scan_index_rejects_damaged_files);
+    RUN_TEST(scan_directory_equal_compares_stamps);
+
+    TEST_SUITE_END();
+    RETURN_TEST_RESULT();
+}
@@ -0,0 +1,348 @@
+/**
+ * @file test_search.c
+ * @brief Tests for incremental name search
+ */
+
+#define _GNU_SOURCE
+#include "test_framework.h"
+#include "../include/search.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+/* Names packed the way WallpaperList stores them */
+typedef struct {
+    char strings[4096];
+    size_t size;
+    uint32_t offsets[64];
+    int count;
+} Names;
+
+static void add_name(Names *names, const char *name) {
+    size_t len = strlen(name);
+    names->offsets[names->count++] = (uint32_t)names->size;
+    memcpy(names->strings + names->size, name, len + 1);
+    names->size += len + 1;
+}
+
+static Names sample_names(void) {
+    Names names;
+    memset(&names, 0, sizeof(names));
+    add_name(&names, "Mountain_Lake.jpg");
+    add_name(&names, "city-night.png");
+    add_name(&names, "mountain sunrise.JPG");
+    add_name(&names, "forest.png");
+    add_name(&names, "CITY_LIGHTS.bmp");
+    add_name(&names, "lakeside.webp");
+    return names;
+}
+
+/* The matches strcasestr() would give, for comparison */
+static bool matches_reference(const Names *names, const char *query, const int *matches, int count) {
+    int expected = 0;
+    for (int i = 0; i < names->count; i++) {
+        if (!strcasestr(names->strings + names->offsets[i], query)) continue;
+        if (expected >= count || matches[expected] != i) return false;
+        expected++;
+    }
+    return expected == count;
+}
+
+static const char* name_text(const void *data, int index, char *buffer, size_t size) {
+    (void)buffer;
+    (void)size;
+    const Names *names = data;
+    return names->strings + names->offsets[index];
+}
+
+static const int* run_query(SearchEngine *engine, const Names *names, const char *query, int *count) {
+    return search_query(engine, name_text, names, names->count, query, count);
+}
+
+/* -------------------------------------------------------------------------- */
+/*                               Test Cases                                    */
+/* -------------------------------------------------------------------------- */
+
+TEST(search_ignores_case) {
+    Names names = sample_names();
+    SearchEngine engine;
+    search_init(&engine);
+
+    int count;
+    const int *matches = run_query(&engine, &names, "CITY", &count);
+    ASSERT_EQ(2, count);
+    ASSERT_EQ(1, matches[0]);
+    ASSERT_EQ(4, matches[1]);
+
+    matches = run_query(&engine, &names, "jpg", &count);
+    ASSERT_TRUE(matches_reference(&names, "jpg", matches, count));
+    ASSERT_EQ(2, count);
+
+    // A name matching twice is listed once
+    matches = run_query(&engine, &names, "n", &count);
+    ASSERT_TRUE(matches_reference(&names, "n", matches, count));
+
+    matches = run_query(&engine, &names, "nothing", &count);
+    ASSERT_EQ(0, count);
+
+    search_free(&engine);
+    TEST_PASS();
+}
+
+TEST(search_typing_refines_and_backspace_restores) {
+    Names names = sample_names();
+    SearchEngine engine;
+    search_init(&engine);
+
+    const char *typed[] = {"l", "la", "lak", "lake"};
+    int count;
+    for (int i = 0; i < 4; i++) {
+        const int *matches = run_query(&engine, &names, typed[i], &count);
+        ASSERT_TRUE(matches_reference(&names, typed[i], matches, count));
+        ASSERT_EQ(i + 1, engine.level_count);
+    }
+    ASSERT_EQ(2, count);
+
+    // Backspace returns the cached results of the shorter query
+    const int *cached = engine.levels[1].matches;
+    const int *matches = run_query(&engine, &names, "la", &count);
+    ASSERT_TRUE(matches == cached);
+    ASSERT_EQ(2, engine.level_count);
+    ASSERT_TRUE(matches_reference(&names, "la", matches, count));
+
+    // A different query starts over
+    matches = run_query(&engine, &names, "forest", &count);
+    ASSERT_EQ(1, engine.level_count);
+    ASSERT_EQ(1, count);
+    ASSERT_EQ(3, matches[0]);
+
+    search_free(&engine);
+    TEST_PASS();
+}
+
+TEST(search_invalidate_reindexes) {
+    Names names = sample_names();
+    SearchEngine engine;
+    search_init(&engine);
+
+    int count;
+    run_query(&engine, &names, "forest", &count);
+    ASSERT_EQ(1, count);
+
+    // Same number of names, different contents: only invalidation notices
+    memcpy(names.strings + names.offsets[3], "FOREST", 6);
+    memcpy(names.strings + names.offsets[5], "forest", 6);
+    search_invalidate(&engine);
+    const int *matches = run_query(&engine, &names, "forest", &count);
+    ASSERT_EQ(2, count);
+    ASSERT_EQ(3, matches[0]);
+    ASSERT_EQ(5, matches[1]);
+
+    // A changed count is picked up on its own
+    add_name(&names, "Forest Path.jpg");
+    matches = run_query(&engine, &names, "forest", &count);
+    ASSERT_EQ(3, count);
+    ASSERT_EQ(6, matches[2]);
+
+    search_free(&engine);
+    TEST_PASS();
+}
+
+TEST(search_trigrams_match_linear_search) {
+    Names names = sample_names();
+    add_name(&names, "archive/2019/lake_district.jpg");
+    add_name(&names, "archive/2020/Night City.png");
+    add_name(&names, "aaaaaa.png");
+    SearchEngine engine;
+    search_init(&engine);
+    search_use_trigrams(&engine, true);
+
+    const char *queries[] = {"lake", "ar", "archive/20", "CITY", "e.p", "aaaa", "zzz", "ake_d"};
+    for (int i = 0; i < 8; i++) {
+        int count;
+        const int *matches = run_query(&engine, &names, queries[i], &count);
+        ASSERT_TRUE(matches_reference(&names, queries[i], matches, count));
+    }
+    ASSERT_EQ(names.count, engine.trigram_count);
+
+    // Typing on through the trigram path keeps refining correctly
+    const char *typed[] = {"n", "ni", "nig", "nigh", "night"};
+    for (int i = 0; i < 5; i++) {
+        int count;
+        const int *matches = run_query(&engine, &names, typed[i], &count);
+        ASSERT_TRUE(matches_reference(&names, typed[i], matches, count));
+    }
+
+    // Invalidation drops the trigrams along with the index
+    search_invalidate(&engine);
+    ASSERT_EQ(-1, engine.trigram_count);
+
+    search_free(&engine);
+    TEST_PASS();
+}
+
+TEST(search_adopted_trigrams_are_used) {
+    Names names = sample_names();
+    const char *texts[6];
+    for (int i = 0; i < names.count; i++) {
+        texts[i] = names.strings + names.offsets[i];
+    }
+    TrigramIndex trigrams;
+    trigram_index_init(&trigrams);
+    ASSERT_TRUE(trigram_index_build(&trigrams, texts, names.count));
+
+    SearchEngine engine;
+    search_init(&engine);
+    search_use_trigrams(&engine, true);
+    search_adopt_trigrams(&engine, &trigrams, names.count);
+    ASSERT_EQ(0u, trigrams.key_count);
+    const uint32_t *adopted = engine.trigrams.keys;
+
+    int count;
+    const int *matches = run_query(&engine, &names, "mountain", &count);
+    ASSERT_TRUE(matches_reference(&names, "mountain", matches, count));
+    ASSERT_EQ(2, count);
+    ASSERT_TRUE(engine.trigrams.keys == adopted);
+
+    search_free(&engine);
+    TEST_PASS();
+}
+
+TEST(search_fuzzy_finds_letters_in_order) {
+    Names names = sample_names();
+    add_name(&names, "nordic_fjord.jpg");
+    SearchEngine engine;
+    search_init(&engine);
+    search_set_mode(&engine, SEARCH_FUZZY);
+
+    int count;
+    const int *matches = run_query(&engine, &names, "NRDCFJRD", &count);
+    ASSERT_EQ(1, count);
+    ASSERT_EQ(6, matches[0]);
+
+    // Out of order letters do not match
+    run_query(&engine, &names, "jfn", &count);
+    ASSERT_EQ(0, count);
+
+    ASSERT_EQ(-1, search_fuzzy_score("forest", 6, "tse", 3));
+    ASSERT_TRUE(search_fuzzy_score("forest", 6, "fst", 3) >= 0);
+
+    search_free(&engine);
+    TEST_PASS();
+}
+
+TEST(search_fuzzy_ranks_best_first) {
+    Names names;
+    memset(&names, 0, sizeof(names));
+    add_name(&names, "l_a_k_e.png");
+    add_name(&names, "la kestrel.jpg");
+    add_name(&names, "Mountain_Lake.jpg");
+    add_name(&names, "lakeside.webp");
+    add_name(&names, "blake.png");
+    SearchEngine engine;
+    search_init(&engine);
+    search_set_mode(&engine, SEARCH_FUZZY);
+
+    int count;
+    const int *matches = run_query(&engine, &names, "lake", &count);
+    ASSERT_EQ(5, count);
+
+    // Whole word at the start, then after '_', then split over two words;
+    // mid-word and scattered matches come last
+    ASSERT_EQ(3, matches[0]);
+    ASSERT_EQ(2, matches[1]);
+    ASSERT_EQ(1, matches[2]);
+    for (int i = 1; i < count; i++) {
+        const char *a = names.strings + names.offsets[matches[i - 1]];
+        const char *b = names.strings + names.offsets[matches[i]];
+        char fa[64], fb[64];
+        size_t la = strlen(a), lb = strlen(b);
+        for (size_t j = 0; j <= la; j++) fa[j] = (char)tolower((unsigned char)a[j]);
+        for (size_t j = 0; j <= lb; j++) fb[j] = (char)tolower((unsigned char)b[j]);
+        ASSERT_TRUE(search_fuzzy_score(fa, la, "lake", 4) >= search_fuzzy_score(fb, lb, "lake", 4));
+    }
+
+    // Typing on refines and re-ranks; backspace returns the cached ranking
+    const int *cached = matches;
+    matches = run_query(&engine, &names, "lakes", &count);
+    ASSERT_EQ(2, count);
+    ASSERT_EQ(3, matches[0]);
+    matches = run_query(&engine, &names, "lake", &count);
+    ASSERT_TRUE(matches == cached);
+
+    search_free(&engine);
+    TEST_PASS();
+}
+
+TEST(search_fuzzy_prefilter_matches_scalar) {
+    // Enough names for the vector loop and its tail, with masks of every kind
+    Names names;
+    memset(&names, 0, sizeof(names));
+    const char *words[] = {"azure", "bq", "zebra", "quartz", "AZ", "craze", "hazy", "x"};
+    for (int i = 0; i < 63; i++) add_name(&names, words[i % 8]);
+    SearchEngine engine;
+    search_init(&engine);
+    search_set_mode(&engine, SEARCH_FUZZY);
+
+    int count;
+    const int *matches = run_query(&engine, &names, "az", &count);
+    int expected = 0;
+    for (int i = 0; i < names.count; i++) {
+        const char *name = names.strings + names.offsets[i];
+        char folded[16];
+        size_t len = strlen(name);
+        for (size_t j = 0; j <= len; j++) folded[j] = (char)tolower((unsigned char)name[j]);
+        if (search_fuzzy_score(folded, len, "az", 2) >= 0) expected++;
+    }
+    ASSERT_EQ(expected, count);
+    for (int i = 0; i < count; i++) {
+        ASSERT_TRUE(matches[i] >= 0 && matches[i] < names.count);
+    }
+
+    search_free(&engine);
+    TEST_PASS();
+}
+
+TEST(search_mode_names) {
+    SearchMode mode;
+    ASSERT_TRUE(search_mode_parse("fuzzy", &mode));
+    ASSERT_EQ(SEARCH_FUZZY, mode);
+    ASSERT_TRUE(search_mode_parse("Substring", &mode));
+    ASSERT_EQ(SEARCH_SUBSTRING, mode);
+    ASSERT_FALSE(search_mode_parse("regex", &mode));
+    ASSERT_STR_EQ("fuzzy", search_mode_name(SEARCH_FUZZY));
+    TEST_PASS();
+}
+
+TEST(search_char_mask_covers_substrings) {
+    uint64_t name = search_char_mask("Mountain_Lake.jpg", 17);
+    uint64_t query = search_char_mask("LAKE", 4);
+    ASSERT_TRUE((query & ~name) == 0);
+    ASSERT_TRUE((search_char_mask("zq", 2) & ~name) != 0);
+    ASSERT_TRUE(search_char_mask("a", 1) == search_char_mask("A", 1));
+    TEST_PASS();
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                Main Runner                                  */
+/* -------------------------------------------------------------------------- */
+
+int main(void) {
+    TEST_SUITE_BEGIN("Search Tests");
+
+    RUN_TEST(search_ignores_case);
+    RUN_TEST(search_typing_refines_and_backspace_restores);
+    RUN_TEST(search_invalidate_reindexes);
+    RUN_TEST(search_trigrams_match_linear_search);
+    RUN_TEST(search_adopted_trigrams_are_used);
+    RUN_TEST(search_fuzzy_finds_letters_in_order);
+    RUN_TEST(search_fuzzy_ranks_best_first);
+    RUN_TEST(search_fuzzy_prefilter_matches_scalar);
+    RUN_TEST(search_mode_names);
+    RUN_TEST(search_char_mask_covers_substrings);
+
+    TEST_SUITE_END();
+    RETURN_TEST_RESULT();
+}
@@ -0,0 +1,372 @@
+/**
+ * @file test_thumbnail_atlas.c
+ * @brief Tests for the memory-mapped thumbnail atlas
+ */
+
+#include "test_framework.h"
+#include "../include/thumbnail_atlas.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#define THUMB_W 8
+#define THUMB_H 6
+
+/* Helper to build a unique temporary atlas path */
+static const char* temp_atlas_path(void) {
+    static char path[256];
+    snprintf(path, sizeof(path), "/tmp/vista_test_atlas_%d.atlas", getpid());
+    return path;
+}
+
+static void make_key(uint8_t key[THUMBNAIL_ATLAS_KEY_SIZE], int n) {
+    for (int i = 0; i < THUMBNAIL_ATLAS_KEY_SIZE; i++) {
+        key[i] = (uint8_t)(n * 31 + i * 7);
+    }
+    key[0] = (uint8_t)(n & 0xff);
+    key[1] = (uint8_t)(n >> 8);
+}
+
+static void fill_pixels(uint8_t *pixels, int seed) {
+    for (int i = 0; i < THUMB_W * THUMB_H * 4; i++) {
+        pixels[i] = (uint8_t)(seed + i);
+    }
+}
+
+static bool pixels_match(const uint8_t *pixels, int seed) {
+    for (int i = 0; i < THUMB_W * THUMB_H * 4; i++) {
+        if (pixels[i] != (uint8_t)(seed + i)) return false;
+    }
+    return true;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                               Test Cases                                    */
+/* -------------------------------------------------------------------------- */
+
+TEST(atlas_store_and_lookup) {
+    const char *path = temp_atlas_path();
+    unlink(path);
+
+    ThumbnailAtlas *atlas = thumbnail_atlas_open(path, THUMB_W, THUMB_H);
+    ASSERT(atlas != NULL);
+
+    uint8_t key[THUMBNAIL_ATLAS_KEY_SIZE];
+    uint8_t pixels[THUMB_W * THUMB_H * 4];
+    ThumbnailStamp stamp = {1700000000, 123456, 42};
+    make_key(key, 1);
+    fill_pixels(pixels, 1);
+
+    ASSERT(thumbnail_atlas_lookup(atlas, key, &stamp, NULL, NULL, NULL) == NULL);
+    ASSERT_TRUE(thumbnail_atlas_store(atlas, key, &stamp, 0, pixels, sizeof(pixels), NULL));
+
+    uint32_t codec = 99;
+    size_t length = 0;
+    const uint8_t *cached = thumbnail_atlas_lookup(atlas, key, &stamp, &codec, &length, NULL);
+    ASSERT(cached != NULL);
+    ASSERT_TRUE(pixels_match(cached, 1));
+    ASSERT_EQ(0, codec);
+    ASSERT_EQ(sizeof(pixels), length);
+    ASSERT_EQ(1, thumbnail_atlas_count(atlas));
+
+    thumbnail_atlas_close(atlas);
+    unlink(path);
+    TEST_PASS();
+}
+
+TEST(atlas_persists_across_open) {
+    const char *path = temp_atlas_path();
+    unlink(path);
+
+    // Enough entries to span several chunks
+    ThumbnailAtlas *atlas = thumbnail_atlas_open(path, THUMB_W, THUMB_H);
+    ASSERT(atlas != NULL);
+
+    uint8_t key[THUMBNAIL_ATLAS_KEY_SIZE];
+    uint8_t pixels[THUMB_W * THUMB_H * 4];
+    ThumbnailStamp stamp = {1700000000, 123456, 42};
+    for (int n = 0; n < 600; n++) {
+        make_key(key, n);
+        fill_pixels(pixels, n);
+        ASSERT_TRUE(thumbnail_atlas_store(atlas, key, &stamp, 0, pixels, sizeof(pixels), NULL));
+    }
+    thumbnail_atlas_close(atlas);
+
+    atlas = thumbnail_atlas_open(path, THUMB_W, THUMB_H);
+    ASSERT(atlas != NULL);
+    ASSERT_EQ(600, thumbnail_atlas_count(atlas));
+
+    for (int n = 0; n < 600; n++) {
+        make_key(key, n);
+        const uint8_t *cached = thumbnail_atlas_lookup(atlas, key, &stamp, NULL, NULL, NULL);
+        ASSERT(cached != NULL);
+        ASSERT_TRUE(pixels_match(cached, n));
+    }
+
+    thumbnail_atlas_close(atlas);
+    unlink(path);
+    TEST_PASS();
+}
+
+TEST(atlas_replace_entry) {
+    const char *path = temp_atlas_path();
+    unlink(path);
+
+    ThumbnailAtlas *atlas = thumbnail_atlas_open(path, THUMB_W, THUMB_H);
+    ASSERT(atlas != NULL);
+
+    uint8_t key[THUMBNAIL_ATLAS_KEY_SIZE];
+    uint8_t pixels[THUMB_W * THUMB_H * 4];
+    ThumbnailStamp stamp = {1700000000, 123456, 42};
+    make_key(key, 5);
+    fill_pixels(pixels, 10);
+    ASSERT_TRUE(thumbnail_atlas_store(atlas, key, &stamp, 0, pixels, sizeof(pixels), NULL));
+    fill_pixels(pixels, 20);
+    ASSERT_TRUE(thumbnail_atlas_store(atlas, key, &stamp, 0, pixels, sizeof(pixels), NULL));
+
+    ASSERT_EQ(1, thumbnail_atlas_count(atlas));
+    ASSERT_TRUE(pixels_match(thumbnail_atlas_lookup(atlas, key, &stamp, NULL, NULL, NULL), 20));
+    thumbnail_atlas_close(atlas);
+
+    // The replaced slot must stay dead after reopening
+    atlas = thumbnail_atlas_open(path, THUMB_W, THUMB_H);
+    ASSERT(atlas != NULL);
+    ASSERT_EQ(1, thumbnail_atlas_count(atlas));
+    ASSERT_TRUE(pixels_match(thumbnail_atlas_lookup(atlas, key, &stamp, NULL, NULL, NULL), 20));
+
+    thumbnail_atlas_close(atlas);
+    unlink(path);
+    TEST_PASS();
+}
+
+TEST(atlas_changed_file_is_stale) {
+    const char *path = temp_atlas_path();
+    unlink(path);
+
+    ThumbnailAtlas *atlas = thumbnail_atlas_open(path, THUMB_W, THUMB_H);
+    ASSERT(atlas != NULL);
+
+    uint8_t key[THUMBNAIL_ATLAS_KEY_SIZE];
+    uint8_t pixels[THUMB_W * THUMB_H * 4];
+    ThumbnailStamp stamp = {1700000000, 123456, 42};
+    make_key(key, 7);
+    fill_pixels(pixels, 7);
+    ASSERT_TRUE(thumbnail_atlas_store(atlas, key, &stamp, 0, pixels, sizeof(pixels), NULL));
+
+    // Any change to mtime, size or inode must miss
+    ThumbnailStamp edited = stamp;
+    edited.mtime++;
+    ASSERT(thumbnail_atlas_lookup(atlas, key, &edited, NULL, NULL, NULL) == NULL);
+    edited = stamp;
+    edited.size = 654321;
+    ASSERT(thumbnail_atlas_lookup(atlas, key, &edited, NULL, NULL, NULL) == NULL);
+    edited = stamp;
+    edited.inode = 43;
+    ASSERT(thumbnail_atlas_lookup(atlas, key, &edited, NULL, NULL, NULL) == NULL);
+
+    // Regenerating replaces the stale entry
+    fill_pixels(pixels, 8);
+    ASSERT_TRUE(thumbnail_atlas_store(atlas, key, &edited, 0, pixels, sizeof(pixels), NULL));
+    ASSERT(thumbnail_atlas_lookup(atlas, key, &stamp, NULL, NULL, NULL) == NULL);
+    ASSERT_TRUE(pixels_match(thumbnail_atlas_lookup(atlas, key, &edited, NULL, NULL, NULL), 8));
+    ASSERT_EQ(1, thumbnail_atlas_count(atlas));
+
+    thumbnail_atlas_close(atlas);
+    unlink(path);
+    TEST_PASS();
+}
+
+TEST(atlas_keeps_codec_length_and_info) {
+    const char *path = temp_atlas_path();
+    unlink(path);
+
+    ThumbnailAtlas *atlas = thumbnail_atlas_open(path, THUMB_W, THUMB_H);
+    ASSERT(atlas != NULL);
+
+    uint8_t key[THUMBNAIL_ATLAS_KEY_SIZE];
+    uint8_t alias_key[THUMBNAIL_ATLAS_KEY_SIZE];
+    uint8_t pixels[THUMB_W * THUMB_H * 4];
+    ThumbnailStamp stamp = {1700000000, 123456, 42};
+    make_key(key, 1);
+    make_key(alias_key, 2);
+    fill_pixels(pixels, 4);
+
+    uint8_t info[THUMBNAIL_ATLAS_INFO_SIZE];
+    for (int i = 0; i < THUMBNAIL_ATLAS_INFO_SIZE; i++) info[i] = (uint8_t)(200 + i);
+
+    // Compressed data is shorter than the slot; oversized data is refused
+    ASSERT_TRUE(thumbnail_atlas_store(atlas, key, &stamp, 2, pixels, 57, info));
+    ASSERT_TRUE(thumbnail_atlas_alias(atlas, alias_key, &stamp, key));
+    uint8_t big[THUMB_W * THUMB_H * 8];
+    ASSERT_FALSE(thumbnail_atlas_store(atlas, key, &stamp, 0, big, sizeof(big), NULL));
+    thumbnail_atlas_close(atlas);
+
+    atlas = thumbnail_atlas_open(path, THUMB_W, THUMB_H);
+    ASSERT(atlas != NULL);
+    uint32_t codec = 0;
+    size_t length = 0;
+    uint8_t cached_info[THUMBNAIL_ATLAS_INFO_SIZE];
+    const uint8_t *cached = thumbnail_atlas_lookup(atlas, alias_key, &stamp, &codec, &length, cached_info);
+    ASSERT(cached != NULL);
+    ASSERT_EQ(2, codec);
+    ASSERT_EQ(57, length);
+    ASSERT_TRUE(memcmp(cached, pixels, 57) == 0);
+    // The alias carries the info of the entry it shares
+    ASSERT_TRUE(memcmp(cached_info, info, sizeof(info)) == 0);
+
+    thumbnail_atlas_close(atlas);
+    unlink(path);
+    TEST_PASS();
+}
+
+TEST(atlas_alias_shares_pixels) {
+    const char *path = temp_atlas_path();
+    unlink(path);
+
+    ThumbnailAtlas *atlas = thumbnail_atlas_open(path, THUMB_W, THUMB_H);
+    ASSERT(atlas != NULL);
+
+    uint8_t content_key[THUMBNAIL_ATLAS_KEY_SIZE];
+    uint8_t path_key[THUMBNAIL_ATLAS_KEY_SIZE];
+    uint8_t missing_key[THUMBNAIL_ATLAS_KEY_SIZE];
+    uint8_t pixels[THUMB_W * THUMB_H * 4];
+    ThumbnailStamp stamp = {1700000000, 123456, 42};
+    make_key(content_key, 1);
+    make_key(path_key, 2);
+    make_key(missing_key, 3);
+    fill_pixels(pixels, 9);
+
+    ASSERT_TRUE(thumbnail_atlas_store(atlas, content_key, &stamp, 0, pixels, sizeof(pixels), NULL));
+    ASSERT_TRUE(thumbnail_atlas_alias(atlas, path_key, &stamp, content_key));
+    ASSERT_FALSE(thumbnail_atlas_alias(atlas, path_key, &stamp, missing_key));
+    ASSERT(thumbnail_atlas_lookup(atlas, path_key, &stamp, NULL, NULL, NULL) ==
+           thumbnail_atlas_lookup(atlas, content_key, NULL, NULL, NULL, NULL));
+    thumbnail_atlas_close(atlas);
+
+    // Aliases survive reopening
+    atlas = thumbnail_atlas_open(path, THUMB_W, THUMB_H);
+    ASSERT(atlas != NULL);
+    ASSERT_EQ(2, thumbnail_atlas_count(atlas));
+    ASSERT_TRUE(pixels_match(thumbnail_atlas_lookup(atlas, path_key, &stamp, NULL, NULL, NULL), 9));
+
+    thumbnail_atlas_close(atlas);
+    unlink(path);
+    TEST_PASS();
+}
+
+static long long file_size(const char *path) {
+    struct stat st;
+    return stat(path, &st) == 0 ? (long long)st.st_size : -1;
+}
+
+TEST(atlas_compacts_replaced_entries) {
+    const char *path = temp_atlas_path();
+    unlink(path);
+
+    ThumbnailAtlas *atlas = thumbnail_atlas_open(path, THUMB_W, THUMB_H);
+    ASSERT(atlas != NULL);
+
+    uint8_t key[THUMBNAIL_ATLAS_KEY_SIZE];
+    uint8_t alias_key[THUMBNAIL_ATLAS_KEY_SIZE];
+    uint8_t pixels[THUMB_W * THUMB_H * 4];
+    uint8_t info[THUMBNAIL_ATLAS_INFO_SIZE] = {7};
+    ThumbnailStamp stamp = {1700000000, 123456, 42};
+
+    // An alias whose target is replaced keeps the pixels it was made with
+    make_key(key, 0);
+    make_key(alias_key, 100);
+    fill_pixels(pixels, 50);
+    ASSERT_TRUE(thumbnail_atlas_store(atlas, key, &stamp, 0, pixels, sizeof(pixels), info));
+    ASSERT_TRUE(thumbnail_atlas_alias(atlas, alias_key, &stamp, key));
+
+    // Ten thumbnails regenerated many times over: a thousand slots, ten live
+    for (int round = 0; round < 100; round++) {
+        for (int n = 0; n < 10; n++) {
+            make_key(key, n);
+            fill_pixels(pixels, n + round);
+            ASSERT_TRUE(thumbnail_atlas_store(atlas, key, &stamp, 3, pixels, sizeof(pixels), NULL));
+        }
+    }
+    ASSERT_EQ(11, thumbnail_atlas_count(atlas));
+    thumbnail_atlas_close(atlas);
+    long long before = file_size(path);
+
+    atlas = thumbnail_atlas_open(path, THUMB_W, THUMB_H);
+    ASSERT(atlas != NULL);
+    ASSERT_TRUE(file_size(path) < before);
+    ASSERT_EQ(11, thumbnail_atlas_count(atlas));
+    for (int n = 0; n < 10; n++) {
+        make_key(key, n);
+        uint32_t codec = 0;
+        const uint8_t *cached = thumbnail_atlas_lookup(atlas, key, &stamp, &codec, NULL, NULL);
+        ASSERT(cached != NULL);
+        ASSERT_TRUE(pixels_match(cached, n + 99));
+        ASSERT_EQ(3, codec);
+    }
+    uint8_t alias_info[THUMBNAIL_ATLAS_INFO_SIZE];
+    ASSERT_TRUE(pixels_match(thumbnail_atlas_lookup(atlas, alias_key, &stamp, NULL, NULL, alias_info), 50));
+    ASSERT_EQ(7, alias_info[0]);
+
+    // New entries go after the copied ones, and all of it survives another open
+    make_key(key, 20);
+    fill_pixels(pixels, 20);
+    ASSERT_TRUE(thumbnail_atlas_store(atlas, key, &stamp, 0, pixels, sizeof(pixels), NULL));
+    thumbnail_atlas_close(atlas);
+
+    atlas = thumbnail_atlas_open(path, THUMB_W, THUMB_H);
+    ASSERT(atlas != NULL);
+    ASSERT_EQ(12, thumbnail_atlas_count(atlas));
+    ASSERT_TRUE(pixels_match(thumbnail_atlas_lookup(atlas, key, &stamp, NULL, NULL, NULL), 20));
+    ASSERT_TRUE(pixels_match(thumbnail_atlas_lookup(atlas, alias_key, &stamp, NULL, NULL, NULL), 50));
+
+    thumbnail_atlas_close(atlas);
+    unlink(path);
+    TEST_PASS();
+}
+
+TEST(atlas_size_change_discards_entries) {
+    const char *path = temp_atlas_path();
+    unlink(path);
+
+    ThumbnailAtlas *atlas = thumbnail_atlas_open(path, THUMB_W, THUMB_H);
+    ASSERT(atlas != NULL);
+
+    uint8_t key[THUMBNAIL_ATLAS_KEY_SIZE];
+    uint8_t pixels[THUMB_W * THUMB_H * 4];
+    ThumbnailStamp stamp = {1700000000, 123456, 42};
+    make_key(key, 3);
+    fill_pixels(pixels, 3);
+    ASSERT_TRUE(thumbnail_atlas_store(atlas, key, &stamp, 0, pixels, sizeof(pixels), NULL));
+    thumbnail_atlas_close(atlas);
+
+    atlas = thumbnail_atlas_open(path, THUMB_W * 2, THUMB_H);
+    ASSERT(atlas != NULL);
+    ASSERT_EQ(0, thumbnail_atlas_count(atlas));
+    ASSERT(thumbnail_atlas_lookup(atlas, key, &stamp, NULL, NULL, NULL) == NULL);
+
+    thumbnail_atlas_close(atlas);
+    unlink(path);
+    TEST_PASS();
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                Main Runner                                  */
+/* -------------------------------------------------------------------------- */
+
+int main(void) {
+    TEST_SUITE_BEGIN("Thumbnail Atlas Tests");
+
+    RUN_TEST(atlas_store_and_lookup);
+    RUN_TEST(atlas_persists_across_open);
+    RUN_TEST(atlas_replace_entry);
+    RUN_TEST(atlas_changed_file_is_stale);
+    RUN_TEST(atlas_alias_shares_pixels);
+    RUN_TEST(atlas_keeps_codec_length_and_info);
+    RUN_TEST(atlas_compacts_replaced_entries);
+    RUN_TEST(atlas_size_change_discards_entries);
+
+    TEST_SUITE_END();
+    RETURN_TEST_RESULT();
+}
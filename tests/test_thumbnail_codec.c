@@ -0,0 +1,155 @@
+/**
+ * @file test_thumbnail_codec.c
+ * @brief Tests for the thumbnail cache codecs
+ */
+
+#include "test_framework.h"
+#include "../include/thumbnail_codec.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#define IMG_W 37
+#define IMG_H 23
+
+/* Image with flat areas, gradients, noise and alpha changes to hit every op */
+static void fill_image(uint8_t *pixels, int pitch) {
+    uint32_t seed = 12345;
+    for (int y = 0; y < IMG_H; y++) {
+        uint8_t *row = pixels + y * pitch;
+        for (int x = 0; x < IMG_W; x++) {
+            uint8_t *p = row + x * 4;
+            seed = seed * 1103515245u + 12345u;
+            if (y < 5) {
+                p[0] = 10; p[1] = 20; p[2] = 30; p[3] = 255;
+            } else if (y < 12) {
+                p[0] = (uint8_t)(x * 3); p[1] = (uint8_t)(y * 5 + x); p[2] = (uint8_t)(x + y); p[3] = 255;
+            } else {
+                p[0] = (uint8_t)(seed >> 24); p[1] = (uint8_t)(seed >> 16);
+                p[2] = (uint8_t)(seed >> 8); p[3] = (uint8_t)(x % 3 == 0 ? 128 : 255);
+            }
+        }
+    }
+}
+
+static bool images_equal(const uint8_t *a, int pitch_a, const uint8_t *b, int pitch_b) {
+    for (int y = 0; y < IMG_H; y++) {
+        if (memcmp(a + y * pitch_a, b + y * pitch_b, IMG_W * 4) != 0) return false;
+    }
+    return true;
+}
+
+/* Encode then decode with padded rows on both sides */
+static bool roundtrip(ThumbnailCodec codec, size_t *encoded_length) {
+    const int pitch = IMG_W * 4 + 12;
+    uint8_t *src = calloc(1, pitch * IMG_H);
+    uint8_t *dst = calloc(1, pitch * IMG_H);
+    size_t capacity = thumbnail_codec_bound(codec, IMG_W, IMG_H);
+    uint8_t *encoded = malloc(capacity);
+
+    fill_image(src, pitch);
+    *encoded_length = thumbnail_codec_encode(codec, src, IMG_W, IMG_H, pitch, encoded, capacity);
+    bool ok = *encoded_length > 0 &&
+              thumbnail_codec_decode(codec, encoded, *encoded_length, dst, IMG_W, IMG_H, pitch) &&
+              images_equal(src, pitch, dst, pitch);
+
+    free(src);
+    free(dst);
+    free(encoded);
+    return ok;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                               Test Cases                                    */
+/* -------------------------------------------------------------------------- */
+
+TEST(codec_parse_names) {
+    ThumbnailCodec codec;
+
+    ASSERT_TRUE(thumbnail_codec_parse("raw", &codec));
+    ASSERT_EQ(THUMBNAIL_CODEC_RAW, codec);
+    ASSERT_TRUE(thumbnail_codec_parse("qoi", &codec));
+    ASSERT_EQ(THUMBNAIL_CODEC_QOI, codec);
+    ASSERT_TRUE(thumbnail_codec_parse("lz4", &codec));
+    ASSERT_EQ(THUMBNAIL_CODEC_LZ4, codec);
+    ASSERT_TRUE(thumbnail_codec_parse("png", &codec));
+    ASSERT_EQ(THUMBNAIL_CODEC_PNG, codec);
+    ASSERT_FALSE(thumbnail_codec_parse("webp", &codec));
+    ASSERT_STR_EQ("lz4", thumbnail_codec_name(THUMBNAIL_CODEC_LZ4));
+
+    TEST_PASS();
+}
+
+TEST(codec_raw_roundtrip) {
+    size_t length;
+    ASSERT_TRUE(roundtrip(THUMBNAIL_CODEC_RAW, &length));
+    ASSERT_EQ(IMG_W * IMG_H * 4, (int)length);
+    TEST_PASS();
+}
+
+TEST(codec_qoi_roundtrip) {
+    size_t length;
+    ASSERT_TRUE(roundtrip(THUMBNAIL_CODEC_QOI, &length));
+    ASSERT_TRUE(length < (size_t)IMG_W * IMG_H * 4);
+    TEST_PASS();
+}
+
+TEST(codec_lz4_roundtrip) {
+    size_t length;
+    ASSERT_TRUE(roundtrip(THUMBNAIL_CODEC_LZ4, &length));
+    ASSERT_TRUE(length < (size_t)IMG_W * IMG_H * 4);
+    TEST_PASS();
+}
+
+TEST(codec_rejects_truncated_input) {
+    uint8_t src[IMG_W * IMG_H * 4];
+    uint8_t dst[IMG_W * IMG_H * 4];
+    uint8_t encoded[IMG_W * IMG_H * 5 + 64];
+    fill_image(src, IMG_W * 4);
+
+    ThumbnailCodec codecs[] = {THUMBNAIL_CODEC_QOI, THUMBNAIL_CODEC_LZ4};
+    for (int i = 0; i < 2; i++) {
+        size_t length = thumbnail_codec_encode(codecs[i], src, IMG_W, IMG_H, IMG_W * 4,
+                                               encoded, sizeof(encoded));
+        ASSERT_TRUE(length > 0);
+        ASSERT_FALSE(thumbnail_codec_decode(codecs[i], encoded, length / 2,
+                                            dst, IMG_W, IMG_H, IMG_W * 4));
+    }
+
+    // Wrong dimensions are caught by the QOI header
+    size_t length = thumbnail_codec_encode(THUMBNAIL_CODEC_QOI, src, IMG_W, IMG_H, IMG_W * 4,
+                                           encoded, sizeof(encoded));
+    ASSERT_FALSE(thumbnail_codec_decode(THUMBNAIL_CODEC_QOI, encoded, length,
+                                        dst, IMG_W - 1, IMG_H, IMG_W * 4));
+    TEST_PASS();
+}
+
+TEST(codec_output_too_small) {
+    uint8_t src[IMG_W * IMG_H * 4];
+    uint8_t encoded[64];
+    fill_image(src, IMG_W * 4);
+
+    ASSERT_EQ(0, (int)thumbnail_codec_encode(THUMBNAIL_CODEC_RAW, src, IMG_W, IMG_H, IMG_W * 4,
+                                             encoded, sizeof(encoded)));
+    ASSERT_EQ(0, (int)thumbnail_codec_encode(THUMBNAIL_CODEC_LZ4, src, IMG_W, IMG_H, IMG_W * 4,
+                                             encoded, sizeof(encoded)));
+    TEST_PASS();
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                Main Runner                                  */
+/* -------------------------------------------------------------------------- */
+
+int main(void) {
+    TEST_SUITE_BEGIN("Thumbnail Codec Tests");
+
+    RUN_TEST(codec_parse_names);
+    RUN_TEST(codec_raw_roundtrip);
+    RUN_TEST(codec_qoi_roundtrip);
+    RUN_TEST(codec_lz4_roundtrip);
+    RUN_TEST(codec_rejects_truncated_input);
+    RUN_TEST(codec_output_too_small);
+
+    TEST_SUITE_END();
+    RETURN_TEST_RESULT();
+}
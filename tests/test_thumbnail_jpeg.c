@@ -0,0 +1,172 @@
+/**
+ * @file test_thumbnail_jpeg.c
+ * @brief Tests for reduced-size JPEG decoding
+ */
+
+#define _GNU_SOURCE
+#include "test_framework.h"
+#include "../include/thumbnail_jpeg.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
+
+#ifdef HAVE_LIBJPEG
+#include <jpeglib.h>
+
+/* Helper to build a unique temporary file path */
+static const char* temp_path(const char *suffix) {
+    static char path[256];
+    snprintf(path, sizeof(path), "/tmp/vista_test_jpeg_%d%s", getpid(), suffix);
+    return path;
+}
+
+/* Write a solid-colour JPEG of the given size */
+static bool write_jpeg(const char *path, int width, int height, uint8_t r, uint8_t g, uint8_t b) {
+    FILE *file = fopen(path, "wb");
+    if (!file) return false;
+
+    struct jpeg_compress_struct cinfo;
+    struct jpeg_error_mgr jerr;
+    cinfo.err = jpeg_std_error(&jerr);
+    jpeg_create_compress(&cinfo);
+    jpeg_stdio_dest(&cinfo, file);
+
+    cinfo.image_width = (JDIMENSION)width;
+    cinfo.image_height = (JDIMENSION)height;
+    cinfo.input_components = 3;
+    cinfo.in_color_space = JCS_RGB;
+    jpeg_set_defaults(&cinfo);
+    jpeg_set_quality(&cinfo, 90, TRUE);
+    jpeg_start_compress(&cinfo, TRUE);
+
+    uint8_t *row = malloc((size_t)width * 3);
+    for (int x = 0; x < width; x++) {
+        row[x * 3 + 0] = r;
+        row[x * 3 + 1] = g;
+        row[x * 3 + 2] = b;
+    }
+    while (cinfo.next_scanline < cinfo.image_height) {
+        JSAMPROW rows[1] = {row};
+        jpeg_write_scanlines(&cinfo, rows, 1);
+    }
+
+    jpeg_finish_compress(&cinfo);
+    jpeg_destroy_compress(&cinfo);
+    free(row);
+    fclose(file);
+    return true;
+}
+#endif
+
+/* -------------------------------------------------------------------------- */
+/*                               Test Cases                                    */
+/* -------------------------------------------------------------------------- */
+
+TEST(jpeg_scale_denom_covers_target) {
+    // 6000x4000 at 1/8 is 750x500, plenty for a 200x150 thumbnail
+    ASSERT_EQ(8, thumbnail_jpeg_scale_denom(6000, 4000, 200, 150));
+
+    // Exactly the target size is enough
+    ASSERT_EQ(8, thumbnail_jpeg_scale_denom(1600, 1200, 200, 150));
+
+    // One pixel short in either direction drops to the next scale
+    ASSERT_EQ(4, thumbnail_jpeg_scale_denom(1600, 1200, 201, 150));
+    ASSERT_EQ(4, thumbnail_jpeg_scale_denom(1600, 1200, 200, 151));
+
+    // Rounding up counts: 1601 / 8 decodes to 201 pixels
+    ASSERT_EQ(8, thumbnail_jpeg_scale_denom(1601, 1200, 201, 150));
+
+    ASSERT_EQ(2, thumbnail_jpeg_scale_denom(400, 300, 200, 150));
+    ASSERT_EQ(1, thumbnail_jpeg_scale_denom(300, 200, 200, 150));
+    ASSERT_EQ(1, thumbnail_jpeg_scale_denom(100, 100, 200, 150));
+    TEST_PASS();
+}
+
+#ifdef HAVE_LIBJPEG
+TEST(jpeg_decodes_at_reduced_size) {
+    const char *path = temp_path(".jpg");
+    ASSERT_TRUE(write_jpeg(path, 1600, 1000, 200, 40, 30));
+
+    int width = 0, height = 0;
+    ThumbnailJpeg *jpeg = thumbnail_jpeg_open(path, 300, 150, &width, &height);
+    ASSERT_TRUE(jpeg != NULL);
+    ASSERT_EQ(400, width);
+    ASSERT_EQ(250, height);
+
+    // Padded rows to check the pitch is honoured
+    int pitch = width * 4 + 16;
+    uint8_t *pixels = calloc(1, (size_t)pitch * height);
+    ASSERT_TRUE(thumbnail_jpeg_read(jpeg, pixels, pitch));
+    thumbnail_jpeg_close(jpeg);
+
+    uint8_t *p = pixels + (height / 2) * pitch + (width / 2) * 4;
+    ASSERT_TRUE(abs(p[0] - 200) <= 4);
+    ASSERT_TRUE(abs(p[1] - 40) <= 4);
+    ASSERT_TRUE(abs(p[2] - 30) <= 4);
+    ASSERT_EQ(255, p[3]);
+
+    // Padding after the last pixel of a row is left alone
+    ASSERT_EQ(0, pixels[width * 4]);
+
+    free(pixels);
+    unlink(path);
+    TEST_PASS();
+}
+
+TEST(jpeg_rejects_other_files) {
+    const char *path = temp_path(".png");
+    FILE *file = fopen(path, "wb");
+    ASSERT_TRUE(file != NULL);
+    fputs("\x89PNG\r\n\x1a\n not really a png", file);
+    fclose(file);
+
+    int width, height;
+    ASSERT_TRUE(thumbnail_jpeg_open(path, 10, 10, &width, &height) == NULL);
+    ASSERT_TRUE(thumbnail_jpeg_open("/nonexistent/vista.jpg", 10, 10, &width, &height) == NULL);
+
+    unlink(path);
+    TEST_PASS();
+}
+
+TEST(jpeg_truncated_file_fails_cleanly) {
+    const char *path = temp_path("_cut.jpg");
+    ASSERT_TRUE(write_jpeg(path, 640, 480, 10, 200, 10));
+    ASSERT_EQ(0, truncate(path, 400));
+
+    int width = 0, height = 0;
+    ThumbnailJpeg *jpeg = thumbnail_jpeg_open(path, 80, 60, &width, &height);
+    if (jpeg) {
+        // Header survived; the scan data is padded out rather than crashing
+        uint8_t *pixels = malloc((size_t)width * height * 4);
+        thumbnail_jpeg_read(jpeg, pixels, width * 4);
+        thumbnail_jpeg_close(jpeg);
+        free(pixels);
+    }
+
+    // Cut inside the header: open fails instead of returning a decoder
+    ASSERT_EQ(0, truncate(path, 20));
+    ASSERT_TRUE(thumbnail_jpeg_open(path, 80, 60, &width, &height) == NULL);
+
+    unlink(path);
+    TEST_PASS();
+}
+#endif
+
+/* -------------------------------------------------------------------------- */
+/*                                Main Runner                                  */
+/* -------------------------------------------------------------------------- */
+
+int main(void) {
+    TEST_SUITE_BEGIN("Thumbnail JPEG Tests");
+
+    RUN_TEST(jpeg_scale_denom_covers_target);
+#ifdef HAVE_LIBJPEG
+    RUN_TEST(jpeg_decodes_at_reduced_size);
+    RUN_TEST(jpeg_rejects_other_files);
+    RUN_TEST(jpeg_truncated_file_fails_cleanly);
+#endif
+
+    TEST_SUITE_END();
+    RETURN_TEST_RESULT();
+}
@@ -0,0 +1,118 @@
+/**
+ * @file test_thumbnail_palette.c
+ * @brief Tests for thumbnail average and dominant colours
+ */
+
+#include "test_framework.h"
+#include "../include/thumbnail_palette.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* Fill rows [y0, y1) of an RGBA image with one colour */
+static void fill_rows(uint8_t *pixels, int width, int pitch, int y0, int y1,
+                      uint8_t r, uint8_t g, uint8_t b) {
+    for (int y = y0; y < y1; y++) {
+        uint8_t *p = pixels + (size_t)y * pitch;
+        for (int x = 0; x < width; x++, p += 4) {
+            p[0] = r;
+            p[1] = g;
+            p[2] = b;
+            p[3] = 255;
+        }
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+/*                               Test Cases                                    */
+/* -------------------------------------------------------------------------- */
+
+TEST(palette_of_solid_image) {
+    uint8_t pixels[8 * 8 * 4];
+    fill_rows(pixels, 8, 32, 0, 8, 200, 100, 50);
+
+    ThumbnailPalette palette;
+    thumbnail_palette_compute(pixels, 8, 8, 32, &palette);
+    ASSERT_TRUE(thumbnail_palette_known(&palette));
+    ASSERT_EQ(200, palette.average[0]);
+    ASSERT_EQ(100, palette.average[1]);
+    ASSERT_EQ(50, palette.average[2]);
+
+    // One colour covering everything, and no others
+    ASSERT_EQ(200, palette.colors[0][0]);
+    ASSERT_EQ(100, palette.colors[0][1]);
+    ASSERT_EQ(50, palette.colors[0][2]);
+    ASSERT_EQ(255, palette.colors[0][3]);
+    ASSERT_EQ(0, palette.colors[1][3]);
+    ASSERT_EQ(0, palette.colors[2][3]);
+    TEST_PASS();
+}
+
+TEST(palette_orders_colors_by_share) {
+    // Rows padded past the width, as SDL surfaces may be
+    int width = 10, height = 20, pitch = 48;
+    uint8_t *pixels = calloc((size_t)pitch * height, 1);
+    ASSERT_TRUE(pixels != NULL);
+    fill_rows(pixels, width, pitch, 0, 4, 250, 10, 10);      // 20% red
+    fill_rows(pixels, width, pitch, 4, 14, 10, 10, 250);     // 50% blue
+    fill_rows(pixels, width, pitch, 14, 20, 10, 250, 10);    // 30% green
+
+    ThumbnailPalette palette;
+    thumbnail_palette_compute(pixels, width, height, pitch, &palette);
+    free(pixels);
+
+    ASSERT_EQ(10, palette.colors[0][0]);
+    ASSERT_EQ(250, palette.colors[0][2]);
+    ASSERT_EQ(128, palette.colors[0][3]);
+    ASSERT_EQ(250, palette.colors[1][1]);
+    ASSERT_EQ(77, palette.colors[1][3]);
+    ASSERT_EQ(250, palette.colors[2][0]);
+    ASSERT_EQ(51, palette.colors[2][3]);
+
+    // The exact mean of every pixel, padding excluded
+    ASSERT_EQ(58, palette.average[0]);
+    ASSERT_EQ(82, palette.average[1]);
+    ASSERT_EQ(130, palette.average[2]);
+    TEST_PASS();
+}
+
+TEST(palette_skips_near_duplicates) {
+    // Two shades a few steps apart land in neighbouring bins
+    uint8_t pixels[4 * 10 * 4];
+    fill_rows(pixels, 4, 16, 0, 5, 127, 127, 127);
+    fill_rows(pixels, 4, 16, 5, 9, 129, 129, 129);
+    fill_rows(pixels, 4, 16, 9, 10, 0, 0, 0);
+
+    ThumbnailPalette palette;
+    thumbnail_palette_compute(pixels, 4, 10, 16, &palette);
+
+    ASSERT_EQ(127, palette.colors[0][0]);
+    ASSERT_EQ(0, palette.colors[1][0]);
+    ASSERT_EQ(26, palette.colors[1][3]);
+    ASSERT_EQ(0, palette.colors[2][3]);
+    TEST_PASS();
+}
+
+TEST(palette_of_empty_image_is_unknown) {
+    ThumbnailPalette palette;
+    memset(&palette, 0xff, sizeof(palette));
+    thumbnail_palette_compute(NULL, 0, 0, 0, &palette);
+    ASSERT_FALSE(thumbnail_palette_known(&palette));
+    ASSERT_EQ(0, palette.colors[0][3]);
+    TEST_PASS();
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                Main Runner                                  */
+/* -------------------------------------------------------------------------- */
+
+int main(void) {
+    TEST_SUITE_BEGIN("Thumbnail Palette Tests");
+
+    RUN_TEST(palette_of_solid_image);
+    RUN_TEST(palette_orders_colors_by_share);
+    RUN_TEST(palette_skips_near_duplicates);
+    RUN_TEST(palette_of_empty_image_is_unknown);
+
+    TEST_SUITE_END();
+    RETURN_TEST_RESULT();
+}
@@ -0,0 +1,200 @@
+/**
+ * @file test_thumbnail_resample.c
+ * @brief Tests for the thumbnail downscaler
+ */
+
+#include "test_framework.h"
+#include "../include/thumbnail_resample.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+static uint8_t* make_image(int height, int pitch, uint32_t seed) {
+    uint8_t *pixels = malloc((size_t)pitch * height);
+    for (int i = 0; i < pitch * height; i++) {
+        seed = seed * 1103515245u + 12345u;
+        pixels[i] = (uint8_t)(seed >> 24);
+    }
+    return pixels;
+}
+
+/* Resize with one instruction set; returns a tightly packed buffer */
+static uint8_t* resample_with(ResampleIsa isa, const uint8_t *src, int sw, int sh, int spitch,
+                              int dw, int dh, ThumbnailFilter filter) {
+    uint8_t *dst = calloc(1, (size_t)dw * dh * 4);
+    thumbnail_resample_force_isa(isa);
+    bool ok = thumbnail_resample(src, sw, sh, spitch, dst, dw, dh, dw * 4, filter);
+    thumbnail_resample_force_isa(RESAMPLE_ISA_COUNT);
+    if (!ok) {
+        free(dst);
+        return NULL;
+    }
+    return dst;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                               Test Cases                                    */
+/* -------------------------------------------------------------------------- */
+
+TEST(resample_parse_filters) {
+    ThumbnailFilter filter;
+
+    ASSERT_TRUE(thumbnail_filter_parse("box", &filter));
+    ASSERT_EQ(THUMBNAIL_FILTER_BOX, filter);
+    ASSERT_TRUE(thumbnail_filter_parse("lanczos", &filter));
+    ASSERT_EQ(THUMBNAIL_FILTER_LANCZOS, filter);
+    ASSERT_FALSE(thumbnail_filter_parse("bicubic", &filter));
+    ASSERT_STR_EQ("lanczos", thumbnail_filter_name(THUMBNAIL_FILTER_LANCZOS));
+    TEST_PASS();
+}
+
+TEST(resample_box_averages_blocks) {
+    // 4x2 -> 2x1: each output is the exact mean of a 2x2 block
+    const uint8_t src[] = {
+        0, 10, 100, 255,    4, 20, 100, 255,    200, 0, 0, 255,   100, 0, 0, 255,
+        8, 30, 100, 255,   12, 40, 100, 255,     50, 0, 0, 255,    50, 0, 0, 255,
+    };
+    uint8_t dst[8];
+
+    ASSERT_TRUE(thumbnail_resample(src, 4, 2, 16, dst, 2, 1, 8, THUMBNAIL_FILTER_BOX));
+    ASSERT_EQ(6, dst[0]);
+    ASSERT_EQ(25, dst[1]);
+    ASSERT_EQ(100, dst[2]);
+    ASSERT_EQ(255, dst[3]);
+    ASSERT_EQ(100, dst[4]);
+    ASSERT_EQ(0, dst[5]);
+    TEST_PASS();
+}
+
+TEST(resample_box_does_not_alias) {
+    // A one-pixel checkerboard shrunk 30x must come out flat grey, not a pattern
+    const int size = 300;
+    uint8_t *src = malloc((size_t)size * size * 4);
+    for (int y = 0; y < size; y++) {
+        for (int x = 0; x < size; x++) {
+            uint8_t v = ((x + y) & 1) ? 255 : 0;
+            uint8_t *p = src + (y * size + x) * 4;
+            p[0] = p[1] = p[2] = v;
+            p[3] = 255;
+        }
+    }
+
+    uint8_t dst[10 * 10 * 4];
+    ASSERT_TRUE(thumbnail_resample(src, size, size, size * 4, dst, 10, 10, 40, THUMBNAIL_FILTER_BOX));
+    for (int i = 0; i < 10 * 10; i++) {
+        ASSERT_TRUE(abs(dst[i * 4] - 128) <= 1);
+        ASSERT_EQ(255, dst[i * 4 + 3]);
+    }
+
+    free(src);
+    TEST_PASS();
+}
+
+TEST(resample_flat_colour_is_preserved) {
+    // Lanczos overshoots on edges, but a flat image must stay exactly flat
+    const int sw = 333, sh = 171;
+    uint8_t *src = malloc((size_t)sw * sh * 4);
+    for (int i = 0; i < sw * sh; i++) {
+        src[i * 4 + 0] = 37;
+        src[i * 4 + 1] = 201;
+        src[i * 4 + 2] = 0;
+        src[i * 4 + 3] = 255;
+    }
+
+    for (int f = 0; f < THUMBNAIL_FILTER_COUNT; f++) {
+        uint8_t *dst = resample_with(thumbnail_resample_isa(), src, sw, sh, sw * 4, 40, 23, (ThumbnailFilter)f);
+        ASSERT_TRUE(dst != NULL);
+        for (int i = 0; i < 40 * 23; i++) {
+            ASSERT_EQ(37, dst[i * 4 + 0]);
+            ASSERT_EQ(201, dst[i * 4 + 1]);
+            ASSERT_EQ(0, dst[i * 4 + 2]);
+            ASSERT_EQ(255, dst[i * 4 + 3]);
+        }
+        free(dst);
+    }
+
+    free(src);
+    TEST_PASS();
+}
+
+TEST(resample_simd_matches_scalar) {
+    // Odd sizes hit every tail loop; include upscales and a near-1:1 resize
+    static const int sizes[][4] = {
+        {640, 480, 200, 150}, {1001, 333, 37, 19}, {97, 61, 13, 9},
+        {50, 40, 200, 150},   {203, 151, 200, 150}, {4000, 30, 7, 30},
+    };
+
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        int sw = sizes[s][0], sh = sizes[s][1], dw = sizes[s][2], dh = sizes[s][3];
+        int spitch = sw * 4 + 12;
+        uint8_t *src = make_image(sh, spitch, (uint32_t)s + 1);
+
+        for (int f = 0; f < THUMBNAIL_FILTER_COUNT; f++) {
+            uint8_t *expected = resample_with(RESAMPLE_ISA_SCALAR, src, sw, sh, spitch, dw, dh, (ThumbnailFilter)f);
+            ASSERT_TRUE(expected != NULL);
+
+            for (int isa = RESAMPLE_ISA_SSE2; isa < RESAMPLE_ISA_COUNT; isa++) {
+                if (!thumbnail_resample_force_isa((ResampleIsa)isa)) {
+                    printf("  (%s not available, skipped)\n", thumbnail_resample_isa_name((ResampleIsa)isa));
+                    continue;
+                }
+                uint8_t *actual = resample_with((ResampleIsa)isa, src, sw, sh, spitch, dw, dh, (ThumbnailFilter)f);
+                ASSERT_TRUE(actual != NULL);
+                ASSERT_TRUE(memcmp(expected, actual, (size_t)dw * dh * 4) == 0);
+                free(actual);
+            }
+            free(expected);
+        }
+        free(src);
+    }
+    TEST_PASS();
+}
+
+TEST(resample_honours_destination_pitch) {
+    const int sw = 64, sh = 48, dw = 9, dh = 7, dpitch = dw * 4 + 20;
+    uint8_t *src = make_image(sh, sw * 4, 99);
+    uint8_t *dst = malloc((size_t)dpitch * dh);
+    memset(dst, 0xAB, (size_t)dpitch * dh);
+
+    ASSERT_TRUE(thumbnail_resample(src, sw, sh, sw * 4, dst, dw, dh, dpitch, THUMBNAIL_FILTER_LANCZOS));
+    for (int y = 0; y < dh; y++) {
+        for (int i = dw * 4; i < dpitch; i++) {
+            ASSERT_EQ(0xAB, dst[y * dpitch + i]);
+        }
+    }
+
+    free(src);
+    free(dst);
+    TEST_PASS();
+}
+
+TEST(resample_rejects_empty_sizes) {
+    uint8_t pixels[16] = {0};
+    ASSERT_FALSE(thumbnail_resample(pixels, 0, 1, 4, pixels, 1, 1, 4, THUMBNAIL_FILTER_BOX));
+    ASSERT_FALSE(thumbnail_resample(pixels, 1, 1, 4, pixels, 1, 0, 4, THUMBNAIL_FILTER_BOX));
+    ASSERT_TRUE(thumbnail_resample_force_isa(RESAMPLE_ISA_SCALAR));
+    ASSERT_EQ(RESAMPLE_ISA_SCALAR, thumbnail_resample_isa());
+    thumbnail_resample_force_isa(RESAMPLE_ISA_COUNT);
+    TEST_PASS();
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                Main Runner                                  */
+/* -------------------------------------------------------------------------- */
+
+int main(void) {
+    TEST_SUITE_BEGIN("Thumbnail Resample Tests");
+
+    printf("Using %s\n", thumbnail_resample_isa_name(thumbnail_resample_isa()));
+
+    RUN_TEST(resample_parse_filters);
+    RUN_TEST(resample_box_averages_blocks);
+    RUN_TEST(resample_box_does_not_alias);
+    RUN_TEST(resample_flat_colour_is_preserved);
+    RUN_TEST(resample_simd_matches_scalar);
+    RUN_TEST(resample_honours_destination_pitch);
+    RUN_TEST(resample_rejects_empty_sizes);
+
+    TEST_SUITE_END();
+    RETURN_TEST_RESULT();
+}
@@ -0,0 +1,112 @@
+/**
+ * @file test_thumbnail_schedule.c
+ * @brief Tests for thumbnail job ordering and cancellation
+ */
+
+#include "test_framework.h"
+#include "../include/thumbnail_schedule.h"
+#include <stdio.h>
+
+#define MS(x) ((uint64_t)(x) * 1000000ull)
+
+/* -------------------------------------------------------------------------- */
+/*                               Test Cases                                    */
+/* -------------------------------------------------------------------------- */
+
+TEST(schedule_inactive_is_fifo) {
+    ThumbnailSchedule s;
+    thumbnail_schedule_init(&s);
+
+    // Before the first update every job scores the same and none are dropped
+    ASSERT_EQ(0, (int)thumbnail_schedule_score(&s, 0));
+    ASSERT_EQ(0, (int)thumbnail_schedule_score(&s, 5000));
+    ASSERT_TRUE(thumbnail_schedule_keep(&s, -3));
+    ASSERT_TRUE(thumbnail_schedule_keep(&s, 5000));
+    TEST_PASS();
+}
+
+TEST(schedule_focus_scores_lowest) {
+    ThumbnailSchedule s;
+    thumbnail_schedule_init(&s);
+    thumbnail_schedule_update(&s, 40, 0, 100, MS(1000));
+
+    ASSERT_EQ(0, (int)thumbnail_schedule_score(&s, 40));
+    ASSERT_TRUE(thumbnail_schedule_score(&s, 41) > 0);
+    ASSERT_TRUE(thumbnail_schedule_score(&s, 39) > 0);
+
+    // Standing still, both sides count the same
+    ASSERT_EQ(thumbnail_schedule_score(&s, 45), thumbnail_schedule_score(&s, 35));
+    ASSERT_TRUE(thumbnail_schedule_score(&s, 42) < thumbnail_schedule_score(&s, 43));
+    TEST_PASS();
+}
+
+TEST(schedule_prefers_direction_of_travel) {
+    ThumbnailSchedule s;
+    thumbnail_schedule_init(&s);
+
+    // Holding right: one step every 50 ms
+    uint64_t now = MS(1000);
+    for (int focus = 10; focus <= 20; focus++) {
+        thumbnail_schedule_update(&s, focus, 0, 100, now);
+        now += MS(50);
+    }
+    ASSERT_TRUE(s.velocity > 10.0f);
+
+    ASSERT_EQ(0, (int)thumbnail_schedule_score(&s, 20));
+    ASSERT_TRUE(thumbnail_schedule_score(&s, 25) < thumbnail_schedule_score(&s, 17));
+    ASSERT_TRUE(thumbnail_schedule_score(&s, 21) < thumbnail_schedule_score(&s, 19));
+
+    // Reversing flips the preference straight away
+    thumbnail_schedule_update(&s, 19, 0, 100, now);
+    ASSERT_TRUE(s.velocity < 0.0f);
+    ASSERT_TRUE(thumbnail_schedule_score(&s, 17) < thumbnail_schedule_score(&s, 21));
+    TEST_PASS();
+}
+
+TEST(schedule_velocity_decays_when_idle) {
+    ThumbnailSchedule s;
+    thumbnail_schedule_init(&s);
+    thumbnail_schedule_update(&s, 0, 0, 50, MS(1000));
+    thumbnail_schedule_update(&s, 1, 0, 50, MS(1100));
+    ASSERT_TRUE(s.velocity > 0.0f);
+
+    // Still moving shortly after the last step
+    thumbnail_schedule_update(&s, 1, 0, 50, MS(1200));
+    ASSERT_TRUE(s.velocity > 0.0f);
+
+    // Stopped: both sides are equal again
+    thumbnail_schedule_update(&s, 1, 0, 50, MS(2000));
+    ASSERT_TRUE(s.velocity == 0.0f);
+    ASSERT_EQ(thumbnail_schedule_score(&s, 4), thumbnail_schedule_score(&s, -2));
+    TEST_PASS();
+}
+
+TEST(schedule_keeps_only_wanted_range) {
+    ThumbnailSchedule s;
+    thumbnail_schedule_init(&s);
+    thumbnail_schedule_update(&s, 100, 80, 130, MS(1000));
+
+    ASSERT_TRUE(thumbnail_schedule_keep(&s, 80));
+    ASSERT_TRUE(thumbnail_schedule_keep(&s, 129));
+    ASSERT_FALSE(thumbnail_schedule_keep(&s, 79));
+    ASSERT_FALSE(thumbnail_schedule_keep(&s, 130));
+    ASSERT_FALSE(thumbnail_schedule_keep(&s, 0));
+    TEST_PASS();
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                Main Runner                                  */
+/* -------------------------------------------------------------------------- */
+
+int main(void) {
+    TEST_SUITE_BEGIN("Thumbnail Schedule Tests");
+
+    RUN_TEST(schedule_inactive_is_fifo);
+    RUN_TEST(schedule_focus_scores_lowest);
+    RUN_TEST(schedule_prefers_direction_of_travel);
+    RUN_TEST(schedule_velocity_decays_when_idle);
+    RUN_TEST(schedule_keeps_only_wanted_range);
+
+    TEST_SUITE_END();
+    RETURN_TEST_RESULT();
+}
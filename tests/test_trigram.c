@@ -0,0 +1,159 @@
+/**
+ * @file test_trigram.c
+ * @brief Tests for the trigram substring index
+ */
+
+#define _GNU_SOURCE
+#include "test_framework.h"
+#include "../include/trigram.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+static const char *sample_texts[] = {
+    "Mountain_Lake.jpg",
+    "city/night.png",
+    "mountain/sunrise.JPG",
+    "forest.png",
+    "city/lights.bmp",
+    "lakeside.webp",
+    "ab",
+};
+#define SAMPLE_COUNT ((int)(sizeof(sample_texts) / sizeof(sample_texts[0])))
+
+/* Every text containing the query must be a candidate */
+static bool covers_matches(const char *const *texts, int count, const char *query,
+                           const uint32_t *candidates, int candidate_count) {
+    int c = 0;
+    for (int i = 0; i < count; i++) {
+        if (!strcasestr(texts[i], query)) continue;
+        while (c < candidate_count && candidates[c] < (uint32_t)i) c++;
+        if (c >= candidate_count || candidates[c] != (uint32_t)i) return false;
+    }
+    return true;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                               Test Cases                                    */
+/* -------------------------------------------------------------------------- */
+
+TEST(trigram_candidates_cover_matches) {
+    TrigramIndex index;
+    trigram_index_init(&index);
+    ASSERT_TRUE(trigram_index_build(&index, sample_texts, SAMPLE_COUNT));
+
+    const char *queries[] = {"mountain", "lake", "city/", "png", "zzz", "e.j"};
+    uint32_t candidates[SAMPLE_COUNT];
+    for (int q = 0; q < 6; q++) {
+        size_t len = strlen(queries[q]);
+        int count = trigram_index_candidates(&index, queries[q], len, candidates);
+        ASSERT_TRUE(count <= (int)trigram_index_estimate(&index, queries[q], len));
+        ASSERT_TRUE(covers_matches(sample_texts, SAMPLE_COUNT, queries[q], candidates, count));
+        for (int i = 1; i < count; i++) {
+            ASSERT_TRUE(candidates[i - 1] < candidates[i]);
+        }
+    }
+
+    // Upper case in the texts is folded
+    int count = trigram_index_candidates(&index, "mountain", 8, candidates);
+    ASSERT_EQ(2, count);
+    ASSERT_EQ(0u, candidates[0]);
+    ASSERT_EQ(2u, candidates[1]);
+
+    ASSERT_EQ(0, trigram_index_candidates(&index, "zzz", 3, candidates));
+    ASSERT_EQ(0u, trigram_index_estimate(&index, "zzz", 3));
+
+    trigram_index_free(&index);
+    TEST_PASS();
+}
+
+TEST(trigram_repeated_trigram_listed_once) {
+    const char *texts[] = {"aaaaaa", "xaaax", "aab"};
+    TrigramIndex index;
+    trigram_index_init(&index);
+    ASSERT_TRUE(trigram_index_build(&index, texts, 3));
+
+    uint32_t candidates[3];
+    ASSERT_EQ(2u, trigram_index_estimate(&index, "aaa", 3));
+    ASSERT_EQ(2, trigram_index_candidates(&index, "aaaa", 4, candidates));
+    ASSERT_EQ(0u, candidates[0]);
+    ASSERT_EQ(1u, candidates[1]);
+
+    trigram_index_free(&index);
+    TEST_PASS();
+}
+
+TEST(trigram_append_matches_single_build) {
+    TrigramIndex first, second, whole;
+    trigram_index_init(&first);
+    trigram_index_init(&second);
+    trigram_index_init(&whole);
+    ASSERT_TRUE(trigram_index_build(&first, sample_texts, 3));
+    ASSERT_TRUE(trigram_index_build(&second, sample_texts + 3, SAMPLE_COUNT - 3));
+    ASSERT_TRUE(trigram_index_build(&whole, sample_texts, SAMPLE_COUNT));
+
+    ASSERT_TRUE(trigram_index_append(&first, &second, 3));
+    ASSERT_EQ(whole.key_count, first.key_count);
+    ASSERT_EQ(whole.posting_count, first.posting_count);
+    ASSERT_TRUE(memcmp(whole.keys, first.keys, sizeof(uint32_t) * whole.key_count) == 0);
+    ASSERT_TRUE(memcmp(whole.starts, first.starts, sizeof(uint32_t) * (whole.key_count + 1)) == 0);
+    ASSERT_TRUE(memcmp(whole.postings, first.postings, sizeof(uint32_t) * whole.posting_count) == 0);
+
+    // Appending to an empty index copies the other one
+    TrigramIndex empty;
+    trigram_index_init(&empty);
+    ASSERT_TRUE(trigram_index_append(&empty, &whole, 0));
+    ASSERT_EQ(whole.posting_count, empty.posting_count);
+
+    trigram_index_free(&first);
+    trigram_index_free(&second);
+    trigram_index_free(&whole);
+    trigram_index_free(&empty);
+    TEST_PASS();
+}
+
+TEST(trigram_intersection_of_long_lists) {
+    // Every text has "abc"; every third has "xyz" too, so galloping skips ahead
+    enum { COUNT = 3000 };
+    char (*storage)[16] = malloc(sizeof(*storage) * COUNT);
+    const char **texts = malloc(sizeof(char*) * COUNT);
+    ASSERT_TRUE(storage && texts);
+    for (int i = 0; i < COUNT; i++) {
+        snprintf(storage[i], sizeof(storage[i]), i % 3 == 0 ? "abcxyz%d" : "abc%d", i);
+        texts[i] = storage[i];
+    }
+
+    TrigramIndex index;
+    trigram_index_init(&index);
+    ASSERT_TRUE(trigram_index_build(&index, texts, COUNT));
+
+    uint32_t *candidates = malloc(sizeof(uint32_t) * COUNT);
+    int count = trigram_index_candidates(&index, "abcxyz", 6, candidates);
+    ASSERT_EQ(COUNT / 3, count);
+    for (int i = 0; i < count; i++) {
+        ASSERT_EQ((uint32_t)i * 3, candidates[i]);
+    }
+
+    free(candidates);
+    trigram_index_free(&index);
+    free(texts);
+    free(storage);
+    TEST_PASS();
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                Main Runner                                  */
+/* -------------------------------------------------------------------------- */
+
+int main(void) {
+    TEST_SUITE_BEGIN("Trigram Tests");
+
+    RUN_TEST(trigram_candidates_cover_matches);
+    RUN_TEST(trigram_repeated_trigram_listed_once);
+    RUN_TEST(trigram_append_matches_single_build);
+    RUN_TEST(trigram_intersection_of_long_lists);
+
+    TEST_SUITE_END();
+    RETURN_TEST_RESULT();
+}